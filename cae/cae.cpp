@@ -42,14 +42,19 @@
 #include <rddb.h>
 #include <rdescape_string.h>
 #include <rd.h>
+#include <rdpeakpyramid.h>
+#include <rdprofile.h>
 #include <rdsocket.h>
 #include <rdsvc.h>
 #include <rdsystem.h>
 
 #include "cae.h"
+#include "decoder_mpeg.h"
 #include "driver_alsa.h"
 #include "driver_hpi.h"
 #include "driver_jack.h"
+#include "driver_null.h"
+#include "mixbus.h"
 
 volatile bool exiting=false;
 
@@ -106,7 +111,6 @@ MainObject::MainObject(QObject *parent)
   //
   debug=false;
   twolame_handle=NULL;
-  mad_handle=NULL;
   if(qApp->arguments().size()>1) {
     for(int i=1;i<qApp->arguments().size();i++) {
       if(qApp->arguments().at(i)=="-d") {
@@ -119,18 +123,9 @@ MainObject::MainObject(QObject *parent)
       record_length[i][j]=0;
       record_threshold[i][j]=-10000;
       record_owner[i][j]=-1;
-      play_length[i][j]=0;
-      play_speed[i][j]=100;
-      play_pitch[i][j]=false;
-      for(int k=0;k<RD_MAX_PORTS;k++) {
-	output_status_flag[i][k][j]=false;
-      }
 #ifdef HAVE_TWOLAME
       twolame_lameopts[i][j]=NULL;
 #endif  // HAVE_TWOLAME
-#ifdef HAVE_MAD
-      mad_active[i][j]=false;
-#endif  // HAVE_MAD
     }
   }
 
@@ -156,6 +151,19 @@ MainObject::MainObject(QObject *parent)
 	  this,SLOT(playData(uint64_t,unsigned,unsigned,unsigned)));
   connect(cae_server,SIGNAL(stopPlaybackReq(uint64_t)),
 	  this,SLOT(stopPlaybackData(uint64_t)));
+  connect(cae_server,
+	  SIGNAL(playAtReq(uint64_t,uint64_t,unsigned,unsigned,unsigned)),
+	  this,
+	  SLOT(playAtData(uint64_t,uint64_t,unsigned,unsigned,unsigned)));
+  connect(cae_server,SIGNAL(stopPlaybackAtReq(uint64_t,uint64_t)),
+	  this,SLOT(stopPlaybackAtData(uint64_t,uint64_t)));
+  connect(cae_server,
+	  SIGNAL(fadeOutputVolumeAtReq(uint64_t,uint64_t,int,unsigned)),
+	  this,SLOT(fadeOutputVolumeAtData(uint64_t,uint64_t,int,unsigned)));
+  connect(cae_server,SIGNAL(sampleClockReq(int,unsigned)),
+	  this,SLOT(sampleClockData(int,unsigned)));
+  connect(cae_server,SIGNAL(streamStatusReq(uint64_t)),
+	  this,SLOT(streamStatusData(uint64_t)));
   connect(cae_server,SIGNAL(timescalingSupportReq(int,unsigned)),
 	  this,SLOT(timescalingSupportData(int,unsigned)));
   connect(cae_server,
@@ -190,6 +198,8 @@ MainObject::MainObject(QObject *parent)
 	  this,SLOT(setInputTypeData(int,unsigned,unsigned,unsigned)));
   connect(cae_server,SIGNAL(getInputStatusReq(int,unsigned,unsigned)),
 	  this,SLOT(getInputStatusData(int,unsigned,unsigned)));
+  connect(cae_server,SIGNAL(getOutputSilenceReq(int,unsigned,unsigned)),
+	  this,SLOT(getOutputSilenceData(int,unsigned,unsigned)));
   connect(cae_server,
 	SIGNAL(setAudioPassthroughLevelReq(int,unsigned,unsigned,unsigned,int)),
 	  this,
@@ -209,6 +219,17 @@ MainObject::MainObject(QObject *parent)
   // Meter Socket
   //
   meter_socket=new QUdpSocket(this);
+  meter_sequence=0;
+
+  //
+  // Meter Segment (for clients on this host)
+  //
+  meter_shm=new RDMeterShm();
+  if(!meter_shm->create(&err_msg)) {
+    rda->syslog(LOG_WARNING,"%s, local clients will use UDP metering",
+		err_msg.toUtf8().constData());
+  }
+  cae_server->setSharedMetersAvailable(meter_shm->isValid());
 
   //
   // Provisioning
@@ -222,9 +243,11 @@ MainObject::MainObject(QObject *parent)
   system_sample_rate=rda->system()->sampleRate();
   ClearDriverEntries();
   unsigned next_card=0;
+  MixBusInit();
   MakeDriver(&next_card,RDStation::Hpi);
   MakeDriver(&next_card,RDStation::Alsa);
   MakeDriver(&next_card,RDStation::Jack);
+  MakeDriver(&next_card,RDStation::Null);
 
   //
   // Probe Capabilities
@@ -241,6 +264,11 @@ MainObject::MainObject(QObject *parent)
   //
   InitMixers();
 
+  //
+  // Dead Air Detection
+  //
+  InitSilenceSense();
+
   //
   // Meter Update Timer
   //
@@ -248,6 +276,18 @@ MainObject::MainObject(QObject *parent)
   connect(timer,SIGNAL(timeout()),this,SLOT(updateMeters()));
   timer->start(RD_METER_UPDATE_INTERVAL);
 
+  //
+  // Statistics Timer
+  //
+  for(int i=0;i<RD_MAX_CARDS;i++) {
+    stats_xruns[i]=0;
+  }
+  if(rda->config()->caeStatisticsInterval()>0) {
+    timer=new QTimer(this);
+    connect(timer,SIGNAL(timeout()),this,SLOT(statisticsData()));
+    timer->start(1000*rda->config()->caeStatisticsInterval());
+  }
+
   //
   // Initialize Thread Priorities
   //
@@ -462,6 +502,8 @@ void MainObject::playData(uint64_t phandle,unsigned length,unsigned speed,
     else {
       psess->setLength(length);
       psess->setSpeed(speed);
+      dvr->streamStats(psess->cardNumber(),psess->streamNumber())->
+	startLatency();
       if(!dvr->play(psess->cardNumber(),psess->streamNumber(),psess->length(),
 		    psess->speed(),false,RD_ALLOW_NONSTANDARD_RATES)) {
 	cae_server->
@@ -513,6 +555,201 @@ void MainObject::stopPlaybackData(uint64_t phandle)
 }
 
 
+void MainObject::playAtData(uint64_t phandle,uint64_t clock,unsigned length,
+			    unsigned speed,unsigned pitch_flag)
+{
+  PlaySession *psess=play_sessions.value(phandle);
+  unsigned serial=PlaySession::serialNumber(phandle);
+  QString echo=QString::asprintf("PA %u %llu %u %u %u",serial,
+				 (unsigned long long)clock,length,
+				 speed,pitch_flag);
+
+  if(psess==NULL) {
+    cae_server->sendCommand(phandle,echo+" -!");
+    rda->syslog(LOG_WARNING,
+		"attempted to play non-existent session, serial:%u",serial);
+    return;
+  }
+  Driver *dvr=GetDriver(psess->cardNumber());
+  if(dvr==NULL) {
+    cae_server->sendCommand(phandle,echo+" -!");
+    rda->syslog(LOG_WARNING,
+		"attempted to access non-existent card, serial: %u card: %u",
+		serial,psess->cardNumber());
+    return;
+  }
+  psess->setLength(length);
+  psess->setSpeed(speed);
+  if(!dvr->playAt(psess->cardNumber(),psess->streamNumber(),clock,
+		  psess->length(),psess->speed(),false,
+		  RD_ALLOW_NONSTANDARD_RATES)) {
+    cae_server->sendCommand(phandle,echo+" -!");
+    return;
+  }
+  rda->syslog(LOG_INFO,
+	      "PlayAt - Card: %d  Stream: %d  Serial: %d  Clock: %llu  Length: %d  Speed: %d  Pitch: %d",
+	      psess->cardNumber(),psess->streamNumber(),serial,
+	      (unsigned long long)clock,psess->length(),psess->speed(),
+	      pitch_flag);
+  // No command echo for success -- statePlayUpdate() sends it at the start!
+}
+
+
+void MainObject::stopPlaybackAtData(uint64_t phandle,uint64_t clock)
+{
+  PlaySession *psess=play_sessions.value(phandle);
+  unsigned serial=PlaySession::serialNumber(phandle);
+
+  if(psess==NULL) {
+    cae_server->
+      sendCommand(phandle,QString::asprintf("SA %u %llu -!",serial,
+					     (unsigned long long)clock));
+    rda->syslog(LOG_WARNING,
+		"attempted to stop non-existent session, serial: %u",serial);
+    return;
+  }
+  Driver *dvr=GetDriver(psess->cardNumber());
+  if(dvr==NULL) {
+    cae_server->
+      sendCommand(phandle,QString::asprintf("SA %u %llu -!",serial,
+					     (unsigned long long)clock));
+    rda->syslog(LOG_WARNING,
+		"attempted to access non-existent card, serial: %u card: %u",
+		serial,psess->cardNumber());
+    return;
+  }
+  if(!dvr->stopPlaybackAt(psess->cardNumber(),psess->streamNumber(),clock)) {
+    cae_server->
+      sendCommand(phandle,QString::asprintf("SA %u %llu -!",serial,
+					     (unsigned long long)clock));
+    return;
+  }
+  rda->syslog(LOG_INFO,
+	      "StopPlaybackAt - Card: %d  Stream: %d  Serial: %d  Clock: %llu",
+	      psess->cardNumber(),psess->streamNumber(),serial,
+	      (unsigned long long)clock);
+  // No command echo for success -- statePlayUpdate() sends it at the stop!
+}
+
+
+void MainObject::fadeOutputVolumeAtData(uint64_t phandle,uint64_t clock,
+					int level,unsigned length)
+{
+  PlaySession *psess=play_sessions.value(phandle);
+  unsigned serial=PlaySession::serialNumber(phandle);
+  QString echo=
+    QString::asprintf("FA %u %llu %d %u",serial,(unsigned long long)clock,
+		      level,length);
+
+  if(psess==NULL) {
+    cae_server->sendCommand(phandle,echo+" -!");
+    rda->syslog(LOG_WARNING,
+		"attempted to operate non-existent session, serial: %u",serial);
+    return;
+  }
+  Driver *dvr=GetDriver(psess->cardNumber());
+  if(dvr==NULL) {
+    cae_server->sendCommand(phandle,echo+" -!");
+    rda->syslog(LOG_WARNING,
+		"attempted to access non-existent card, serial: %u card: %u",
+		serial,psess->cardNumber());
+    return;
+  }
+  if(!rda->config()->testOutputStreams()) {
+    if(!dvr->fadeOutputVolumeAt(psess->cardNumber(),psess->streamNumber(),
+				psess->portNumber(),level,length,clock)) {
+      cae_server->sendCommand(phandle,echo+" -!");
+      return;
+    }
+    if(rda->config()->enableMixerLogging()) {
+      rda->syslog(LOG_INFO,
+		  "[mixer] FadeOutputVolumeAt - Serial: %u  Card: %d  Stream: %d  Port: %d  Clock: %llu  Level: %d  Length: %d",
+		  serial,psess->cardNumber(),psess->streamNumber(),
+		  psess->portNumber(),(unsigned long long)clock,level,length);
+    }
+  }
+  cae_server->sendCommand(phandle,echo+" +!");
+}
+
+
+void MainObject::sampleClockData(int id,unsigned card)
+{
+  uint64_t clock=0;
+  unsigned samprate=0;
+  Driver *dvr=GetDriver(card);
+
+  if((dvr==NULL)||(!dvr->getSampleClock(card,&clock,&samprate))) {
+    cae_server->sendCommand(id,QString::asprintf("CK %u -!",card));
+    return;
+  }
+  cae_server->
+    sendCommand(id,QString::asprintf("CK %u %llu %u +!",card,
+				     (unsigned long long)clock,samprate));
+}
+
+
+void MainObject::streamStatusData(uint64_t phandle)
+{
+  PlaySession *psess=play_sessions.value(phandle);
+  unsigned serial=PlaySession::serialNumber(phandle);
+  Driver *dvr=NULL;
+
+  if((psess==NULL)||((dvr=GetDriver(psess->cardNumber()))==NULL)) {
+    cae_server->sendCommand(phandle,QString::asprintf("ST %u -!",serial));
+    return;
+  }
+  StreamStats *stats=
+    dvr->streamStats(psess->cardNumber(),psess->streamNumber());
+  cae_server->
+    sendCommand(phandle,
+		QString::asprintf("ST %u %u %u %u %d %d %u %d %d %d +!",
+				  serial,psess->cardNumber(),
+				  dvr->xruns(psess->cardNumber()),
+				  stats->underruns(),
+				  stats->fillLow(),stats->fillHigh(),
+				  stats->refills(),stats->refillAverage(),
+				  stats->refillMax(),stats->latency()));
+}
+
+
+void MainObject::statisticsData()
+{
+  //
+  // Periodic summary of playout health, one line per card
+  //
+  for(int i=0;i<RD_MAX_CARDS;i++) {
+    Driver *dvr=GetDriver(i);
+    if(dvr==NULL) {
+      continue;
+    }
+    unsigned xruns=dvr->xruns(i);
+    unsigned streams=0;
+    unsigned underruns=0;
+    int fill_low=-1;
+    int refill_max=-1;
+    for(QMap<uint64_t,PlaySession *>::const_iterator it=
+	  play_sessions.begin();it!=play_sessions.end();it++) {
+      if(it.value()->cardNumber()==(unsigned)i) {
+	StreamStats *stats=dvr->streamStats(i,it.value()->streamNumber());
+	streams++;
+	underruns+=stats->underruns();
+	if((stats->fillLow()>=0)&&
+	   ((fill_low<0)||(stats->fillLow()<fill_low))) {
+	  fill_low=stats->fillLow();
+	}
+	if(stats->refillMax()>refill_max) {
+	  refill_max=stats->refillMax();
+	}
+      }
+    }
+    rda->syslog(LOG_INFO,
+		"statistics - Card: %d  Xruns: %u  Streams: %u  Underruns: %u  Lowest Fill: %dms  Longest Refill: %dus",
+		i,xruns-stats_xruns[i],streams,underruns,fill_low,refill_max);
+    stats_xruns[i]=xruns;
+  }
+}
+
+
 void MainObject::timescalingSupportData(int id,unsigned card)
 {
   bool state=false;
@@ -550,6 +787,7 @@ void MainObject::loadRecordingData(int id,unsigned card,unsigned port,
     wavename=rda->config()->audioFileName(name);
     unlink(wavename.toUtf8());  // So we don't trainwreck any current playouts!
     unlink((wavename+".energy").toUtf8());
+    unlink(RDPeakPyramid::sidecarName(wavename).toUtf8());
     if(!dvr->loadRecord(card,port,coding,channels,samprate,bitrate,wavename)) {
       cae_server->
 	sendCommand(id,QString::asprintf("LR %u %u %u %u %u %u %s -!",
@@ -944,6 +1182,18 @@ void MainObject::getInputStatusData(int id,unsigned card,unsigned port)
 }
 
 
+void MainObject::getOutputSilenceData(int id,unsigned card,unsigned port)
+{
+  Driver *dvr=GetDriver(card);
+
+  if(dvr==NULL) {
+    return;
+  }
+  cae_server->sendCommand(id,QString::asprintf("OS %d %d %d +!",card,port,
+			       dvr->silenceSense(card,port)->isSilent()));
+}
+
+
 void MainObject::setAudioPassthroughLevelData(int id,unsigned card,
 					      unsigned input,unsigned output,
 					      int level)
@@ -1056,6 +1306,10 @@ void MainObject::statePlayUpdate(int card,int stream,int state)
     cae_server->
       sendCommand(phandle,QString::asprintf("SP %d +!",serial).toUtf8());
     break;
+
+  case 3:   // Fade Complete
+    cae_server->sendCommand(phandle,QString::asprintf("FC %u +!",serial));
+    break;
   }
 }
 
@@ -1092,12 +1346,20 @@ void MainObject::stateRecordUpdate(int card,int stream,int state)
 void MainObject::updateMeters()
 {
   short levels[2];
-  unsigned positions[RD_MAX_STREAMS];
+  unsigned positions[RD_MAX_CAE_STREAMS];
+  short stream_levels[RD_MAX_CAE_STREAMS][2];
+  short lufs[3];
+  bool loudness=false;
+  LoudnessMeter *meter=NULL;
+  RDMeterFrame frame;
+  RDMeterShmData shm;
+  PlaySession *psess=NULL;
 
   if(exiting) {
     for(int i=0;i<d_drivers.size();i++) {
       delete d_drivers.at(i);
     }
+    delete meter_shm;
     rda->syslog(LOG_INFO,"cae exiting");
     exit(0);
   }
@@ -1109,9 +1371,16 @@ void MainObject::updateMeters()
     d_drivers.at(i)->processBuffers();
   }
 
+  meter_sequence++;
+
+  //
+  // Loudness values only change once per 100 ms sub-block
+  //
+  loudness=(meter_sequence%(100/RD_METER_UPDATE_INTERVAL))==0;
   for(int i=0;i<RD_MAX_CARDS;i++) {
     Driver *dvr=GetDriver(i);
     if(dvr!=NULL) {
+      frame.clear(i,meter_sequence);
       for(int j=0;j<RD_MAX_PORTS;j++) {
 
 	//
@@ -1127,15 +1396,41 @@ void MainObject::updateMeters()
 	  }
 	}
 
+	//
+	// Output Port Silence
+	//
+	if(dvr->silenceSense(i,j)->isSilent()!=silence_status[i][j]) {
+	  silence_status[i][j]=dvr->silenceSense(i,j)->isSilent();
+	  if(silence_status[i][j]) {
+	    rda->syslog(LOG_NOTICE,"silence detected on card %d port %d",i,j);
+	  }
+	  else {
+	    rda->syslog(LOG_NOTICE,"audio restored on card %d port %d",i,j);
+	  }
+	  cae_server->sendCommand(QString::asprintf("OS %d %d %d!",i,j,
+						    silence_status[i][j]));
+	}
+
 	//
 	// Port Meters
 	//
 	if(dvr->getInputMeters(i,j,levels)) {
 	  SendMeterLevelUpdate("I",i,j,levels);
+	  frame.setInputLevels(j,levels);
 	}
 	if(dvr->getOutputMeters(i,j,levels)) {
 	  SendMeterLevelUpdate("O",i,j,levels);
+	  frame.setOutputLevels(j,levels);
 	}      
+
+	//
+	// Port Loudness
+	//
+	if(loudness&&(j<dvr->outputPortQuantity(i))&&
+	   ((meter=dvr->outputLoudness(i,j))!=NULL)) {
+	  meter->getLoudness(lufs);
+	  SendLoudnessUpdate("O",i,j,lufs);
+	}
       }
 
       //
@@ -1147,6 +1442,10 @@ void MainObject::updateMeters()
       //
       // Output Stream Meters
       //
+      for(int j=0;j<dvr->maxStreams();j++) {
+	stream_levels[j][0]=RD_MUTE_DEPTH;
+	stream_levels[j][1]=RD_MUTE_DEPTH;
+      }
       for(QMap<uint64_t,PlaySession *>::const_iterator it=play_sessions.begin();
 	  it!=play_sessions.end();it++) {
 	if((int)it.value()->cardNumber()==i) {
@@ -1154,8 +1453,53 @@ void MainObject::updateMeters()
 					it.value()->streamNumber(),
 					levels)) {
 	    SendStreamMeterLevelUpdate(it.value(),levels);
+	    stream_levels[it.value()->streamNumber()][0]=levels[0];
+	    stream_levels[it.value()->streamNumber()][1]=levels[1];
+	  }
+	  if(loudness&&((meter=dvr->streamLoudness(i,it.value()->
+						   streamNumber()))!=NULL)) {
+	    meter->getLoudness(lufs);
+	    SendStreamLoudnessUpdate(it.value(),lufs);
+	  }
+	}
+      }
+
+      //
+      // Binary Meter Frames
+      //
+      SendMeterFrames(frame,stream_levels,positions);
+
+      //
+      // Meter Segment
+      //
+      if(meter_shm->isValid()) {
+	memset(&shm,0,sizeof(shm));
+	for(int j=0;j<RD_MAX_PORTS;j++) {
+	  if(frame.inputLevels(j,levels)) {
+	    shm.input_mask|=1u<<j;
+	    shm.input_levels[j][0]=levels[0];
+	    shm.input_levels[j][1]=levels[1];
+	  }
+	  if(frame.outputLevels(j,levels)) {
+	    shm.output_mask|=1u<<j;
+	    shm.output_levels[j][0]=levels[0];
+	    shm.output_levels[j][1]=levels[1];
+	  }
+	}
+	for(QMap<uint64_t,PlaySession *>::const_iterator it=
+	      play_sessions.begin();it!=play_sessions.end();it++) {
+	  psess=it.value();
+	  if((int)psess->cardNumber()==i) {
+	    int j=psess->streamNumber();
+	    shm.streams[j].owner=
+	      cae_server->meterPort(psess->socketDescriptor());
+	    shm.streams[j].serial=psess->serialNumber();
+	    shm.streams[j].levels[0]=stream_levels[j][0];
+	    shm.streams[j].levels[1]=stream_levels[j][1];
+	    shm.streams[j].position=positions[j];
 	  }
 	}
+	meter_shm->write(i,&shm);
       }
     }
   }
@@ -1256,6 +1600,82 @@ void MainObject::InitMixers()
 }
 
 
+void MainObject::InitSilenceSense()
+{
+  Driver *dvr=NULL;
+  int card;
+  int port;
+  int threshold;
+  int duration;
+  int hysteresis;
+  bool card_ok=false;
+  bool port_ok=false;
+  int count=1;
+  RDProfile *profile=new RDProfile();
+
+  for(int i=0;i<RD_MAX_CARDS;i++) {
+    for(int j=0;j<RD_MAX_PORTS;j++) {
+      silence_status[i][j]=false;
+    }
+  }
+
+  //
+  // Ports to watch are listed in rd.conf(5) as numbered entries, starting
+  // from 'Card1' and 'Port1'
+  //
+  profile->setSource(RD_CONF_FILE);
+  card=profile->intValue("SilenceSense",QString::asprintf("Card%d",count),
+			 -1,&card_ok);
+  port=profile->intValue("SilenceSense",QString::asprintf("Port%d",count),
+			 -1,&port_ok);
+  while(card_ok&&port_ok) {
+    threshold=profile->
+      intValue("SilenceSense",QString::asprintf("Threshold%d",count),
+	       SILENCESENSE_DEFAULT_THRESHOLD);
+    duration=profile->
+      intValue("SilenceSense",QString::asprintf("Duration%d",count),
+	       SILENCESENSE_DEFAULT_DURATION);
+    hysteresis=profile->
+      intValue("SilenceSense",QString::asprintf("Hysteresis%d",count),
+	       SILENCESENSE_DEFAULT_HYSTERESIS);
+    if((card<0)||(card>=RD_MAX_CARDS)||(port<0)||(port>=RD_MAX_PORTS)||
+       ((dvr=GetDriver(card))==NULL)) {
+      rda->syslog(LOG_WARNING,
+		  "[SilenceSense] entry %d: no such card/port %d:%d",
+		  count,card,port);
+    }
+    else {
+      if(dvr->driverType()==RDStation::Hpi) {
+	rda->syslog(LOG_WARNING,
+		    "[SilenceSense] entry %d: not supported on HPI cards",
+		    count);
+      }
+      else {
+	if(duration<0) {
+	  duration=0;
+	}
+	if(hysteresis<0) {
+	  hysteresis=0;
+	}
+	dvr->silenceSense(card,port)->
+	  setParameters(threshold,
+			(uint64_t)duration*system_sample_rate/1000,
+			hysteresis);
+	rda->syslog(LOG_INFO,
+		    "watching card %d port %d for silence below %d.%02d dBFS",
+		    card,port,threshold/100,abs(threshold%100));
+      }
+    }
+    count++;
+    card=profile->intValue("SilenceSense",QString::asprintf("Card%d",count),
+			   -1,&card_ok);
+    port=profile->intValue("SilenceSense",QString::asprintf("Port%d",count),
+			   -1,&port_ok);
+  }
+  delete profile;
+}
+
+
 void MainObject::KillSocket(int sock)
 {
   for(int i=0;i<RD_MAX_CARDS;i++) {
@@ -1364,7 +1784,7 @@ void MainObject::ProbeCaps(RDStation *station)
   //
   station->setHaveCapability(RDStation::HaveLame,CheckLame());
   station->setHaveCapability(RDStation::HaveTwoLame,LoadTwoLame());
-  station->setHaveCapability(RDStation::HaveMpg321,LoadMad());
+  station->setHaveCapability(RDStation::HaveMpg321,CaeDecoderMpeg::load());
 
   //
   // MP4 Decoder
@@ -1496,98 +1916,67 @@ void MainObject::FreeTwoLameEncoder(int card,int stream)
 }
 
 
-bool MainObject::LoadMad()
+void MainObject::SendMeterLevelUpdate(const QString &type,int cardnum,
+				      int portnum,short levels[])
 {
-#ifdef HAVE_MAD
-  if((mad_handle=dlopen("libmad.so.0",RTLD_LAZY))==NULL) {
-    rda->syslog(LOG_INFO,
-	   "MAD decoder library not found, MPEG L2 decoding not supported");
-    return false;
+  QList<int> ids=cae_server->connectionIds();
+
+  for(int l=0;l<ids.size();l++) {
+    if((cae_server->meterPort(ids.at(l))>0)&&
+       (cae_server->meterVersion(ids.at(l))==0)&&
+       cae_server->metersEnabled(ids.at(l),cardnum)) {
+      SendMeterUpdate(QString::asprintf("ML %s %d %d %d %d",
+					type.toUtf8().constData(),
+					cardnum,portnum,levels[0],levels[1]),
+		      ids.at(l));
+    }
   }
-  *(void **)(&mad_stream_init)=
-    dlsym(mad_handle,"mad_stream_init");
-  *(void **)(&mad_frame_init)=
-    dlsym(mad_handle,"mad_frame_init");
-  *(void **)(&mad_synth_init)=
-    dlsym(mad_handle,"mad_synth_init");
-  *(void **)(&mad_stream_buffer)=
-    dlsym(mad_handle,"mad_stream_buffer");
-  *(void **)(&mad_frame_decode)=
-    dlsym(mad_handle,"mad_frame_decode");
-  *(void **)(&mad_synth_frame)=
-    dlsym(mad_handle,"mad_synth_frame");
-  *(void **)(&mad_frame_finish)=
-    dlsym(mad_handle,"mad_frame_finish");
-  *(void **)(&mad_stream_finish)=
-    dlsym(mad_handle,"mad_stream_finish");
-  rda->syslog(LOG_INFO,
-	 "Found MAD decoder library, MPEG L2 decoding supported");
-  return true;
-#else
-  rda->syslog(LOG_INFO,"MPEG L2 decoding not enabled");
-  return false;
-#endif  // HAVE_MAD
 }
 
 
-void MainObject::InitMadDecoder(int card,int stream,RDWaveFile *wave)
+void MainObject::SendStreamMeterLevelUpdate(PlaySession *psess,short levels[])
 {
-#ifdef HAVE_MAD
-  if(mad_active[card][stream]) {
-    FreeMadDecoder(card,stream);
-  }
-  mad_stream_init(&mad_stream[card][stream]);
-  mad_frame_init(&mad_frame[card][stream]);
-  mad_synth_init(&mad_synth[card][stream]);
-  mad_frame_size[card][stream]=
-    144*wave->getHeadBitRate()/wave->getSamplesPerSec();
-  mad_left_over[card][stream]=0;
-  mad_active[card][stream]=true;
-#endif  // HAVE_MAD
-}
-
+  if((cae_server->meterPort(psess->socketDescriptor())>0)&&
+     (cae_server->meterVersion(psess->socketDescriptor())==0)&&
+     cae_server->metersEnabled(psess->socketDescriptor(),psess->cardNumber())) {
+    SendMeterUpdate(QString::asprintf("MO %u %d %d",psess->serialNumber(),
+				      levels[0],levels[1]),
+		    psess->socketDescriptor());
+  }
 
-void MainObject::FreeMadDecoder(int card,int stream)
-{
-#ifdef HAVE_MAD
-  if(mad_active[card][stream]) {
-    mad_synth_finish(&mad_synth[card][stream]);
-    mad_frame_finish(&mad_frame[card][stream]);
-    mad_stream_finish(&mad_stream[card][stream]);
-    mad_frame_size[card][stream]=0;
-    mad_left_over[card][stream]=0;
-    mad_active[card][stream]=false;
-  }
-#endif  // HAVE_MAD
 }
 
 
-void MainObject::SendMeterLevelUpdate(const QString &type,int cardnum,
-				      int portnum,short levels[])
+void MainObject::SendLoudnessUpdate(const QString &type,int cardnum,
+				    int portnum,short lufs[])
 {
   QList<int> ids=cae_server->connectionIds();
 
+  //
+  // Sent as text whatever the meter version, as there is no room for
+  // loudness in the binary frames
+  //
   for(int l=0;l<ids.size();l++) {
     if((cae_server->meterPort(ids.at(l))>0)&&
        cae_server->metersEnabled(ids.at(l),cardnum)) {
-      SendMeterUpdate(QString::asprintf("ML %s %d %d %d %d",
+      SendMeterUpdate(QString::asprintf("LL %s %d %d %d %d %d",
 					type.toUtf8().constData(),
-					cardnum,portnum,levels[0],levels[1]),
+					cardnum,portnum,
+					lufs[0],lufs[1],lufs[2]),
 		      ids.at(l));
     }
   }
 }
 
 
-void MainObject::SendStreamMeterLevelUpdate(PlaySession *psess,short levels[])
+void MainObject::SendStreamLoudnessUpdate(PlaySession *psess,short lufs[])
 {
   if((cae_server->meterPort(psess->socketDescriptor())>0)&&
      cae_server->metersEnabled(psess->socketDescriptor(),psess->cardNumber())) {
-    SendMeterUpdate(QString::asprintf("MO %u %d %d",psess->serialNumber(),
-				      levels[0],levels[1]),
+    SendMeterUpdate(QString::asprintf("LO %u %d %d %d",psess->serialNumber(),
+				      lufs[0],lufs[1],lufs[2]),
 		    psess->socketDescriptor());
   }
-
 }
 
 
@@ -1596,13 +1985,20 @@ void MainObject::SendMeterPositionUpdate(int cardnum,unsigned pos[])
   PlaySession *psess=NULL;
   QList<int> ids=cae_server->connectionIds();
 
-  for(unsigned k=0;k<RD_MAX_STREAMS;k++) {
-    if((psess=GetPlaySession(cardnum,k))!=NULL) {
+  //
+  // Walk the sessions rather than the stream numbers, as there can be
+  // a great many more of the latter
+  //
+  for(QMap<uint64_t,PlaySession *>::const_iterator it=play_sessions.begin();
+      it!=play_sessions.end();it++) {
+    psess=it.value();
+    if(((int)psess->cardNumber()==cardnum)&&
+       (cae_server->meterVersion(psess->socketDescriptor())==0)) {
       for(int l=0;l<ids.size();l++) {
 	if((cae_server->meterPort(ids.at(l))>0)&&
 	   cae_server->metersEnabled(ids.at(l),cardnum)) {
-	  SendMeterUpdate(QString::asprintf("MP %u %d",
-					    psess->serialNumber(),pos[k]),
+	  SendMeterUpdate(QString::asprintf("MP %u %d",psess->serialNumber(),
+					    pos[psess->streamNumber()]),
 			  psess->socketDescriptor());
 	}
       }
@@ -1611,6 +2007,39 @@ void MainObject::SendMeterPositionUpdate(int cardnum,unsigned pos[])
 }
 
 
+void MainObject::SendMeterFrames(const RDMeterFrame &ports,
+				 short stream_levels[][2],unsigned pos[])
+{
+  PlaySession *psess=NULL;
+  QList<int> ids=cae_server->connectionIds();
+
+  //
+  // One datagram per card per connection, carrying the card's port levels
+  // plus the connection's own streams
+  //
+  for(int l=0;l<ids.size();l++) {
+    if((cae_server->meterPort(ids.at(l))>0)&&
+       (cae_server->meterVersion(ids.at(l))==RDMETERFRAME_VERSION)&&
+       cae_server->metersEnabled(ids.at(l),ports.card())) {
+      RDMeterFrame frame=ports;
+      for(QMap<uint64_t,PlaySession *>::const_iterator it=
+	    play_sessions.begin();it!=play_sessions.end();it++) {
+	psess=it.value();
+	if((psess->cardNumber()==ports.card())&&
+	   (psess->socketDescriptor()==ids.at(l))) {
+	  frame.addStream(psess->serialNumber(),
+			  stream_levels[psess->streamNumber()],
+			  pos[psess->streamNumber()]);
+	}
+      }
+      meter_socket->writeDatagram(frame.data(),frame.size(),
+				  cae_server->peerAddress(ids.at(l)),
+				  cae_server->meterPort(ids.at(l)));
+    }
+  }
+}
+
+
 void MainObject::SendMeterUpdate(const QString &msg,int conn_id)
 {
   /*
@@ -1669,6 +2098,10 @@ void MainObject::MakeDriver(unsigned *next_card,RDStation::AudioDriver type)
 #endif  // JACK
     break;
 
+  case RDStation::Null:
+    dvr=new DriverNull(this);
+    break;
+
   case RDStation::None:
     break;
   }
@@ -1683,7 +2116,7 @@ void MainObject::MakeDriver(unsigned *next_card,RDStation::AudioDriver type)
 	      this,SLOT(stateRecordUpdate(int,int,int)));
       d_drivers.push_back(dvr);
       for(unsigned i=first_card;i<*next_card;i++) {
-	for(int j=0;j<RD_MAX_STREAMS;j++) {
+	for(int j=0;j<dvr->maxStreams();j++) {
 	  for(int k=0;k<RD_MAX_PORTS;k++) {
 	    dvr->setOutputVolume(i,j,k,initial_output_volume);
 	  }
@@ -1697,19 +2130,6 @@ void MainObject::MakeDriver(unsigned *next_card,RDStation::AudioDriver type)
 }
 
 
-PlaySession *MainObject::GetPlaySession(unsigned card,unsigned stream) const
-{
-  for(QMap<uint64_t,PlaySession *>::const_iterator it=play_sessions.begin();
-      it!=play_sessions.end();it++) {
-    if((it.value()->cardNumber()==card)&&
-       (it.value()->streamNumber()==stream)) {
-      return it.value();
-    }
-  }
-  return NULL;
-}
-
-
 int main(int argc,char *argv[])
 {
   int rc;
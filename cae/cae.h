@@ -37,12 +37,11 @@
 #ifdef HAVE_TWOLAME
 #include <twolame.h>
 #endif  // HAVE_TWOLAME
-#ifdef HAVE_MAD
-#include <mad.h>
-#endif  // HAVE_MAD
 
 #include <rd.h>
 #include <rdconfig.h>
+#include <rdmeterframe.h>
+#include <rdmetershm.h>
 #include <rdstation.h>
 
 #include "driver.h"
@@ -78,6 +77,13 @@ class MainObject : public QObject
   void playData(uint64_t phandle,unsigned length,unsigned speed,
 		unsigned pitch_flag);
   void stopPlaybackData(uint64_t phandle);
+  void playAtData(uint64_t phandle,uint64_t clock,unsigned length,
+		  unsigned speed,unsigned pitch_flag);
+  void stopPlaybackAtData(uint64_t phandle,uint64_t clock);
+  void fadeOutputVolumeAtData(uint64_t phandle,uint64_t clock,int level,
+			      unsigned length);
+  void sampleClockData(int id,unsigned card);
+  void streamStatusData(uint64_t phandle);
   void timescalingSupportData(int id,unsigned card);
   void loadRecordingData(int id,unsigned card,unsigned port,unsigned coding,
 			unsigned channels,unsigned samprate,unsigned bitrate,
@@ -96,6 +102,7 @@ class MainObject : public QObject
   void setInputVoxLevelData(int id,unsigned card,unsigned stream,int level);
   void setInputTypeData(int id,unsigned card,unsigned port,unsigned type);
   void getInputStatusData(int id,unsigned card,unsigned port);
+  void getOutputSilenceData(int id,unsigned card,unsigned port);
   void setAudioPassthroughLevelData(int id,unsigned card,unsigned input,
 				    unsigned output,int level);
   void setClockSourceData(int id,unsigned card,int input);
@@ -103,22 +110,28 @@ class MainObject : public QObject
   void statePlayUpdate(int card,int stream,int state);
   void stateRecordUpdate(int card,int stream,int state);
   void updateMeters();
+  void statisticsData();
   void connectionDroppedData(int id);
   
  private:
   void InitProvisioning() const;
   void InitMixers();
+  void InitSilenceSense();
   void KillSocket(int);
   bool CheckDaemon(QString);
   pid_t GetPid(QString pidfile);
-  PlaySession *GetPlaySession(unsigned card,unsigned stream) const;
   uint64_t GetPlayHandle(unsigned cardnum,unsigned streamnum) const;
   void ProbeCaps(RDStation *station);
   void ClearDriverEntries() const;
   void SendMeterLevelUpdate(const QString &type,int cardnum,int portnum,
 			    short levels[]);
   void SendStreamMeterLevelUpdate(PlaySession *psess,short levels[]);
+  void SendLoudnessUpdate(const QString &type,int cardnum,int portnum,
+			  short lufs[]);
+  void SendStreamLoudnessUpdate(PlaySession *psess,short lufs[]);
   void SendMeterPositionUpdate(int cardnum,unsigned pos[]);
+  void SendMeterFrames(const RDMeterFrame &ports,short stream_levels[][2],
+		       unsigned pos[]);
   void SendMeterUpdate(const QString &msg,int conn_id);
   Driver *GetDriver(unsigned card) const;
   void MakeDriver(unsigned *next_card,RDStation::AudioDriver type);
@@ -128,15 +141,15 @@ class MainObject : public QObject
   CaeServer *cae_server;
   int16_t tcp_port;
   QUdpSocket *meter_socket;
+  uint32_t meter_sequence;
+  RDMeterShm *meter_shm;
   int record_owner[RD_MAX_CARDS][RD_MAX_STREAMS];
   int record_length[RD_MAX_CARDS][RD_MAX_STREAMS];
   int record_threshold[RD_MAX_CARDS][RD_MAX_STREAMS];
-  int play_length[RD_MAX_CARDS][RD_MAX_STREAMS];
-  int play_speed[RD_MAX_CARDS][RD_MAX_STREAMS];
-  bool play_pitch[RD_MAX_CARDS][RD_MAX_STREAMS];
   bool port_status[RD_MAX_CARDS][RD_MAX_PORTS];
-  bool output_status_flag[RD_MAX_CARDS][RD_MAX_PORTS][RD_MAX_STREAMS];
+  bool silence_status[RD_MAX_CARDS][RD_MAX_PORTS];
   QMap<uint64_t,PlaySession *> play_sessions;
+  unsigned stats_xruns[RD_MAX_CARDS];
  private:
   bool CheckLame();
   bool CheckMp4Decode();
@@ -166,32 +179,6 @@ class MainObject : public QObject
   int (*twolame_set_energy_levels)(twolame_options *,int);
   twolame_options *twolame_lameopts[RD_MAX_CARDS][RD_MAX_STREAMS];
 #endif  // HAVE_TWOLAME
-
-  //
-  // MAD Decoder
-  //
-  bool LoadMad();
-  void InitMadDecoder(int card,int stream,RDWaveFile *wave);
-  void FreeMadDecoder(int card,int stream);
-  void *mad_handle;
-#ifdef HAVE_MAD
-  void (*mad_stream_init)(struct mad_stream *);
-  void (*mad_frame_init)(struct mad_frame *);
-  void (*mad_synth_init)(struct mad_synth *);
-  void (*mad_stream_buffer)(struct mad_stream *,unsigned char const *,
-			    unsigned long);
-  int (*mad_frame_decode)(struct mad_frame *, struct mad_stream *);
-  void (*mad_synth_frame)(struct mad_synth *, struct mad_frame const *);
-  void (*mad_frame_finish)(struct mad_frame *);
-  void (*mad_stream_finish)(struct mad_stream *);
-  struct mad_stream mad_stream[RD_MAX_CARDS][RD_MAX_STREAMS];
-  struct mad_frame mad_frame[RD_MAX_CARDS][RD_MAX_STREAMS];
-  struct mad_synth mad_synth[RD_MAX_CARDS][RD_MAX_STREAMS];
-  bool mad_active[RD_MAX_CARDS][RD_MAX_STREAMS];
-  int mad_frame_size[RD_MAX_CARDS][RD_MAX_STREAMS];
-  int mad_left_over[RD_MAX_CARDS][RD_MAX_STREAMS];
-  unsigned char *mad_mpeg[RD_MAX_CARDS][RD_MAX_STREAMS];
-#endif  // HAVE_MAD
 };
 
 
@@ -25,6 +25,8 @@
 #include <qstringlist.h>
 
 #include <rdapplication.h>
+#include <rdmeterframe.h>
+#include <rdmetershm.h>
 
 #include "cae_server.h"
 #include "playsession.h"
@@ -40,6 +42,7 @@ CaeServerConnection::CaeServerConnection(QTcpSocket *sock)
   authenticated=false;
   accum="";
   meter_port=0;
+  meter_version=0;
   for(int i=0;i<RD_MAX_CARDS;i++) {
     meters_enabled[i]=false;
   }
@@ -58,6 +61,7 @@ CaeServer::CaeServer(RDConfig *config,QObject *parent)
   : QObject(parent)
 {
   cae_config=config;
+  cae_shared_meters_available=false;
 
   cae_server=new QTcpServer(this);
   connect(cae_server,SIGNAL(newConnection()),this,SLOT(newConnectionData()));
@@ -109,6 +113,18 @@ void CaeServer::setMeterPort(int id,uint16_t port)
 }
 
 
+unsigned CaeServer::meterVersion(int id) const
+{
+  return cae_connections[id]->meter_version;
+}
+
+
+void CaeServer::setSharedMetersAvailable(bool state)
+{
+  cae_shared_meters_available=state;
+}
+
+
 bool CaeServer::metersEnabled(int id,unsigned card) const
 {
   return cae_connections[id]->meters_enabled[card];
@@ -344,6 +360,67 @@ bool CaeServer::ProcessCommand(int id,const QString &cmd)
       was_processed=true;
     }
   }
+  if((f0.at(0)=="PA")&&(f0.size()==6)) {  // Play At
+    unsigned serial=f0.at(1).toUInt(&ok);
+    if(ok) {
+      uint64_t clock=f0.at(2).toULongLong(&ok);
+      if(ok) {
+	unsigned len=f0.at(3).toUInt(&ok);
+	if(ok) {
+	  unsigned speed=f0.at(4).toUInt(&ok);
+	  if(ok) {
+	    unsigned pitch=f0.at(5).toUInt(&ok);
+	    if(ok) {
+	      emit playAtReq(PlaySession::makeHandle(id,serial),clock,len,
+			     speed,pitch);
+	      was_processed=true;
+	    }
+	  }
+	}
+      }
+    }
+  }
+  if((f0.at(0)=="SA")&&(f0.size()==3)) {  // Stop Playback At
+    unsigned serial=f0.at(1).toUInt(&ok);
+    if(ok) {
+      uint64_t clock=f0.at(2).toULongLong(&ok);
+      if(ok) {
+	emit stopPlaybackAtReq(PlaySession::makeHandle(id,serial),clock);
+	was_processed=true;
+      }
+    }
+  }
+  if((f0.at(0)=="FA")&&(f0.size()==5)) {  // Fade Output Volume At
+    unsigned serial=f0.at(1).toUInt(&ok);
+    if(ok) {
+      uint64_t clock=f0.at(2).toULongLong(&ok);
+      if(ok) {
+	int level=f0.at(3).toInt(&ok);
+	if(ok) {
+	  unsigned len=f0.at(4).toUInt(&ok);
+	  if(ok) {
+	    emit fadeOutputVolumeAtReq(PlaySession::makeHandle(id,serial),
+				       clock,level,len);
+	    was_processed=true;
+	  }
+	}
+      }
+    }
+  }
+  if((f0.at(0)=="CK")&&(f0.size()==2)) {  // Sample Clock
+    unsigned card=f0.at(1).toUInt(&ok);
+    if(ok&&(card<RD_MAX_CARDS)) {
+      emit sampleClockReq(id,card);
+      was_processed=true;
+    }
+  }
+  if((f0.at(0)=="ST")&&(f0.size()==2)) {  // Stream Status
+    unsigned serial=f0.at(1).toUInt(&ok);
+    if(ok) {
+      emit streamStatusReq(PlaySession::makeHandle(id,serial));
+      was_processed=true;
+    }
+  }
   if((f0.at(0)=="TS")&&(f0.size()==2)) {  // Timescaling Support
     unsigned card=f0.at(1).toUInt(&ok);
     if(ok&&(card<RD_MAX_CARDS)) {
@@ -541,6 +618,16 @@ bool CaeServer::ProcessCommand(int id,const QString &cmd)
       }
     }
   }
+  if((f0.at(0)=="OS")&&(f0.size()==3)) {  // Get Output Silence Status
+    unsigned card=f0.at(1).toUInt(&ok);
+    if(ok&&(card<RD_MAX_CARDS)) {
+      unsigned port=f0.at(2).toUInt(&ok);
+      if(ok&&(port<RD_MAX_PORTS)) {
+	emit getOutputSilenceReq(id,card,port);
+	was_processed=true;
+      }
+    }
+  }
   if((f0.at(0)=="AL")&&(f0.size()==5)) {  // Set Audio Passthrough Level
     unsigned card=f0.at(1).toUInt(&ok);
     if(ok&&(card<RD_MAX_CARDS)) {
@@ -568,6 +655,29 @@ bool CaeServer::ProcessCommand(int id,const QString &cmd)
     }
   }
 
+  if((f0.at(0)=="MF")&&(f0.size()==2)) {  // Meter Format
+    unsigned version=f0.at(1).toUInt(&ok);
+    if(ok&&(version==RDMETERSHM_METER_FORMAT)) {
+      //
+      // Only for clients on this host, and only if we have a segment
+      //
+      ok=cae_shared_meters_available&&
+	(conn->socket->peerAddress().isLoopback()||
+	 (conn->socket->peerAddress()==conn->socket->localAddress()));
+    }
+    else {
+      ok=ok&&(version<=RDMETERFRAME_VERSION);
+    }
+    if(ok) {
+      conn->meter_version=version;
+      sendCommand(id,QString::asprintf("MF %u +!",version));
+    }
+    else {
+      sendCommand(id,f0.join(" ")+" -!");
+    }
+    was_processed=true;
+  }
+
   if(f0.at(0)=="ME") {  // Meter Enable
     if(f0.size()>2) {  // So we don't warn if no cards are specified
       uint16_t udp_port=0xFFFF&f0.at(1).toUInt(&ok);
@@ -41,6 +41,7 @@ class CaeServerConnection
   bool authenticated;
   QString accum;
   uint16_t meter_port;
+  unsigned meter_version;
   bool meters_enabled[RD_MAX_CARDS];
   unsigned play_serial;
   unsigned play_stream;
@@ -60,6 +61,8 @@ class CaeServer : public QObject
   uint16_t peerPort(int id) const;
   uint16_t meterPort(int id) const;
   void setMeterPort(int id,uint16_t port);
+  unsigned meterVersion(int id) const;
+  void setSharedMetersAvailable(bool state);
   bool metersEnabled(int id,unsigned card) const;
   void setMetersEnabled(int id,unsigned card,bool state);
   bool listen(const QHostAddress &addr,uint16_t port);
@@ -76,6 +79,13 @@ class CaeServer : public QObject
   void playReq(uint64_t phandle,unsigned length,unsigned speed,
 	       unsigned pitch_flag);
   void stopPlaybackReq(uint64_t phandle);
+  void playAtReq(uint64_t phandle,uint64_t clock,unsigned length,
+		 unsigned speed,unsigned pitch_flag);
+  void stopPlaybackAtReq(uint64_t phandle,uint64_t clock);
+  void fadeOutputVolumeAtReq(uint64_t phandle,uint64_t clock,int level,
+			     unsigned length);
+  void sampleClockReq(int id,unsigned card);
+  void streamStatusReq(uint64_t phandle);
   void timescalingSupportReq(int id,unsigned card);
   void loadRecordingReq(int id,unsigned card,unsigned port,unsigned coding,
 			unsigned channels,unsigned samprate,unsigned bitrate,
@@ -94,6 +104,7 @@ class CaeServer : public QObject
   void setInputVoxLevelReq(int id,unsigned card,unsigned stream,int level);
   void setInputTypeReq(int id,unsigned card,unsigned port,unsigned type);
   void getInputStatusReq(int id,unsigned card,unsigned port);
+  void getOutputSilenceReq(int id,unsigned card,unsigned port);
   void setAudioPassthroughLevelReq(int id,unsigned card,unsigned input,
 				   unsigned output,int level);
   void setClockSourceReq(int id,unsigned card,int input);
@@ -111,6 +122,7 @@ class CaeServer : public QObject
   QSignalMapper *cae_ready_read_mapper;
   QSignalMapper *cae_connection_closed_mapper;
   RDConfig *cae_config;
+  bool cae_shared_meters_available;
 };
 
 
@@ -0,0 +1,238 @@
+// decoder.cpp
+//
+// Abstract base class for caed(8) playout decoders.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include <string.h>
+
+#include <rdapplication.h>
+
+#include "decoder.h"
+#include "decoder_flac.h"
+#include "decoder_mpeg.h"
+#include "decoder_pcm.h"
+
+CaeDecoder::CaeDecoder(RDWaveFile *wave)
+{
+  decoder_wave=wave;
+  decoder_channels=wave->getChannels();
+  decoder_finished=false;
+  decoder_frame=new float[decoder_channels];
+  decoder_src=NULL;
+  decoder_src_ratio=1.0;
+  decoder_src_buffer=NULL;
+  decoder_src_finished=false;
+}
+
+
+CaeDecoder::~CaeDecoder()
+{
+  setOutputSampleRate(0);
+  delete[] decoder_frame;
+}
+
+
+RDWaveFile *CaeDecoder::wave() const
+{
+  return decoder_wave;
+}
+
+
+unsigned CaeDecoder::channels() const
+{
+  return decoder_channels;
+}
+
+
+unsigned CaeDecoder::sampleRate() const
+{
+  return decoder_wave->getSamplesPerSec();
+}
+
+
+unsigned CaeDecoder::outputSampleRate() const
+{
+  return (unsigned)((double)sampleRate()*decoder_src_ratio+0.5);
+}
+
+
+bool CaeDecoder::setOutputSampleRate(unsigned rate)
+{
+  int err=0;
+
+  if(decoder_src!=NULL) {
+    src_delete(decoder_src);
+    decoder_src=NULL;
+    delete[] decoder_src_buffer;
+    decoder_src_buffer=NULL;
+  }
+  decoder_src_ratio=1.0;
+  decoder_src_finished=false;
+  if((rate==0)||(rate==sampleRate())) {
+    return true;
+  }
+  if((decoder_src=src_callback_new(SrcCallback,DECODER_SRC_CONVERTER,
+				   decoder_channels,&err,this))==NULL) {
+    rda->syslog(LOG_WARNING,"unable to resample \"%s\" to %u: %s",
+		decoder_wave->getName().toUtf8().constData(),rate,
+		src_strerror(err));
+    return false;
+  }
+  decoder_src_ratio=(double)rate/(double)sampleRate();
+  decoder_src_buffer=new float[DECODER_SRC_BLOCK_FRAMES*decoder_channels];
+
+  return true;
+}
+
+
+bool CaeDecoder::isFinished() const
+{
+  return decoder_finished;
+}
+
+
+unsigned CaeDecoder::seek(unsigned frame)
+{
+  decoder_finished=false;
+  if(decoder_src!=NULL) {
+    src_reset(decoder_src);
+    decoder_src_finished=false;
+  }
+  return SeekData(frame);
+}
+
+
+unsigned CaeDecoder::decode(float *pcm,unsigned frames)
+{
+  unsigned n=0;
+
+  if(decoder_finished||(frames==0)) {
+    return 0;
+  }
+  if(decoder_src==NULL) {
+    n=DecodeData(pcm,frames);
+  }
+  else {
+    n=src_callback_read(decoder_src,decoder_src_ratio,frames,pcm);
+  }
+  if(n<frames) {
+    decoder_finished=true;
+  }
+  return n;
+}
+
+
+unsigned CaeDecoder::fillRing(RDSpscRing *ring)
+{
+  RDSpscSpan span;
+  size_t fsize=sizeof(float)*decoder_channels;
+  size_t n=ring->writeSpace();
+  size_t m=0;
+  unsigned frames=0;
+  unsigned want=0;
+
+  n-=n%fsize;
+  if((n==0)||decoder_finished) {
+    return 0;
+  }
+  ring->reserveWrite(&span,n);
+
+  //
+  // Decode straight into the ring.  Should the wrap point ever fall in
+  // the middle of a frame (only possible with odd channel counts), that
+  // one frame is bounced through 'decoder_frame' and split across the two spans.
+  //
+  want=span.len[0]/fsize;
+  m=decode((float *)span.data[0],want);
+  frames+=m;
+  if((m==want)&&(span.len[1]>0)) {
+    if((m=span.len[0]%fsize)>0) {
+      if(decode(decoder_frame,1)!=1) {
+	ring->commitWrite(frames*fsize);
+	return frames;
+      }
+      memcpy(span.data[0]+span.len[0]-m,decoder_frame,m);
+      memcpy(span.data[1],(char *)decoder_frame+m,fsize-m);
+      frames++;
+      m=fsize-m;
+    }
+    want=(span.len[1]-m)/fsize;
+    frames+=decode((float *)(span.data[1]+m),want);
+  }
+  ring->commitWrite(frames*fsize);
+
+  return frames;
+}
+
+
+CaeDecoder *CaeDecoder::create(RDWaveFile *wave)
+{
+#ifdef HAVE_FLAC
+  CaeDecoderFlac *flac=NULL;
+#endif  // HAVE_FLAC
+
+  switch(wave->getFormatTag()) {
+  case WAVE_FORMAT_PCM:
+    switch(wave->getBitsPerSample()) {
+    case 16:
+    case 24:
+      return new CaeDecoderPcm(wave);
+    }
+    break;
+
+  case WAVE_FORMAT_VORBIS:
+    return new CaeDecoderPcm(wave);
+
+  case WAVE_FORMAT_MPEG:
+    if(!CaeDecoderMpeg::load()) {
+      rda->syslog(LOG_WARNING,"MPEG Layer 2 decode not available");
+      return NULL;
+    }
+    return new CaeDecoderMpeg(wave);
+
+#ifdef HAVE_FLAC
+  case WAVE_FORMAT_FLAC:
+    flac=new CaeDecoderFlac(wave);
+    if(!flac->isValid()) {
+      delete flac;
+      return NULL;
+    }
+    return flac;
+#endif  // HAVE_FLAC
+  }
+
+  return NULL;
+}
+
+
+long CaeDecoder::SrcCallback(void *priv,float **data)
+{
+  CaeDecoder *decoder=(CaeDecoder *)priv;
+  unsigned n=0;
+
+  *data=decoder->decoder_src_buffer;
+  if(decoder->decoder_src_finished) {
+    return 0;
+  }
+  n=decoder->DecodeData(decoder->decoder_src_buffer,DECODER_SRC_BLOCK_FRAMES);
+  if(n<DECODER_SRC_BLOCK_FRAMES) {
+    decoder->decoder_src_finished=true;
+  }
+
+  return n;
+}
@@ -0,0 +1,80 @@
+// decoder.h
+//
+// Abstract base class for caed(8) playout decoders.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef DECODER_H
+#define DECODER_H
+
+#include <samplerate.h>
+
+#include <rdspscring.h>
+#include <rdwavefile.h>
+
+#define DECODER_SRC_CONVERTER SRC_SINC_FASTEST
+#define DECODER_SRC_BLOCK_FRAMES 1024
+
+//
+// One decoder instance is created for each loaded play stream and is
+// only ever touched with that stream's reader pool lock held.  Output is
+// always interleaved 32 bit float at the file's native channel count,
+// with 1.0 == full scale.
+//
+// Output is at the file's own sample rate unless setOutputSampleRate()
+// has been used to attach a resampler.  Positions passed to and returned
+// from seek() are always in file sample frames.
+//
+class CaeDecoder
+{
+ public:
+  CaeDecoder(RDWaveFile *wave);
+  virtual ~CaeDecoder();
+  RDWaveFile *wave() const;
+  unsigned channels() const;
+  unsigned sampleRate() const;
+  unsigned outputSampleRate() const;
+  bool setOutputSampleRate(unsigned rate);
+  bool isFinished() const;
+  unsigned seek(unsigned frame);
+  unsigned decode(float *pcm,unsigned frames);
+  unsigned fillRing(RDSpscRing *ring);
+  static CaeDecoder *create(RDWaveFile *wave);
+
+ protected:
+  //
+  // SeekData() returns the frame actually reached, which may be earlier
+  // than the one requested (e.g. on an MPEG frame boundary).
+  // DecodeData() returns fewer than 'frames' only at end of file.
+  //
+  virtual unsigned SeekData(unsigned frame)=0;
+  virtual unsigned DecodeData(float *pcm,unsigned frames)=0;
+
+ private:
+  unsigned decoder_channels;
+  bool decoder_finished;
+  static long SrcCallback(void *priv,float **data);
+  RDWaveFile *decoder_wave;
+  float *decoder_frame;
+  SRC_STATE *decoder_src;
+  double decoder_src_ratio;
+  float *decoder_src_buffer;
+  bool decoder_src_finished;
+};
+
+
+#endif  // DECODER_H
@@ -0,0 +1,173 @@
+// decoder_flac.cpp
+//
+// FLAC playout decoder for caed(8).
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+
+#include <string.h>
+
+#include <rdapplication.h>
+
+#include "decoder_flac.h"
+#include "mixbus.h"
+
+#ifdef HAVE_FLAC
+CaeDecoderFlac::CaeDecoderFlac(RDWaveFile *wave)
+  : CaeDecoder(wave), FLAC::Decoder::File()
+{
+  flac_buffer32=NULL;
+  flac_pcm=NULL;
+  flac_pcm_size=0;
+  flac_pcm_frames=0;
+  flac_pcm_offset=0;
+  flac_valid=
+    init(wave->getName().toUtf8().constData())==
+    FLAC__STREAM_DECODER_INIT_STATUS_OK;
+  if(!flac_valid) {
+    rda->syslog(LOG_WARNING,"unable to initialize FLAC decoder for \"%s\"",
+		wave->getName().toUtf8().constData());
+  }
+}
+
+
+CaeDecoderFlac::~CaeDecoderFlac()
+{
+  if(flac_valid) {
+    finish();
+  }
+  if(flac_buffer32!=NULL) {
+    delete[] flac_buffer32;
+  }
+  if(flac_pcm!=NULL) {
+    delete[] flac_pcm;
+  }
+}
+
+
+bool CaeDecoderFlac::isValid() const
+{
+  return flac_valid;
+}
+
+
+unsigned CaeDecoderFlac::SeekData(unsigned frame)
+{
+  if(!flac_valid) {
+    return 0;
+  }
+
+  //
+  // libFLAC trims the frame containing the target sample, so whatever
+  // lands in the pending buffer starts exactly at 'frame'
+  //
+  flac_pcm_frames=0;
+  flac_pcm_offset=0;
+  if(!seek_absolute(frame)) {
+    if(get_state()==FLAC__STREAM_DECODER_SEEK_ERROR) {
+      flush();
+    }
+    reset();
+    flac_pcm_frames=0;
+    return 0;
+  }
+  return frame;
+}
+
+
+unsigned CaeDecoderFlac::DecodeData(float *pcm,unsigned frames)
+{
+  unsigned total=0;
+  unsigned n=0;
+
+  if(!flac_valid) {
+    return 0;
+  }
+  while(total<frames) {
+    if(flac_pcm_offset==flac_pcm_frames) {
+      flac_pcm_frames=0;
+      flac_pcm_offset=0;
+      if(!process_single()) {
+	break;
+      }
+      if(flac_pcm_frames==0) {  // Metadata block or end of stream
+	if(get_state()==FLAC__STREAM_DECODER_END_OF_STREAM) {
+	  break;
+	}
+	continue;
+      }
+    }
+    n=flac_pcm_frames-flac_pcm_offset;
+    if(n>(frames-total)) {
+      n=frames-total;
+    }
+    memcpy(pcm,flac_pcm+flac_pcm_offset*channels(),
+	   n*channels()*sizeof(float));
+    pcm+=n*channels();
+    flac_pcm_offset+=n;
+    total+=n;
+  }
+
+  return total;
+}
+
+
+FLAC__StreamDecoderWriteStatus
+CaeDecoderFlac::write_callback(const ::FLAC__Frame *frame,
+			       const FLAC__int32 *const buffer[])
+{
+  unsigned chans=channels();
+  unsigned shift=32-frame->header.bits_per_sample;
+  unsigned n=frame->header.blocksize*chans;
+
+  if(n>flac_pcm_size) {
+    if(flac_buffer32!=NULL) {
+      delete[] flac_buffer32;
+    }
+    if(flac_pcm!=NULL) {
+      delete[] flac_pcm;
+    }
+    flac_pcm_size=n;
+    flac_buffer32=new int32_t[flac_pcm_size];
+    flac_pcm=new float[flac_pcm_size];
+  }
+
+  //
+  // Interleave, left justified to 32 bits so that any sample width can
+  // share the one conversion kernel
+  //
+  for(unsigned i=0;i<chans;i++) {
+    const FLAC__int32 *src=
+      buffer[(i<frame->header.channels)?i:(frame->header.channels-1)];
+    for(unsigned j=0;j<frame->header.blocksize;j++) {
+      flac_buffer32[j*chans+i]=(int32_t)((uint32_t)src[j]<<shift);
+    }
+  }
+  MixBusS32ToFloat(flac_pcm,flac_buffer32,n);
+  flac_pcm_frames=frame->header.blocksize;
+  flac_pcm_offset=0;
+
+  return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+}
+
+
+void CaeDecoderFlac::error_callback(::FLAC__StreamDecoderErrorStatus status)
+{
+  rda->syslog(LOG_WARNING,"FLAC decode error %d in \"%s\"",status,
+	      wave()->getName().toUtf8().constData());
+}
+#endif  // HAVE_FLAC
@@ -0,0 +1,62 @@
+// decoder_flac.h
+//
+// FLAC playout decoder for caed(8).
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+
+#ifndef DECODER_FLAC_H
+#define DECODER_FLAC_H
+
+#ifdef HAVE_FLAC
+#include <stdint.h>
+
+#include <FLAC++/decoder.h>
+
+#include "decoder.h"
+
+//
+// Decodes a native FLAC stream one FLAC frame at a time, so nothing
+// beyond a single block (at most 65535 frames) is ever held in memory.
+//
+class CaeDecoderFlac : public CaeDecoder, protected FLAC::Decoder::File
+{
+ public:
+  CaeDecoderFlac(RDWaveFile *wave);
+  ~CaeDecoderFlac();
+  bool isValid() const;
+
+ protected:
+  unsigned SeekData(unsigned frame);
+  unsigned DecodeData(float *pcm,unsigned frames);
+  FLAC__StreamDecoderWriteStatus
+    write_callback(const ::FLAC__Frame *frame,
+		   const FLAC__int32 *const buffer[]);
+  void error_callback(::FLAC__StreamDecoderErrorStatus status);
+
+ private:
+  bool flac_valid;
+  int32_t *flac_buffer32;
+  float *flac_pcm;
+  unsigned flac_pcm_size;
+  unsigned flac_pcm_frames;
+  unsigned flac_pcm_offset;
+};
+#endif  // HAVE_FLAC
+
+
+#endif  // DECODER_FLAC_H
@@ -0,0 +1,223 @@
+// decoder_mpeg.cpp
+//
+// MPEG Layer 2 playout decoder for caed(8), using libmad.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+
+#include <dlfcn.h>
+#include <string.h>
+
+#include <rdapplication.h>
+
+#include "decoder_mpeg.h"
+
+#ifdef HAVE_MAD
+void (*CaeDecoderMpeg::mad_stream_init)(struct mad_stream *)=NULL;
+void (*CaeDecoderMpeg::mad_frame_init)(struct mad_frame *)=NULL;
+void (*CaeDecoderMpeg::mad_synth_init)(struct mad_synth *)=NULL;
+void (*CaeDecoderMpeg::mad_stream_buffer)(struct mad_stream *,
+					  unsigned char const *,
+					  unsigned long)=NULL;
+int (*CaeDecoderMpeg::mad_frame_decode)(struct mad_frame *,
+					struct mad_stream *)=NULL;
+void (*CaeDecoderMpeg::mad_synth_frame)(struct mad_synth *,
+					struct mad_frame const *)=NULL;
+void (*CaeDecoderMpeg::mad_frame_finish)(struct mad_frame *)=NULL;
+void (*CaeDecoderMpeg::mad_stream_finish)(struct mad_stream *)=NULL;
+#endif  // HAVE_MAD
+void *CaeDecoderMpeg::mad_handle=NULL;
+int CaeDecoderMpeg::mad_loaded=-1;
+
+CaeDecoderMpeg::CaeDecoderMpeg(RDWaveFile *wave)
+  : CaeDecoder(wave)
+{
+  mpeg_pcm=new float[DECODER_MPEG_FRAME_SAMPLES*channels()];
+  InitDecoder();
+}
+
+
+CaeDecoderMpeg::~CaeDecoderMpeg()
+{
+  FreeDecoder();
+  delete[] mpeg_pcm;
+}
+
+
+bool CaeDecoderMpeg::load()
+{
+  if(mad_loaded>=0) {
+    return mad_loaded>0;
+  }
+  mad_loaded=0;
+#ifdef HAVE_MAD
+  if((mad_handle=dlopen("libmad.so.0",RTLD_NOW))==NULL) {
+    rda->syslog(LOG_INFO,
+	   "MAD decoder library not found, MPEG L2 decoding not supported");
+    return false;
+  }
+  *(void **)(&mad_stream_init)=
+    dlsym(mad_handle,"mad_stream_init");
+  *(void **)(&mad_frame_init)=
+    dlsym(mad_handle,"mad_frame_init");
+  *(void **)(&mad_synth_init)=
+    dlsym(mad_handle,"mad_synth_init");
+  *(void **)(&mad_stream_buffer)=
+    dlsym(mad_handle,"mad_stream_buffer");
+  *(void **)(&mad_frame_decode)=
+    dlsym(mad_handle,"mad_frame_decode");
+  *(void **)(&mad_synth_frame)=
+    dlsym(mad_handle,"mad_synth_frame");
+  *(void **)(&mad_frame_finish)=
+    dlsym(mad_handle,"mad_frame_finish");
+  *(void **)(&mad_stream_finish)=
+    dlsym(mad_handle,"mad_stream_finish");
+  rda->syslog(LOG_INFO,
+	 "Found MAD decoder library, MPEG L2 decoding supported");
+  mad_loaded=1;
+  return true;
+#else
+  rda->syslog(LOG_INFO,"MPEG L2 decoding not enabled");
+  return false;
+#endif  // HAVE_MAD
+}
+
+
+unsigned CaeDecoderMpeg::SeekData(unsigned frame)
+{
+  //
+  // Layer 2 frames are fixed length and carry no bit reservoir, so we can
+  // land on any frame boundary and simply restart the decoder there.
+  //
+  frame=frame/DECODER_MPEG_FRAME_SAMPLES*DECODER_MPEG_FRAME_SAMPLES;
+  FreeDecoder();
+  InitDecoder();
+  if(wave()->seekWave(frame/DECODER_MPEG_FRAME_SAMPLES*
+		      wave()->getBlockAlign(),SEEK_SET)<0) {
+    return 0;
+  }
+  return frame;
+}
+
+
+unsigned CaeDecoderMpeg::DecodeData(float *pcm,unsigned frames)
+{
+  unsigned total=0;
+  unsigned n=0;
+
+  while(total<frames) {
+    if(mpeg_pcm_offset==mpeg_pcm_frames) {
+      if(!DecodeFrame()) {
+	break;
+      }
+    }
+    n=mpeg_pcm_frames-mpeg_pcm_offset;
+    if(n>(frames-total)) {
+      n=frames-total;
+    }
+    memcpy(pcm,mpeg_pcm+mpeg_pcm_offset*channels(),
+	   n*channels()*sizeof(float));
+    pcm+=n*channels();
+    mpeg_pcm_offset+=n;
+    total+=n;
+  }
+
+  return total;
+}
+
+
+void CaeDecoderMpeg::InitDecoder()
+{
+  mpeg_pcm_frames=0;
+  mpeg_pcm_offset=0;
+  mpeg_eof=false;
+#ifdef HAVE_MAD
+  mad_stream_init(&mpeg_stream);
+  mad_frame_init(&mpeg_frame);
+  mad_synth_init(&mpeg_synth);
+#endif  // HAVE_MAD
+}
+
+
+void CaeDecoderMpeg::FreeDecoder()
+{
+#ifdef HAVE_MAD
+  mad_synth_finish(&mpeg_synth);
+  mad_frame_finish(&mpeg_frame);
+  mad_stream_finish(&mpeg_stream);
+#endif  // HAVE_MAD
+}
+
+
+bool CaeDecoderMpeg::DecodeFrame()
+{
+#ifdef HAVE_MAD
+  size_t left_over=0;
+  int n=0;
+  int chan=0;
+  float *pcm=mpeg_pcm;
+
+  while(true) {
+    //
+    // Top up the input buffer, keeping whatever part of a frame libmad
+    // has not yet consumed
+    //
+    if((mpeg_stream.buffer==NULL)||(mpeg_stream.error==MAD_ERROR_BUFLEN)) {
+      if(mpeg_eof) {
+	return false;
+      }
+      left_over=0;
+      if(mpeg_stream.next_frame!=NULL) {
+	left_over=mpeg_stream.bufend-mpeg_stream.next_frame;
+	memmove(mpeg_buffer,mpeg_stream.next_frame,left_over);
+      }
+      n=wave()->readWave(mpeg_buffer+left_over,
+			 DECODER_MPEG_BUFFER_SIZE-left_over);
+      if(n<=0) {  // End-of-file, let libmad read out the last frame
+	memset(mpeg_buffer+left_over,0,MAD_BUFFER_GUARD);
+	n=MAD_BUFFER_GUARD;
+	mpeg_eof=true;
+      }
+      mad_stream_buffer(&mpeg_stream,mpeg_buffer,left_over+n);
+      mpeg_stream.error=MAD_ERROR_NONE;
+    }
+    if(mad_frame_decode(&mpeg_frame,&mpeg_stream)!=0) {
+      if(MAD_RECOVERABLE(mpeg_stream.error)||
+	 (mpeg_stream.error==MAD_ERROR_BUFLEN)) {
+	continue;
+      }
+      rda->syslog(LOG_WARNING,"MPEG decode error 0x%04x in \"%s\"",
+		  mpeg_stream.error,wave()->getName().toUtf8().constData());
+      return false;
+    }
+    mad_synth_frame(&mpeg_synth,&mpeg_frame);
+    mpeg_pcm_frames=mpeg_synth.pcm.length;
+    if(mpeg_pcm_frames>DECODER_MPEG_FRAME_SAMPLES) {
+      mpeg_pcm_frames=DECODER_MPEG_FRAME_SAMPLES;
+    }
+    mpeg_pcm_offset=0;
+    for(unsigned i=0;i<mpeg_pcm_frames;i++) {
+      for(unsigned j=0;j<channels();j++) {
+	chan=(j<mpeg_synth.pcm.channels)?j:(mpeg_synth.pcm.channels-1);
+	*pcm++=(float)mad_f_todouble(mpeg_synth.pcm.samples[chan][i]);
+      }
+    }
+    return true;
+  }
+#endif  // HAVE_MAD
+  return false;
+}
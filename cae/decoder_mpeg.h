@@ -0,0 +1,80 @@
+// decoder_mpeg.h
+//
+// MPEG Layer 2 playout decoder for caed(8), using libmad.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+
+#ifndef DECODER_MPEG_H
+#define DECODER_MPEG_H
+
+#include <stdint.h>
+
+#ifdef HAVE_MAD
+#include <mad.h>
+#endif  // HAVE_MAD
+
+#include "decoder.h"
+
+#define DECODER_MPEG_BUFFER_SIZE 16384
+#define DECODER_MPEG_FRAME_SAMPLES 1152
+
+//
+// libmad is loaded at runtime, once per process, by load().  Each
+// instance carries its own MAD state, so nothing is allocated for streams
+// that are not actually playing MPEG.
+//
+class CaeDecoderMpeg : public CaeDecoder
+{
+ public:
+  CaeDecoderMpeg(RDWaveFile *wave);
+  ~CaeDecoderMpeg();
+  static bool load();
+
+ protected:
+  unsigned SeekData(unsigned frame);
+  unsigned DecodeData(float *pcm,unsigned frames);
+
+ private:
+  void InitDecoder();
+  void FreeDecoder();
+  bool DecodeFrame();
+  float *mpeg_pcm;
+  unsigned mpeg_pcm_frames;
+  unsigned mpeg_pcm_offset;
+  bool mpeg_eof;
+#ifdef HAVE_MAD
+  unsigned char mpeg_buffer[DECODER_MPEG_BUFFER_SIZE+MAD_BUFFER_GUARD];
+  struct mad_stream mpeg_stream;
+  struct mad_frame mpeg_frame;
+  struct mad_synth mpeg_synth;
+  static void (*mad_stream_init)(struct mad_stream *);
+  static void (*mad_frame_init)(struct mad_frame *);
+  static void (*mad_synth_init)(struct mad_synth *);
+  static void (*mad_stream_buffer)(struct mad_stream *,unsigned char const *,
+				   unsigned long);
+  static int (*mad_frame_decode)(struct mad_frame *, struct mad_stream *);
+  static void (*mad_synth_frame)(struct mad_synth *, struct mad_frame const *);
+  static void (*mad_frame_finish)(struct mad_frame *);
+  static void (*mad_stream_finish)(struct mad_stream *);
+#endif  // HAVE_MAD
+  static void *mad_handle;
+  static int mad_loaded;
+};
+
+
+#endif  // DECODER_MPEG_H
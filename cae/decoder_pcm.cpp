@@ -0,0 +1,129 @@
+// decoder_pcm.cpp
+//
+// PCM and Ogg Vorbis playout decoder for caed(8).
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+
+#include "decoder_pcm.h"
+#include "mixbus.h"
+
+CaeDecoderPcm::CaeDecoderPcm(RDWaveFile *wave)
+  : CaeDecoder(wave)
+{
+  pcm_sample_size=2;
+  if((wave->getFormatTag()==WAVE_FORMAT_PCM)&&
+     (wave->getBitsPerSample()==24)) {
+    pcm_sample_size=3;
+  }
+  pcm_frame_size=pcm_sample_size*channels();
+  pcm_buffer=new uint8_t[DECODER_PCM_BLOCK_FRAMES*pcm_frame_size];
+  pcm_buffer32=NULL;
+  if(pcm_sample_size==3) {
+    pcm_buffer32=new int32_t[DECODER_PCM_BLOCK_FRAMES*channels()];
+  }
+
+  //
+  // Where possible, convert straight out of the page cache rather than
+  // copying each block through read()
+  //
+  wave->mapWave();
+}
+
+
+CaeDecoderPcm::~CaeDecoderPcm()
+{
+  delete[] pcm_buffer;
+  if(pcm_buffer32!=NULL) {
+    delete[] pcm_buffer32;
+  }
+}
+
+
+unsigned CaeDecoderPcm::SeekData(unsigned frame)
+{
+  int offset=wave()->seekWave(frame*pcm_frame_size,SEEK_SET);
+
+  if(offset<0) {
+    return 0;
+  }
+  return offset/pcm_frame_size;
+}
+
+
+unsigned CaeDecoderPcm::DecodeData(float *pcm,unsigned frames)
+{
+  volatile unsigned total=0;
+  unsigned want=0;
+  unsigned n=0;
+  int r=0;
+  const uint8_t *data=pcm_buffer;
+  bool mapped=wave()->isMapped();
+  sigjmp_buf env;
+
+  if(mapped) {
+    if(sigsetjmp(env,1)!=0) {
+      //
+      // The file went away underneath the mapping, so end the stream with
+      // what was converted before the fault
+      //
+      wave()->abandonMap();
+      return total;
+    }
+    RDWaveFile::armMapGuard(&env);
+  }
+  while(total<frames) {
+    want=frames-total;
+    if(want>DECODER_PCM_BLOCK_FRAMES) {
+      want=DECODER_PCM_BLOCK_FRAMES;
+    }
+    if(mapped) {
+      r=wave()->mapReadWave((const void **)&data,want*pcm_frame_size);
+    }
+    else {
+      r=wave()->readWave(pcm_buffer,want*pcm_frame_size);
+    }
+    if(r<=0) {
+      break;
+    }
+    n=r/pcm_frame_size;
+    if(pcm_sample_size==3) {
+      //
+      // Left justify into 32 bits; the low byte is left at zero
+      //
+      for(unsigned i=0;i<n*channels();i++) {
+	pcm_buffer32[i]=(int32_t)(((uint32_t)data[3*i]<<8)|
+				  ((uint32_t)data[3*i+1]<<16)|
+				  ((uint32_t)data[3*i+2]<<24));
+      }
+      MixBusS32ToFloat(pcm,pcm_buffer32,n*channels());
+    }
+    else {
+      MixBusS16ToFloat(pcm,(const int16_t *)data,n*channels());
+    }
+    pcm+=n*channels();
+    total+=n;
+    if(n<want) {
+      break;
+    }
+  }
+  if(mapped) {
+    RDWaveFile::disarmMapGuard();
+  }
+
+  return total;
+}
@@ -0,0 +1,53 @@
+// decoder_pcm.h
+//
+// PCM and Ogg Vorbis playout decoder for caed(8).
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+
+#ifndef DECODER_PCM_H
+#define DECODER_PCM_H
+
+#include <stdint.h>
+
+#include "decoder.h"
+
+#define DECODER_PCM_BLOCK_FRAMES 4096
+
+//
+// Handles linear PCM16 and PCM24, plus Ogg Vorbis (which RDWaveFile
+// already hands back as PCM16).
+//
+class CaeDecoderPcm : public CaeDecoder
+{
+ public:
+  CaeDecoderPcm(RDWaveFile *wave);
+  ~CaeDecoderPcm();
+
+ protected:
+  unsigned SeekData(unsigned frame);
+  unsigned DecodeData(float *pcm,unsigned frames);
+
+ private:
+  unsigned pcm_sample_size;
+  unsigned pcm_frame_size;
+  uint8_t *pcm_buffer;
+  int32_t *pcm_buffer32;
+};
+
+
+#endif  // DECODER_PCM_H
@@ -18,8 +18,6 @@
 //   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 //
 
-#include <dlfcn.h>
-
 #include "driver.h"
 
 Driver::Driver(RDStation::AudioDriver type,QObject *parent)
@@ -27,11 +25,39 @@ Driver::Driver(RDStation::AudioDriver type,QObject *parent)
 {
   d_driver_type=type;
   d_system_sample_rate=rda->system()->sampleRate();
-  twolame_handle=NULL;
-  mad_handle=NULL;
+  d_reader_pool=NULL;
+  d_max_streams=rda->config()->caeMaxStreams();
+  d_loudness_meters=rda->config()->caeLoudnessMeters();
+  for(int i=0;i<RD_MAX_CARDS;i++) {
+    d_stream_stats[i]=NULL;
+    d_stream_loudness[i]=NULL;
+    for(int j=0;j<RD_MAX_PORTS;j++) {
+      d_output_loudness[i][j]=NULL;
+      d_silence_sense[i][j]=NULL;
+    }
+  }
+}
+
+
+Driver::~Driver()
+{
+  stopReaderPool();
   for(int i=0;i<RD_MAX_CARDS;i++) {
-    for(int j=0;j<RD_MAX_STREAMS;j++) {
-      twolame_lameopts[i][j]=NULL;
+    if(d_stream_stats[i]!=NULL) {
+      for(int j=0;j<d_max_streams;j++) {
+	delete d_stream_stats[i][j];
+      }
+      delete[] d_stream_stats[i];
+    }
+    if(d_stream_loudness[i]!=NULL) {
+      for(int j=0;j<d_max_streams;j++) {
+	delete d_stream_loudness[i][j];
+      }
+      delete[] d_stream_loudness[i];
+    }
+    for(int j=0;j<RD_MAX_PORTS;j++) {
+      delete d_output_loudness[i][j];
+      delete d_silence_sense[i][j];
     }
   }
 }
@@ -49,6 +75,87 @@ bool Driver::hasCard(int cardnum) const
 }
 
 
+int Driver::maxStreams() const
+{
+  //
+  // Play stream numbers on each of the driver's cards run from 0 to
+  // maxStreams()-1
+  //
+  return d_max_streams;
+}
+
+
+bool Driver::getSampleClock(int card,uint64_t *clock,unsigned *samprate)
+{
+  //
+  // Drivers that can carry out transitions at a given sample clock
+  // position override this and the *At() methods below
+  //
+  return false;
+}
+
+
+bool Driver::playAt(int card,int stream,uint64_t clock,int length,
+		    int speed,bool pitch,bool rates)
+{
+  return false;
+}
+
+
+bool Driver::stopPlaybackAt(int card,int stream,uint64_t clock)
+{
+  return false;
+}
+
+
+bool Driver::fadeOutputVolumeAt(int card,int stream,int port,int level,
+				int length,uint64_t clock)
+{
+  return false;
+}
+
+
+void Driver::fillStream(int card,int stream,ReaderBuffer *buf)
+{
+}
+
+
+unsigned Driver::xruns(int card) const
+{
+  return 0;
+}
+
+
+StreamStats *Driver::streamStats(int card,int stream) const
+{
+  return d_stream_stats[card][stream];
+}
+
+
+LoudnessMeter *Driver::streamLoudness(int card,int stream) const
+{
+  //
+  // NULL unless loudness metering is enabled and the stream has been used
+  //
+  if(d_stream_loudness[card]==NULL) {
+    return NULL;
+  }
+  return d_stream_loudness[card][stream];
+}
+
+
+LoudnessMeter *Driver::outputLoudness(int card,int port) const
+{
+  return d_output_loudness[card][port];
+}
+
+
+SilenceSense *Driver::silenceSense(int card,int port) const
+{
+  return d_silence_sense[card][port];
+}
+
+
 void Driver::processBuffers()
 {
 }
@@ -75,179 +182,130 @@ void Driver::addCard(unsigned cardnum)
 		cardnum);
   }
   else {
+    allocateStreams(cardnum);
     d_cards.push_back(cardnum);
   }
 }
 
 
-unsigned Driver::systemSampleRate() const
+void Driver::allocateStreams(unsigned cardnum)
 {
-  return d_system_sample_rate;
+  //
+  // Drivers whose callbacks start before the card is added must call this
+  // first, as the callbacks use the statistics objects
+  //
+  if(d_stream_stats[cardnum]==NULL) {
+    d_stream_stats[cardnum]=new StreamStats *[d_max_streams];
+    for(int i=0;i<d_max_streams;i++) {
+      d_stream_stats[cardnum][i]=new StreamStats();
+    }
+    for(int i=0;i<RD_MAX_PORTS;i++) {
+      d_silence_sense[cardnum][i]=new SilenceSense();
+    }
+    if(d_loudness_meters) {
+      d_stream_loudness[cardnum]=new LoudnessMeter *[d_max_streams];
+      for(int i=0;i<d_max_streams;i++) {
+	d_stream_loudness[cardnum][i]=NULL;
+      }
+      for(int i=0;i<RD_MAX_PORTS;i++) {
+	d_output_loudness[cardnum][i]=new LoudnessMeter(d_system_sample_rate);
+      }
+    }
+  }
+  if(d_reader_pool!=NULL) {
+    d_reader_pool->addCard(cardnum);
+  }
 }
 
 
-bool Driver::LoadTwoLame()
+void Driver::setMaxStreams(int streams)
 {
-#ifdef HAVE_TWOLAME
-  if((twolame_handle=dlopen("libtwolame.so.0",RTLD_NOW))==NULL) {
-    rda->syslog(LOG_INFO,
-	   "TwoLAME encoder library not found, MPEG L2 encoding not supported");
-    return false;
+  //
+  // For drivers with a fixed limit of their own.  Must be called before
+  // any cards are added.
+  //
+  if(streams<d_max_streams) {
+    d_max_streams=streams;
   }
-  *(void **)(&twolame_init)=dlsym(twolame_handle,"twolame_init");
-  *(void **)(&twolame_set_mode)=dlsym(twolame_handle,"twolame_set_mode");
-  *(void **)(&twolame_set_num_channels)=
-    dlsym(twolame_handle,"twolame_set_num_channels");
-  *(void **)(&twolame_set_in_samplerate)=
-    dlsym(twolame_handle,"twolame_set_in_samplerate");
-  *(void **)(&twolame_set_out_samplerate)=
-    dlsym(twolame_handle,"twolame_set_out_samplerate");
-  *(void **)(&twolame_set_bitrate)=
-    dlsym(twolame_handle,"twolame_set_bitrate");
-  *(void **)(&twolame_init_params)=
-    dlsym(twolame_handle,"twolame_init_params");
-  *(void **)(&twolame_close)=dlsym(twolame_handle,"twolame_close");
-  *(void **)(&twolame_encode_buffer_interleaved)=
-    dlsym(twolame_handle,"twolame_encode_buffer_interleaved");
-  *(void **)(&twolame_encode_buffer_float32_interleaved)=
-    dlsym(twolame_handle,"twolame_encode_buffer_float32_interleaved");
-  *(void **)(&twolame_encode_flush)=
-    dlsym(twolame_handle,"twolame_encode_flush");
-  *(void **)(&twolame_set_energy_levels)=
-    dlsym(twolame_handle,"twolame_set_energy_levels");
-  rda->syslog(LOG_INFO,
-	 "Found TwoLAME encoder library, MPEG L2 encoding supported");
-  return true;
-#else
-  rda->syslog(LOG_INFO,"MPEG L2 encoding not enabled");
-
-  return false;
-#endif  // HAVE_TWOLAME
 }
 
 
-bool Driver::InitTwoLameEncoder(int card,int stream,int chans,int samprate,
-				    int bitrate)
+LoudnessMeter *Driver::addStreamLoudness(int card,int stream)
 {
-  if(twolame_handle==NULL) {
-    rda->syslog(LOG_WARNING,"MPEG Layer 2 encode not available");
-    return false;
+  //
+  // Called from the main thread when a stream is first used, before the
+  // callback can see it.  Returns NULL if loudness metering is disabled.
+  //
+  if(d_stream_loudness[card]==NULL) {
+    return NULL;
   }
-#ifdef HAVE_TWOLAME
-  TWOLAME_MPEG_mode mpeg_mode=TWOLAME_STEREO;
+  if(d_stream_loudness[card][stream]==NULL) {
+    d_stream_loudness[card][stream]=new LoudnessMeter(d_system_sample_rate);
+  }
+  return d_stream_loudness[card][stream];
+}
 
-  switch(chans) {
-  case 1:
-    mpeg_mode=TWOLAME_MONO;
-    break;
 
-  case 2:
-    mpeg_mode=TWOLAME_STEREO;    
-    break;
-  }
-  if((twolame_lameopts[card][stream]=twolame_init())==NULL) {
-    rda->syslog(LOG_WARNING,
-	   "unable to initialize twolame instance, card=%d, stream=%d",
-	   card,stream);
-    return false;
-  }
-  twolame_set_mode(twolame_lameopts[card][stream],mpeg_mode);
-  twolame_set_num_channels(twolame_lameopts[card][stream],chans);
-  twolame_set_in_samplerate(twolame_lameopts[card][stream],samprate);
-  twolame_set_out_samplerate(twolame_lameopts[card][stream],samprate);
-  twolame_set_bitrate(twolame_lameopts[card][stream],bitrate/1000);
-  twolame_set_energy_levels(twolame_lameopts[card][stream],1);
-  if(twolame_init_params(twolame_lameopts[card][stream])!=0) {
-    rda->syslog(LOG_WARNING,
-			  "invalid twolame parameters, card=%d, stream=%d, chans=%d, samprate=%d  bitrate=%d",
-			  card,stream,chans,samprate,bitrate);
-    return false;
-  }
-  return true;
-#else
-  return false;
-#endif  // HAVE_TWOLAME
+void Driver::setLoudnessMeters(bool state)
+{
+  //
+  // For drivers that do not mix in software.  Must be called before any
+  // cards are added.
+  //
+  d_loudness_meters=d_loudness_meters&&state;
+}
+
+
+unsigned Driver::systemSampleRate() const
+{
+  return d_system_sample_rate;
 }
 
 
-void Driver::FreeTwoLameEncoder(int card,int stream)
+unsigned Driver::playRingSize(unsigned sample_size) const
 {
-#ifdef HAVE_TWOLAME
-  if(twolame_lameopts[card][stream]!=NULL) { 
-    twolame_close(&twolame_lameopts[card][stream]);
-    twolame_lameopts[card][stream]=NULL;
+  //
+  // Big enough to hold the configured preroll of stereo audio
+  //
+  unsigned size=RINGBUFFER_SIZE;
+  uint64_t preroll=(uint64_t)rda->config()->caePrerollLength()*
+    d_system_sample_rate*2*sample_size/1000;
+  while(size<=preroll) {
+    size*=2;
   }
-#endif  // HAVE_TWOLAME
+  return size;
 }
 
 
-bool Driver::LoadMad()
+void Driver::startReaderPool(unsigned bufsize,bool timescale)
 {
-#ifdef HAVE_MAD
-  if((mad_handle=dlopen("libmad.so.0",RTLD_NOW))==NULL) {
+  int ts_threads=0;
+
+  if(d_reader_pool==NULL) {
+    if(timescale) {
+      ts_threads=rda->config()->caeTimescaleThreads();
+    }
+    d_reader_pool=new ReaderPool(this,rda->config()->caeReaderThreads(),
+				 ts_threads,d_max_streams,bufsize);
     rda->syslog(LOG_INFO,
-	   "MAD decoder library not found, MPEG L2 decoding not supported");
-    return false;
+		"%s driver started %d reader thread(s), %d timescale thread(s)",
+		RDStation::audioDriverText(d_driver_type).toUtf8().constData(),
+		d_reader_pool->threadQuantity(),
+		d_reader_pool->timescaleThreadQuantity());
   }
-  *(void **)(&mad_stream_init)=
-    dlsym(mad_handle,"mad_stream_init");
-  *(void **)(&mad_frame_init)=
-    dlsym(mad_handle,"mad_frame_init");
-  *(void **)(&mad_synth_init)=
-    dlsym(mad_handle,"mad_synth_init");
-  *(void **)(&mad_stream_buffer)=
-    dlsym(mad_handle,"mad_stream_buffer");
-  *(void **)(&mad_frame_decode)=
-    dlsym(mad_handle,"mad_frame_decode");
-  *(void **)(&mad_synth_frame)=
-    dlsym(mad_handle,"mad_synth_frame");
-  *(void **)(&mad_frame_finish)=
-    dlsym(mad_handle,"mad_frame_finish");
-  *(void **)(&mad_stream_finish)=
-    dlsym(mad_handle,"mad_stream_finish");
-  rda->syslog(LOG_INFO,
-	 "Found MAD decoder library, MPEG L2 decoding supported");
-  return true;
-#else
-  rda->syslog(LOG_INFO,"MPEG L2 decoding not enabled");
-  return false;
-#endif  // HAVE_MAD
 }
 
 
-bool Driver::InitMadDecoder(int card,int stream,RDWaveFile *wave)
+void Driver::stopReaderPool()
 {
-  if(mad_handle==NULL) {
-    rda->syslog(LOG_WARNING,"MPEG Layer 2 decode not available");
-    return false;
-  }
-#ifdef HAVE_MAD
-  if(mad_active[card][stream]) {
-    FreeMadDecoder(card,stream);
+  if(d_reader_pool!=NULL) {
+    delete d_reader_pool;
+    d_reader_pool=NULL;
   }
-  mad_stream_init(&mad_stream[card][stream]);
-  mad_frame_init(&mad_frame[card][stream]);
-  mad_synth_init(&mad_synth[card][stream]);
-  mad_frame_size[card][stream]=
-    144*wave->getHeadBitRate()/wave->getSamplesPerSec();
-  mad_left_over[card][stream]=0;
-  mad_active[card][stream]=true;
-  return true;
-#endif  // HAVE_MAD
-  return false;
 }
 
 
-void Driver::FreeMadDecoder(int card,int stream)
+ReaderPool *Driver::readerPool() const
 {
-#ifdef HAVE_MAD
-  if(mad_active[card][stream]) {
-    mad_synth_finish(&mad_synth[card][stream]);
-    mad_frame_finish(&mad_frame[card][stream]);
-    mad_stream_finish(&mad_stream[card][stream]);
-    mad_frame_size[card][stream]=0;
-    mad_left_over[card][stream]=0;
-    mad_active[card][stream]=false;
-  }
-#endif  // HAVE_MAD
+  return d_reader_pool;
 }
@@ -21,13 +21,6 @@
 #ifndef DRIVER_H
 #define DRIVER_H
 
-#ifdef HAVE_TWOLAME
-#include <twolame.h>
-#endif  // HAVE_TWOLAME
-#ifdef HAVE_MAD
-#include <mad.h>
-#endif  // HAVE_MAD
-
 #include <QList>
 #include <QObject>
 #include <QSignalMapper>
@@ -35,6 +28,13 @@
 #include <rdapplication.h>
 #include <rdwavefile.h>
 
+#include "faderamp.h"
+#include "loudnessmeter.h"
+#include "playschedule.h"
+#include "readerpool.h"
+#include "silencesense.h"
+#include "streamstats.h"
+
 #define RINGBUFFER_SIZE 262144
 
 extern void SigHandler(int signum);
@@ -44,8 +44,10 @@ class Driver : public QObject
   Q_OBJECT
  public:
   Driver(RDStation::AudioDriver type,QObject *parent=0);
+  ~Driver();
   RDStation::AudioDriver driverType() const;
   bool hasCard(int cardnum) const;
+  int maxStreams() const;
   virtual QString version() const=0;
   virtual bool initialize(unsigned *next_cardnum)=0;;
   virtual int inputPortQuantity(int card) const=0;
@@ -80,6 +82,18 @@ class Driver : public QObject
   virtual bool setPassthroughLevel(int card,int in_port,int out_port,
 				   int level)=0;
   virtual void getOutputPosition(int card,unsigned *pos)=0;
+  virtual bool getSampleClock(int card,uint64_t *clock,unsigned *samprate);
+  virtual bool playAt(int card,int stream,uint64_t clock,int length,
+		      int speed,bool pitch,bool rates);
+  virtual bool stopPlaybackAt(int card,int stream,uint64_t clock);
+  virtual bool fadeOutputVolumeAt(int card,int stream,int port,int level,
+				  int length,uint64_t clock);
+  virtual void fillStream(int card,int stream,ReaderBuffer *buf);
+  virtual unsigned xruns(int card) const;
+  StreamStats *streamStats(int card,int stream) const;
+  LoudnessMeter *streamLoudness(int card,int stream) const;
+  LoudnessMeter *outputLoudness(int card,int port) const;
+  SilenceSense *silenceSense(int card,int port) const;
 
  signals:
   void playStateChanged(int card,int stream,int state);
@@ -94,64 +108,28 @@ class Driver : public QObject
 
  protected:
   void addCard(unsigned cardnum);
+  void allocateStreams(unsigned cardnum);
+  void setMaxStreams(int streams);
+  LoudnessMeter *addStreamLoudness(int card,int stream);
+  void setLoudnessMeters(bool state);
   unsigned systemSampleRate() const;
   RDConfig *config() const;
-  //
-  // TwoLAME Encoder
-  //
-  bool LoadTwoLame();
-  bool InitTwoLameEncoder(int card,int stream,int chans,int samprate,
-			  int bitrate);
-  void FreeTwoLameEncoder(int card,int stream);
-  void *twolame_handle;
-#ifdef HAVE_TWOLAME
-  twolame_options *(*twolame_init)(void);
-  void (*twolame_set_mode)(twolame_options *,TWOLAME_MPEG_mode);
-  void (*twolame_set_num_channels)(twolame_options *,int);
-  void (*twolame_set_in_samplerate)(twolame_options *,int);
-  void (*twolame_set_out_samplerate)(twolame_options *,int);
-  void (*twolame_set_bitrate)(twolame_options *,int);
-  int (*twolame_init_params)(twolame_options *);
-  void (*twolame_close)(twolame_options **);
-  int (*twolame_encode_buffer_interleaved)(twolame_options *,const short int[],
-					   int,unsigned char *,int);
-  int (*twolame_encode_buffer_float32_interleaved)
-    (twolame_options *,const float[],int,unsigned char *,int);
-  int (*twolame_encode_flush)(twolame_options *,unsigned char *,int);
-  int (*twolame_set_energy_levels)(twolame_options *,int);
-  twolame_options *twolame_lameopts[RD_MAX_CARDS][RD_MAX_STREAMS];
-#endif  // HAVE_TWOLAME
-
-  //
-  // MAD Decoder
-  //
-  bool LoadMad();
-  bool InitMadDecoder(int card,int stream,RDWaveFile *wave);
-  void FreeMadDecoder(int card,int stream);
-  void *mad_handle;
-#ifdef HAVE_MAD
-  void (*mad_stream_init)(struct mad_stream *);
-  void (*mad_frame_init)(struct mad_frame *);
-  void (*mad_synth_init)(struct mad_synth *);
-  void (*mad_stream_buffer)(struct mad_stream *,unsigned char const *,
-			    unsigned long);
-  int (*mad_frame_decode)(struct mad_frame *, struct mad_stream *);
-  void (*mad_synth_frame)(struct mad_synth *, struct mad_frame const *);
-  void (*mad_frame_finish)(struct mad_frame *);
-  void (*mad_stream_finish)(struct mad_stream *);
-  struct mad_stream mad_stream[RD_MAX_CARDS][RD_MAX_STREAMS];
-  struct mad_frame mad_frame[RD_MAX_CARDS][RD_MAX_STREAMS];
-  struct mad_synth mad_synth[RD_MAX_CARDS][RD_MAX_STREAMS];
-  bool mad_active[RD_MAX_CARDS][RD_MAX_STREAMS];
-  int mad_frame_size[RD_MAX_CARDS][RD_MAX_STREAMS];
-  int mad_left_over[RD_MAX_CARDS][RD_MAX_STREAMS];
-  unsigned char *mad_mpeg[RD_MAX_CARDS][RD_MAX_STREAMS];
-#endif  // HAVE_MAD
+  unsigned playRingSize(unsigned sample_size) const;
+  void startReaderPool(unsigned bufsize,bool timescale=false);
+  void stopReaderPool();
+  ReaderPool *readerPool() const;
 
  private:
   RDStation::AudioDriver d_driver_type;
   QList<unsigned> d_cards;
   unsigned d_system_sample_rate;
+  ReaderPool *d_reader_pool;
+  int d_max_streams;
+  StreamStats **d_stream_stats[RD_MAX_CARDS];
+  bool d_loudness_meters;
+  LoudnessMeter **d_stream_loudness[RD_MAX_CARDS];
+  LoudnessMeter *d_output_loudness[RD_MAX_CARDS][RD_MAX_PORTS];
+  SilenceSense *d_silence_sense[RD_MAX_CARDS][RD_MAX_PORTS];
 };
 
 
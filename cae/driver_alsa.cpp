@@ -20,36 +20,57 @@
 
 #include <math.h>
 #include <signal.h>
+#include <string.h>
+
+#include <atomic>
 
 #include <rdconf.h>
 #include <rdmeteraverage.h>
-#include <rdringbuffer.h>
+#include <rdspscring.h>
 
 #include "driver_alsa.h"
+#include "mixbus.h"
+#include "recorddeck.h"
 
 #ifdef ALSA
 //
 // Callback Variables
 //
+// Per-stream tables are allocated by AlsaInitStreams() for each card, and
+// are indexed by stream number.  Stream output meters take two entries
+// (left, right) per stream.
+//
 volatile int alsa_input_channels[RD_MAX_CARDS][RD_MAX_PORTS];
-volatile int alsa_output_channels[RD_MAX_CARDS][RD_MAX_STREAMS];
+volatile int *alsa_output_channels[RD_MAX_CARDS];
 RDMeterAverage *alsa_input_meter[RD_MAX_CARDS][RD_MAX_PORTS][2];
 RDMeterAverage *alsa_output_meter[RD_MAX_CARDS][RD_MAX_PORTS][2];
-RDMeterAverage *alsa_stream_output_meter[RD_MAX_CARDS][RD_MAX_STREAMS][2];
+RDMeterAverage **alsa_stream_output_meter[RD_MAX_CARDS];
 volatile double alsa_input_volume[RD_MAX_CARDS][RD_MAX_PORTS];
-volatile double alsa_output_volume[RD_MAX_CARDS][RD_MAX_PORTS][RD_MAX_STREAMS];
+volatile double *alsa_output_volume[RD_MAX_CARDS][RD_MAX_PORTS];
 volatile double
   alsa_passthrough_volume[RD_MAX_CARDS][RD_MAX_PORTS][RD_MAX_PORTS];
 volatile double alsa_input_vox[RD_MAX_CARDS][RD_MAX_PORTS];
-RDRingBuffer *alsa_play_ring[RD_MAX_CARDS][RD_MAX_STREAMS];
-RDRingBuffer *alsa_record_ring[RD_MAX_CARDS][RD_MAX_PORTS];
-RDRingBuffer *alsa_passthrough_ring[RD_MAX_CARDS][RD_MAX_PORTS];
-volatile bool alsa_playing[RD_MAX_CARDS][RD_MAX_STREAMS];
-volatile bool alsa_stopping[RD_MAX_CARDS][RD_MAX_STREAMS];
-volatile bool alsa_eof[RD_MAX_CARDS][RD_MAX_STREAMS];
-volatile int alsa_output_pos[RD_MAX_CARDS][RD_MAX_STREAMS];
+RDSpscRing **alsa_play_ring[RD_MAX_CARDS];
+RDSpscRing *alsa_record_ring[RD_MAX_CARDS][RD_MAX_PORTS];
+RecordDeck *alsa_record_deck[RD_MAX_CARDS][RD_MAX_PORTS];
+RDSpscRing *alsa_passthrough_ring[RD_MAX_CARDS][RD_MAX_PORTS];
+volatile bool *alsa_playing[RD_MAX_CARDS];
+volatile bool *alsa_stopping[RD_MAX_CARDS];
+volatile bool *alsa_eof[RD_MAX_CARDS];
+volatile int *alsa_output_pos[RD_MAX_CARDS];
 volatile bool alsa_recording[RD_MAX_CARDS][RD_MAX_PORTS];
 volatile bool alsa_ready[RD_MAX_CARDS][RD_MAX_PORTS];
+ReaderPool *alsa_reader_pool;
+volatile unsigned alsa_play_ring_low_water;
+FadeRamp **alsa_fade_ramp[RD_MAX_CARDS];
+PlaySchedule **alsa_play_schedule[RD_MAX_CARDS];
+volatile bool *alsa_starting[RD_MAX_CARDS];
+std::atomic<uint64_t> alsa_sample_clock[RD_MAX_CARDS];
+StreamStats **alsa_stream_stats[RD_MAX_CARDS];
+LoudnessMeter **alsa_stream_loudness[RD_MAX_CARDS];
+LoudnessMeter *alsa_output_loudness[RD_MAX_CARDS][RD_MAX_PORTS];
+SilenceSense *alsa_silence_sense[RD_MAX_CARDS][RD_MAX_PORTS];
+std::atomic<unsigned> alsa_xruns[RD_MAX_CARDS];
 
 void *AlsaCaptureCallback(void *ptr)
 {
@@ -68,6 +89,7 @@ void *AlsaCaptureCallback(void *ptr)
 	(!alsa_format->exiting))||(s<0)) {
       snd_pcm_drop (alsa_format->pcm);
       snd_pcm_prepare(alsa_format->pcm);
+      alsa_xruns[alsa_format->card]++;
       rda->syslog(LOG_DEBUG,"****** ALSA Capture Xrun - Card: %d ******",
 		  alsa_format->card);
     }
@@ -91,8 +113,7 @@ void *AlsaCaptureCallback(void *ptr)
 					card_buffer)
 				       [modulo*k+2*i+1]));
 		}
-		alsa_record_ring[alsa_format->card][i]->
-		  write(alsa_buffer,s*sizeof(int16_t));
+		alsa_record_deck[alsa_format->card][i]->capture(alsa_buffer,s);
 		break;
 
 	      case 2:
@@ -108,8 +129,7 @@ void *AlsaCaptureCallback(void *ptr)
 					card_buffer)
 				       [modulo*k+2*i+1]));
 		}
-		alsa_record_ring[alsa_format->card][i]->
-		  write(alsa_buffer,s*2*sizeof(int16_t));
+		alsa_record_deck[alsa_format->card][i]->capture(alsa_buffer,s);
 		break;
 	      }
 	    }
@@ -170,8 +190,7 @@ void *AlsaCaptureCallback(void *ptr)
 					card_buffer)
 				       [modulo*k+4*i+3]));
 		}
-		alsa_record_ring[alsa_format->card][i]->
-		  write(alsa_buffer,s*sizeof(int16_t));
+		alsa_record_deck[alsa_format->card][i]->capture(alsa_buffer,s);
 		break;
 
 	      case 2:
@@ -185,8 +204,7 @@ void *AlsaCaptureCallback(void *ptr)
 			      (double)(((int16_t *)alsa_format->card_buffer)
 				       [modulo*k+4*i+3]));
 		}
-		alsa_record_ring[alsa_format->card][i]->
-		  write(alsa_buffer,s*2*sizeof(int16_t));
+		alsa_record_deck[alsa_format->card][i]->capture(alsa_buffer,s);
 		break;
 	      }
 	    }
@@ -239,269 +257,272 @@ void *AlsaCaptureCallback(void *ptr)
 }
 
 
+//
+// Convert up to 'frames' frames straight out of a ring into 'dst',
+// returning the number of frames consumed.  Only whole frames are taken.
+//
+unsigned AlsaReadRing(RDSpscRing *ring,float *dst,snd_pcm_format_t fmt,
+		      unsigned chans,unsigned frames)
+{
+  RDSpscSpan span;
+  size_t ssize=sizeof(int16_t);
+  size_t fsize=0;
+  size_t n=0;
+
+  switch(fmt) {
+  case SND_PCM_FORMAT_S32_LE:
+  case SND_PCM_FORMAT_FLOAT_LE:
+    ssize=sizeof(int32_t);
+    break;
+
+  default:
+    break;
+  }
+  fsize=chans*ssize;
+  n=ring->readSpace();
+
+  if(n>(frames*fsize)) {
+    n=frames*fsize;
+  }
+  n-=n%fsize;
+  ring->reserveRead(&span,n);
+  for(unsigned i=0;i<2;i++) {
+    if(span.len[i]>0) {
+      switch(fmt) {
+      case SND_PCM_FORMAT_FLOAT_LE:
+	memcpy(dst,span.data[i],span.len[i]);
+	break;
+
+      case SND_PCM_FORMAT_S32_LE:
+	MixBusS32ToFloat(dst,(int32_t *)span.data[i],span.len[i]/ssize);
+	break;
+
+      default:
+	MixBusS16ToFloat(dst,(int16_t *)span.data[i],span.len[i]/ssize);
+	break;
+      }
+      dst+=span.len[i]/ssize;
+    }
+  }
+  ring->commitRead(n);
+
+  return n/fsize;
+}
+
+
 void *AlsaPlayCallback(void *ptr)
 {
   int n=0;
   int p;
-  char alsa_buffer[RINGBUFFER_SIZE];
-  int modulo;
-  int16_t out_meter[RD_MAX_PORTS][2];
-  int16_t stream_out_meter=0;
+  float peaks[2];
+  float volume;
+  float *bus;
+  bool fading;
+  uint64_t clock;
+  unsigned offset;
+  unsigned count;
+  unsigned when;
+  bool stopping;
+  int fade_port;
+  int fade_from;
+  int fade_to;
+  unsigned fade_frames;
 
   struct alsa_format *alsa_format=(struct alsa_format *)ptr;
+  int card=alsa_format->card;
+  unsigned frames=alsa_format->buffer_size/(2*alsa_format->periods);
+  unsigned ports=alsa_format->channels/2;
 
   signal(SIGTERM,SigHandler);
   signal(SIGINT,SigHandler);
 
   while(!alsa_format->exiting) {
-    memset(alsa_format->card_buffer,0,alsa_format->card_buffer_size);
-
-    switch(alsa_format->format) {
-    case SND_PCM_FORMAT_S16_LE:
-      for(unsigned j=0;j<RD_MAX_STREAMS;j++) {
-        if(alsa_playing[alsa_format->card][j]) {
-          switch(alsa_output_channels[alsa_format->card][j]) {
-          case 1:
-            n=alsa_play_ring[alsa_format->card][j]->
-              read(alsa_buffer,alsa_format->
-                   buffer_size/alsa_format->periods)/
-              (2*sizeof(int16_t));
-            stream_out_meter=0;  // Stream Output Meters
-            for(int k=0;k<n;k++) {
-              if(abs(((int16_t *)alsa_buffer)[k])>stream_out_meter) {
-                stream_out_meter=abs(((int16_t *)alsa_buffer)[k]);
-              }
-            }
-            alsa_stream_output_meter[alsa_format->card][j][0]->
-              addValue(((double)stream_out_meter)/32768.0);
-            alsa_stream_output_meter[alsa_format->card][j][1]->
-              addValue(((double)stream_out_meter)/32768.0);
-            modulo=alsa_format->channels;
-            for(unsigned i=0;i<(alsa_format->channels/2);i++) {
-              if(alsa_output_volume[alsa_format->card][i][j]!=0.0) {
-                for(int k=0;k<(2*n);k++) {
-                  ((int16_t *)alsa_format->card_buffer)[modulo*k+2*i]+=
-                    (int16_t)(alsa_output_volume[alsa_format->card][i][j]*
-                              (double)(((int16_t *)alsa_buffer)[k]));
-                  ((int16_t *)alsa_format->card_buffer)[modulo*k+2*i+1]+=
-                    (int16_t)(alsa_output_volume[alsa_format->card][i][j]*
-                              (double)(((int16_t *)alsa_buffer)[k]));
-                }
-              }
-            }
-            n*=2;
-            break;
-
-          case 2:
-            n=alsa_play_ring[alsa_format->card][j]->
-              read(alsa_buffer,alsa_format->buffer_size*2/
-                   alsa_format->periods)/(2*sizeof(int16_t));
-            for(unsigned k=0;k<2;k++) {  // Stream Output Meters
-              stream_out_meter=0;
-              for(int l=0;l<n;l+=2) {
-                if(abs(((int16_t *)alsa_buffer)[l+k])>stream_out_meter) {
-                  stream_out_meter=abs(((int16_t *)alsa_buffer)[l+k]);
-                }
-              }
-              alsa_stream_output_meter[alsa_format->card][j][k]->
-                addValue(((double)stream_out_meter)/32768.0);
-            }
-            modulo=alsa_format->channels;
-            for(unsigned i=0;i<(alsa_format->channels/2);i++) {
-              if(alsa_output_volume[alsa_format->card][i][j]!=0.0) {
-                for(int k=0;k<n;k++) {
-                  ((int16_t *)alsa_format->card_buffer)[modulo*k+2*i]+=
-                    (int16_t)(alsa_output_volume[alsa_format->card][i][j]*
-                              (double)(((int16_t *)alsa_buffer)[2*k]));
-                  ((int16_t *)alsa_format->card_buffer)[modulo*k+2*i+1]+=
-                    (int16_t)(alsa_output_volume[alsa_format->card][i][j]*
-                              (double)(((int16_t *)alsa_buffer)[2*k+1]));
-                }
-              }
-            }
-            break;
-          }
-          alsa_output_pos[alsa_format->card][j]+=n;
-          if((n==0)&&alsa_eof[alsa_format->card][j]) {
-            alsa_stopping[alsa_format->card][j]=true;
-          }
-        }
-      }
-      n=alsa_format->buffer_size/(2*alsa_format->periods);
-
+    //
+    // Mix Streams
+    //
+    // Everything is summed at 32 bit float, one stereo bus per output
+    // port, and only converted back to the card format at the very end.
+    //
+    MixBusZero(alsa_format->mix_buffer,2*frames*ports);
+    clock=alsa_sample_clock[card].load();
+    for(unsigned j=0;j<alsa_format->streams;j++) {
       //
-      // Process Passthroughs
+      // Scheduled transitions.  A stream started or stopped part way
+      // through the period only contributes to the frames on its side of
+      // the transition.
       //
-      for(unsigned i=0;i<alsa_format->capture_channels;i+=2) {
-        p=alsa_passthrough_ring[alsa_format->card][i/2]->
-          read(alsa_format->passthrough_buffer,4*n)/4;
-        bool zero_volume = true;
-        for (unsigned j=0;j<alsa_format->channels && zero_volume;j+=1) {
-          zero_volume = (alsa_passthrough_volume[alsa_format->card][i/2][j] == 0.0);
-        }
-        if (!zero_volume) {
-          for(unsigned j=0;j<alsa_format->channels;j+=2) {
-            double passthrough_volume = alsa_passthrough_volume[alsa_format->card][i/2][j/2];
-            if (passthrough_volume != 0.0) {
-              for(unsigned k=0;k<2;k++) {
-                for(int l=0;l<p;l++) {
-                  ((int16_t *)alsa_format->
-                   card_buffer)[alsa_format->channels*l+j+k]+=
-                    (int16_t)((double)((int16_t *)alsa_format->passthrough_buffer)[2*l+k]*passthrough_volume);
-                }
-              }
-            }
-          }
-        }
+      offset=0;
+      count=frames;
+      stopping=false;
+      if(alsa_play_ring[card][j]!=NULL) {
+	alsa_play_ring[card][j]->serviceFlush();
+	if((!alsa_playing[card][j])&&
+	   alsa_play_schedule[card][j]->take(PlaySchedule::Play,clock,frames,
+					     &offset)) {
+	  alsa_playing[card][j]=true;
+	  alsa_starting[card][j]=true;
+	  count=frames-offset;
+	}
+	if(alsa_playing[card][j]) {
+	  if(alsa_play_schedule[card][j]->take(PlaySchedule::Stop,clock,
+					       frames,&when)) {
+	    count=0;
+	    if(when>offset) {
+	      count=when-offset;
+	    }
+	    stopping=true;
+	  }
+	  if(alsa_play_schedule[card][j]->take(PlaySchedule::Fade,clock,
+					       frames,&when)) {
+	    alsa_play_schedule[card][j]->
+	      fadeParameters(&fade_port,&fade_from,&fade_to,&fade_frames);
+	    alsa_fade_ramp[card][j]->
+	      begin(fade_port,fade_from,fade_to,fade_frames,
+		    when>offset ? when-offset : 0);
+	  }
+	}
       }
+      if(alsa_playing[card][j]) {
+	alsa_stream_stats[card][j]->
+	  updateFill(alsa_play_ring[card][j]->readSpace()/
+		     (sizeof(float)*alsa_output_channels[card][j]));
+	switch(alsa_output_channels[card][j]) {
+	case 1:
+	  n=AlsaReadRing(alsa_play_ring[card][j],alsa_format->scratch_buffer,
+			 SND_PCM_FORMAT_FLOAT_LE,1,count);
+	  peaks[0]=MixBusPeak(alsa_format->scratch_buffer,n);
+	  peaks[1]=peaks[0];
+	  MixBusMonoToStereo(alsa_format->stream_buffer,
+			     alsa_format->scratch_buffer,n);
+	  break;
+
+	case 2:
+	  n=AlsaReadRing(alsa_play_ring[card][j],alsa_format->stream_buffer,
+			 SND_PCM_FORMAT_FLOAT_LE,2,count);
+	  MixBusStereoPeak(alsa_format->stream_buffer,n,peaks);
+	  break;
+
+	default:
+	  n=0;
+	  peaks[0]=0.0;
+	  peaks[1]=0.0;
+	  break;
+	}
+	if(n>0) {
+	  alsa_stream_stats[card][j]->markFirstSample();
+	}
+	if(((unsigned)n<count)&&(!alsa_eof[card][j])) {
+	  alsa_stream_stats[card][j]->addUnderrun();
+	}
+	for(unsigned k=0;k<2;k++) {  // Stream Output Meters
+	  alsa_stream_output_meter[card][2*j+k]->addValue(peaks[k]);
+	}
+	if(alsa_stream_loudness[card][j]!=NULL) {
+	  alsa_stream_loudness[card][j]->
+	    process(alsa_format->stream_buffer,2,n);
+	}
+	fading=alsa_fade_ramp[card][j]->render(alsa_format->fade_buffer,n);
+	for(unsigned i=0;i<ports;i++) {
+	  bus=alsa_format->mix_buffer+2*(frames*i+offset);
+	  if(fading&&((int)i==alsa_fade_ramp[card][j]->port())) {
+	    MixBusAccumulateRamp(bus,alsa_format->stream_buffer,
+				 alsa_format->fade_buffer,n);
+	    continue;
+	  }
+	  volume=alsa_output_volume[card][i][j];
+	  if(volume!=0.0) {
+	    MixBusAccumulate(bus,alsa_format->stream_buffer,volume,2*n);
+	  }
+	}
+	alsa_output_pos[card][j]+=n;
+	if((!alsa_eof[card][j])&&
+	   (alsa_play_ring[card][j]->readSpace()<alsa_play_ring_low_water)) {
+	  alsa_reader_pool->requestFill(card,j);
+	}
+	if(stopping) {
+	  alsa_playing[card][j]=false;
+	  alsa_stopping[card][j]=true;
+	}
+	else {
+	  if((n==0)&&alsa_eof[card][j]) {
+	    alsa_stopping[card][j]=true;
+	  }
+	}
+      }
+    }
 
-      //
-      // Process Output Meters
-      //
-      for(unsigned i=0;i<alsa_format->channels;i+=2) {
-        unsigned port=i/2;
-        for(unsigned j=0;j<2;j++) {
-          out_meter[port][j]=0;
-          for(unsigned k=0;k<alsa_format->buffer_size;k++) {
-            int16_t sample = ((int16_t *)alsa_format->
-                              card_buffer)[alsa_format->channels*k+2*i+j];
-
-            if(sample> out_meter[i][j]) {
-              out_meter[i][j]= sample;
-            }
-          }
-          alsa_output_meter[alsa_format->card][i][j]->
-            addValue(((double)out_meter[i][j])/32768.0);
-        }
+    //
+    // Process Passthroughs
+    //
+    for(unsigned i=0;i<alsa_format->capture_channels;i+=2) {
+      switch(alsa_format->format) {
+      case SND_PCM_FORMAT_S16_LE:
+      case SND_PCM_FORMAT_S32_LE:
+	p=AlsaReadRing(alsa_passthrough_ring[card][i/2],
+		       alsa_format->stream_buffer,alsa_format->format,2,
+		       frames);
+	break;
+
+      default:
+	p=0;
+	break;
       }
-      break;
-
-    case SND_PCM_FORMAT_S32_LE:
-      for(unsigned j=0;j<RD_MAX_STREAMS;j++) {
-        if(alsa_playing[alsa_format->card][j]) {
-          switch(alsa_output_channels[alsa_format->card][j]) {
-          case 1:
-            n=alsa_play_ring[alsa_format->card][j]->
-              read(alsa_buffer,alsa_format->buffer_size/
-                   alsa_format->periods)/(2*sizeof(int16_t));
-            stream_out_meter=0;
-            for(int k=0;k<n;k++) {  // Stream Output Meters
-              if(abs(((int16_t *)alsa_buffer)[k])>stream_out_meter) {
-                stream_out_meter=abs(((int16_t *)alsa_buffer)[k]);
-              }
-            }
-            alsa_stream_output_meter[alsa_format->card][j][0]->
-              addValue(((double)stream_out_meter)/32768.0);
-            alsa_stream_output_meter[alsa_format->card][j][1]->
-              addValue(((double)stream_out_meter)/32768.0);
-            modulo=alsa_format->channels*2;
-            for(unsigned i=0;i<(alsa_format->channels/2);i++) {
-              if(alsa_output_volume[alsa_format->card][i][j]!=0.0) {
-                for(int k=0;k<(2*n);k++) {
-                  ((int16_t *)alsa_format->card_buffer)[modulo*k+4*i+1]+=
-                    (int16_t)(alsa_output_volume[alsa_format->card][i][j]*
-                              (double)(((int16_t *)alsa_buffer)[k]));
-                  ((int16_t *)alsa_format->card_buffer)[modulo*k+4*i+3]+=
-                    (int16_t)(alsa_output_volume[alsa_format->card][i][j]*
-                              (double)(((int16_t *)alsa_buffer)[k]));
-                }
-              }
-            }
-            n*=2;
-            break;
-
-          case 2:
-            n=alsa_play_ring[alsa_format->card][j]->
-              read(alsa_buffer,alsa_format->buffer_size*2/
-                   alsa_format->periods)/(2*sizeof(int16_t));
-            for(unsigned k=0;k<2;k++) {  // Stream Output Meters
-              stream_out_meter=0;
-              for(int l=0;l<n;l+=2) {
-                if(abs(((int16_t *)alsa_buffer)[l+k])>stream_out_meter) {
-                  stream_out_meter=abs(((int16_t *)alsa_buffer)[l+k]);
-                }
-              }
-              alsa_stream_output_meter[alsa_format->card][j][k]->
-                addValue(((double)stream_out_meter)/32768.0);
-            }
-            modulo=alsa_format->channels*2;
-            for(unsigned i=0;i<(alsa_format->channels/2);i++) {
-              if(alsa_output_volume[alsa_format->card][i][j]!=0.0) {
-                for(int k=0;k<n;k++) {
-                  ((int16_t *)alsa_format->card_buffer)[modulo*k+4*i+1]+=
-                    (int16_t)(alsa_output_volume[alsa_format->card][i][j]*
-                              (double)(((int16_t *)alsa_buffer)[2*k]));
-                  ((int16_t *)alsa_format->card_buffer)[modulo*k+4*i+3]+=
-                    (int16_t)(alsa_output_volume[alsa_format->card][i][j]*
-                              (double)(((int16_t *)alsa_buffer)[2*k+1]));
-                }
-              }
-            }
-            break;
-          }
-          alsa_output_pos[alsa_format->card][j]+=n;
-          if((n==0)&&alsa_eof[alsa_format->card][j]) {
-            alsa_stopping[alsa_format->card][j]=true;
-            // Empty the ring buffer
-            while(alsa_play_ring[alsa_format->card][j]->
-                  read(alsa_buffer,alsa_format->buffer_size*2/
-                       alsa_format->periods)/(2*sizeof(int16_t))>0);
-          }
-        }
+      for(unsigned j=0;j<ports;j++) {
+	volume=alsa_passthrough_volume[card][i/2][j];
+	if(volume!=0.0) {
+	  MixBusAccumulate(alsa_format->mix_buffer+2*frames*j,
+			   alsa_format->stream_buffer,volume,2*p);
+	}
       }
-      n=alsa_format->buffer_size/(2*alsa_format->periods);
+    }
 
-      //
-      // Process Passthroughs
-      //
-      for(unsigned i=0;i<alsa_format->capture_channels;i+=2) {
-        p=alsa_passthrough_ring[alsa_format->card][i/2]->
-          read(alsa_format->passthrough_buffer,8*n)/8;
-        bool zero_volume = true;
-        for (unsigned j=0;j<alsa_format->channels && zero_volume;j+=1) {
-          zero_volume = (alsa_passthrough_volume[alsa_format->card][i/2][j] == 0.0);
-        }
-        if (!zero_volume) {
-          for(unsigned j=0;j<alsa_format->channels;j+=2) {
-            double passthrough_volume = alsa_passthrough_volume[alsa_format->card][i/2][j/2];
-            if (passthrough_volume != 0.0) {
-              for(unsigned k=0;k<2;k++) {
-                for(int l=0;l<p;l++) {
-                  ((int32_t *)alsa_format->
-                   card_buffer)[alsa_format->channels*l+j+k]+=
-                    (int32_t)((double)((int32_t *)alsa_format->passthrough_buffer)[2*l+k]*passthrough_volume);
-                }
-              }
-            }
-          }
-        }
+    //
+    // Process Output Meters and Convert to Card Format
+    //
+    // The port buses can legitimately exceed full scale when several
+    // streams overlap, so the conversion saturates rather than wraps.
+    //
+    for(unsigned i=0;i<ports;i++) {
+      bus=alsa_format->mix_buffer+2*frames*i;
+      MixBusStereoPeak(bus,frames,peaks);
+      for(unsigned j=0;j<2;j++) {
+	alsa_output_meter[card][i][j]->addValue(peaks[j]);
       }
-
-      //
-      // Process Output Meters
-      //
-      unsigned buffer_width;
-      buffer_width = (alsa_format->buffer_size*2/alsa_format->periods);
-      for(unsigned i=0;i<alsa_format->channels;i+=2) {
-        unsigned port=i/2;
-        for(unsigned j=0;j<2;j++) {
-          out_meter[port][j]=0;
-          for(unsigned k=0; k<buffer_width; k++) {
-            int16_t sample = ((int16_t *)alsa_format->
-                              card_buffer)[alsa_format->channels*2*k+2*i+1+2*j];
-            if (sample > out_meter[port][j]) {
-              out_meter[port][j] = sample;
-            }
-          }
-          alsa_output_meter[alsa_format->card][port][j]->
-            addValue(((double)out_meter[port][j])/32768.0);
-        }
+      alsa_silence_sense[card][i]->
+	update(peaks[0]>peaks[1] ? peaks[0] : peaks[1],frames);
+      if(alsa_output_loudness[card][i]!=NULL) {
+	alsa_output_loudness[card][i]->process(bus,2,frames);
       }
-      break;
+      switch(alsa_format->format) {
+      case SND_PCM_FORMAT_S16_LE:
+	MixBusFloatToS16((int16_t *)alsa_format->convert_buffer,bus,2*frames,
+			 alsa_format->dithered ? &alsa_format->dither : NULL);
+	for(unsigned k=0;k<frames;k++) {
+	  for(unsigned j=0;j<2;j++) {
+	    ((int16_t *)alsa_format->card_buffer)
+	      [alsa_format->channels*k+2*i+j]=
+	      ((int16_t *)alsa_format->convert_buffer)[2*k+j];
+	  }
+	}
+	break;
 
-    default:
-      break;
+      case SND_PCM_FORMAT_S32_LE:
+	MixBusFloatToS32((int32_t *)alsa_format->convert_buffer,bus,2*frames);
+	for(unsigned k=0;k<frames;k++) {
+	  for(unsigned j=0;j<2;j++) {
+	    ((int32_t *)alsa_format->card_buffer)
+	      [alsa_format->channels*k+2*i+j]=
+	      ((int32_t *)alsa_format->convert_buffer)[2*k+j];
+	  }
+	}
+	break;
+
+      default:
+	break;
+      }
     }
+    n=frames;
+
     int s=snd_pcm_writei(alsa_format->pcm,alsa_format->card_buffer,n);
     if(s!=n) {
       if(s<0) {
@@ -509,7 +530,7 @@ void *AlsaPlayCallback(void *ptr)
 			      "*** alsa error %d: %s",-s,snd_strerror(s));
       }
       else {
-        rda->syslog(LOG_WARNING,
+	rda->syslog(LOG_WARNING,
 			      "period size mismatch - wrote %d",s);
       }
     }
@@ -517,10 +538,12 @@ void *AlsaPlayCallback(void *ptr)
        (!alsa_format->exiting)) {
       snd_pcm_drop (alsa_format->pcm);
       snd_pcm_prepare(alsa_format->pcm);
+      alsa_xruns[card]++;
       rda->syslog(LOG_DEBUG,
 			    "****** ALSA Playout Xrun - Card: %d ******",
 	     alsa_format->card);
     }
+    alsa_sample_clock[card]+=frames;
   }
 
   return 0;
@@ -529,7 +552,7 @@ void *AlsaPlayCallback(void *ptr)
 
 void DriverAlsa::AlsaInitCallback()
 {
-  int avg_periods=
+  alsa_meter_periods=
     (330*systemSampleRate())/(1000*rda->config()->alsaPeriodSize());
   for(int i=0;i<RD_MAX_CARDS;i++) {
     for(int j=0;j<RD_MAX_PORTS;j++) {
@@ -538,27 +561,107 @@ void DriverAlsa::AlsaInitCallback()
       alsa_input_volume[i][j]=1.0;
       alsa_input_vox[i][j]=0.0;
       for(int k=0;k<2;k++) {
-	alsa_input_meter[i][j][k]=new RDMeterAverage(avg_periods);
-	alsa_output_meter[i][j][k]=new RDMeterAverage(avg_periods);
-      }
-      for(int k=0;k<RD_MAX_STREAMS;k++) {
-	alsa_output_volume[i][j][k]=1.0;
+	alsa_input_meter[i][j][k]=new RDMeterAverage(alsa_meter_periods);
+	alsa_output_meter[i][j][k]=new RDMeterAverage(alsa_meter_periods);
       }
-      alsa_passthrough_ring[i][j]=new RDRingBuffer(RINGBUFFER_SIZE);
+      alsa_output_volume[i][j]=NULL;
+      alsa_output_loudness[i][j]=NULL;
+      alsa_silence_sense[i][j]=NULL;
+      alsa_passthrough_ring[i][j]=new RDSpscRing(RINGBUFFER_SIZE);
       alsa_passthrough_ring[i][j]->reset();
       alsa_record_ring[i][j]=NULL;
+      alsa_record_deck[i][j]=NULL;
       for(int k=0;k<RD_MAX_PORTS;k++) {
 	alsa_passthrough_volume[i][j][k]=0.0;
       }
     }
-    for(int j=0;j<RD_MAX_STREAMS;j++) {
-      alsa_play_ring[i][j]=NULL;
-      alsa_playing[i][j]=false;
-      for(int k=0;k<2;k++) {
-	alsa_stream_output_meter[i][j][k]=new RDMeterAverage(avg_periods);
-      }
+    alsa_output_channels[i]=NULL;
+    alsa_stream_output_meter[i]=NULL;
+    alsa_play_ring[i]=NULL;
+    alsa_playing[i]=NULL;
+    alsa_stopping[i]=NULL;
+    alsa_eof[i]=NULL;
+    alsa_output_pos[i]=NULL;
+    alsa_fade_ramp[i]=NULL;
+    alsa_play_schedule[i]=NULL;
+    alsa_starting[i]=NULL;
+    alsa_stream_stats[i]=NULL;
+    alsa_stream_loudness[i]=NULL;
+  }
+}
+
+
+void DriverAlsa::AlsaInitStreams(int card)
+{
+  //
+  // Only the tables are allocated here.  The fade ramp, schedule and
+  // meters behind each stream are created when the stream is first used
+  // (see GetAlsaOutputStream()) and are then kept for reuse.
+  //
+  int streams=maxStreams();
+
+  if(alsa_play_ring[card]!=NULL) {
+    return;
+  }
+  allocateStreams(card);
+  for(int i=0;i<RD_MAX_PORTS;i++) {
+    alsa_output_loudness[card][i]=outputLoudness(card,i);
+    alsa_silence_sense[card][i]=silenceSense(card,i);
+    alsa_output_volume[card][i]=new volatile double[streams];
+    alsa_output_volume_db[card][i]=new short[streams];
+    for(int j=0;j<streams;j++) {
+      alsa_output_volume[card][i][j]=1.0;
+      alsa_output_volume_db[card][i][j]=0;
     }
   }
+  alsa_output_channels[card]=new volatile int[streams];
+  alsa_stream_output_meter[card]=new RDMeterAverage *[2*streams];
+  alsa_playing[card]=new volatile bool[streams];
+  alsa_stopping[card]=new volatile bool[streams];
+  alsa_eof[card]=new volatile bool[streams];
+  alsa_output_pos[card]=new volatile int[streams];
+  alsa_fade_ramp[card]=new FadeRamp *[streams];
+  alsa_play_schedule[card]=new PlaySchedule *[streams];
+  alsa_starting[card]=new volatile bool[streams];
+  alsa_stream_stats[card]=new StreamStats *[streams];
+  alsa_stream_loudness[card]=new LoudnessMeter *[streams];
+  alsa_play_wave[card]=new RDWaveFile *[streams];
+  alsa_play_decoder[card]=new CaeDecoder *[streams];
+  alsa_offset[card]=new int[streams];
+  alsa_play_length[card]=new int[streams];
+  alsa_stop_timer[card]=new QTimer *[streams];
+  for(int i=0;i<streams;i++) {
+    alsa_output_channels[card][i]=0;
+    alsa_stream_output_meter[card][2*i]=NULL;
+    alsa_stream_output_meter[card][2*i+1]=NULL;
+    alsa_playing[card][i]=false;
+    alsa_stopping[card][i]=false;
+    alsa_eof[card][i]=false;
+    alsa_output_pos[card][i]=0;
+    alsa_fade_ramp[card][i]=NULL;
+    alsa_play_schedule[card][i]=NULL;
+    alsa_starting[card][i]=false;
+    alsa_stream_stats[card][i]=streamStats(card,i);
+    alsa_stream_loudness[card][i]=NULL;
+    alsa_play_wave[card][i]=NULL;
+    alsa_play_decoder[card][i]=NULL;
+    alsa_offset[card][i]=0;
+    alsa_play_length[card][i]=0;
+    alsa_stop_timer[card][i]=new QTimer(this);
+    alsa_stop_timer[card][i]->setSingleShot(true);
+    alsa_stop_mapper->setMapping(alsa_stop_timer[card][i],card*streams+i);
+    connect(alsa_stop_timer[card][i],SIGNAL(timeout()),
+	    alsa_stop_mapper,SLOT(map()));
+  }
+
+  //
+  // The play callback polls this one, so it goes last
+  //
+  RDSpscRing **rings=new RDSpscRing *[streams];
+  for(int i=0;i<streams;i++) {
+    rings[i]=NULL;
+  }
+  alsa_play_ring[card]=rings;
 }
 #endif  // ALSA
 
@@ -573,40 +676,31 @@ DriverAlsa::DriverAlsa(QObject *parent)
   for(int i=0;i<RD_MAX_CARDS;i++) {
     for(int j=0;j<RD_MAX_STREAMS;j++) {
       alsa_input_volume_db[i][j]=0;
-      alsa_samples_recorded[i][j]=0;
-#ifdef HAVE_MAD
-      mad_mpeg[i][j]=new unsigned char[16384];
-#endif  // HAVE_MAD
-      for(int k=0;k<RD_MAX_PORTS;k++) {
-	alsa_output_volume_db[i][k][j]=0;
-      }
     }
     for(int j=0;j<RD_MAX_PORTS;j++) {
+      alsa_output_volume_db[i][j]=NULL;
       for(int k=0;k<RD_MAX_PORTS;k++) {
 	alsa_passthrough_volume_db[i][j][k]=RD_MUTE_DEPTH;
       }
     }
+    alsa_play_wave[i]=NULL;
+    alsa_play_decoder[i]=NULL;
+    alsa_offset[i]=NULL;
+    alsa_play_length[i]=NULL;
+    alsa_stop_timer[i]=NULL;
   }
 
   //
-  // Stop & Fade Timers
+  // Stop Timers (the per-stream ones are created by AlsaInitStreams())
   //
-  QSignalMapper *stop_mapper=new QSignalMapper(this);
-  connect(stop_mapper,SIGNAL(mapped(int)),this,SLOT(stopTimerData(int)));
-  QSignalMapper *fade_mapper=new QSignalMapper(this);
-  connect(fade_mapper,SIGNAL(mapped(int)),this,SLOT(fadeTimerData(int)));
+  alsa_stop_mapper=new QSignalMapper(this);
+  connect(alsa_stop_mapper,SIGNAL(mapped(int)),
+	  this,SLOT(stopTimerData(int)));
   QSignalMapper *record_mapper=new QSignalMapper(this);
   connect(record_mapper,SIGNAL(mapped(int)),this,SLOT(recordTimerData(int)));
   for(int i=0;i<RD_MAX_CARDS;i++) {
-    for(int j=0;j<RD_MAX_STREAMS;j++) {
-      alsa_stop_timer[i][j]=new QTimer(this);
-      alsa_stop_timer[i][j]->setSingleShot(true);
-      stop_mapper->setMapping(alsa_stop_timer[i][j],i*RD_MAX_STREAMS+j);
-      connect(alsa_stop_timer[i][j],SIGNAL(timeout()),stop_mapper,SLOT(map()));
-      alsa_fade_timer[i][j]=new QTimer(this);
-      fade_mapper->setMapping(alsa_fade_timer[i][j],i*RD_MAX_STREAMS+j);
-      connect(alsa_fade_timer[i][j],SIGNAL(timeout()),fade_mapper,SLOT(map()));
-    }
+    alsa_sample_clock[i]=0;
+    alsa_xruns[i]=0;
     for(int j=0;j<RD_MAX_PORTS;j++) {
       alsa_record_timer[i][j]=new QTimer(this);
       alsa_record_timer[i][j]->setSingleShot(true);
@@ -620,11 +714,6 @@ DriverAlsa::DriverAlsa(QObject *parent)
   // Allocate Temporary Buffers
   //
   AlsaInitCallback();
-  alsa_wave_buffer=new int16_t[RINGBUFFER_SIZE];
-  alsa_wave24_buffer=new uint8_t[2*RINGBUFFER_SIZE];
-
-  LoadTwoLame();
-  LoadMad();
 #endif  // ALSA
 }
 
@@ -632,6 +721,7 @@ DriverAlsa::DriverAlsa(QObject *parent)
 DriverAlsa::~DriverAlsa()
 {
 #ifdef ALSA
+  stopReaderPool();
   for(int i=0;i<RD_MAX_CARDS;i++) {
     if(hasCard(i)) {
       alsa_play_format[i].exiting=true;
@@ -670,6 +760,17 @@ bool DriverAlsa::initialize(unsigned *next_cardnum)
   bool pcm_opened=false;
   int card=0;
 
+  rda->syslog(LOG_INFO,"ALSA driver using %s mixing kernels",
+	      MixBusKernelName());
+
+  //
+  // Start Reader Threads
+  //
+  alsa_play_ring_size=playRingSize(sizeof(float));
+  alsa_play_ring_low_water=alsa_play_ring_size/2;
+  startReaderPool(alsa_play_ring_size);
+  alsa_reader_pool=readerPool();
+
   //
   // Start Up Interfaces
   //
@@ -723,6 +824,7 @@ bool DriverAlsa::initialize(unsigned *next_cardnum)
     if(!pcm_opened) {
       return card>0;
     }
+    AlsaInitStreams(*next_cardnum);  // For capture-only cards
     addCard(*next_cardnum);
     (*next_cardnum)++;
   }
@@ -771,22 +873,8 @@ bool DriverAlsa::loadPlayback(int card,QString wavename,int *stream)
     *stream=-1;
     return false;
   }
-  switch(alsa_play_wave[card][*stream]->getFormatTag()) {
-  case WAVE_FORMAT_PCM:
-  case WAVE_FORMAT_VORBIS:
-    break;
-
-  case WAVE_FORMAT_MPEG:
-    if(!InitMadDecoder(card,*stream,alsa_play_wave[card][*stream])) {
-      delete alsa_play_wave[card][*stream];
-      alsa_play_wave[card][*stream]=NULL;
-      FreeAlsaOutputStream(card,*stream);
-      *stream=-1;
-      return false;
-    }
-    break;
-
-  default:
+  if((alsa_play_decoder[card][*stream]=
+      CaeDecoder::create(alsa_play_wave[card][*stream]))==NULL) {
     rda->syslog(LOG_WARNING,
 	"alsaLoadPlayback(%s) getFormatTag()%d || getBistsPerSample()%d failed",
 		wavename.toUtf8().constData(),
@@ -798,6 +886,16 @@ bool DriverAlsa::loadPlayback(int card,QString wavename,int *stream)
     *stream=-1;
     return false;
   }
+  if(!alsa_play_decoder[card][*stream]->
+     setOutputSampleRate(alsa_play_format[card].sample_rate)) {
+    delete alsa_play_decoder[card][*stream];
+    alsa_play_decoder[card][*stream]=NULL;
+    delete alsa_play_wave[card][*stream];
+    alsa_play_wave[card][*stream]=NULL;
+    FreeAlsaOutputStream(card,*stream);
+    *stream=-1;
+    return false;
+  }
   alsa_output_channels[card][*stream]=
     alsa_play_wave[card][*stream]->getChannels();
   alsa_stopping[card][*stream]=false;
@@ -805,7 +903,11 @@ bool DriverAlsa::loadPlayback(int card,QString wavename,int *stream)
   alsa_output_pos[card][*stream]=0;
   alsa_eof[card][*stream]=false;
   alsa_play_ring[card][*stream]->reset();
-  FillAlsaOutputStream(card,*stream);
+  streamStats(card,*stream)->reset(alsa_play_format[card].sample_rate);
+  if(alsa_stream_loudness[card][*stream]!=NULL) {
+    alsa_stream_loudness[card][*stream]->reset();
+  }
+  readerPool()->requestFill(card,*stream);
   return true;
 #else
   return false;
@@ -819,16 +921,17 @@ bool DriverAlsa::unloadPlayback(int card,int stream)
   if(alsa_play_ring[card][stream]==NULL) {
     return false;
   }
+  alsa_play_schedule[card][stream]->cancelAll();
   alsa_playing[card][stream]=false;
-  switch(alsa_play_wave[card][stream]->getFormatTag()) {
-  case WAVE_FORMAT_MPEG:
-    FreeMadDecoder(card,stream);
-    break;
-  }
+  readerPool()->lock(card,stream);
+  delete alsa_play_decoder[card][stream];
+  alsa_play_decoder[card][stream]=NULL;
   alsa_play_wave[card][stream]->closeWave();
   delete alsa_play_wave[card][stream];
   alsa_play_wave[card][stream]=NULL;
   FreeAlsaOutputStream(card,stream);
+  readerPool()->unlock(card,stream);
+  alsa_fade_ramp[card][stream]->cancel();
   return true;
 #else
   return false;
@@ -841,39 +944,31 @@ bool DriverAlsa::playbackPosition(int card,int stream,unsigned pos)
 #ifdef ALSA
   unsigned offset=0;
 
-  if(alsa_play_format[card].exiting){
+  if(alsa_play_format[card].exiting||
+     (alsa_play_decoder[card][stream]==NULL)) {
     return false;
   }
-  switch(alsa_play_wave[card][stream]->getFormatTag()) {
-  case WAVE_FORMAT_PCM:
-    offset=(unsigned)((double)alsa_play_wave[card][stream]->getSamplesPerSec()*
-		      (double)alsa_play_wave[card][stream]->getBlockAlign()*
-		      (double)pos/1000);
-    alsa_offset[card][stream]=
-      offset/alsa_play_wave[card][stream]->getBlockAlign();
-    offset=
-      alsa_offset[card][stream]*alsa_play_wave[card][stream]->getBlockAlign();
-    break;
-
-  case WAVE_FORMAT_MPEG:
-    offset=(unsigned)((double)alsa_play_wave[card][stream]->getSamplesPerSec()*
-		      (double)pos/1000);
-    alsa_offset[card][stream]=offset/1152*1152;
-    offset=alsa_offset[card][stream]/1152*
-      alsa_play_wave[card][stream]->getBlockAlign();
-    FreeMadDecoder(card,stream);
-    InitMadDecoder(card,stream,alsa_play_wave[card][stream]);
-    break;
-  }
-  if(alsa_offset[card][stream]>
-     (int)alsa_play_wave[card][stream]->getSampleLength()) {
+  offset=(unsigned)((double)alsa_play_wave[card][stream]->getSamplesPerSec()*
+		    (double)pos/1000);
+  if(offset>alsa_play_wave[card][stream]->getSampleLength()) {
     return false;
   }
+  readerPool()->lock(card,stream);
+  if(!alsa_play_ring[card][stream]->flush()) {
+    rda->syslog(LOG_WARNING,
+		"play ring for card %d stream %d flushed without the callback",
+		card,stream);
+  }
+  alsa_offset[card][stream]=alsa_play_decoder[card][stream]->seek(offset);
   alsa_output_pos[card][stream]=0;
-  alsa_play_wave[card][stream]->seekWave(offset,SEEK_SET);
   alsa_eof[card][stream]=false;
-  alsa_play_ring[card][stream]->reset();
-  FillAlsaOutputStream(card,stream);
+  readerPool()->unlock(card,stream);
+  if(alsa_playing[card][stream]) {
+    readerPool()->fill(card,stream);
+  }
+  else {
+    readerPool()->requestFill(card,stream);  // Preroll in the background
+  }
 
   if(alsa_playing[card][stream]) {
     alsa_stop_timer[card][stream]->stop();
@@ -895,6 +990,7 @@ bool DriverAlsa::play(int card,int stream,int length,int speed,bool pitch,
      alsa_playing[card][stream]||(speed!=RD_TIMESCALE_DIVISOR)) {
     return false;
   }
+  readerPool()->waitFill(card,stream);
   alsa_playing[card][stream]=true;
   if(length>0) {
     alsa_stop_timer[card][stream]->start(length);
@@ -910,11 +1006,25 @@ bool DriverAlsa::play(int card,int stream,int length,int speed,bool pitch,
 bool DriverAlsa::stopPlayback(int card,int stream)
 {
 #ifdef ALSA
-  if((alsa_play_ring[card][stream]==NULL)||(!alsa_playing[card][stream])) {
+  if(alsa_play_ring[card][stream]==NULL) {
     return false;
   }
+  if(!alsa_playing[card][stream]) {
+    //
+    // Withdraw a scheduled start that has yet to happen
+    //
+    if(!alsa_play_schedule[card][stream]->isScheduled(PlaySchedule::Play)) {
+      return false;
+    }
+    alsa_play_schedule[card][stream]->cancelAll();
+    statePlayUpdate(card,stream,2);
+    return true;
+  }
+  alsa_play_schedule[card][stream]->cancel(PlaySchedule::Stop);
   alsa_playing[card][stream]=false;
-  alsa_play_ring[card][stream]->reset();
+  readerPool()->lock(card,stream);
+  alsa_play_ring[card][stream]->flush();
+  readerPool()->unlock(card,stream);
   alsa_stop_timer[card][stream]->stop();
   statePlayUpdate(card,stream,2);
   return true;
@@ -934,74 +1044,13 @@ bool DriverAlsa::loadRecord(int card,int port,int coding,int chans,int samprate,
 			    int bitrate,QString wavename)
 {
 #ifdef ALSA
-  alsa_record_wave[card][port]=new RDWaveFile(wavename);
-  switch(coding) {
-  case 0:  // PCM16
-    alsa_record_wave[card][port]->setFormatTag(WAVE_FORMAT_PCM);
-    alsa_record_wave[card][port]->setChannels(chans);
-    alsa_record_wave[card][port]->setSamplesPerSec(samprate);
-    alsa_record_wave[card][port]->setBitsPerSample(16);
-    break;
-
-  case 4:  // PCM24
-    alsa_record_wave[card][port]->setFormatTag(WAVE_FORMAT_PCM);
-    alsa_record_wave[card][port]->setChannels(chans);
-    alsa_record_wave[card][port]->setSamplesPerSec(samprate);
-    alsa_record_wave[card][port]->setBitsPerSample(24);
-    break;
+  CaeEncoder *enc=NULL;
 
-  case 2:  // MPEG Layer 2
-    if(!InitTwoLameEncoder(card,port,chans,samprate,bitrate)) {
-      delete alsa_record_wave[card][port];
-      alsa_record_wave[card][port]=NULL;
-      return false;
-    }
-    alsa_record_wave[card][port]->setFormatTag(WAVE_FORMAT_MPEG);
-    alsa_record_wave[card][port]->setChannels(chans);
-    alsa_record_wave[card][port]->setSamplesPerSec(samprate);
-    alsa_record_wave[card][port]->setBitsPerSample(16);
-    alsa_record_wave[card][port]->setHeadLayer(ACM_MPEG_LAYER2);
-    switch(chans) {
-    case 1:
-      alsa_record_wave[card][port]->setHeadMode(ACM_MPEG_SINGLECHANNEL);
-      break;
-
-    case 2:
-      alsa_record_wave[card][port]->setHeadMode(ACM_MPEG_STEREO);
-      break;
-
-    default:
-      rda->syslog(LOG_WARNING,
-	     "requested unsupported channel count %d, card: %d, port: %d",
-	     chans,card,port);
-      delete alsa_record_wave[card][port];
-      alsa_record_wave[card][port]=NULL;
-      return false;
-    }
-    alsa_record_wave[card][port]->setHeadBitRate(bitrate);
-    alsa_record_wave[card][port]->setMextChunk(true);
-    alsa_record_wave[card][port]->setMextHomogenous(true);
-    alsa_record_wave[card][port]->setMextPaddingUsed(false);
-    alsa_record_wave[card][port]->setMextHackedBitRate(true);
-    alsa_record_wave[card][port]->setMextFreeFormat(false);
-    alsa_record_wave[card][port]->
-      setMextFrameSize(144*alsa_record_wave[card][port]->getHeadBitRate()/
-		       alsa_record_wave[card][port]->getSamplesPerSec());
-    alsa_record_wave[card][port]->setMextAncillaryLength(5);
-    alsa_record_wave[card][port]->setMextLeftEnergyPresent(true);
-    if(chans>1) {
-      alsa_record_wave[card][port]->setMextRightEnergyPresent(true);
-    }
-    else {
-      alsa_record_wave[card][port]->setMextRightEnergyPresent(false);
-    }
-    alsa_record_wave[card][port]->setMextPrivateDataPresent(false);
-    break;
-
-  default:
-    rda->syslog(LOG_WARNING,
-	   "requested invalid audio encoding %d, card: %d, port: %d",
-	   coding,card,port);
+  alsa_record_wave[card][port]=new RDWaveFile(wavename);
+  if((enc=CaeEncoder::create(alsa_record_wave[card][port],coding,chans,
+			     samprate,bitrate))==NULL) {
+    rda->syslog(LOG_WARNING,"unable to load recording, card: %d, port: %d",
+		card,port);
     delete alsa_record_wave[card][port];
     alsa_record_wave[card][port]=NULL;
     return false;
@@ -1009,6 +1058,7 @@ bool DriverAlsa::loadRecord(int card,int port,int coding,int chans,int samprate,
   alsa_record_wave[card][port]->setBextChunk(true);
   alsa_record_wave[card][port]->setLevlChunk(true);
   if(!alsa_record_wave[card][port]->createWave()) {
+    delete enc;
     delete alsa_record_wave[card][port];
     alsa_record_wave[card][port]=NULL;
     return false;
@@ -1016,8 +1066,10 @@ bool DriverAlsa::loadRecord(int card,int port,int coding,int chans,int samprate,
   RDCheckExitCode(rda->config(),"alsaLoadRecord() chown",
 		  chown(wavename.toUtf8(),rda->config()->uid(),rda->config()->gid()));
   alsa_input_channels[card][port]=chans;
-  alsa_record_ring[card][port]=new RDRingBuffer(RINGBUFFER_SIZE);
+  alsa_record_ring[card][port]=new RDSpscRing(RINGBUFFER_SIZE);
   alsa_record_ring[card][port]->reset();
+  alsa_record_deck[card][port]=
+    new RecordDeck(enc,alsa_record_ring[card][port],RecordDeck::S16);
   alsa_ready[card][port]=true;
   return true;
 #else
@@ -1031,15 +1083,14 @@ bool DriverAlsa::unloadRecord(int card,int port,unsigned *len_frames)
 #ifdef ALSA
   alsa_recording[card][port]=false;
   alsa_ready[card][port]=false;
-  EmptyAlsaInputStream(card,port);
-  *len_frames=alsa_samples_recorded[card][port];
-  alsa_samples_recorded[card][port]=0;
+  *len_frames=alsa_record_deck[card][port]->finish();
+  delete alsa_record_deck[card][port];
+  alsa_record_deck[card][port]=NULL;
   alsa_record_wave[card][port]->closeWave(*len_frames);
   delete alsa_record_wave[card][port];
   alsa_record_wave[card][port]=NULL;
   delete alsa_record_ring[card][port];
   alsa_record_ring[card][port]=NULL;
-  FreeTwoLameEncoder(card,port);
   return true;
 #else
   return false;
@@ -1121,6 +1172,9 @@ bool DriverAlsa::setOutputVolume(int card,int stream,int port,int level)
     alsa_output_volume[card][port][stream]=0.0;
     alsa_output_volume_db[card][port][stream]=-10000;
   }
+  if(alsa_fade_ramp[card][stream]!=NULL) {
+    alsa_fade_ramp[card][stream]->cancel(port);
+  }
   return true;
 #else
   return false;
@@ -1132,23 +1186,9 @@ bool DriverAlsa::fadeOutputVolume(int card,int stream,int port,int level,
 				  int length)
 {
 #ifdef ALSA
-  int diff;
-
-  if(alsa_fade_timer[card][stream]->isActive()) {
-    alsa_fade_timer[card][stream]->stop();
-  }
-  if(level>alsa_output_volume_db[card][port][stream]) {
-    alsa_fade_up[card][stream]=true;
-    diff=level-alsa_output_volume_db[card][port][stream];
-  }
-  else {
-    alsa_fade_up[card][stream]=false;
-    diff=alsa_output_volume_db[card][port][stream]-level;
-  }
-  alsa_fade_volume_db[card][stream]=level;
-  alsa_fade_port[card][stream]=port;
-  alsa_fade_increment[card][stream]=diff*RD_ALSA_FADE_INTERVAL/length;
-  alsa_fade_timer[card][stream]->start(RD_ALSA_FADE_INTERVAL);
+  alsa_fade_ramp[card][stream]->
+    start(port,alsa_output_volume_db[card][port][stream],level,
+	  (unsigned)((double)length*(double)systemSampleRate()/1000.0));
   return true;
 #else
   return false;
@@ -1280,8 +1320,11 @@ bool DriverAlsa::getStreamOutputMeters(int card,int stream,short levels[2])
 #ifdef ALSA
   double meter;
 
+  if(alsa_stream_output_meter[card][2*stream]==NULL) {
+    return false;
+  }
   for(int i=0;i<2;i++) {
-    meter=alsa_stream_output_meter[card][stream][i]->average();
+    meter=alsa_stream_output_meter[card][2*stream+i]->average();
     if(meter==0.0) {
       levels[i]=-10000;
     }
@@ -1322,11 +1365,15 @@ bool DriverAlsa::setPassthroughLevel(int card,int in_port,int out_port,
 void DriverAlsa::getOutputPosition(int card,unsigned *pos)
 {// pos is in miliseconds
 #ifdef ALSA
-  for(int i=0;i<RD_MAX_STREAMS;i++) {
+  for(int i=0;i<maxStreams();i++) {
     if((!alsa_play_format[card].exiting)&&(alsa_play_wave[card][i]!=NULL)) {
-      pos[i]=1000*(unsigned long long)(alsa_offset[card][i]+
-				       alsa_output_pos[card][i])/
-	alsa_play_wave[card][i]->getSamplesPerSec();
+      //
+      // The offset is in file frames, the output position in card frames
+      //
+      pos[i]=1000*(unsigned long long)alsa_offset[card][i]/
+	alsa_play_wave[card][i]->getSamplesPerSec()+
+	1000*(unsigned long long)alsa_output_pos[card][i]/
+	alsa_play_format[card].sample_rate;
     }
     else {
       pos[i]=0;
@@ -1336,25 +1383,116 @@ void DriverAlsa::getOutputPosition(int card,unsigned *pos)
 }
 
 
+unsigned DriverAlsa::xruns(int card) const
+{
+#ifdef ALSA
+  return alsa_xruns[card];
+#else
+  return 0;
+#endif  // ALSA
+}
+
+
+bool DriverAlsa::getSampleClock(int card,uint64_t *clock,unsigned *samprate)
+{
+#ifdef ALSA
+  if((card<0)||(card>=RD_MAX_CARDS)||(!hasCard(card))||
+     (alsa_play_format[card].exiting)) {
+    return false;
+  }
+  *clock=alsa_sample_clock[card].load();
+  *samprate=alsa_play_format[card].sample_rate;
+  return true;
+#else
+  return false;
+#endif  // ALSA
+}
+
+
+bool DriverAlsa::playAt(int card,int stream,uint64_t clock,int length,
+			int speed,bool pitch,bool rates)
+{
+#ifdef ALSA
+  if((alsa_play_ring[card][stream]==NULL)||
+     alsa_playing[card][stream]||(speed!=RD_TIMESCALE_DIVISOR)) {
+    return false;
+  }
+  readerPool()->waitFill(card,stream);
+  alsa_play_length[card][stream]=length;
+  alsa_play_schedule[card][stream]->schedule(PlaySchedule::Play,clock);
+  return true;
+#else
+  return false;
+#endif  // ALSA
+}
+
+
+bool DriverAlsa::stopPlaybackAt(int card,int stream,uint64_t clock)
+{
+#ifdef ALSA
+  if(alsa_play_ring[card][stream]==NULL) {
+    return false;
+  }
+  alsa_play_schedule[card][stream]->schedule(PlaySchedule::Stop,clock);
+  return true;
+#else
+  return false;
+#endif  // ALSA
+}
+
+
+bool DriverAlsa::fadeOutputVolumeAt(int card,int stream,int port,int level,
+				    int length,uint64_t clock)
+{
+#ifdef ALSA
+  if(alsa_play_ring[card][stream]==NULL) {
+    return false;
+  }
+  alsa_play_schedule[card][stream]->
+    scheduleFade(clock,port,alsa_output_volume_db[card][port][stream],level,
+		 (unsigned)((double)length*
+			    (double)alsa_play_format[card].sample_rate/1000.0));
+  return true;
+#else
+  return false;
+#endif  // ALSA
+}
+
+
 void DriverAlsa::processBuffers()
 {
 #ifdef ALSA
+  int port;
+  int level;
+
   for(int i=0;i<RD_MAX_CARDS;i++) {
     if(hasCard(i)) {
-      for(int j=0;j<RD_MAX_STREAMS;j++) {
+      for(int j=0;j<maxStreams();j++) {
+	if(alsa_fade_ramp[i][j]==NULL) {  // Never used
+	  continue;
+	}
+	if(alsa_starting[i][j]) {  // Scheduled start
+	  alsa_starting[i][j]=false;
+	  if(alsa_play_length[i][j]>0) {
+	    alsa_stop_timer[i][j]->start(alsa_play_length[i][j]);
+	  }
+	  statePlayUpdate(i,j,1);
+	}
+	if(alsa_fade_ramp[i][j]->isFinished(&port,&level)) {
+	  setOutputVolume(i,j,port,level);
+	  alsa_fade_ramp[i][j]->clear();
+	  statePlayUpdate(i,j,3);
+	}
 	if(alsa_stopping[i][j]) {
 	  alsa_stopping[i][j]=false;
 	  alsa_eof[i][j]=false;
 	  alsa_playing[i][j]=false;
+	  alsa_stop_timer[i][j]->stop();
 	  statePlayUpdate(i,j,2);
 	}
-	if(alsa_playing[i][j]) {
-	  FillAlsaOutputStream(i,j);
-	}
-      }
-      for(int j=0;j<RD_MAX_PORTS;j++) {
-	if(alsa_recording[i][j]) {
-	  EmptyAlsaInputStream(i,j);
+	if(alsa_playing[i][j]&&alsa_eof[i][j]&&
+	   alsa_stop_timer[i][j]->isActive()) {
+	  alsa_stop_timer[i][j]->stop();
 	}
       }
     }
@@ -1363,41 +1501,21 @@ void DriverAlsa::processBuffers()
 }
 
 
-void DriverAlsa::stopTimerData(int cardstream)
+void DriverAlsa::fillStream(int card,int stream,ReaderBuffer *buf)
 {
 #ifdef ALSA
-  int card=cardstream/RD_MAX_STREAMS;
-  int stream=cardstream-card*RD_MAX_STREAMS;
-
-  stopPlayback(card,stream);
+  FillAlsaOutputStream(card,stream,buf);
 #endif  // ALSA
 }
 
 
-void DriverAlsa::fadeTimerData(int cardstream)
+void DriverAlsa::stopTimerData(int cardstream)
 {
 #ifdef ALSA
-  int card=cardstream/RD_MAX_STREAMS;
-  int stream=cardstream-card*RD_MAX_STREAMS;
-  int16_t level;
-  if(alsa_fade_up[card][stream]) {
-    level=alsa_output_volume_db[card][alsa_fade_port[card][stream]][stream]+
-      alsa_fade_increment[card][stream];
-    if(level>=alsa_fade_volume_db[card][stream]) {
-      level=alsa_fade_volume_db[card][stream];
-      alsa_fade_timer[card][stream]->stop();
-    }
-  }
-  else {
-    level=alsa_output_volume_db[card][alsa_fade_port[card][stream]][stream]-
-      alsa_fade_increment[card][stream];
-    if(level<=alsa_fade_volume_db[card][stream]) {
-      level=alsa_fade_volume_db[card][stream];
-      alsa_fade_timer[card][stream]->stop();
-    }
-  }
-  rda->syslog(LOG_DEBUG,"FadeLevel: %d",level);
-  setOutputVolume(card,stream,alsa_fade_port[card][stream],level);
+  int card=cardstream/maxStreams();
+  int stream=cardstream-card*maxStreams();
+
+  stopPlayback(card,stream);
 #endif  // ALSA
 }
 
@@ -1589,6 +1707,7 @@ bool DriverAlsa::AlsaStartPlayDevice(QString &dev,int card,snd_pcm_t *pcm)
   int err;
   pthread_attr_t pthread_attr;
   unsigned sr;
+  unsigned frames;
 
   memset(&alsa_play_format[card],0,sizeof(struct alsa_format));
 
@@ -1706,8 +1825,18 @@ bool DriverAlsa::AlsaStartPlayDevice(QString &dev,int card,snd_pcm_t *pcm)
   }
   alsa_play_format[card].card_buffer=
     new char[alsa_play_format[card].card_buffer_size];
-  alsa_play_format[card].passthrough_buffer=
-    new char[alsa_play_format[card].card_buffer_size];
+  memset(alsa_play_format[card].card_buffer,0,
+	 alsa_play_format[card].card_buffer_size);
+  frames=alsa_play_format[card].buffer_size/
+    (2*alsa_play_format[card].periods);
+  alsa_play_format[card].mix_buffer=
+    new float[frames*2*(alsa_play_format[card].channels/2)];
+  alsa_play_format[card].stream_buffer=new float[frames*2];
+  alsa_play_format[card].scratch_buffer=new float[frames];
+  alsa_play_format[card].fade_buffer=new float[frames];
+  alsa_play_format[card].convert_buffer=new char[frames*2*sizeof(int32_t)];
+  alsa_play_format[card].dither=0;
+  alsa_play_format[card].dithered=rda->config()->caeDither();
   alsa_play_format[card].pcm=pcm;
   alsa_play_format[card].card=card;
 
@@ -1732,6 +1861,8 @@ bool DriverAlsa::AlsaStartPlayDevice(QString &dev,int card,snd_pcm_t *pcm)
     pthread_attr_setschedpolicy(&pthread_attr,SCHED_FIFO);
   }
   */
+  AlsaInitStreams(card);
+  alsa_play_format[card].streams=maxStreams();
   alsa_play_format[card].exiting = false;
   pthread_create(&alsa_play_format[card].thread,&pthread_attr,
 		 AlsaPlayCallback,&alsa_play_format[card]);
@@ -1741,9 +1872,18 @@ bool DriverAlsa::AlsaStartPlayDevice(QString &dev,int card,snd_pcm_t *pcm)
 
 int DriverAlsa::GetAlsaOutputStream(int card)
 {
-  for(int i=0;i<RD_MAX_STREAMS;i++) {
+  for(int i=0;i<maxStreams();i++) {
     if(alsa_play_ring[card][i]==NULL) {
-      alsa_play_ring[card][i]=new RDRingBuffer(RINGBUFFER_SIZE);
+      if(alsa_fade_ramp[card][i]==NULL) {
+	alsa_fade_ramp[card][i]=new FadeRamp();
+	alsa_play_schedule[card][i]=new PlaySchedule();
+	for(int j=0;j<2;j++) {
+	  alsa_stream_output_meter[card][2*i+j]=
+	    new RDMeterAverage(alsa_meter_periods);
+	}
+	alsa_stream_loudness[card][i]=addStreamLoudness(card,i);
+      }
+      alsa_play_ring[card][i]=new RDSpscRing(alsa_play_ring_size);
       return i;
     }
   }
@@ -1758,175 +1898,17 @@ void DriverAlsa::FreeAlsaOutputStream(int card,int stream)
 }
 
 
-void DriverAlsa::EmptyAlsaInputStream(int card,int stream)
+void DriverAlsa::FillAlsaOutputStream(int card,int stream,
+				      ReaderBuffer *buf)
 {
-  unsigned n=alsa_record_ring[card][stream]->
-    read((char *)alsa_wave_buffer,alsa_record_ring[card][stream]->
-	 readSpace());
-  WriteAlsaBuffer(card,stream,alsa_wave_buffer,n);
-}
-
-
-void DriverAlsa::WriteAlsaBuffer(int card,int stream,int16_t *buffer,unsigned len)
-{
-  ssize_t s;
-  unsigned char mpeg[2048];
-  unsigned frames;
-  unsigned n;
-
-  frames=len/(2*alsa_record_wave[card][stream]->getChannels());
-  alsa_samples_recorded[card][stream]+=frames;
-  switch(alsa_record_wave[card][stream]->getFormatTag()) {
-  case WAVE_FORMAT_PCM:
-    switch(alsa_record_wave[card][stream]->getBitsPerSample()) {
-    case 16:   // PCM16
-      alsa_record_wave[card][stream]->writeWave(buffer,len);
-      break;
-
-    case 24:   // PCM24
-      for(unsigned i=0;i<(len/2);i++) {
-	alsa_wave24_buffer[3*i]=0;      // FIXME: we lose eight bits here!
-	alsa_wave24_buffer[3*i+1]=((uint8_t *)buffer)[2*i];
-	alsa_wave24_buffer[3*i+2]=((uint8_t *)buffer)[2*i+1];
-      }
-      alsa_record_wave[card][stream]->writeWave(alsa_wave24_buffer,3*len/2);
-      break;
-    }
-    break;
-
-  case WAVE_FORMAT_MPEG:
-#ifdef HAVE_TWOLAME
-    for(unsigned i=0;i<frames;i+=1152) {
-      if((i+1152)>frames) {
-	n=frames-i;
-      }
-      else {
-	n=1152;
-      }
-      if((s=twolame_encode_buffer_interleaved(twolame_lameopts[card][stream],
-		   buffer+i*alsa_record_wave[card][stream]->getChannels(),
-					      n,mpeg,2048))>=0) {
-	alsa_record_wave[card][stream]->writeWave(mpeg,s);
-      }
-      else {
-	rda->syslog(LOG_WARNING,
-			      "TwoLAME encode error, card: %d, stream: %d",
-	       card,stream);
-      }
-    }
-#endif  // HAVE_TWOLAME
-    break;
-  }
-}
-
-
-void DriverAlsa::FillAlsaOutputStream(int card,int stream)
-{
-  unsigned mpeg_frames=0;
-  unsigned frame_offset=0;
-  int m=0;
-  int n=0;
-  double ratio=0.0;
-  int free=(alsa_play_ring[card][stream]->writeSpace()-1);
-  if(free<=0) {
+  if((alsa_play_ring[card][stream]==NULL)||
+     (alsa_play_decoder[card][stream]==NULL)) {
     return;
   }
-  ratio=(double)alsa_play_format[card].sample_rate/
-    (double)alsa_play_wave[card][stream]->getSamplesPerSec();
-  switch(alsa_play_wave[card][stream]->getFormatTag()) {
-  case WAVE_FORMAT_PCM:
-  case WAVE_FORMAT_VORBIS:
-    switch(alsa_play_wave[card][stream]->getBitsPerSample()) {
-    case 16:   // PCM16
-      free=(int)((double)free/ratio)/(2*alsa_output_channels[card][stream])*
-	      (2*alsa_output_channels[card][stream]);
-      n=alsa_play_wave[card][stream]->readWave(alsa_wave_buffer,free);
-      if(n!=free) {
-	alsa_eof[card][stream]=true;
-	alsa_stop_timer[card][stream]->stop();
-      }
-      break;
-
-    case 24:   // PCM24
-      free=(int)((double)free/ratio)/(2*alsa_output_channels[card][stream])*
-	      (2*alsa_output_channels[card][stream]);
-      n=2*alsa_play_wave[card][stream]->readWave(alsa_wave24_buffer,3*free/2)/3;
-      if(n!=free) {
-	alsa_eof[card][stream]=true;
-	alsa_stop_timer[card][stream]->stop();
-	break;
-      }
-      for(int i=0;i<n/2;i++) {
-	((uint8_t *)alsa_wave_buffer)[2*i]=alsa_wave24_buffer[3*i+1];
-	((uint8_t *)alsa_wave_buffer)[2*i+1]=alsa_wave24_buffer[3*i+2];
-      }
-    }
-    break;
-
-  case WAVE_FORMAT_MPEG:
-#ifdef HAVE_MAD
-    mpeg_frames=free/(2304*alsa_output_channels[card][stream]);
-    free=mpeg_frames*2304*alsa_output_channels[card][stream];
-    for(unsigned i=0;i<mpeg_frames;i++) {
-      m=alsa_play_wave[card][stream]->
-	readWave(mad_mpeg[card][stream]+mad_left_over[card][stream],
-		 mad_frame_size[card][stream]);
-      if(m==mad_frame_size[card][stream]) {
-	mad_stream_buffer(&mad_stream[card][stream],mad_mpeg[card][stream],
-			  m+mad_left_over[card][stream]);
-	while(mad_frame_decode(&mad_frame[card][stream],
-			       &mad_stream[card][stream])==0) {
-	  mad_synth_frame(&mad_synth[card][stream],&mad_frame[card][stream]);
-	  n+=(2*alsa_output_channels[card][stream]*
-	      mad_synth[card][stream].pcm.length);
-	  for(int j=0;j<mad_synth[card][stream].pcm.length;j++) {
-	    for(int k=0;k<mad_synth[card][stream].pcm.channels;k++) {
-	      alsa_wave_buffer[frame_offset+
-			       j*mad_synth[card][stream].pcm.channels+k]=
-		(int16_t)(32768.0*mad_f_todouble(mad_synth[card][stream].
-					       pcm.samples[k][j]));
-	    }
-	  }
-	  frame_offset+=(mad_synth[card][stream].pcm.length*
-			 mad_synth[card][stream].pcm.channels);
-	}
-      }
-      else {  // End-of-file, read out last samples
-	if(!alsa_eof[card][stream]) {
-	  memset(mad_mpeg[card][stream]+mad_left_over[card][stream],0,
-		 MAD_BUFFER_GUARD);
-	  mad_stream_buffer(&mad_stream[card][stream],
-			    mad_mpeg[card][stream],
-			    MAD_BUFFER_GUARD+mad_left_over[card][stream]);
-	  if(mad_frame_decode(&mad_frame[card][stream],
-			      &mad_stream[card][stream])==0) {
-	    mad_synth_frame(&mad_synth[card][stream],
-			    &mad_frame[card][stream]);
-	    n+=(alsa_output_channels[card][stream]*
-		mad_synth[card][stream].pcm.length);
-	    for(int j=0;j<mad_synth[card][stream].pcm.length;j++) {
-	      for(int k=0;k<mad_synth[card][stream].pcm.channels;k++) {
-		alsa_wave_buffer[frame_offset+
-				 j*mad_synth[card][stream].pcm.channels+k]=
-		  (int16_t)(32768.0*mad_f_todouble(mad_synth[card][stream].
-						 pcm.samples[k][j]));
-	      }
-	    }
-	  }
-	}
-	alsa_eof[card][stream]=true;
-	alsa_stop_timer[card][stream]->stop();
-	continue;
-      }
-      mad_left_over[card][stream]=
-	mad_stream[card][stream].bufend-mad_stream[card][stream].next_frame;
-      memmove(mad_mpeg[card][stream],mad_stream[card][stream].next_frame,
-	      mad_left_over[card][stream]);
-    }
-#endif  // HAVE_MAD
-    break;
+  alsa_play_decoder[card][stream]->fillRing(alsa_play_ring[card][stream]);
+  if(alsa_play_decoder[card][stream]->isFinished()) {
+    alsa_eof[card][stream]=true;
   }
-  alsa_play_ring[card][stream]->write((char *)alsa_wave_buffer,n);
 }
 #endif  // ALSA
 
@@ -1936,20 +1918,16 @@ void DriverAlsa::AlsaClock()
 {
   for(int i=0;i<RD_MAX_CARDS;i++) {
     if(hasCard(i)) {
-      for(int j=0;j<RD_MAX_STREAMS;j++) {
+      for(int j=0;j<maxStreams();j++) {
 	if(alsa_stopping[i][j]) {
 	  alsa_stopping[i][j]=false;
 	  alsa_eof[i][j]=false;
 	  alsa_playing[i][j]=false;
 	  statePlayUpdate(i,j,2);
 	}
-	if(alsa_playing[i][j]) {
-	  FillAlsaOutputStream(i,j);
-	}
-      }
-      for(int j=0;j<RD_MAX_PORTS;j++) {
-	if(alsa_recording[i][j]) {
-	  EmptyAlsaInputStream(i,j);
+	if(alsa_playing[i][j]&&alsa_eof[i][j]&&
+	   alsa_stop_timer[i][j]->isActive()) {
+	  alsa_stop_timer[i][j]->stop();
 	}
       }
     }
@@ -26,6 +26,7 @@
 #include <rdconfig.h>
 #include <rdwavefile.h>
 
+#include "decoder.h"
 #include "driver.h"
 
 #ifdef ALSA
@@ -42,7 +43,15 @@ struct alsa_format {
   char *card_buffer;
   char *passthrough_buffer;
   unsigned card_buffer_size;
+  float *mix_buffer;
+  float *stream_buffer;
+  float *scratch_buffer;
+  float *fade_buffer;
+  char *convert_buffer;
+  unsigned dither;
+  bool dithered;
   unsigned periods;
+  unsigned streams;
   bool exiting;
 };
 #endif  // ALSA
@@ -87,13 +96,20 @@ class DriverAlsa : public Driver
   bool setPassthroughLevel(int card,int in_port,int out_port,
 				   int level);
   void getOutputPosition(int card,unsigned *pos);
+  unsigned xruns(int card) const;
+  bool getSampleClock(int card,uint64_t *clock,unsigned *samprate);
+  bool playAt(int card,int stream,uint64_t clock,int length,int speed,
+	      bool pitch,bool rates);
+  bool stopPlaybackAt(int card,int stream,uint64_t clock);
+  bool fadeOutputVolumeAt(int card,int stream,int port,int level,int length,
+			  uint64_t clock);
+  void fillStream(int card,int stream,ReaderBuffer *buf);
 
  public slots:
   void processBuffers();
 
  private slots:
   void stopTimerData(int cardstream);
-  void fadeTimerData(int cardstream);
   void recordTimerData(int cardport);
 
  private:
@@ -101,32 +117,28 @@ class DriverAlsa : public Driver
   bool AlsaStartCaptureDevice(QString &dev,int card,snd_pcm_t *pcm);
   bool AlsaStartPlayDevice(QString &dev,int card,snd_pcm_t *pcm);
   void AlsaInitCallback();
+  void AlsaInitStreams(int card);
   int GetAlsaOutputStream(int card);
   void FreeAlsaOutputStream(int card,int stream);
-  void EmptyAlsaInputStream(int card,int stream);
-  void WriteAlsaBuffer(int card,int stream,short *buffer,unsigned len);
-  void FillAlsaOutputStream(int card,int stream);
+  void FillAlsaOutputStream(int card,int stream,ReaderBuffer *buf);
   void AlsaClock();
   QMap<int,int> alsa_input_port_quantities;
   QMap<int,int> alsa_output_port_quantities;
+  unsigned alsa_play_ring_size;
+  int alsa_meter_periods;
   struct alsa_format alsa_play_format[RD_MAX_CARDS];
   struct alsa_format alsa_capture_format[RD_MAX_CARDS];
   short alsa_input_volume_db[RD_MAX_CARDS][RD_MAX_STREAMS];
-  short alsa_output_volume_db[RD_MAX_CARDS][RD_MAX_PORTS][RD_MAX_STREAMS];
+  short *alsa_output_volume_db[RD_MAX_CARDS][RD_MAX_PORTS];
   short alsa_passthrough_volume_db[RD_MAX_CARDS][RD_MAX_PORTS][RD_MAX_PORTS];
-  short *alsa_wave_buffer;
-  uint8_t *alsa_wave24_buffer;
   RDWaveFile *alsa_record_wave[RD_MAX_CARDS][RD_MAX_STREAMS];
-  RDWaveFile *alsa_play_wave[RD_MAX_CARDS][RD_MAX_STREAMS];
-  int alsa_offset[RD_MAX_CARDS][RD_MAX_STREAMS];
-  QTimer *alsa_fade_timer[RD_MAX_CARDS][RD_MAX_STREAMS];
-  QTimer *alsa_stop_timer[RD_MAX_CARDS][RD_MAX_STREAMS];
+  RDWaveFile **alsa_play_wave[RD_MAX_CARDS];
+  CaeDecoder **alsa_play_decoder[RD_MAX_CARDS];
+  int *alsa_offset[RD_MAX_CARDS];
+  int *alsa_play_length[RD_MAX_CARDS];
+  QSignalMapper *alsa_stop_mapper;
+  QTimer **alsa_stop_timer[RD_MAX_CARDS];
   QTimer *alsa_record_timer[RD_MAX_CARDS][RD_MAX_PORTS];
-  bool alsa_fade_up[RD_MAX_CARDS][RD_MAX_STREAMS];
-  short alsa_fade_volume_db[RD_MAX_CARDS][RD_MAX_STREAMS];
-  short alsa_fade_increment[RD_MAX_CARDS][RD_MAX_STREAMS];
-  int alsa_fade_port[RD_MAX_CARDS][RD_MAX_STREAMS];
-  unsigned alsa_samples_recorded[RD_MAX_CARDS][RD_MAX_STREAMS];
 #endif  // ALSA
 };
 
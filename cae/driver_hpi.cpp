@@ -24,6 +24,12 @@
 DriverHpi::DriverHpi(QObject *parent)
   : Driver(RDStation::Hpi,parent)
 {
+  //
+  // HPI streams are fixed by the adapter hardware, which also does the
+  // mixing, so there is nothing to measure loudness on
+  //
+  setMaxStreams(RD_MAX_STREAMS);
+  setLoudnessMeters(false);
 #ifdef HPI
   for(int i=0;i<RD_MAX_CARDS;i++) {
     for(int j=0;j<RD_MAX_STREAMS;j++) {
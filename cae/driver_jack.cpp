@@ -20,7 +20,7 @@
 
 #include <math.h>
 
-#include <samplerate.h>
+#include <atomic>
 
 #include <QProcessEnvironment>
 
@@ -28,55 +28,94 @@
 #include <rddatedecode.h>
 #include <rdescape_string.h>
 #include <rdprofile.h>
+#include <rdspscring.h>
 
 #include "driver_jack.h"
+#include "mixbus.h"
+#include "recorddeck.h"
 
 #ifdef JACK
 //
 // Callback Variables
 //
+// Per-stream tables are allocated by JackInitCallback(), and are indexed
+// by stream number.  Stream output meters take two entries (left, right)
+// per stream.
+//
 jack_client_t *jack_client;
+int jack_max_streams;
 RDMeterAverage *jack_input_meter[RD_MAX_PORTS][2];
 RDMeterAverage *jack_output_meter[RD_MAX_PORTS][2];
-RDMeterAverage *jack_stream_output_meter[RD_MAX_STREAMS][2];
+RDMeterAverage **jack_stream_output_meter;
+int jack_meter_periods;
 volatile jack_default_audio_sample_t 
   jack_input_volume[RD_MAX_PORTS];
 volatile jack_default_audio_sample_t 
-  jack_output_volume[RD_MAX_PORTS][RD_MAX_STREAMS];
+  *jack_output_volume[RD_MAX_PORTS];
 volatile jack_default_audio_sample_t
   jack_passthrough_volume[RD_MAX_PORTS][RD_MAX_PORTS];
 volatile jack_default_audio_sample_t jack_input_vox[RD_MAX_PORTS];
 jack_port_t *jack_input_port[RD_MAX_PORTS][2];
 jack_port_t *jack_output_port[RD_MAX_PORTS][2];
 volatile int jack_input_channels[RD_MAX_PORTS];
-volatile int jack_output_channels[RD_MAX_STREAMS];
+volatile int *jack_output_channels;
 volatile jack_default_audio_sample_t *jack_input_buffer[RD_MAX_PORTS][2];
 volatile jack_default_audio_sample_t *jack_output_buffer[RD_MAX_PORTS][2];
-RDRingBuffer *jack_play_ring[RD_MAX_STREAMS];
-RDRingBuffer *jack_record_ring[RD_MAX_PORTS];
-volatile bool jack_playing[RD_MAX_STREAMS];
-volatile bool jack_stopping[RD_MAX_STREAMS];
-volatile bool jack_eof[RD_MAX_STREAMS];
+RDSpscRing **jack_play_ring;
+RDSpscRing *jack_record_ring[RD_MAX_PORTS];
+RecordDeck *jack_record_deck[RD_MAX_PORTS];
+volatile bool *jack_playing;
+volatile bool *jack_stopping;
+volatile bool *jack_eof;
 volatile bool jack_recording[RD_MAX_PORTS];
 volatile bool jack_ready[RD_MAX_PORTS];
-volatile int jack_output_pos[RD_MAX_STREAMS];
-volatile unsigned jack_output_sample_rate[RD_MAX_STREAMS];
+volatile int *jack_output_pos;
+volatile unsigned *jack_output_sample_rate;
 volatile unsigned jack_sample_rate;
 int jack_input_mode[RD_MAX_CARDS][RD_MAX_PORTS];
 int jack_card_process;  // local copy of object member jack_card, for use by the callback process.
+ReaderPool *jack_reader_pool;
+volatile unsigned jack_play_ring_low_water;
+volatile unsigned jack_play_ring_timescale_water;
+FadeRamp **jack_fade_ramp;
+PlaySchedule **jack_play_schedule;
+volatile bool *jack_starting;
+std::atomic<uint64_t> jack_sample_clock;
+StreamStats **jack_stream_stats;
+LoudnessMeter **jack_stream_loudness;
+LoudnessMeter *jack_output_loudness[RD_MAX_PORTS];
+SilenceSense *jack_silence_sense[RD_MAX_PORTS];
+std::atomic<unsigned> jack_xruns;
 
 
 //
 // Callback Buffers
 //
 jack_default_audio_sample_t jack_callback_buffer[RINGBUFFER_SIZE];
+jack_default_audio_sample_t jack_fade_buffer[RINGBUFFER_SIZE];
 
 int JackProcess(jack_nframes_t nframes, void *arg)
 {
   unsigned n=0;
+  uint64_t clock;
+  unsigned offset;
+  unsigned frames;
+  unsigned when;
+  bool stopping;
+  int fade_port;
+  int fade_from;
+  int fade_to;
+  unsigned fade_frames;
   jack_default_audio_sample_t in_meter[2];
   jack_default_audio_sample_t out_meter[2];
-  jack_default_audio_sample_t stream_out_meter;
+  jack_default_audio_sample_t stream_out_meter[2];
+  float peaks[2];
+  unsigned chans;
+  RDSpscSpan span;
+  unsigned len[2];
+  const jack_default_audio_sample_t *src;
+  float *left;
+  float *right;
 
   //
   // Ensure Buffers are Valid
@@ -151,10 +190,7 @@ int JackProcess(jack_nframes_t nframes, void *arg)
 	      break;
 	    }
 	  } // for nframes
-	  n=jack_record_ring[i]->
-	    write((char *)jack_callback_buffer,
-		  nframes*sizeof(jack_default_audio_sample_t))/
-	    sizeof(jack_default_audio_sample_t);
+	  n=jack_record_deck[i]->capture(jack_callback_buffer,nframes);
 	  break;
 
 	case 2: // stereo
@@ -187,10 +223,7 @@ int JackProcess(jack_nframes_t nframes, void *arg)
 	      break;
 	    }
 	  } // for nframes
-	  n=jack_record_ring[i]->
-	    write((char *)jack_callback_buffer,
-		  2*nframes*sizeof(jack_default_audio_sample_t))/
-	    (2*sizeof(jack_default_audio_sample_t));
+	  n=jack_record_deck[i]->capture(jack_callback_buffer,nframes);
 	  break;
 	}
       }
@@ -200,79 +233,145 @@ int JackProcess(jack_nframes_t nframes, void *arg)
   //
   // Process Output Streams
   //
-  for(int i=0;i<RD_MAX_STREAMS;i++) {
-    if(jack_playing[i]) {
-      switch(jack_output_channels[i]) {
-      case 1:
-	n=jack_play_ring[i]->
-	  read((char *)jack_callback_buffer,
-	       nframes*sizeof(jack_default_audio_sample_t))/
-	  sizeof(jack_default_audio_sample_t);
-	stream_out_meter=0.0;
-	for(unsigned j=0;j<n;j++) {  // Stream Output Meters
-	  if(fabsf(jack_callback_buffer[j])>stream_out_meter) {
-	    stream_out_meter=fabsf(jack_callback_buffer[j]);
+  clock=jack_sample_clock.load();
+  for(int i=0;i<jack_max_streams;i++) {
+    //
+    // Scheduled transitions.  A stream started or stopped part way through
+    // the period only contributes to the frames on its side of the
+    // transition.
+    //
+    offset=0;
+    frames=nframes;
+    stopping=false;
+    if(jack_play_ring[i]!=NULL) {
+      jack_play_ring[i]->serviceFlush();
+      if((!jack_playing[i])&&
+	 jack_play_schedule[i]->take(PlaySchedule::Play,clock,nframes,
+				     &offset)) {
+	jack_playing[i]=true;
+	jack_starting[i]=true;
+	frames=nframes-offset;
+      }
+      if(jack_playing[i]) {
+	if(jack_play_schedule[i]->take(PlaySchedule::Stop,clock,nframes,
+				       &when)) {
+	  frames=0;
+	  if(when>offset) {
+	    frames=when-offset;
 	  }
+	  stopping=true;
 	}
-	jack_stream_output_meter[i][0]->addValue(stream_out_meter);
-	jack_stream_output_meter[i][1]->addValue(stream_out_meter);
-	break;
-
-      case 2:
+	if(jack_play_schedule[i]->take(PlaySchedule::Fade,clock,nframes,
+				       &when)) {
+	  jack_play_schedule[i]->
+	    fadeParameters(&fade_port,&fade_from,&fade_to,&fade_frames);
+	  jack_fade_ramp[i]->begin(fade_port,fade_from,fade_to,fade_frames,
+				   when>offset ? when-offset : 0);
+	}
+      }
+    }
+    if(jack_playing[i]) {
+      chans=jack_output_channels[i];
+      jack_stream_stats[i]->
+	updateFill(jack_play_ring[i]->readSpace()/
+		   (sizeof(jack_default_audio_sample_t)*chans));
+
+      //
+      // Mix straight out of the ring.  The span is only released back to
+      // the reader threads once every port has been fed from it.
+      //
+      n=0;
+      len[0]=0;
+      len[1]=0;
+      if((chans==1)||(chans==2)) {
 	n=jack_play_ring[i]->
-	  read((char *)jack_callback_buffer,
-	       2*nframes*sizeof(jack_default_audio_sample_t))/
-	  (2*sizeof(jack_default_audio_sample_t));
-	for(unsigned j=0;j<2;j++) {  // Stream Output Meters
-	  stream_out_meter=0.0;
-	  for(unsigned k=0;k<n;k+=2) {
-	    if(fabsf(jack_callback_buffer[k+j])>stream_out_meter) {
-	      stream_out_meter=fabsf(jack_callback_buffer[k+j]);
+	  reserveRead(&span,chans*frames*sizeof(jack_default_audio_sample_t))/
+	  (chans*sizeof(jack_default_audio_sample_t));
+	len[0]=span.len[0]/(chans*sizeof(jack_default_audio_sample_t));
+	if(len[0]>n) {
+	  len[0]=n;
+	}
+	len[1]=n-len[0];
+      }
+      stream_out_meter[0]=0.0;
+      stream_out_meter[1]=0.0;
+      for(unsigned k=0;k<2;k++) {  // Stream Output Meters
+	if(len[k]>0) {
+	  src=(const jack_default_audio_sample_t *)span.data[k];
+	  if(chans==1) {
+	    peaks[0]=MixBusPeak(src,len[k]);
+	    peaks[1]=peaks[0];
+	  }
+	  else {
+	    MixBusStereoPeak(src,len[k],peaks);
+	  }
+	  for(unsigned j=0;j<2;j++) {
+	    if(peaks[j]>stream_out_meter[j]) {
+	      stream_out_meter[j]=peaks[j];
 	    }
 	  }
-	  jack_stream_output_meter[i][j]->addValue(stream_out_meter);
+	  if(jack_stream_loudness[i]!=NULL) {
+	    jack_stream_loudness[i]->process(src,chans,len[k]);
+	  }
 	}
-	break;
       }
+      for(unsigned j=0;j<2;j++) {
+	jack_stream_output_meter[2*i+j]->addValue(stream_out_meter[j]);
+      }
+      if(n>0) {
+	jack_stream_stats[i]->markFirstSample();
+      }
+      if((n<frames)&&(!jack_eof[i])) {
+	jack_stream_stats[i]->addUnderrun();
+      }
+      bool fading=jack_fade_ramp[i]->render(jack_fade_buffer,n);
       for(int j=0;j<RD_MAX_PORTS;j++) {
-	if(jack_output_port[j][0]!=NULL) {
-	  if(jack_output_volume[j][i]>0.0) {
-	    switch(jack_output_channels[i]) {
-	    case 1:
-	      for(unsigned k=0;k<n;k++) {
-		jack_output_buffer[j][0][k]=
-		  jack_output_buffer[j][0][k]+jack_output_volume[j][i]*
-		  jack_callback_buffer[k];
-		jack_output_buffer[j][1][k]=
-		  jack_output_buffer[j][1][k]+jack_output_volume[j][i]*
-		  jack_callback_buffer[k];
-	      }
-	      if(n!=nframes && jack_eof[i]) {
-		jack_stopping[i]=true;
-		jack_playing[i]=false;
-	      }
-	      break;
-
-	    case 2:
-	      for(unsigned k=0;k<n;k++) {
-		jack_output_buffer[j][0][k]=
-		  jack_output_buffer[j][0][k]+jack_output_volume[j][i]*
-		  jack_callback_buffer[k*2];
-		jack_output_buffer[j][1][k]=
-		  jack_output_buffer[j][1][k]+jack_output_volume[j][i]*
-		  jack_callback_buffer[k*2+1];
-	      }
-	      if(n!=nframes && jack_eof[i]) {
-		jack_stopping[i]=true;
-		jack_playing[i]=false;
-	      }
-	      break;
+	if(jack_output_port[j][0]==NULL) {
+	  continue;
+	}
+	bool ramp=fading&&(j==jack_fade_ramp[i]->port());
+	if((!ramp)&&(jack_output_volume[j][i]<=0.0)) {
+	  continue;
+	}
+	unsigned done=0;
+	for(unsigned k=0;k<2;k++) {
+	  if(len[k]>0) {
+	    src=(const jack_default_audio_sample_t *)span.data[k];
+	    left=(float *)jack_output_buffer[j][0]+offset+done;
+	    right=(float *)jack_output_buffer[j][1]+offset+done;
+	    if(ramp) {
+	      MixBusAccumulateSplitRamp(left,right,src,chans,
+					jack_fade_buffer+done,len[k]);
 	    }
+	    else {
+	      MixBusAccumulateSplit(left,right,src,chans,
+				    jack_output_volume[j][i],len[k]);
+	    }
+	    done+=len[k];
 	  }
 	}
       }
+      jack_play_ring[i]->
+	commitRead(n*chans*sizeof(jack_default_audio_sample_t));
+      if((n!=frames)&&jack_eof[i]) {
+	jack_stopping[i]=true;
+	jack_playing[i]=false;
+      }
+      if(stopping) {
+	jack_stopping[i]=true;
+	jack_playing[i]=false;
+      }
       double ratio=(double)jack_output_sample_rate[i]/(double)jack_sample_rate;
       jack_output_pos[i]+=(int)(((double)n*ratio)+0.5);
+      if(!jack_eof[i]) {
+	unsigned water=jack_play_ring_low_water;
+	if(jack_reader_pool->isTimescaled(jack_card_process,i)) {
+	  water=jack_play_ring_timescale_water;
+	}
+	if(jack_play_ring[i]->readSpace()<water) {
+	  jack_reader_pool->requestFill(jack_card_process,i);
+	}
+      }
     }
   }
 
@@ -322,8 +421,25 @@ int JackProcess(jack_nframes_t nframes, void *arg)
 	}
 	jack_output_meter[i][j]->addValue(out_meter[j]);
       }
+      jack_silence_sense[i]->
+	update(out_meter[0]>out_meter[1] ? out_meter[0] : out_meter[1],nframes);
+      if(jack_output_loudness[i]!=NULL) {
+	jack_output_loudness[i]->
+	  processSplit((const float *)jack_output_buffer[i][0],
+		       (const float *)jack_output_buffer[i][1],nframes);
+      }
     }
   } // for RD_MAX_PORTS
+  jack_sample_clock+=nframes;
+
+  return 0;
+}
+
+
+int JackXrun(void *arg)
+{
+  jack_xruns++;
+
   return 0;
 }
 
@@ -349,33 +465,59 @@ void JackShutdown(void *arg)
 
 void JackInitCallback()
 {
-  int avg_periods=(int)(330.0*jack_get_sample_rate(jack_client)/
-			(1000.0*jack_get_buffer_size(jack_client)));
+  //
+  // The stream output meters (and the fade ramps and schedules) are only
+  // created when a stream is first used (see GetJackOutputStream()), and
+  // are then kept for reuse.
+  //
+  jack_meter_periods=(int)(330.0*jack_get_sample_rate(jack_client)/
+			   (1000.0*jack_get_buffer_size(jack_client)));
   for(int i=0;i<RD_MAX_PORTS;i++) {
     jack_recording[i]=false;
     jack_ready[i]=false;
     jack_input_volume[i]=1.0;
     jack_input_vox[i]=0.0;
     for(int j=0;j<2;j++) {
-      jack_input_meter[i][j]=new RDMeterAverage(avg_periods);
-      jack_output_meter[i][j]=new RDMeterAverage(avg_periods);
+      jack_input_meter[i][j]=new RDMeterAverage(jack_meter_periods);
+      jack_output_meter[i][j]=new RDMeterAverage(jack_meter_periods);
       jack_input_buffer[i][j]=NULL;
       jack_output_buffer[i][j]=NULL;
     }
-    for(int j=0;j<RD_MAX_STREAMS;j++) {
+    jack_output_volume[i]=
+      new volatile jack_default_audio_sample_t[jack_max_streams];
+    for(int j=0;j<jack_max_streams;j++) {
       jack_output_volume[i][j]=1.0;
     }
     for(int j=0;j<RD_MAX_PORTS;j++) {
       jack_passthrough_volume[i][j]=0.0;
     }
     jack_record_ring[i]=NULL;
-  }
-  for(int i=0;i<RD_MAX_STREAMS;i++) {
+    jack_record_deck[i]=NULL;
+  }
+  jack_stream_output_meter=new RDMeterAverage *[2*jack_max_streams];
+  jack_output_channels=new volatile int[jack_max_streams];
+  jack_play_ring=new RDSpscRing *[jack_max_streams];
+  jack_playing=new volatile bool[jack_max_streams];
+  jack_stopping=new volatile bool[jack_max_streams];
+  jack_eof=new volatile bool[jack_max_streams];
+  jack_output_pos=new volatile int[jack_max_streams];
+  jack_output_sample_rate=new volatile unsigned[jack_max_streams];
+  jack_fade_ramp=new FadeRamp *[jack_max_streams];
+  jack_play_schedule=new PlaySchedule *[jack_max_streams];
+  jack_starting=new volatile bool[jack_max_streams];
+  for(int i=0;i<jack_max_streams;i++) {
+    jack_stream_output_meter[2*i]=NULL;
+    jack_stream_output_meter[2*i+1]=NULL;
+    jack_output_channels[i]=0;
     jack_play_ring[i]=NULL;
     jack_playing[i]=false;
-    for(int j=0;j<2;j++) {
-      jack_stream_output_meter[i][j]=new RDMeterAverage(avg_periods);
-    }
+    jack_stopping[i]=false;
+    jack_eof[i]=false;
+    jack_output_pos[i]=0;
+    jack_output_sample_rate[i]=0;
+    jack_fade_ramp[i]=NULL;
+    jack_play_schedule[i]=NULL;
+    jack_starting[i]=false;
   }
 }
 #endif  // JACK
@@ -389,24 +531,6 @@ DriverJack::DriverJack(QObject *parent)
 #ifdef JACK
   jack_connected=false;
   jack_activated=false;
-
-  //
-  // Allocate Temporary Buffers
-  //
-  jack_wave_buffer=new short[RINGBUFFER_SIZE];
-  jack_wave32_buffer=new int[RINGBUFFER_SIZE];
-  jack_wave24_buffer=new uint8_t[RINGBUFFER_SIZE];
-  jack_sample_buffer=new jack_default_audio_sample_t[RINGBUFFER_SIZE];
-#ifdef HAVE_MAD
-  for(int i=0;i<RD_MAX_CARDS;i++) {
-    for(int j=0;j<RD_MAX_STREAMS;j++) {
-      mad_mpeg[i][j]=new unsigned char[16384];
-    }
-  }
-#endif  // HAVE_MAD
-
-  LoadTwoLame();
-  LoadMad();
 #endif  // JACK
 }
 
@@ -414,6 +538,7 @@ DriverJack::DriverJack(QObject *parent)
 DriverJack::~DriverJack()
 {
 #ifdef JACK
+  stopReaderPool();
   for(int i=0;i<jack_clients.size();i++) {
     jack_clients[i]->kill();
     delete jack_clients[i];
@@ -422,17 +547,6 @@ DriverJack::~DriverJack()
   if(jack_activated) {
     jack_deactivate(jack_client);
   }
-  delete jack_wave_buffer;
-  delete jack_wave32_buffer;
-  delete jack_wave24_buffer;
-  delete jack_sample_buffer;
-#ifdef HAVE_MAD
-  for(int i=0;i<RD_MAX_CARDS;i++) {
-    for(int j=0;j<RD_MAX_STREAMS;j++) {
-      delete mad_mpeg[i][j];
-    }
-  }
-#endif  // HAVE_MAD
 #endif  // JACK
 }
 
@@ -574,6 +688,7 @@ bool DriverJack::initialize(unsigned *next_cardnum)
   jack_connected=true;
   jack_set_process_callback(jack_client,JackProcess,0);
   jack_set_sample_rate_callback(jack_client,JackSampleRate,0);
+  jack_set_xrun_callback(jack_client,JackXrun,0);
   //jack_set_port_connect_callback(jack_client,JackPortConnectCB,this);
 #ifdef HAVE_JACK_INFO_SHUTDOWN
   jack_on_info_shutdown(jack_client,JackInfoShutdown,0);
@@ -604,13 +719,35 @@ bool DriverJack::initialize(unsigned *next_cardnum)
   //
   // Initialize Data Structures
   //
-  for(int i=0;i<RD_MAX_STREAMS;i++) {
-    for(int j=0;j<RD_MAX_PORTS;j++) {
-      jack_output_volume_db[j][i]=0; 
-      jack_samples_recorded[i]=0;
+  jack_max_streams=maxStreams();
+  allocateStreams(jack_card);
+  for(int i=0;i<RD_MAX_PORTS;i++) {
+    jack_output_loudness[i]=outputLoudness(jack_card,i);
+    jack_silence_sense[i]=silenceSense(jack_card,i);
+    jack_output_volume_db[i]=new short[jack_max_streams];
+    for(int j=0;j<jack_max_streams;j++) {
+      jack_output_volume_db[i][j]=0;
     }
+  }
+  jack_play_wave=new RDWaveFile *[jack_max_streams];
+  jack_play_decoder=new CaeDecoder *[jack_max_streams];
+  jack_st_conv=new soundtouch::SoundTouch *[jack_max_streams];
+  jack_stream_stats=new StreamStats *[jack_max_streams];
+  jack_stream_loudness=new LoudnessMeter *[jack_max_streams];
+  jack_stop_timer=new QTimer *[jack_max_streams];
+  jack_offset=new int[jack_max_streams];
+  jack_play_length=new int[jack_max_streams];
+  for(int i=0;i<jack_max_streams;i++) {
+    jack_play_wave[i]=NULL;
+    jack_play_decoder[i]=NULL;
     jack_st_conv[i]=NULL;
+    jack_stream_stats[i]=streamStats(jack_card,i);
+    jack_stream_loudness[i]=NULL;
+    jack_offset[i]=0;
+    jack_play_length[i]=0;
   }
+  jack_sample_clock=0;
+  jack_xruns=0;
   for(int i=0;i<RD_MAX_PORTS;i++) {
     jack_input_volume_db[i]=0;
     for(int j=0;j<RD_MAX_PORTS;j++) {
@@ -625,22 +762,17 @@ bool DriverJack::initialize(unsigned *next_cardnum)
   jack_card_process = jack_card; // populate variable used by callback process
 
   //
-  // Stop & Fade Timers
+  // Stop Timers
   //
   QSignalMapper *stop_mapper=new QSignalMapper(this);
   connect(stop_mapper,SIGNAL(mapped(int)),this,SLOT(stopTimerData(int)));
-  QSignalMapper *fade_mapper=new QSignalMapper(this);
-  connect(fade_mapper,SIGNAL(mapped(int)),this,SLOT(fadeTimerData(int)));
   QSignalMapper *record_mapper=new QSignalMapper(this);
   connect(record_mapper,SIGNAL(mapped(int)),this,SLOT(recordTimerData(int)));
-  for(int i=0;i<RD_MAX_STREAMS;i++) {
+  for(int i=0;i<jack_max_streams;i++) {
     jack_stop_timer[i]=new QTimer(this);
     jack_stop_timer[i]->setSingleShot(true);
     stop_mapper->setMapping(jack_stop_timer[i],i);
     connect(jack_stop_timer[i],SIGNAL(timeout()),stop_mapper,SLOT(map()));
-    jack_fade_timer[i]=new QTimer(this);
-    fade_mapper->setMapping(jack_fade_timer[i],i);
-    connect(jack_fade_timer[i],SIGNAL(timeout()),fade_mapper,SLOT(map()));
   }
   for(int i=0;i<RD_MAX_PORTS;i++) {
     jack_record_timer[i]=new QTimer(this);
@@ -685,6 +817,20 @@ bool DriverJack::initialize(unsigned *next_cardnum)
   //
   JackInitCallback();
 
+  //
+  // Start Reader Threads
+  //
+  jack_play_ring_size=playRingSize(sizeof(jack_default_audio_sample_t));
+  jack_play_ring_low_water=jack_play_ring_size/2;
+
+  //
+  // Timescale threads run below the reader threads, so keep timescaled
+  // streams topped up from further ahead to give them the slack
+  //
+  jack_play_ring_timescale_water=3*jack_play_ring_size/4;
+  startReaderPool(jack_play_ring_size,true);
+  jack_reader_pool=readerPool();
+
   //
   // Join the Graph
   //
@@ -737,22 +883,8 @@ bool DriverJack::loadPlayback(int card,QString wavename,int *stream)
     *stream=-1;
     return false;
   }
-  switch(jack_play_wave[*stream]->getFormatTag()) {
-  case WAVE_FORMAT_PCM:
-  case WAVE_FORMAT_VORBIS:
-    break;
-
-  case WAVE_FORMAT_MPEG:
-    if(!InitMadDecoder(card,*stream,jack_play_wave[*stream])) {
-      delete jack_play_wave[*stream];
-      jack_play_wave[*stream]=NULL;
-      FreeJackOutputStream(*stream);
-      *stream=-1;
-      return false;
-    }
-    break;
-
-  default:
+  if((jack_play_decoder[*stream]=
+      CaeDecoder::create(jack_play_wave[*stream]))==NULL) {
     rda->syslog(LOG_DEBUG,
 	"jackLoadPlayback(%s) getFormatTag()%d || getBistsPerSample()%d failed",
 		wavename.toUtf8().constData(),
@@ -764,13 +896,27 @@ bool DriverJack::loadPlayback(int card,QString wavename,int *stream)
     *stream=-1;
     return false;
   }
+  if(!jack_play_decoder[*stream]->setOutputSampleRate(jack_sample_rate)) {
+    delete jack_play_decoder[*stream];
+    jack_play_decoder[*stream]=NULL;
+    delete jack_play_wave[*stream];
+    jack_play_wave[*stream]=NULL;
+    FreeJackOutputStream(*stream);
+    *stream=-1;
+    return false;
+  }
   jack_output_channels[*stream]=jack_play_wave[*stream]->getChannels();
   jack_output_sample_rate[*stream]=jack_play_wave[*stream]->getSamplesPerSec();
   jack_stopping[*stream]=false;
   jack_offset[*stream]=0;
   jack_output_pos[*stream]=0;
   jack_eof[*stream]=false;
-  FillJackOutputStream(*stream);
+  readerPool()->resetCpuTime(jack_card,*stream);
+  streamStats(jack_card,*stream)->reset(jack_sample_rate);
+  if(jack_stream_loudness[*stream]!=NULL) {
+    jack_stream_loudness[*stream]->reset();
+  }
+  readerPool()->requestFill(jack_card,*stream);
   return true;
 #else
   return false;
@@ -781,22 +927,27 @@ bool DriverJack::loadPlayback(int card,QString wavename,int *stream)
 bool DriverJack::unloadPlayback(int card,int stream)
 {
 #ifdef JACK
-  if ((stream <0) || (stream >= RD_MAX_STREAMS)){
+  if ((stream <0) || (stream>=maxStreams())){
     return false;
   }
   if(jack_play_ring[stream]==NULL) {
     return false;
   }
+  jack_play_schedule[stream]->cancelAll();
   jack_playing[stream]=false;
-  switch(jack_play_wave[stream]->getFormatTag()) {
-  case WAVE_FORMAT_MPEG:
-    FreeMadDecoder(card,stream);
-    break;
+  if(readerPool()->isTimescaled(jack_card,stream)) {
+    LogTimescaleUsage(stream);
+    readerPool()->setTimescaled(jack_card,stream,false);
   }
+  readerPool()->lock(jack_card,stream);
+  delete jack_play_decoder[stream];
+  jack_play_decoder[stream]=NULL;
   jack_play_wave[stream]->closeWave();
   delete jack_play_wave[stream];
   jack_play_wave[stream]=NULL;
   FreeJackOutputStream(stream);
+  readerPool()->unlock(jack_card,stream);
+  jack_fade_ramp[stream]->cancel();
   return true;
 #else
   return false;
@@ -809,38 +960,32 @@ bool DriverJack::playbackPosition(int card,int stream,unsigned pos)
 #ifdef JACK
   unsigned offset=0;
 
-  if ((stream <0) || (stream >= RD_MAX_STREAMS)){
+  if ((stream <0) || (stream>=maxStreams())){
     return false;
   }
-  jack_eof[stream]=false;
-  jack_play_ring[stream]->reset();
-
-
-  switch(jack_play_wave[stream]->getFormatTag()) {
-  case WAVE_FORMAT_PCM:
-  case WAVE_FORMAT_VORBIS:
-    offset=(unsigned)((double)jack_play_wave[stream]->getSamplesPerSec()*
-		      (double)jack_play_wave[stream]->getBlockAlign()*
-		      (double)pos/1000);
-    jack_offset[stream]=offset/jack_play_wave[stream]->getBlockAlign();
-    offset=jack_offset[stream]*jack_play_wave[stream]->getBlockAlign();
-    break;
-
-  case WAVE_FORMAT_MPEG:
-    offset=(unsigned)((double)jack_play_wave[stream]->getSamplesPerSec()*
-		      (double)pos/1000);
-    jack_offset[stream]=offset/1152*1152;
-    offset=jack_offset[stream]/1152*jack_play_wave[stream]->getBlockAlign();
-    FreeMadDecoder(jack_card,stream);
-    InitMadDecoder(jack_card,stream,jack_play_wave[stream]);
-    break;
-  }
-  if(jack_offset[stream]>(int)jack_play_wave[stream]->getSampleLength()) {
+  if(jack_play_decoder[stream]==NULL) {
     return false;
   }
+  offset=(unsigned)((double)jack_play_wave[stream]->getSamplesPerSec()*
+		    (double)pos/1000);
+  if(offset>jack_play_wave[stream]->getSampleLength()) {
+    return false;
+  }
+  readerPool()->lock(jack_card,stream);
+  jack_eof[stream]=false;
+  if(!jack_play_ring[stream]->flush()) {
+    rda->syslog(LOG_WARNING,
+		"play ring for stream %d flushed without the callback",stream);
+  }
+  jack_offset[stream]=jack_play_decoder[stream]->seek(offset);
   jack_output_pos[stream]=0;
-  jack_play_wave[stream]->seekWave(offset,SEEK_SET);
-  FillJackOutputStream(stream);
+  readerPool()->unlock(jack_card,stream);
+  if(jack_playing[stream]) {
+    readerPool()->fill(jack_card,stream);
+  }
+  else {
+    readerPool()->requestFill(jack_card,stream);  // Preroll in the background
+  }
 
   if(jack_playing[stream]) {
     jack_stop_timer[stream]->stop();
@@ -858,16 +1003,9 @@ bool DriverJack::play(int card,int stream,int length,int speed,bool pitch,
 		      bool rates)
 {
 #ifdef JACK
-  if((stream <0) || (stream >= RD_MAX_STREAMS) || 
-     (jack_play_ring[stream]==NULL)||jack_playing[stream]) {
+  if(!PreparePlayback(stream,speed)) {
     return false;
   }
-  if(speed!=RD_TIMESCALE_DIVISOR) {
-    jack_st_conv[stream]=new soundtouch::SoundTouch();
-    jack_st_conv[stream]->setTempo((float)speed/RD_TIMESCALE_DIVISOR);
-    jack_st_conv[stream]->setSampleRate(jack_output_sample_rate[stream]);
-    jack_st_conv[stream]->setChannels(jack_output_channels[stream]);
-  }
   jack_playing[stream]=true;
   if(length>0) {
     jack_stop_timer[stream]->start(length);
@@ -883,10 +1021,22 @@ bool DriverJack::play(int card,int stream,int length,int speed,bool pitch,
 bool DriverJack::stopPlayback(int card,int stream)
 {
 #ifdef JACK
-  if((stream <0) || (stream>=RD_MAX_STREAMS) || 
-     (jack_play_ring[stream]==NULL)||(!jack_playing[stream])) {
+  if((stream <0) || (stream>=maxStreams()) || 
+     (jack_play_ring[stream]==NULL)) {
     return false;
   }
+  if(!jack_playing[stream]) {
+    //
+    // Withdraw a scheduled start that has yet to happen
+    //
+    if(!jack_play_schedule[stream]->isScheduled(PlaySchedule::Play)) {
+      return false;
+    }
+    jack_play_schedule[stream]->cancelAll();
+    statePlayUpdate(card,stream,2);
+    return true;
+  }
+  jack_play_schedule[stream]->cancel(PlaySchedule::Stop);
   jack_playing[stream]=false;
   jack_stop_timer[stream]->stop();
   statePlayUpdate(card,stream,2);
@@ -911,74 +1061,13 @@ bool DriverJack::loadRecord(int card,int port,int coding,int chans,int samprate,
 			    int bitrate,QString wavename)
 {
 #ifdef JACK
-  jack_record_wave[port]=new RDWaveFile(wavename);
-  switch(coding) {
-  case 0:  // PCM16
-    jack_record_wave[port]->setFormatTag(WAVE_FORMAT_PCM);
-    jack_record_wave[port]->setChannels(chans);
-    jack_record_wave[port]->setSamplesPerSec(samprate);
-    jack_record_wave[port]->setBitsPerSample(16);
-    break;
-
-  case 4:  // PCM24
-    jack_record_wave[port]->setFormatTag(WAVE_FORMAT_PCM);
-    jack_record_wave[port]->setChannels(chans);
-    jack_record_wave[port]->setSamplesPerSec(samprate);
-    jack_record_wave[port]->setBitsPerSample(24);
-    break;
-
-  case 2:  // MPEG Layer 2
-    if(!InitTwoLameEncoder(card,port,chans,samprate,bitrate)) {
-      delete jack_record_wave[port];
-      jack_record_wave[port]=NULL;
-      return false;
-    }
-    jack_record_wave[port]->setFormatTag(WAVE_FORMAT_MPEG);
-    jack_record_wave[port]->setChannels(chans);
-    jack_record_wave[port]->setSamplesPerSec(samprate);
-    jack_record_wave[port]->setBitsPerSample(16);
-    jack_record_wave[port]->setHeadLayer(ACM_MPEG_LAYER2);
-    switch(chans) {
-    case 1:
-      jack_record_wave[port]->setHeadMode(ACM_MPEG_SINGLECHANNEL);
-      break;
-
-    case 2:
-      jack_record_wave[port]->setHeadMode(ACM_MPEG_STEREO);
-      break;
-
-    default:
-      rda->syslog(LOG_WARNING,
-	     "requested unsupported channel count %d, card: %d, port: %d",
-	     chans,card,port);
-      delete jack_record_wave[port];
-      jack_record_wave[port]=NULL;
-      return false;
-    }
-    jack_record_wave[port]->setHeadBitRate(bitrate);
-    jack_record_wave[port]->setMextChunk(true);
-    jack_record_wave[port]->setMextHomogenous(true);
-    jack_record_wave[port]->setMextPaddingUsed(false);
-    jack_record_wave[port]->setMextHackedBitRate(true);
-    jack_record_wave[port]->setMextFreeFormat(false);
-    jack_record_wave[port]->
-      setMextFrameSize(144*jack_record_wave[port]->getHeadBitRate()/
-		       jack_record_wave[port]->getSamplesPerSec());
-    jack_record_wave[port]->setMextAncillaryLength(5);
-    jack_record_wave[port]->setMextLeftEnergyPresent(true);
-    if(chans>1) {
-      jack_record_wave[port]->setMextRightEnergyPresent(true);
-    }
-    else {
-      jack_record_wave[port]->setMextRightEnergyPresent(false);
-    }
-    jack_record_wave[port]->setMextPrivateDataPresent(false);
-    break;
+  CaeEncoder *enc=NULL;
 
-  default:
-    rda->syslog(LOG_WARNING,
-	   "requested invalid audio encoding %d, card: %d, port: %d",
-	   coding,card,port);
+  jack_record_wave[port]=new RDWaveFile(wavename);
+  if((enc=CaeEncoder::create(jack_record_wave[port],coding,chans,
+			     samprate,bitrate))==NULL) {
+    rda->syslog(LOG_WARNING,"unable to load recording, card: %d, port: %d",
+		card,port);
     delete jack_record_wave[port];
     jack_record_wave[port]=NULL;
     return false;
@@ -986,6 +1075,7 @@ bool DriverJack::loadRecord(int card,int port,int coding,int chans,int samprate,
   jack_record_wave[port]->setBextChunk(true);
   jack_record_wave[port]->setLevlChunk(true);
   if(!jack_record_wave[port]->createWave()) {
+    delete enc;
     delete jack_record_wave[port];
     jack_record_wave[port]=NULL;
     return false;
@@ -993,8 +1083,10 @@ bool DriverJack::loadRecord(int card,int port,int coding,int chans,int samprate,
   RDCheckExitCode(rda->config(),"jackLoadRecord() chown",
 		  chown(wavename.toUtf8(),rda->config()->uid(),rda->config()->gid()));
   jack_input_channels[port]=chans;
-  jack_record_ring[port]=new RDRingBuffer(RINGBUFFER_SIZE);
+  jack_record_ring[port]=new RDSpscRing(RINGBUFFER_SIZE);
   jack_record_ring[port]->reset();
+  jack_record_deck[port]=
+    new RecordDeck(enc,jack_record_ring[port],RecordDeck::Float32);
   jack_ready[port]=true;
   return true;
 #else
@@ -1011,15 +1103,14 @@ bool DriverJack::unloadRecord(int card,int port,unsigned *len_frames)
   }
   jack_recording[port]=false;
   jack_ready[port]=false;
-  EmptyJackInputStream(port,true);
-  *len_frames=jack_samples_recorded[port];
-  jack_samples_recorded[port]=0;
+  *len_frames=jack_record_deck[port]->finish();
+  delete jack_record_deck[port];
+  jack_record_deck[port]=NULL;
   jack_record_wave[port]->closeWave(*len_frames);
   delete jack_record_wave[port];
   jack_record_wave[port]=NULL;
   delete jack_record_ring[port];
   jack_record_ring[port]=NULL;
-  FreeTwoLameEncoder(card,port);
   return true;
 #else
   return false;
@@ -1103,7 +1194,7 @@ bool DriverJack::setInputVolume(int card,int stream,int level)
 bool DriverJack::setOutputVolume(int card,int stream,int port,int level)
 {
 #ifdef JACK
-  if((stream<0)||(stream>=RD_MAX_STREAMS)||(port<0)||(port>=RD_MAX_PORTS)) {
+  if((stream<0)||(stream>=maxStreams())||(port<0)||(port>=RD_MAX_PORTS)) {
     return false;
   }
   if(level>-10000) {
@@ -1115,6 +1206,9 @@ bool DriverJack::setOutputVolume(int card,int stream,int port,int level)
     jack_output_volume[port][stream]=0.0;
     jack_output_volume_db[port][stream]=-10000;
   }
+  if(jack_fade_ramp[stream]!=NULL) {
+    jack_fade_ramp[stream]->cancel(port);
+  }
   return true;
 #else
   return false;
@@ -1126,26 +1220,13 @@ bool DriverJack::fadeOutputVolume(int card,int stream,int port,int level,
 				  int length)
 {
 #ifdef JACK
-  int diff;
-
-  if((stream<0)||(stream>=RD_MAX_STREAMS)||(port<0)||(port>=RD_MAX_PORTS)) {
+  if((stream<0)||(stream>=maxStreams())||(port<0)||(port>=RD_MAX_PORTS)||
+     (jack_fade_ramp[stream]==NULL)) {
     return false;
   }
-  if(jack_fade_timer[stream]->isActive()) {
-    jack_fade_timer[stream]->stop();
-  }
-  if(level>jack_output_volume_db[port][stream]) {
-    jack_fade_up[stream]=true;
-    diff=level-jack_output_volume_db[port][stream];
-  }
-  else {
-    jack_fade_up[stream]=false;
-    diff=jack_output_volume_db[port][stream]-level;
-  }
-  jack_fade_volume_db[stream]=level;
-  jack_fade_port[stream]=port;
-  jack_fade_increment[stream]=diff*RD_JACK_FADE_INTERVAL/length;
-  jack_fade_timer[stream]->start(RD_JACK_FADE_INTERVAL);
+  jack_fade_ramp[stream]->
+    start(port,jack_output_volume_db[port][stream],level,
+	  (unsigned)((double)length*(double)jack_sample_rate/1000.0));
   return true;
 #else
   return false;
@@ -1281,12 +1362,13 @@ bool DriverJack::getStreamOutputMeters(int card,int stream,short levels[2])
 {
 #ifdef JACK
   jack_default_audio_sample_t meter;
-  if((stream<0)||(stream>=RD_MAX_STREAMS)) {
+  if((stream<0)||(stream>=maxStreams())||
+     (jack_stream_output_meter[2*stream]==NULL)) {
     return false;
   }
 
   for(int i=0;i<2;i++) {
-    meter=jack_stream_output_meter[stream][i]->average();
+    meter=jack_stream_output_meter[2*stream+i]->average();
     if(meter==0.0) {
       levels[i]=-10000;
     }
@@ -1331,7 +1413,7 @@ bool DriverJack::setPassthroughLevel(int card,int in_port,int out_port,
 void DriverJack::getOutputPosition(int card,unsigned *pos)
 {
 #ifdef JACK
-  for(int i=0;i<RD_MAX_STREAMS;i++) {
+  for(int i=0;i<maxStreams();i++) {
     if(jack_play_wave[i]!=NULL) {
       pos[i]=1000*((unsigned long long)jack_offset[i]+jack_output_pos[i])/
 	jack_play_wave[i]->getSamplesPerSec();
@@ -1344,22 +1426,108 @@ void DriverJack::getOutputPosition(int card,unsigned *pos)
 }
 
 
+unsigned DriverJack::xruns(int card) const
+{
+#ifdef JACK
+  return jack_xruns;
+#else
+  return 0;
+#endif  // JACK
+}
+
+
+bool DriverJack::getSampleClock(int card,uint64_t *clock,unsigned *samprate)
+{
+#ifdef JACK
+  if(!jack_activated) {
+    return false;
+  }
+  *clock=jack_sample_clock.load();
+  *samprate=jack_sample_rate;
+  return true;
+#else
+  return false;
+#endif  // JACK
+}
+
+
+bool DriverJack::playAt(int card,int stream,uint64_t clock,int length,
+			int speed,bool pitch,bool rates)
+{
+#ifdef JACK
+  if(!PreparePlayback(stream,speed)) {
+    return false;
+  }
+  jack_play_length[stream]=length;
+  jack_play_schedule[stream]->schedule(PlaySchedule::Play,clock);
+  return true;
+#else
+  return false;
+#endif  // JACK
+}
+
+
+bool DriverJack::stopPlaybackAt(int card,int stream,uint64_t clock)
+{
+#ifdef JACK
+  if((stream<0)||(stream>=maxStreams())||(jack_play_ring[stream]==NULL)) {
+    return false;
+  }
+  jack_play_schedule[stream]->schedule(PlaySchedule::Stop,clock);
+  return true;
+#else
+  return false;
+#endif  // JACK
+}
+
+
+bool DriverJack::fadeOutputVolumeAt(int card,int stream,int port,int level,
+				    int length,uint64_t clock)
+{
+#ifdef JACK
+  if((stream<0)||(stream>=maxStreams())||(port<0)||(port>=RD_MAX_PORTS)||
+     (jack_play_ring[stream]==NULL)) {
+    return false;
+  }
+  jack_play_schedule[stream]->
+    scheduleFade(clock,port,jack_output_volume_db[port][stream],level,
+		 (unsigned)((double)length*(double)jack_sample_rate/1000.0));
+  return true;
+#else
+  return false;
+#endif  // JACK
+}
+
+
 void DriverJack::processBuffers()
 {
 #ifdef JACK
-  for(int i=0;i<RD_MAX_STREAMS;i++) {
+  int port;
+  int level;
+
+  for(int i=0;i<maxStreams();i++) {
+    if(jack_fade_ramp[i]==NULL) {  // Never used
+      continue;
+    }
+    if(jack_starting[i]) {  // Scheduled start
+      jack_starting[i]=false;
+      if(jack_play_length[i]>0) {
+	jack_stop_timer[i]->start(jack_play_length[i]);
+      }
+      statePlayUpdate(jack_card,i,1);
+    }
+    if(jack_fade_ramp[i]->isFinished(&port,&level)) {
+      setOutputVolume(jack_card,i,port,level);
+      jack_fade_ramp[i]->clear();
+      statePlayUpdate(jack_card,i,3);
+    }
     if(jack_stopping[i]) {
       jack_stopping[i]=false;
+      jack_stop_timer[i]->stop();
       statePlayUpdate(jack_card,i,2);
     }
-    if(jack_playing[i]&&((jack_clock_phase%4)==0)) {
-      FillJackOutputStream(i);
-    }
-  }
-  jack_clock_phase++;
-  for(int i=0;i<RD_MAX_PORTS;i++) {
-    if(jack_recording[i]) {
-      EmptyJackInputStream(i,false);
+    if(jack_playing[i]&&jack_eof[i]&&jack_stop_timer[i]->isActive()) {
+      jack_stop_timer[i]->stop();
     }
   }
 #endif  // JACK
@@ -1375,35 +1543,18 @@ void DriverJack::stopTimerData(int stream)
 }
 
 
-void DriverJack::fadeTimerData(int stream)
+void DriverJack::recordTimerData(int stream)
 {
 #ifdef JACK
-  int level;
-  if(!jack_fade_up[stream]) {
-    level=jack_output_volume_db[jack_fade_port[stream]][stream]-
-      jack_fade_increment[stream];
-    if(level<=jack_fade_volume_db[stream]) {
-      level=jack_fade_volume_db[stream];
-      jack_fade_timer[stream]->stop();
-    }
-  }
-  else {
-    level=jack_output_volume_db[jack_fade_port[stream]][stream]+
-      jack_fade_increment[stream];
-    if(level>=jack_fade_volume_db[stream]) {
-      level=jack_fade_volume_db[stream];
-      jack_fade_timer[stream]->stop();
-    }
-  }
-  setOutputVolume(jack_card,stream,jack_fade_port[stream],level);
+  stopRecord(jack_card,stream);
 #endif  // JACK
 }
 
 
-void DriverJack::recordTimerData(int stream)
+void DriverJack::fillStream(int card,int stream,ReaderBuffer *buf)
 {
 #ifdef JACK
-  stopRecord(jack_card,stream);
+  FillJackOutputStream(stream,buf);
 #endif  // JACK
 }
 
@@ -1443,12 +1594,50 @@ void DriverJack::clientStartData()
 }
 
 
+bool DriverJack::PreparePlayback(int stream,int speed)
+{
+#ifdef JACK
+  if((stream <0) || (stream>=maxStreams()) || 
+     (jack_play_ring[stream]==NULL)||jack_playing[stream]) {
+    return false;
+  }
+  readerPool()->waitFill(jack_card,stream);
+  readerPool()->lock(jack_card,stream);
+  if(jack_st_conv[stream]!=NULL) {
+    delete jack_st_conv[stream];
+    jack_st_conv[stream]=NULL;
+  }
+  if(speed!=RD_TIMESCALE_DIVISOR) {
+    jack_st_conv[stream]=new soundtouch::SoundTouch();
+    jack_st_conv[stream]->setTempo((float)speed/RD_TIMESCALE_DIVISOR);
+    jack_st_conv[stream]->
+      setSampleRate(jack_play_decoder[stream]->outputSampleRate());
+    jack_st_conv[stream]->setChannels(jack_output_channels[stream]);
+  }
+  readerPool()->unlock(jack_card,stream);
+  readerPool()->setTimescaled(jack_card,stream,jack_st_conv[stream]!=NULL);
+  return true;
+#else
+  return false;
+#endif  // JACK
+}
+
+
 int DriverJack::GetJackOutputStream()
 {
 #ifdef JACK
-  for(int i=0;i<RD_MAX_STREAMS;i++) {
+  for(int i=0;i<maxStreams();i++) {
     if(jack_play_ring[i]==NULL) {
-      jack_play_ring[i]=new RDRingBuffer(RINGBUFFER_SIZE);
+      if(jack_fade_ramp[i]==NULL) {
+	jack_fade_ramp[i]=new FadeRamp();
+	jack_play_schedule[i]=new PlaySchedule();
+	for(int j=0;j<2;j++) {
+	  jack_stream_output_meter[2*i+j]=
+	    new RDMeterAverage(jack_meter_periods);
+	}
+	jack_stream_loudness[i]=addStreamLoudness(jack_card,i);
+      }
+      jack_play_ring[i]=new RDSpscRing(jack_play_ring_size);
       return i;
     }
   }
@@ -1462,7 +1651,7 @@ int DriverJack::GetJackOutputStream()
 void DriverJack::FreeJackOutputStream(int stream)
 {
 #ifdef JACK
-  if ((stream <0) || (stream >= RD_MAX_STREAMS)){
+  if ((stream <0) || (stream>=maxStreams())){
     return;
   }
   delete jack_play_ring[stream];
@@ -1477,231 +1666,69 @@ void DriverJack::FreeJackOutputStream(int stream)
 }
 
 
-void DriverJack::EmptyJackInputStream(int stream,bool done)
+void DriverJack::LogTimescaleUsage(int stream)
 {
 #ifdef JACK
-  if ((stream <0) || (stream >= RD_MAX_STREAMS)){
-    return;
+  //
+  // Report the CPU used to timescale the stream, relative to the amount
+  // of audio that was played
+  //
+  double played=(double)jack_output_pos[stream]/
+    (double)jack_output_sample_rate[stream];
+  double cpu=(double)readerPool()->cpuTime(jack_card,stream)/1000000000.0;
+  if(played>0.0) {
+    rda->syslog(LOG_DEBUG,
+		"timescaled stream %d used %.3lf s CPU for %.3lf s audio [%.1lf%%]",
+		stream,cpu,played,100.0*cpu/played);
   }
-  unsigned n=jack_record_ring[stream]->
-    read((char *)jack_sample_buffer,jack_record_ring[stream]->readSpace());
-  WriteJackBuffer(stream,jack_sample_buffer,n,done);
+  readerPool()->resetCpuTime(jack_card,stream);
 #endif  // JACK
 }
 
-#ifdef JACK
-void DriverJack::WriteJackBuffer(int stream,jack_default_audio_sample_t *buffer,
-				 unsigned len,bool done)
-{
-  ssize_t s;
-  unsigned char mpeg[2048];
-  unsigned frames;
-  unsigned n;
-
-  frames=len/(sizeof(jack_default_audio_sample_t)*
-	      jack_record_wave[stream]->getChannels());
-  jack_samples_recorded[stream]+=frames;
-  switch(jack_record_wave[stream]->getFormatTag()) {
-  case WAVE_FORMAT_PCM:
-    switch(jack_record_wave[stream]->getBitsPerSample()) {
-    case 16:  // PCM16
-      n=len/sizeof(jack_default_audio_sample_t);
-      src_float_to_short_array(buffer,jack_wave_buffer,n);
-      jack_record_wave[stream]->writeWave(jack_wave_buffer,n*sizeof(short));
-      break;
-
-    case 24:  // PCM24
-      n=len/sizeof(jack_default_audio_sample_t);
-      src_float_to_int_array(buffer,jack_wave32_buffer,n);
-      for(unsigned i=0;i<n;i++) {
-	for(unsigned j=0;j<3;j++) {
-	  jack_wave24_buffer[3*i+j]=((uint8_t *)jack_wave32_buffer)[4*i+j+1];
-	}
-      }
-      jack_record_wave[stream]->writeWave(jack_wave24_buffer,n*3);
-      break;
-    }
-    break;
-
-  case WAVE_FORMAT_MPEG:
-#ifdef HAVE_TWOLAME
-    for(unsigned i=0;i<frames;i+=1152) {
-      if((i+1152)>frames) {
-	n=frames-i;
-      }
-      else {
-	n=1152;
-      }
-      if((s=twolame_encode_buffer_float32_interleaved(
-		 twolame_lameopts[jack_card][stream],
-		 buffer+i*jack_record_wave[stream]->getChannels(),
-		 n,mpeg,2048))>=0) {
-	jack_record_wave[stream]->writeWave(mpeg,s);
-      }
-      else {
-	rda->syslog(LOG_WARNING,
-	       "TwoLAME encode error, card: %d, stream: %d",jack_card,stream);
-      }
-    }
-    if(done) {
-      if((s=twolame_encode_flush(twolame_lameopts[jack_card][stream],
-				 mpeg,2048))>=0) {
-	jack_record_wave[stream]->writeWave(mpeg,s);
-      }
-    }
-#endif  // HAVE_TWOLAME
-    break;
-  }
-}
-#endif  // JACK
 
-void DriverJack::FillJackOutputStream(int stream)
+void DriverJack::FillJackOutputStream(int stream,ReaderBuffer *buf)
 {
 #ifdef JACK
   int n=0;
-  unsigned mpeg_frames=0;
-  unsigned frame_offset=0;
-  int m=0;
+  int free=0;
 
-  if ((stream <0) || (stream >= RD_MAX_STREAMS)){
+  if ((stream <0) || (stream>=maxStreams())){
     return;
   }
-  int free=
-    jack_play_ring[stream]->writeSpace()/sizeof(jack_default_audio_sample_t)-1;
-  if((free<=0)||(jack_eof[stream]==true)) {
+  if((jack_play_ring[stream]==NULL)||(jack_play_decoder[stream]==NULL)||
+     jack_eof[stream]) {
     return;
   }
-  switch(jack_play_wave[stream]->getFormatTag()) {
-  case WAVE_FORMAT_PCM:
-    switch(jack_play_wave[stream]->getBitsPerSample()) {
-    case 16:  // PMC16
-      free=(int)free/jack_output_channels[stream]*jack_output_channels[stream];
-      n=jack_play_wave[stream]->readWave(jack_wave_buffer,sizeof(short)*free)/
-	sizeof(short);
-      if((n!=free)&&(jack_st_conv[stream]==NULL)) {
-	jack_eof[stream]=true;
-	jack_stop_timer[stream]->stop();
-      }
-      src_short_to_float_array(jack_wave_buffer,jack_sample_buffer,n);
-      break;
-
-    case 24:  // PMC24
-      free=(int)free/jack_output_channels[stream]*jack_output_channels[stream];
-      n=jack_play_wave[stream]->readWave(jack_wave24_buffer,3*free)/3;
-      if((n!=free)&&(jack_st_conv[stream]==NULL)) {
-	jack_eof[stream]=true;
-	jack_stop_timer[stream]->stop();
-      }
-      for(int i=0;i<n;i++) {
-	for(unsigned j=0;j<3;j++) {
-	  ((uint8_t *)jack_wave32_buffer)[4*i+j+1]=jack_wave24_buffer[3*i+j];
-	}
-      }
-      src_int_to_float_array(jack_wave32_buffer,jack_sample_buffer,n);
-      break;
-    }
-    break;
-
-  case WAVE_FORMAT_VORBIS:
-    free=(int)free/jack_output_channels[stream]*jack_output_channels[stream];
-    n=jack_play_wave[stream]->readWave(jack_wave_buffer,sizeof(short)*free)/
-      sizeof(short);
-    if((n!=free)&&(jack_st_conv[stream]==NULL)) {
+  if(jack_st_conv[stream]==NULL) {
+    jack_play_decoder[stream]->fillRing(jack_play_ring[stream]);
+    if(jack_play_decoder[stream]->isFinished()) {
       jack_eof[stream]=true;
-      jack_stop_timer[stream]->stop();
-    }
-    src_short_to_float_array(jack_wave_buffer,jack_sample_buffer,n);
-    break;
-
-  case WAVE_FORMAT_MPEG:
-#ifdef HAVE_MAD
-    mpeg_frames=free/(1152*jack_output_channels[stream]);
-    free=mpeg_frames*1152*jack_output_channels[stream];
-    for(unsigned i=0;i<mpeg_frames;i++) {
-      m=jack_play_wave[stream]->
-	readWave(mad_mpeg[jack_card][stream]+mad_left_over[jack_card][stream],
-		 mad_frame_size[jack_card][stream]);
-      if(m==mad_frame_size[jack_card][stream]) {
-	mad_stream_buffer(&mad_stream[jack_card][stream],
-			  mad_mpeg[jack_card][stream],
-			  m+mad_left_over[jack_card][stream]);
-	while(mad_frame_decode(&mad_frame[jack_card][stream],
-			    &mad_stream[jack_card][stream])==0) {
-	  mad_synth_frame(&mad_synth[jack_card][stream],
-			  &mad_frame[jack_card][stream]);
-	  n+=(jack_output_channels[stream]*
-	      mad_synth[jack_card][stream].pcm.length);
-	  for(int j=0;j<mad_synth[jack_card][stream].pcm.length;j++) {
-	    for(int k=0;k<mad_synth[jack_card][stream].pcm.channels;k++) {
-	      jack_sample_buffer[frame_offset+
-				 j*mad_synth[jack_card][stream].pcm.channels+k]=
-		(jack_default_audio_sample_t)
-		mad_f_todouble(mad_synth[jack_card][stream].pcm.samples[k][j]);
-	      
-	    }
-	  }
-	  frame_offset+=(mad_synth[jack_card][stream].pcm.length*
-			 mad_synth[jack_card][stream].pcm.channels);
-	}
-      }
-      else {  // End-of-file, read out last samples
-	memset(mad_mpeg[jack_card][stream]+mad_left_over[jack_card][stream],0,
-	       MAD_BUFFER_GUARD);
-	mad_stream_buffer(&mad_stream[jack_card][stream],
-			  mad_mpeg[jack_card][stream],
-			  MAD_BUFFER_GUARD+mad_left_over[jack_card][stream]);
-	if(mad_frame_decode(&mad_frame[jack_card][stream],
-			    &mad_stream[jack_card][stream])==0) {
-	  mad_synth_frame(&mad_synth[jack_card][stream],
-			  &mad_frame[jack_card][stream]);
-	  n+=(jack_output_channels[stream]*
-	      mad_synth[jack_card][stream].pcm.length);
-	  for(int j=0;j<mad_synth[jack_card][stream].pcm.length;j++) {
-	    for(int k=0;k<mad_synth[jack_card][stream].pcm.channels;k++) {
-	      jack_sample_buffer[frame_offset+
-				 j*mad_synth[jack_card][stream].pcm.channels+k]=
-		(jack_default_audio_sample_t)
-		mad_f_todouble(mad_synth[jack_card][stream].pcm.samples[k][j]);
-	    }
-	  }
-	}
-	jack_eof[stream]=true;
-	jack_stop_timer[stream]->stop();
-	continue;
-      }
-      mad_left_over[jack_card][stream]=
-	mad_stream[jack_card][stream].bufend-
-	mad_stream[jack_card][stream].next_frame;
-      memmove(mad_mpeg[jack_card][stream],
-	      mad_stream[jack_card][stream].next_frame,
-	      mad_left_over[jack_card][stream]);
     }
-#endif  // HAVE_MAD
-    break;
+    return;
   }
-  if(jack_st_conv[stream]==NULL) {
+
+  //
+  // Timescaled
+  //
+  free=jack_play_ring[stream]->writeSpace()/
+    (sizeof(jack_default_audio_sample_t)*jack_output_channels[stream])-1;
+  if(free>0) {
+    n=jack_play_decoder[stream]->decode(buf->samples,free);
+    jack_st_conv[stream]->putSamples(buf->samples,n);
+  }
+  while((free>0)&&
+	((n=jack_st_conv[stream]->receiveSamples(buf->samples,free))>0)) {
     jack_play_ring[stream]->
-      write((char *)jack_sample_buffer,n*sizeof(jack_default_audio_sample_t));
-  }
-  else {
-    jack_st_conv[stream]->
-      putSamples(jack_sample_buffer,n/jack_output_channels[stream]);
+      write((char *)buf->samples,n*
+	    sizeof(jack_default_audio_sample_t)*
+	    jack_output_channels[stream]);
     free=jack_play_ring[stream]->writeSpace()/
       (sizeof(jack_default_audio_sample_t)*jack_output_channels[stream])-1;
-    while((n=jack_st_conv[stream]->
-	   receiveSamples(jack_sample_buffer,free))>0) {
-      jack_play_ring[stream]->
-	write((char *)jack_sample_buffer,n*
-	      sizeof(jack_default_audio_sample_t)*
-	      jack_output_channels[stream]);
-      free=jack_play_ring[stream]->writeSpace()/
-	(sizeof(jack_default_audio_sample_t)*jack_output_channels[stream])-1;
-    }
-    if((jack_st_conv[stream]->numSamples()==0)&&
-       (jack_st_conv[stream]->numUnprocessedSamples()==0)) {
-      jack_eof[stream]=true;
-      jack_stop_timer[stream]->stop();
-    }
+  }
+  if(jack_play_decoder[stream]->isFinished()&&
+     (jack_st_conv[stream]->numSamples()==0)&&
+     (jack_st_conv[stream]->numUnprocessedSamples()==0)) {
+    jack_eof[stream]=true;
   }
 #endif  // JACK
 }
@@ -1710,19 +1737,13 @@ void DriverJack::FillJackOutputStream(int stream)
 void DriverJack::JackClock()
 {
 #ifdef JACK
-  for(int i=0;i<RD_MAX_STREAMS;i++) {
+  for(int i=0;i<maxStreams();i++) {
     if(jack_stopping[i]) {
       jack_stopping[i]=false;
       statePlayUpdate(jack_card,i,2);
     }
-    if(jack_playing[i]&&((jack_clock_phase%4)==0)) {
-      FillJackOutputStream(i);
-    }
-  }
-  jack_clock_phase++;
-  for(int i=0;i<RD_MAX_PORTS;i++) {
-    if(jack_recording[i]) {
-      EmptyJackInputStream(i,false);
+    if(jack_playing[i]&&jack_eof[i]&&jack_stop_timer[i]->isActive()) {
+      jack_stop_timer[i]->stop();
     }
   }
 #endif  // JACK
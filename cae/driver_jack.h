@@ -29,6 +29,7 @@
 #include <rdmeteraverage.h>
 #include <rdwavefile.h>
 
+#include "decoder.h"
 #include "driver.h"
 
 #ifdef JACK
@@ -75,53 +76,49 @@ class DriverJack : public Driver
   bool setPassthroughLevel(int card,int in_port,int out_port,
 				   int level);
   void getOutputPosition(int card,unsigned *pos);
+  unsigned xruns(int card) const;
+  bool getSampleClock(int card,uint64_t *clock,unsigned *samprate);
+  bool playAt(int card,int stream,uint64_t clock,int length,int speed,
+	      bool pitch,bool rates);
+  bool stopPlaybackAt(int card,int stream,uint64_t clock);
+  bool fadeOutputVolumeAt(int card,int stream,int port,int level,int length,
+			  uint64_t clock);
+  void fillStream(int card,int stream,ReaderBuffer *buf);
 
  public slots:
   void processBuffers();
 
  private slots:
   void stopTimerData(int stream);
-  void fadeTimerData(int stream);
   void recordTimerData(int stream);
   void clientStartData();
 
  private:
+  bool PreparePlayback(int stream,int speed);
   int GetJackOutputStream();
   void FreeJackOutputStream(int stream);
-  void EmptyJackInputStream(int stream,bool done);
-#ifdef JACK
-  void WriteJackBuffer(int stream,jack_default_audio_sample_t *buffer,
-		       unsigned len,bool done);
-#endif  // JACK
-  void FillJackOutputStream(int stream);
+  void LogTimescaleUsage(int stream);
+  void FillJackOutputStream(int stream,ReaderBuffer *buf);
   void JackClock();
   void JackSessionSetup();
   bool jack_connected;
   bool jack_activated;
 #ifdef JACK
   int jack_card;
+  unsigned jack_play_ring_size;
   QList<QProcess *> jack_clients;
   RDWaveFile *jack_record_wave[RD_MAX_STREAMS];
-  RDWaveFile *jack_play_wave[RD_MAX_STREAMS];
-  short *jack_wave_buffer;
-  int *jack_wave32_buffer;
-  uint8_t *jack_wave24_buffer;
-  jack_default_audio_sample_t *jack_sample_buffer;
-  soundtouch::SoundTouch *jack_st_conv[RD_MAX_STREAMS];
+  RDWaveFile **jack_play_wave;
+  CaeDecoder **jack_play_decoder;
+  soundtouch::SoundTouch **jack_st_conv;
   short jack_input_volume_db[RD_MAX_STREAMS];
-  short jack_output_volume_db[RD_MAX_PORTS][RD_MAX_STREAMS];
+  short *jack_output_volume_db[RD_MAX_PORTS];
   short jack_passthrough_volume_db[RD_MAX_PORTS][RD_MAX_PORTS];
-  short jack_fade_volume_db[RD_MAX_STREAMS];
-  short jack_fade_increment[RD_MAX_STREAMS];
-  int jack_fade_port[RD_MAX_STREAMS];
-  bool jack_fade_up[RD_MAX_STREAMS];
-  QTimer *jack_fade_timer[RD_MAX_STREAMS];
-  QTimer *jack_stop_timer[RD_MAX_STREAMS];
+  QTimer **jack_stop_timer;
   QTimer *jack_record_timer[RD_MAX_PORTS];
   QTimer *jack_client_start_timer;
-  int jack_offset[RD_MAX_STREAMS];
-  int jack_clock_phase;
-  unsigned jack_samples_recorded[RD_MAX_STREAMS];
+  int *jack_offset;
+  int *jack_play_length;
 #endif  // JACK
 };
 
@@ -0,0 +1,1068 @@
+// driver_null.cpp
+//
+// caed(8) driver for virtual, clock-driven sound cards
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+
+#include <atomic>
+
+#include <rdspscring.h>
+
+#include "driver_null.h"
+#include "mixbus.h"
+
+//
+// Callback Variables
+//
+// Per-stream tables are allocated by NullInitStreams() for each card that
+// is started, and are indexed by stream number.  Stream output meters take
+// two entries (left, right) per stream.
+//
+volatile int *null_output_channels[RD_MAX_CARDS];
+RDMeterAverage *null_output_meter[RD_MAX_CARDS][RD_MAX_PORTS][2];
+RDMeterAverage **null_stream_output_meter[RD_MAX_CARDS];
+volatile double *null_output_volume[RD_MAX_CARDS][RD_MAX_PORTS];
+RDSpscRing **null_play_ring[RD_MAX_CARDS];
+volatile bool *null_playing[RD_MAX_CARDS];
+volatile bool *null_stopping[RD_MAX_CARDS];
+volatile bool *null_eof[RD_MAX_CARDS];
+volatile int *null_output_pos[RD_MAX_CARDS];
+ReaderPool *null_reader_pool;
+volatile unsigned null_play_ring_low_water;
+FadeRamp **null_fade_ramp[RD_MAX_CARDS];
+PlaySchedule **null_play_schedule[RD_MAX_CARDS];
+volatile bool *null_starting[RD_MAX_CARDS];
+std::atomic<uint64_t> null_sample_clock[RD_MAX_CARDS];
+StreamStats **null_stream_stats[RD_MAX_CARDS];
+LoudnessMeter **null_stream_loudness[RD_MAX_CARDS];
+LoudnessMeter *null_output_loudness[RD_MAX_CARDS][RD_MAX_PORTS];
+SilenceSense *null_silence_sense[RD_MAX_CARDS][RD_MAX_PORTS];
+std::atomic<unsigned> null_xruns[RD_MAX_CARDS];
+
+uint64_t NullNow()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+
+  return (uint64_t)ts.tv_sec*1000000000+ts.tv_nsec;
+}
+
+
+void NullSleepUntil(uint64_t when)
+{
+  struct timespec ts;
+
+  ts.tv_sec=when/1000000000;
+  ts.tv_nsec=when%1000000000;
+  while(clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&ts,NULL)==EINTR) {
+  }
+}
+
+
+//
+// Copy up to 'frames' frames straight out of a ring into 'dst', returning
+// the number of frames consumed.  Only whole frames are taken.
+//
+unsigned NullReadRing(RDSpscRing *ring,float *dst,unsigned chans,
+		      unsigned frames)
+{
+  RDSpscSpan span;
+  size_t fsize=chans*sizeof(float);
+  size_t n=ring->readSpace();
+
+  if(n>(frames*fsize)) {
+    n=frames*fsize;
+  }
+  n-=n%fsize;
+  ring->reserveRead(&span,n);
+  for(unsigned i=0;i<2;i++) {
+    if(span.len[i]>0) {
+      memcpy(dst,span.data[i],span.len[i]);
+      dst+=span.len[i]/sizeof(float);
+    }
+  }
+  ring->commitRead(n);
+
+  return n/fsize;
+}
+
+
+//
+// A free-running card has no deadline to meet, so rather than underrun
+// it gives the reader threads as long as they need (up to a second) to
+// get a full period into each of its playing streams.
+//
+void NullWaitRefills(struct null_format *null_format)
+{
+  int card=null_format->card;
+  bool waiting=true;
+  uint64_t timeout=NullNow()+1000000000;
+
+  while(waiting&&(!null_format->exiting)&&(NullNow()<timeout)) {
+    waiting=false;
+    for(unsigned j=0;j<null_format->streams;j++) {
+      if(null_play_ring[card][j]!=NULL) {
+	null_play_ring[card][j]->serviceFlush();
+      }
+      if(null_playing[card][j]&&(!null_eof[card][j])&&
+	 (null_play_ring[card][j]->readSpace()<
+	  (null_format->period_size*sizeof(float)*
+	   null_output_channels[card][j]))) {
+	null_reader_pool->requestFill(card,j);
+	waiting=true;
+      }
+    }
+    if(waiting) {
+      NullSleepUntil(NullNow()+100000);
+    }
+  }
+}
+
+
+void *NullPlayCallback(void *ptr)
+{
+  unsigned n=0;
+  float peaks[2];
+  float volume;
+  float *bus;
+  bool fading;
+  uint64_t clock;
+  unsigned offset;
+  unsigned count;
+  unsigned when;
+  bool stopping;
+  int fade_port;
+  int fade_from;
+  int fade_to;
+  unsigned fade_frames;
+  uint64_t period=0;
+  uint64_t deadline;
+  uint64_t now;
+
+  struct null_format *null_format=(struct null_format *)ptr;
+  int card=null_format->card;
+  unsigned frames=null_format->period_size;
+  unsigned ports=null_format->ports;
+
+  signal(SIGTERM,SigHandler);
+  signal(SIGINT,SigHandler);
+
+  if(null_format->speed>0) {
+    period=(uint64_t)frames*1000000000/
+      ((uint64_t)null_format->sample_rate*null_format->speed);
+  }
+  deadline=NullNow();
+  while(!null_format->exiting) {
+    if(period==0) {
+      NullWaitRefills(null_format);
+    }
+
+    //
+    // Mix Streams
+    //
+    MixBusZero(null_format->mix_buffer,2*frames*ports);
+    clock=null_sample_clock[card].load();
+    for(unsigned j=0;j<null_format->streams;j++) {
+      //
+      // Scheduled transitions
+      //
+      offset=0;
+      count=frames;
+      stopping=false;
+      if(null_play_ring[card][j]!=NULL) {
+	null_play_ring[card][j]->serviceFlush();
+	if((!null_playing[card][j])&&
+	   null_play_schedule[card][j]->take(PlaySchedule::Play,clock,frames,
+					     &offset)) {
+	  null_playing[card][j]=true;
+	  null_starting[card][j]=true;
+	  count=frames-offset;
+	}
+	if(null_playing[card][j]) {
+	  if(null_play_schedule[card][j]->take(PlaySchedule::Stop,clock,
+					       frames,&when)) {
+	    count=0;
+	    if(when>offset) {
+	      count=when-offset;
+	    }
+	    stopping=true;
+	  }
+	  if(null_play_schedule[card][j]->take(PlaySchedule::Fade,clock,
+					       frames,&when)) {
+	    null_play_schedule[card][j]->
+	      fadeParameters(&fade_port,&fade_from,&fade_to,&fade_frames);
+	    null_fade_ramp[card][j]->
+	      begin(fade_port,fade_from,fade_to,fade_frames,
+		    when>offset ? when-offset : 0);
+	  }
+	}
+      }
+      if(null_playing[card][j]) {
+	null_stream_stats[card][j]->
+	  updateFill(null_play_ring[card][j]->readSpace()/
+		     (sizeof(float)*null_output_channels[card][j]));
+	switch(null_output_channels[card][j]) {
+	case 1:
+	  n=NullReadRing(null_play_ring[card][j],null_format->scratch_buffer,
+			 1,count);
+	  peaks[0]=MixBusPeak(null_format->scratch_buffer,n);
+	  peaks[1]=peaks[0];
+	  MixBusMonoToStereo(null_format->stream_buffer,
+			     null_format->scratch_buffer,n);
+	  break;
+
+	case 2:
+	  n=NullReadRing(null_play_ring[card][j],null_format->stream_buffer,
+			 2,count);
+	  MixBusStereoPeak(null_format->stream_buffer,n,peaks);
+	  break;
+
+	default:
+	  n=0;
+	  peaks[0]=0.0;
+	  peaks[1]=0.0;
+	  break;
+	}
+	if(n>0) {
+	  null_stream_stats[card][j]->markFirstSample();
+	}
+	if((n<count)&&(!null_eof[card][j])) {
+	  null_stream_stats[card][j]->addUnderrun();
+	}
+	for(unsigned k=0;k<2;k++) {  // Stream Output Meters
+	  null_stream_output_meter[card][2*j+k]->addValue(peaks[k]);
+	}
+	if(null_stream_loudness[card][j]!=NULL) {
+	  null_stream_loudness[card][j]->
+	    process(null_format->stream_buffer,2,n);
+	}
+	fading=null_fade_ramp[card][j]->render(null_format->fade_buffer,n);
+	for(unsigned i=0;i<ports;i++) {
+	  bus=null_format->mix_buffer+2*(frames*i+offset);
+	  if(fading&&((int)i==null_fade_ramp[card][j]->port())) {
+	    MixBusAccumulateRamp(bus,null_format->stream_buffer,
+				 null_format->fade_buffer,n);
+	    continue;
+	  }
+	  volume=null_output_volume[card][i][j];
+	  if(volume!=0.0) {
+	    MixBusAccumulate(bus,null_format->stream_buffer,volume,2*n);
+	  }
+	}
+	null_output_pos[card][j]+=n;
+	if((!null_eof[card][j])&&
+	   (null_play_ring[card][j]->readSpace()<null_play_ring_low_water)) {
+	  null_reader_pool->requestFill(card,j);
+	}
+	if(stopping) {
+	  null_playing[card][j]=false;
+	  null_stopping[card][j]=true;
+	}
+	else {
+	  if((n==0)&&null_eof[card][j]) {
+	    null_stopping[card][j]=true;
+	  }
+	}
+      }
+    }
+
+    //
+    // Process Output Meters and Tap
+    //
+    for(unsigned i=0;i<ports;i++) {
+      bus=null_format->mix_buffer+2*frames*i;
+      MixBusStereoPeak(bus,frames,peaks);
+      for(unsigned j=0;j<2;j++) {
+	null_output_meter[card][i][j]->addValue(peaks[j]);
+      }
+      null_silence_sense[card][i]->
+	update(peaks[0]>peaks[1] ? peaks[0] : peaks[1],frames);
+      if(null_output_loudness[card][i]!=NULL) {
+	null_output_loudness[card][i]->process(bus,2,frames);
+      }
+    }
+    if(null_format->tap_wave!=NULL) {
+      MixBusFloatToS16(null_format->tap_buffer,
+		       null_format->mix_buffer+2*frames*null_format->tap_port,
+		       2*frames,
+		       null_format->dithered ? &null_format->dither : NULL);
+      null_format->tap_wave->
+	writeWave(null_format->tap_buffer,2*frames*sizeof(int16_t));
+    }
+    null_sample_clock[card]+=frames;
+
+    //
+    // Wait for the next period.  Falling more than a period behind the
+    // clock is as close as a virtual card gets to an xrun.
+    //
+    if(period>0) {
+      deadline+=period;
+      now=NullNow();
+      if(now>(deadline+period)) {
+	null_xruns[card]++;
+	rda->syslog(LOG_DEBUG,"****** Null Playout Xrun - Card: %d ******",
+		    card);
+	deadline=now;
+      }
+      else {
+	NullSleepUntil(deadline);
+      }
+    }
+  }
+
+  return 0;
+}
+
+
+void DriverNull::NullInitCallback()
+{
+  null_meter_periods=
+    (330*systemSampleRate())/(1000*rda->config()->nullPeriodSize());
+  for(int i=0;i<RD_MAX_CARDS;i++) {
+    for(int j=0;j<RD_MAX_PORTS;j++) {
+      for(int k=0;k<2;k++) {
+	null_output_meter[i][j][k]=new RDMeterAverage(null_meter_periods);
+      }
+      null_output_volume[i][j]=NULL;
+      null_output_loudness[i][j]=NULL;
+      null_silence_sense[i][j]=NULL;
+    }
+    null_output_channels[i]=NULL;
+    null_stream_output_meter[i]=NULL;
+    null_play_ring[i]=NULL;
+    null_playing[i]=NULL;
+    null_stopping[i]=NULL;
+    null_eof[i]=NULL;
+    null_output_pos[i]=NULL;
+    null_fade_ramp[i]=NULL;
+    null_play_schedule[i]=NULL;
+    null_starting[i]=NULL;
+    null_stream_stats[i]=NULL;
+    null_stream_loudness[i]=NULL;
+  }
+}
+
+
+void DriverNull::NullInitStreams(int card)
+{
+  //
+  // Only the tables are allocated here.  The objects behind each stream
+  // are created when the stream is first used (see GetNullOutputStream())
+  // and are then kept for reuse.
+  //
+  int streams=maxStreams();
+
+  allocateStreams(card);
+  for(int i=0;i<RD_MAX_PORTS;i++) {
+    null_output_loudness[card][i]=outputLoudness(card,i);
+    null_silence_sense[card][i]=silenceSense(card,i);
+    null_output_volume[card][i]=new volatile double[streams];
+    null_output_volume_db[card][i]=new short[streams];
+    for(int j=0;j<streams;j++) {
+      null_output_volume[card][i][j]=1.0;
+      null_output_volume_db[card][i][j]=0;
+    }
+  }
+  null_output_channels[card]=new volatile int[streams];
+  null_stream_output_meter[card]=new RDMeterAverage *[2*streams];
+  null_play_ring[card]=new RDSpscRing *[streams];
+  null_playing[card]=new volatile bool[streams];
+  null_stopping[card]=new volatile bool[streams];
+  null_eof[card]=new volatile bool[streams];
+  null_output_pos[card]=new volatile int[streams];
+  null_fade_ramp[card]=new FadeRamp *[streams];
+  null_play_schedule[card]=new PlaySchedule *[streams];
+  null_starting[card]=new volatile bool[streams];
+  null_stream_stats[card]=new StreamStats *[streams];
+  null_stream_loudness[card]=new LoudnessMeter *[streams];
+  null_play_wave[card]=new RDWaveFile *[streams];
+  null_play_decoder[card]=new CaeDecoder *[streams];
+  null_offset[card]=new int[streams];
+  for(int i=0;i<streams;i++) {
+    null_output_channels[card][i]=0;
+    null_stream_output_meter[card][2*i]=NULL;
+    null_stream_output_meter[card][2*i+1]=NULL;
+    null_play_ring[card][i]=NULL;
+    null_playing[card][i]=false;
+    null_stopping[card][i]=false;
+    null_eof[card][i]=false;
+    null_output_pos[card][i]=0;
+    null_fade_ramp[card][i]=NULL;
+    null_play_schedule[card][i]=NULL;
+    null_starting[card][i]=false;
+    null_stream_stats[card][i]=streamStats(card,i);
+    null_stream_loudness[card][i]=NULL;
+    null_play_wave[card][i]=NULL;
+    null_play_decoder[card][i]=NULL;
+    null_offset[card][i]=0;
+  }
+}
+
+
+DriverNull::DriverNull(QObject *parent)
+  : Driver(RDStation::Null,parent)
+{
+  //
+  // Initialize Data Structures
+  //
+  for(int i=0;i<RD_MAX_CARDS;i++) {
+    memset(&null_play_format[i],0,sizeof(struct null_format));
+    null_play_format[i].exiting=true;
+    for(int j=0;j<RD_MAX_PORTS;j++) {
+      null_output_volume_db[i][j]=NULL;
+    }
+    null_play_wave[i]=NULL;
+    null_play_decoder[i]=NULL;
+    null_offset[i]=NULL;
+    null_sample_clock[i]=0;
+    null_xruns[i]=0;
+  }
+  NullInitCallback();
+}
+
+
+DriverNull::~DriverNull()
+{
+  //
+  // The clock threads post refill requests, so must be gone before the
+  // reader pool is
+  //
+  for(int i=0;i<RD_MAX_CARDS;i++) {
+    if(hasCard(i)) {
+      null_play_format[i].exiting=true;
+      pthread_join(null_play_format[i].thread,NULL);
+      if(null_play_format[i].tap_wave!=NULL) {
+	null_play_format[i].tap_wave->closeWave();
+	delete null_play_format[i].tap_wave;
+      }
+    }
+  }
+  stopReaderPool();
+}
+
+
+QString DriverNull::version() const
+{
+  return QString("1.0.0");
+}
+
+
+bool DriverNull::initialize(unsigned *next_cardnum)
+{
+  int cards=0;
+
+  if(rda->config()->nullCards()==0) {
+    return false;
+  }
+  rda->syslog(LOG_INFO,"Null driver using %s mixing kernels",
+	      MixBusKernelName());
+
+  //
+  // Start Reader Threads
+  //
+  null_play_ring_size=playRingSize(sizeof(float));
+  null_play_ring_low_water=null_play_ring_size/2;
+  startReaderPool(null_play_ring_size);
+  null_reader_pool=readerPool();
+
+  //
+  // Start Up Interfaces
+  //
+  while((cards<rda->config()->nullCards())&&((*next_cardnum)<RD_MAX_CARDS)) {
+    if(!NullStartDevice(*next_cardnum,cards==0)) {
+      break;
+    }
+    rda->station()->setCardDriver(*next_cardnum,RDStation::Null);
+    rda->station()->
+      setCardName(*next_cardnum,tr("Null Device")+QString::asprintf(" %d",
+								    cards));
+    rda->station()->setCardInputs(*next_cardnum,0);
+    rda->station()->setCardOutputs(*next_cardnum,
+				   null_play_format[*next_cardnum].ports);
+    addCard(*next_cardnum);
+    (*next_cardnum)++;
+    cards++;
+  }
+  return cards>0;
+}
+
+
+int DriverNull::inputPortQuantity(int card) const
+{
+  return 0;
+}
+
+
+int DriverNull::outputPortQuantity(int card) const
+{
+  return null_play_format[card].ports;
+}
+
+
+bool DriverNull::loadPlayback(int card,QString wavename,int *stream)
+{
+  if(null_play_format[card].exiting||
+     ((*stream=GetNullOutputStream(card))<0)) {
+    rda->syslog(LOG_DEBUG,"nullLoadPlayback(%s) GetNullOutputStream():%d < 0",
+		wavename.toUtf8().constData(),*stream);
+    return false;
+  }
+  null_play_wave[card][*stream]=new RDWaveFile(wavename);
+  if(!null_play_wave[card][*stream]->openWave()) {
+    rda->syslog(LOG_DEBUG,"nullLoadPlayback(%s) openWave() failed to open file",
+		wavename.toUtf8().constData());
+    delete null_play_wave[card][*stream];
+    null_play_wave[card][*stream]=NULL;
+    FreeNullOutputStream(card,*stream);
+    *stream=-1;
+    return false;
+  }
+  if((null_play_decoder[card][*stream]=
+      CaeDecoder::create(null_play_wave[card][*stream]))==NULL) {
+    rda->syslog(LOG_WARNING,
+		"nullLoadPlayback(%s) unsupported format %d, %d bits",
+		wavename.toUtf8().constData(),
+		null_play_wave[card][*stream]->getFormatTag(),
+		null_play_wave[card][*stream]->getBitsPerSample());
+    delete null_play_wave[card][*stream];
+    null_play_wave[card][*stream]=NULL;
+    FreeNullOutputStream(card,*stream);
+    *stream=-1;
+    return false;
+  }
+  if(!null_play_decoder[card][*stream]->
+     setOutputSampleRate(null_play_format[card].sample_rate)) {
+    delete null_play_decoder[card][*stream];
+    null_play_decoder[card][*stream]=NULL;
+    delete null_play_wave[card][*stream];
+    null_play_wave[card][*stream]=NULL;
+    FreeNullOutputStream(card,*stream);
+    *stream=-1;
+    return false;
+  }
+  null_output_channels[card][*stream]=
+    null_play_wave[card][*stream]->getChannels();
+  null_stopping[card][*stream]=false;
+  null_offset[card][*stream]=0;
+  null_output_pos[card][*stream]=0;
+  null_eof[card][*stream]=false;
+  null_play_ring[card][*stream]->reset();
+  streamStats(card,*stream)->reset(null_play_format[card].sample_rate);
+  if(null_stream_loudness[card][*stream]!=NULL) {
+    null_stream_loudness[card][*stream]->reset();
+  }
+  readerPool()->requestFill(card,*stream);
+  return true;
+}
+
+
+bool DriverNull::unloadPlayback(int card,int stream)
+{
+  if(null_play_ring[card][stream]==NULL) {
+    return false;
+  }
+  null_play_schedule[card][stream]->cancelAll();
+  null_playing[card][stream]=false;
+  readerPool()->lock(card,stream);
+  delete null_play_decoder[card][stream];
+  null_play_decoder[card][stream]=NULL;
+  null_play_wave[card][stream]->closeWave();
+  delete null_play_wave[card][stream];
+  null_play_wave[card][stream]=NULL;
+  FreeNullOutputStream(card,stream);
+  readerPool()->unlock(card,stream);
+  null_fade_ramp[card][stream]->cancel();
+  return true;
+}
+
+
+bool DriverNull::playbackPosition(int card,int stream,unsigned pos)
+{
+  unsigned offset=0;
+
+  if(null_play_format[card].exiting||
+     (null_play_decoder[card][stream]==NULL)) {
+    return false;
+  }
+  offset=(unsigned)((double)null_play_wave[card][stream]->getSamplesPerSec()*
+		    (double)pos/1000);
+  if(offset>null_play_wave[card][stream]->getSampleLength()) {
+    return false;
+  }
+  readerPool()->lock(card,stream);
+  if(!null_play_ring[card][stream]->flush()) {
+    rda->syslog(LOG_WARNING,
+		"play ring for card %d stream %d flushed without the callback",
+		card,stream);
+  }
+  null_offset[card][stream]=null_play_decoder[card][stream]->seek(offset);
+  null_output_pos[card][stream]=0;
+  null_eof[card][stream]=false;
+  readerPool()->unlock(card,stream);
+  if(null_playing[card][stream]) {
+    readerPool()->fill(card,stream);
+  }
+  else {
+    readerPool()->requestFill(card,stream);  // Preroll in the background
+  }
+  return true;
+}
+
+
+bool DriverNull::play(int card,int stream,int length,int speed,bool pitch,
+		      bool rates)
+{
+  if((null_play_ring[card][stream]==NULL)||
+     null_playing[card][stream]||(speed!=RD_TIMESCALE_DIVISOR)) {
+    return false;
+  }
+  readerPool()->waitFill(card,stream);
+
+  //
+  // Lengths are measured against the card's own clock, which need not
+  // run at wall clock speed
+  //
+  if(length>0) {
+    null_play_schedule[card][stream]->
+      schedule(PlaySchedule::Stop,null_sample_clock[card].load()+
+	       (uint64_t)length*null_play_format[card].sample_rate/1000);
+  }
+  null_playing[card][stream]=true;
+  statePlayUpdate(card,stream,1);
+  return true;
+}
+
+
+bool DriverNull::stopPlayback(int card,int stream)
+{
+  if(null_play_ring[card][stream]==NULL) {
+    return false;
+  }
+  if(!null_playing[card][stream]) {
+    //
+    // Withdraw a scheduled start that has yet to happen
+    //
+    if(!null_play_schedule[card][stream]->isScheduled(PlaySchedule::Play)) {
+      return false;
+    }
+    null_play_schedule[card][stream]->cancelAll();
+    statePlayUpdate(card,stream,2);
+    return true;
+  }
+  null_play_schedule[card][stream]->cancel(PlaySchedule::Stop);
+  null_playing[card][stream]=false;
+  readerPool()->lock(card,stream);
+  null_play_ring[card][stream]->flush();
+  readerPool()->unlock(card,stream);
+  statePlayUpdate(card,stream,2);
+  return true;
+}
+
+
+bool DriverNull::timescaleSupported(int card)
+{
+  return false;
+}
+
+
+bool DriverNull::loadRecord(int card,int port,int coding,int chans,
+			    int samprate,int bitrate,QString wavename)
+{
+  return false;
+}
+
+
+bool DriverNull::unloadRecord(int card,int port,unsigned *len_frames)
+{
+  return false;
+}
+
+
+bool DriverNull::record(int card,int port,int length,int thres)
+{
+  return false;
+}
+
+
+bool DriverNull::stopRecord(int card,int port)
+{
+  return false;
+}
+
+
+bool DriverNull::setClockSource(int card,int src)
+{
+  return true;
+}
+
+
+bool DriverNull::setInputVolume(int card,int stream,int level)
+{
+  return false;
+}
+
+
+bool DriverNull::setOutputVolume(int card,int stream,int port,int level)
+{
+  if(level>-10000) {
+    null_output_volume[card][port][stream]=pow(10.0,(double)level/2000.0);
+    null_output_volume_db[card][port][stream]=level;
+  }
+  else {
+    null_output_volume[card][port][stream]=0.0;
+    null_output_volume_db[card][port][stream]=-10000;
+  }
+  if(null_fade_ramp[card][stream]!=NULL) {
+    null_fade_ramp[card][stream]->cancel(port);
+  }
+  return true;
+}
+
+
+bool DriverNull::fadeOutputVolume(int card,int stream,int port,int level,
+				  int length)
+{
+  null_fade_ramp[card][stream]->
+    start(port,null_output_volume_db[card][port][stream],level,
+	  (unsigned)((double)length*(double)systemSampleRate()/1000.0));
+  return true;
+}
+
+
+bool DriverNull::setInputLevel(int card,int port,int level)
+{
+  return false;
+}
+
+
+bool DriverNull::setOutputLevel(int card,int port,int level)
+{
+  return true;
+}
+
+
+bool DriverNull::setInputMode(int card,int stream,int mode)
+{
+  return false;
+}
+
+
+bool DriverNull::setOutputMode(int card,int stream,int mode)
+{
+  return true;
+}
+
+
+bool DriverNull::setInputVoxLevel(int card,int stream,int level)
+{
+  return false;
+}
+
+
+bool DriverNull::setInputType(int card,int port,int type)
+{
+  return false;
+}
+
+
+bool DriverNull::getInputStatus(int card,int port)
+{
+  return false;
+}
+
+
+bool DriverNull::getInputMeters(int card,int port,short levels[2])
+{
+  return false;
+}
+
+
+bool DriverNull::getOutputMeters(int card,int port,short levels[2])
+{
+  return GetMeterLevels(null_output_meter[card][port],levels);
+}
+
+
+bool DriverNull::getStreamOutputMeters(int card,int stream,short levels[2])
+{
+  if(null_stream_output_meter[card][2*stream]==NULL) {
+    return false;
+  }
+  return GetMeterLevels(null_stream_output_meter[card]+2*stream,levels);
+}
+
+
+bool DriverNull::setPassthroughLevel(int card,int in_port,int out_port,
+				     int level)
+{
+  return false;
+}
+
+
+void DriverNull::getOutputPosition(int card,unsigned *pos)
+{// pos is in miliseconds
+  for(int i=0;i<maxStreams();i++) {
+    if((!null_play_format[card].exiting)&&(null_play_wave[card][i]!=NULL)) {
+      pos[i]=1000*(unsigned long long)null_offset[card][i]/
+	null_play_wave[card][i]->getSamplesPerSec()+
+	1000*(unsigned long long)null_output_pos[card][i]/
+	null_play_format[card].sample_rate;
+    }
+    else {
+      pos[i]=0;
+    }
+  }
+}
+
+
+unsigned DriverNull::xruns(int card) const
+{
+  return null_xruns[card];
+}
+
+
+bool DriverNull::getSampleClock(int card,uint64_t *clock,unsigned *samprate)
+{
+  if((card<0)||(card>=RD_MAX_CARDS)||(!hasCard(card))||
+     (null_play_format[card].exiting)) {
+    return false;
+  }
+  *clock=null_sample_clock[card].load();
+  *samprate=null_play_format[card].sample_rate;
+  return true;
+}
+
+
+bool DriverNull::playAt(int card,int stream,uint64_t clock,int length,
+			int speed,bool pitch,bool rates)
+{
+  if((null_play_ring[card][stream]==NULL)||
+     null_playing[card][stream]||(speed!=RD_TIMESCALE_DIVISOR)) {
+    return false;
+  }
+  readerPool()->waitFill(card,stream);
+  if(length>0) {
+    null_play_schedule[card][stream]->
+      schedule(PlaySchedule::Stop,clock+
+	       (uint64_t)length*null_play_format[card].sample_rate/1000);
+  }
+  null_play_schedule[card][stream]->schedule(PlaySchedule::Play,clock);
+  return true;
+}
+
+
+bool DriverNull::stopPlaybackAt(int card,int stream,uint64_t clock)
+{
+  if(null_play_ring[card][stream]==NULL) {
+    return false;
+  }
+  null_play_schedule[card][stream]->schedule(PlaySchedule::Stop,clock);
+  return true;
+}
+
+
+bool DriverNull::fadeOutputVolumeAt(int card,int stream,int port,int level,
+				    int length,uint64_t clock)
+{
+  if(null_play_ring[card][stream]==NULL) {
+    return false;
+  }
+  null_play_schedule[card][stream]->
+    scheduleFade(clock,port,null_output_volume_db[card][port][stream],level,
+		 (unsigned)((double)length*
+			    (double)null_play_format[card].sample_rate/1000.0));
+  return true;
+}
+
+
+void DriverNull::processBuffers()
+{
+  int port;
+  int level;
+
+  for(int i=0;i<RD_MAX_CARDS;i++) {
+    if(hasCard(i)) {
+      for(int j=0;j<maxStreams();j++) {
+	if(null_fade_ramp[i][j]==NULL) {  // Never used
+	  continue;
+	}
+	if(null_starting[i][j]) {  // Scheduled start
+	  null_starting[i][j]=false;
+	  statePlayUpdate(i,j,1);
+	}
+	if(null_fade_ramp[i][j]->isFinished(&port,&level)) {
+	  setOutputVolume(i,j,port,level);
+	  null_fade_ramp[i][j]->clear();
+	  statePlayUpdate(i,j,3);
+	}
+	if(null_stopping[i][j]) {
+	  null_stopping[i][j]=false;
+	  null_eof[i][j]=false;
+	  null_playing[i][j]=false;
+	  null_play_schedule[i][j]->cancel(PlaySchedule::Stop);
+	  statePlayUpdate(i,j,2);
+	}
+      }
+    }
+  }
+}
+
+
+void DriverNull::fillStream(int card,int stream,ReaderBuffer *buf)
+{
+  if((null_play_ring[card][stream]==NULL)||
+     (null_play_decoder[card][stream]==NULL)) {
+    return;
+  }
+  null_play_decoder[card][stream]->fillRing(null_play_ring[card][stream]);
+  if(null_play_decoder[card][stream]->isFinished()) {
+    null_eof[card][stream]=true;
+  }
+}
+
+
+bool DriverNull::NullStartDevice(int card,bool tap)
+{
+  struct null_format *fmt=&null_play_format[card];
+  pthread_attr_t pthread_attr;
+  unsigned frames;
+
+  memset(fmt,0,sizeof(struct null_format));
+  fmt->card=card;
+  fmt->ports=rda->config()->nullPorts();
+  fmt->streams=rda->config()->nullStreams();
+  if((int)fmt->streams>maxStreams()) {
+    fmt->streams=maxStreams();
+  }
+  fmt->period_size=rda->config()->nullPeriodSize();
+  fmt->sample_rate=systemSampleRate();
+  fmt->speed=rda->config()->nullSpeed();
+  rda->syslog(LOG_INFO,"Starting Null Play Device %d:",card);
+  rda->syslog(LOG_INFO,"  SampleRate = %u",fmt->sample_rate);
+  rda->syslog(LOG_INFO,"  Ports = %u",fmt->ports);
+  rda->syslog(LOG_INFO,"  Streams = %u",fmt->streams);
+  rda->syslog(LOG_INFO,"  PeriodSize = %u frames",fmt->period_size);
+  if(fmt->speed==0) {
+    rda->syslog(LOG_INFO,"  Speed = free running");
+  }
+  else {
+    rda->syslog(LOG_INFO,"  Speed = %ux real time",fmt->speed);
+  }
+
+  frames=fmt->period_size;
+  fmt->mix_buffer=new float[frames*2*fmt->ports];
+  fmt->stream_buffer=new float[frames*2];
+  fmt->scratch_buffer=new float[frames];
+  fmt->fade_buffer=new float[frames];
+  fmt->tap_buffer=new int16_t[frames*2];
+  fmt->dither=0;
+  fmt->dithered=rda->config()->caeDither();
+
+  //
+  // Output Tap
+  //
+  if(tap&&(!rda->config()->nullTapFile().isEmpty())) {
+    fmt->tap_port=rda->config()->nullTapPort();
+    fmt->tap_wave=new RDWaveFile(rda->config()->nullTapFile());
+    fmt->tap_wave->setFormatTag(WAVE_FORMAT_PCM);
+    fmt->tap_wave->setChannels(2);
+    fmt->tap_wave->setSamplesPerSec(fmt->sample_rate);
+    fmt->tap_wave->setBitsPerSample(16);
+    if(fmt->tap_wave->createWave()) {
+      rda->syslog(LOG_INFO,"  Tap = port %u to %s",fmt->tap_port,
+		  rda->config()->nullTapFile().toUtf8().constData());
+    }
+    else {
+      rda->syslog(LOG_WARNING,"  unable to create tap file %s",
+		  rda->config()->nullTapFile().toUtf8().constData());
+      delete fmt->tap_wave;
+      fmt->tap_wave=NULL;
+    }
+  }
+
+  //
+  // Start the Callback
+  //
+  NullInitStreams(card);
+  pthread_attr_init(&pthread_attr);
+  fmt->exiting=false;
+  if(pthread_create(&fmt->thread,&pthread_attr,NullPlayCallback,fmt)!=0) {
+    rda->syslog(LOG_WARNING,"  unable to start clock thread");
+    fmt->exiting=true;
+    pthread_attr_destroy(&pthread_attr);
+    return false;
+  }
+  pthread_attr_destroy(&pthread_attr);
+  rda->syslog(LOG_INFO,"  Device started successfully");
+  return true;
+}
+
+
+int DriverNull::GetNullOutputStream(int card)
+{
+  for(unsigned i=0;i<null_play_format[card].streams;i++) {
+    if(null_play_ring[card][i]==NULL) {
+      if(null_fade_ramp[card][i]==NULL) {
+	null_fade_ramp[card][i]=new FadeRamp();
+	null_play_schedule[card][i]=new PlaySchedule();
+	for(int j=0;j<2;j++) {
+	  null_stream_output_meter[card][2*i+j]=
+	    new RDMeterAverage(null_meter_periods);
+	}
+	null_stream_loudness[card][i]=addStreamLoudness(card,i);
+      }
+      null_play_ring[card][i]=new RDSpscRing(null_play_ring_size);
+      return i;
+    }
+  }
+  return -1;
+}
+
+
+void DriverNull::FreeNullOutputStream(int card,int stream)
+{
+  delete null_play_ring[card][stream];
+  null_play_ring[card][stream]=NULL;
+}
+
+
+bool DriverNull::GetMeterLevels(RDMeterAverage *meters[2],
+				short levels[2]) const
+{
+  double meter;
+
+  for(int i=0;i<2;i++) {
+    meter=meters[i]->average();
+    if(meter==0.0) {
+      levels[i]=-10000;
+    }
+    else {
+      levels[i]=(int16_t)(2000.0*log10(meter));
+      if(levels[i]<-10000) {
+	levels[i]=-10000;
+      }
+    }
+  }
+  return true;
+}
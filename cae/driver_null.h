@@ -0,0 +1,123 @@
+// driver_null.h
+//
+// caed(8) driver for virtual, clock-driven sound cards
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef DRIVER_NULL_H
+#define DRIVER_NULL_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <rdconfig.h>
+#include <rdmeteraverage.h>
+#include <rdwavefile.h>
+
+#include "decoder.h"
+#include "driver.h"
+
+struct null_format {
+  int card;
+  pthread_t thread;
+  unsigned ports;
+  unsigned streams;
+  unsigned period_size;
+  unsigned sample_rate;
+  unsigned speed;
+  float *mix_buffer;
+  float *stream_buffer;
+  float *scratch_buffer;
+  float *fade_buffer;
+  int16_t *tap_buffer;
+  RDWaveFile *tap_wave;
+  unsigned tap_port;
+  unsigned dither;
+  bool dithered;
+  bool exiting;
+};
+
+class DriverNull : public Driver
+{
+  Q_OBJECT
+ public:
+  DriverNull(QObject *parent=0);
+  ~DriverNull();
+  QString version() const;
+  bool initialize(unsigned *next_cardnum);
+  int inputPortQuantity(int card) const;
+  int outputPortQuantity(int card) const;
+  bool loadPlayback(int card,QString wavename,int *stream);
+  bool unloadPlayback(int card,int stream);
+  bool playbackPosition(int card,int stream,unsigned pos);
+  bool play(int card,int stream,int length,int speed,bool pitch,
+	       bool rates);
+  bool stopPlayback(int card,int stream);
+  bool timescaleSupported(int card);
+  bool loadRecord(int card,int port,int coding,int chans,int samprate,
+		     int bitrate,QString wavename);
+  bool unloadRecord(int card,int port,unsigned *len_frames);
+  bool record(int card,int port,int length,int thres);
+  bool stopRecord(int card,int port);
+  bool setClockSource(int card,int src);
+  bool setInputVolume(int card,int stream,int level);
+  bool setOutputVolume(int card,int stream,int port,int level);
+  bool fadeOutputVolume(int card,int stream,int port,int level,
+				int length);
+  bool setInputLevel(int card,int port,int level);
+  bool setOutputLevel(int card,int port,int level);
+  bool setInputMode(int card,int stream,int mode);
+  bool setOutputMode(int card,int stream,int mode);
+  bool setInputVoxLevel(int card,int stream,int level);
+  bool setInputType(int card,int port,int type);
+  bool getInputStatus(int card,int port);
+  bool getInputMeters(int card,int port,short levels[2]);
+  bool getOutputMeters(int card,int port,short levels[2]);
+  bool getStreamOutputMeters(int card,int stream,short levels[2]);
+  bool setPassthroughLevel(int card,int in_port,int out_port,
+				   int level);
+  void getOutputPosition(int card,unsigned *pos);
+  unsigned xruns(int card) const;
+  bool getSampleClock(int card,uint64_t *clock,unsigned *samprate);
+  bool playAt(int card,int stream,uint64_t clock,int length,int speed,
+	      bool pitch,bool rates);
+  bool stopPlaybackAt(int card,int stream,uint64_t clock);
+  bool fadeOutputVolumeAt(int card,int stream,int port,int level,int length,
+			  uint64_t clock);
+  void fillStream(int card,int stream,ReaderBuffer *buf);
+
+ public slots:
+  void processBuffers();
+
+ private:
+  bool NullStartDevice(int card,bool tap);
+  void NullInitCallback();
+  void NullInitStreams(int card);
+  int GetNullOutputStream(int card);
+  void FreeNullOutputStream(int card,int stream);
+  bool GetMeterLevels(RDMeterAverage *meters[2],short levels[2]) const;
+  unsigned null_play_ring_size;
+  int null_meter_periods;
+  struct null_format null_play_format[RD_MAX_CARDS];
+  short *null_output_volume_db[RD_MAX_CARDS][RD_MAX_PORTS];
+  RDWaveFile **null_play_wave[RD_MAX_CARDS];
+  CaeDecoder **null_play_decoder[RD_MAX_CARDS];
+  int *null_offset[RD_MAX_CARDS];
+};
+
+
+#endif  // DRIVER_NULL_H
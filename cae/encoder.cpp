@@ -0,0 +1,147 @@
+// encoder.cpp
+//
+// Abstract base class for caed(8) record encoders.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include <rdapplication.h>
+
+#include "encoder.h"
+#include "encoder_mpeg.h"
+#include "encoder_pcm.h"
+
+CaeEncoder::CaeEncoder(RDWaveFile *wave)
+{
+  encoder_wave=wave;
+  encoder_channels=wave->getChannels();
+  encoder_frames=0;
+  encoder_finished=false;
+}
+
+
+CaeEncoder::~CaeEncoder()
+{
+}
+
+
+RDWaveFile *CaeEncoder::wave() const
+{
+  return encoder_wave;
+}
+
+
+unsigned CaeEncoder::channels() const
+{
+  return encoder_channels;
+}
+
+
+unsigned CaeEncoder::framesEncoded() const
+{
+  return encoder_frames;
+}
+
+
+bool CaeEncoder::encode(const float *pcm,unsigned frames)
+{
+  if(encoder_finished) {
+    return false;
+  }
+  encoder_frames+=frames;
+  return EncodeData(pcm,frames);
+}
+
+
+bool CaeEncoder::finish()
+{
+  if(encoder_finished) {
+    return true;
+  }
+  encoder_finished=true;
+  return FinishData();
+}
+
+
+CaeEncoder *CaeEncoder::create(RDWaveFile *wave,int coding,int chans,
+			       int samprate,int bitrate)
+{
+  CaeEncoderMpeg *mpeg=NULL;
+
+  if((chans<1)||(chans>2)) {
+    rda->syslog(LOG_WARNING,"requested unsupported channel count %d",chans);
+    return NULL;
+  }
+  switch(coding) {
+  case 0:  // PCM16
+    wave->setFormatTag(WAVE_FORMAT_PCM);
+    wave->setChannels(chans);
+    wave->setSamplesPerSec(samprate);
+    wave->setBitsPerSample(16);
+    return new CaeEncoderPcm(wave);
+
+  case 4:  // PCM24
+    wave->setFormatTag(WAVE_FORMAT_PCM);
+    wave->setChannels(chans);
+    wave->setSamplesPerSec(samprate);
+    wave->setBitsPerSample(24);
+    return new CaeEncoderPcm(wave);
+
+  case 2:  // MPEG Layer 2
+    if(!CaeEncoderMpeg::load()) {
+      rda->syslog(LOG_WARNING,"MPEG Layer 2 encode not available");
+      return NULL;
+    }
+    wave->setFormatTag(WAVE_FORMAT_MPEG);
+    wave->setChannels(chans);
+    wave->setSamplesPerSec(samprate);
+    wave->setBitsPerSample(16);
+    wave->setHeadLayer(ACM_MPEG_LAYER2);
+    if(chans==1) {
+      wave->setHeadMode(ACM_MPEG_SINGLECHANNEL);
+    }
+    else {
+      wave->setHeadMode(ACM_MPEG_STEREO);
+    }
+    wave->setHeadBitRate(bitrate);
+    wave->setMextChunk(true);
+    wave->setMextHomogenous(true);
+    wave->setMextPaddingUsed(false);
+    wave->setMextHackedBitRate(true);
+    wave->setMextFreeFormat(false);
+    wave->setMextFrameSize(144*wave->getHeadBitRate()/
+			   wave->getSamplesPerSec());
+    wave->setMextAncillaryLength(5);
+    wave->setMextLeftEnergyPresent(true);
+    wave->setMextRightEnergyPresent(chans>1);
+    wave->setMextPrivateDataPresent(false);
+    mpeg=new CaeEncoderMpeg(wave);
+    if(!mpeg->isValid()) {
+      delete mpeg;
+      return NULL;
+    }
+    return mpeg;
+  }
+  rda->syslog(LOG_WARNING,"requested invalid audio encoding %d",coding);
+
+  return NULL;
+}
+
+
+bool CaeEncoder::FinishData()
+{
+  return true;
+}
@@ -0,0 +1,66 @@
+// encoder.h
+//
+// Abstract base class for caed(8) record encoders.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include <rdwavefile.h>
+
+//
+// One encoder instance is created for each loaded record deck and is
+// only ever touched from that deck's thread (see RecordDeck).  Input is
+// always interleaved 32 bit float at the file's channel count, with
+// 1.0 == full scale.
+//
+// create() sets up the format of 'wave' for the requested coding, so
+// must be called before RDWaveFile::createWave().  Coding values are
+// those of the 'Load Recording' ['LR'] CAE command.  New formats are
+// added by subclassing CaeEncoder and adding a case to create().
+//
+class CaeEncoder
+{
+ public:
+  CaeEncoder(RDWaveFile *wave);
+  virtual ~CaeEncoder();
+  RDWaveFile *wave() const;
+  unsigned channels() const;
+  unsigned framesEncoded() const;
+  bool encode(const float *pcm,unsigned frames);
+  bool finish();
+  static CaeEncoder *create(RDWaveFile *wave,int coding,int chans,
+			    int samprate,int bitrate);
+
+ protected:
+  //
+  // FinishData() is called once, after the last call to EncodeData(),
+  // to flush anything that the encoder is still holding.
+  //
+  virtual bool EncodeData(const float *pcm,unsigned frames)=0;
+  virtual bool FinishData();
+
+ private:
+  RDWaveFile *encoder_wave;
+  unsigned encoder_channels;
+  unsigned encoder_frames;
+  bool encoder_finished;
+};
+
+
+#endif  // ENCODER_H
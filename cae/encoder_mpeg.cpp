@@ -0,0 +1,183 @@
+// encoder_mpeg.cpp
+//
+// MPEG Layer 2 record encoder for caed(8).
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include <dlfcn.h>
+
+#include <rdapplication.h>
+
+#include "encoder_mpeg.h"
+
+#ifdef HAVE_TWOLAME
+twolame_options *(*CaeEncoderMpeg::twolame_init)(void)=NULL;
+void (*CaeEncoderMpeg::twolame_set_mode)(twolame_options *,
+					 TWOLAME_MPEG_mode)=NULL;
+void (*CaeEncoderMpeg::twolame_set_num_channels)(twolame_options *,int)=NULL;
+void (*CaeEncoderMpeg::twolame_set_in_samplerate)(twolame_options *,int)=NULL;
+void (*CaeEncoderMpeg::twolame_set_out_samplerate)(twolame_options *,
+						   int)=NULL;
+void (*CaeEncoderMpeg::twolame_set_bitrate)(twolame_options *,int)=NULL;
+int (*CaeEncoderMpeg::twolame_init_params)(twolame_options *)=NULL;
+void (*CaeEncoderMpeg::twolame_close)(twolame_options **)=NULL;
+int (*CaeEncoderMpeg::twolame_encode_buffer_float32_interleaved)
+  (twolame_options *,const float[],int,unsigned char *,int)=NULL;
+int (*CaeEncoderMpeg::twolame_encode_flush)(twolame_options *,
+					    unsigned char *,int)=NULL;
+int (*CaeEncoderMpeg::twolame_set_energy_levels)(twolame_options *,
+						 int)=NULL;
+#endif  // HAVE_TWOLAME
+void *CaeEncoderMpeg::twolame_handle=NULL;
+int CaeEncoderMpeg::twolame_loaded=-1;
+
+CaeEncoderMpeg::CaeEncoderMpeg(RDWaveFile *wave)
+  : CaeEncoder(wave)
+{
+#ifdef HAVE_TWOLAME
+  if((mpeg_lameopts=twolame_init())==NULL) {
+    rda->syslog(LOG_WARNING,"unable to initialize twolame instance");
+    return;
+  }
+  if(channels()==1) {
+    twolame_set_mode(mpeg_lameopts,TWOLAME_MONO);
+  }
+  else {
+    twolame_set_mode(mpeg_lameopts,TWOLAME_STEREO);
+  }
+  twolame_set_num_channels(mpeg_lameopts,channels());
+  twolame_set_in_samplerate(mpeg_lameopts,wave->getSamplesPerSec());
+  twolame_set_out_samplerate(mpeg_lameopts,wave->getSamplesPerSec());
+  twolame_set_bitrate(mpeg_lameopts,wave->getHeadBitRate()/1000);
+  twolame_set_energy_levels(mpeg_lameopts,1);
+  if(twolame_init_params(mpeg_lameopts)!=0) {
+    rda->syslog(LOG_WARNING,
+		"invalid twolame parameters, chans=%d, samprate=%d  bitrate=%d",
+		channels(),wave->getSamplesPerSec(),wave->getHeadBitRate());
+    twolame_close(&mpeg_lameopts);
+    mpeg_lameopts=NULL;
+  }
+#endif  // HAVE_TWOLAME
+}
+
+
+CaeEncoderMpeg::~CaeEncoderMpeg()
+{
+#ifdef HAVE_TWOLAME
+  if(mpeg_lameopts!=NULL) {
+    twolame_close(&mpeg_lameopts);
+  }
+#endif  // HAVE_TWOLAME
+}
+
+
+bool CaeEncoderMpeg::isValid() const
+{
+#ifdef HAVE_TWOLAME
+  return mpeg_lameopts!=NULL;
+#else
+  return false;
+#endif  // HAVE_TWOLAME
+}
+
+
+bool CaeEncoderMpeg::load()
+{
+  if(twolame_loaded>=0) {
+    return twolame_loaded>0;
+  }
+  twolame_loaded=0;
+#ifdef HAVE_TWOLAME
+  if((twolame_handle=dlopen("libtwolame.so.0",RTLD_NOW))==NULL) {
+    rda->syslog(LOG_INFO,
+	   "TwoLAME encoder library not found, MPEG L2 encoding not supported");
+    return false;
+  }
+  *(void **)(&twolame_init)=dlsym(twolame_handle,"twolame_init");
+  *(void **)(&twolame_set_mode)=dlsym(twolame_handle,"twolame_set_mode");
+  *(void **)(&twolame_set_num_channels)=
+    dlsym(twolame_handle,"twolame_set_num_channels");
+  *(void **)(&twolame_set_in_samplerate)=
+    dlsym(twolame_handle,"twolame_set_in_samplerate");
+  *(void **)(&twolame_set_out_samplerate)=
+    dlsym(twolame_handle,"twolame_set_out_samplerate");
+  *(void **)(&twolame_set_bitrate)=
+    dlsym(twolame_handle,"twolame_set_bitrate");
+  *(void **)(&twolame_init_params)=
+    dlsym(twolame_handle,"twolame_init_params");
+  *(void **)(&twolame_close)=dlsym(twolame_handle,"twolame_close");
+  *(void **)(&twolame_encode_buffer_float32_interleaved)=
+    dlsym(twolame_handle,"twolame_encode_buffer_float32_interleaved");
+  *(void **)(&twolame_encode_flush)=
+    dlsym(twolame_handle,"twolame_encode_flush");
+  *(void **)(&twolame_set_energy_levels)=
+    dlsym(twolame_handle,"twolame_set_energy_levels");
+  rda->syslog(LOG_INFO,
+	 "Found TwoLAME encoder library, MPEG L2 encoding supported");
+  twolame_loaded=1;
+  return true;
+#else
+  rda->syslog(LOG_INFO,"MPEG L2 encoding not enabled");
+  return false;
+#endif  // HAVE_TWOLAME
+}
+
+
+bool CaeEncoderMpeg::EncodeData(const float *pcm,unsigned frames)
+{
+#ifdef HAVE_TWOLAME
+  unsigned n=0;
+  int s=0;
+  bool ret=true;
+
+  for(unsigned i=0;i<frames;i+=ENCODER_MPEG_FRAME_SAMPLES) {
+    n=frames-i;
+    if(n>ENCODER_MPEG_FRAME_SAMPLES) {
+      n=ENCODER_MPEG_FRAME_SAMPLES;
+    }
+    if((s=twolame_encode_buffer_float32_interleaved(mpeg_lameopts,
+						    pcm+i*channels(),n,
+						    mpeg_buffer,
+						ENCODER_MPEG_BUFFER_SIZE))>=0) {
+      wave()->writeWave(mpeg_buffer,s);
+    }
+    else {
+      rda->syslog(LOG_WARNING,"TwoLAME encode error");
+      ret=false;
+    }
+  }
+  return ret;
+#else
+  return false;
+#endif  // HAVE_TWOLAME
+}
+
+
+bool CaeEncoderMpeg::FinishData()
+{
+#ifdef HAVE_TWOLAME
+  int s=0;
+
+  if((s=twolame_encode_flush(mpeg_lameopts,mpeg_buffer,
+			     ENCODER_MPEG_BUFFER_SIZE))>0) {
+    wave()->writeWave(mpeg_buffer,s);
+  }
+  return s>=0;
+#else
+  return true;
+#endif  // HAVE_TWOLAME
+}
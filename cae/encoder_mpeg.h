@@ -0,0 +1,72 @@
+// encoder_mpeg.h
+//
+// MPEG Layer 2 record encoder for caed(8).
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef ENCODER_MPEG_H
+#define ENCODER_MPEG_H
+
+#ifdef HAVE_TWOLAME
+#include <twolame.h>
+#endif  // HAVE_TWOLAME
+
+#include "encoder.h"
+
+#define ENCODER_MPEG_FRAME_SAMPLES 1152
+#define ENCODER_MPEG_BUFFER_SIZE 16384
+
+//
+// TwoLAME is loaded at runtime, once per process, by load().  Each
+// instance carries its own encoder state, which is set up from the MPEG
+// parameters already stored in the wave file.
+//
+class CaeEncoderMpeg : public CaeEncoder
+{
+ public:
+  CaeEncoderMpeg(RDWaveFile *wave);
+  ~CaeEncoderMpeg();
+  bool isValid() const;
+  static bool load();
+
+ protected:
+  bool EncodeData(const float *pcm,unsigned frames);
+  bool FinishData();
+
+ private:
+  unsigned char mpeg_buffer[ENCODER_MPEG_BUFFER_SIZE];
+#ifdef HAVE_TWOLAME
+  twolame_options *mpeg_lameopts;
+  static twolame_options *(*twolame_init)(void);
+  static void (*twolame_set_mode)(twolame_options *,TWOLAME_MPEG_mode);
+  static void (*twolame_set_num_channels)(twolame_options *,int);
+  static void (*twolame_set_in_samplerate)(twolame_options *,int);
+  static void (*twolame_set_out_samplerate)(twolame_options *,int);
+  static void (*twolame_set_bitrate)(twolame_options *,int);
+  static int (*twolame_init_params)(twolame_options *);
+  static void (*twolame_close)(twolame_options **);
+  static int (*twolame_encode_buffer_float32_interleaved)
+    (twolame_options *,const float[],int,unsigned char *,int);
+  static int (*twolame_encode_flush)(twolame_options *,unsigned char *,int);
+  static int (*twolame_set_energy_levels)(twolame_options *,int);
+#endif  // HAVE_TWOLAME
+  static void *twolame_handle;
+  static int twolame_loaded;
+};
+
+
+#endif  // ENCODER_MPEG_H
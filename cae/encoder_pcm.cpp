@@ -0,0 +1,82 @@
+// encoder_pcm.cpp
+//
+// Linear PCM record encoder for caed(8).
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include "encoder_pcm.h"
+#include "mixbus.h"
+
+CaeEncoderPcm::CaeEncoderPcm(RDWaveFile *wave)
+  : CaeEncoder(wave)
+{
+  pcm_bytes=wave->getBitsPerSample()/8;
+  pcm_s32=new int32_t[ENCODER_PCM_BLOCK_FRAMES*channels()];
+  pcm_buffer=new uint8_t[ENCODER_PCM_BLOCK_FRAMES*channels()*pcm_bytes];
+}
+
+
+CaeEncoderPcm::~CaeEncoderPcm()
+{
+  delete[] pcm_buffer;
+  delete[] pcm_s32;
+}
+
+
+bool CaeEncoderPcm::EncodeData(const float *pcm,unsigned frames)
+{
+  unsigned n=0;
+  unsigned samples=0;
+  int32_t s=0;
+  bool ret=true;
+
+  while(frames>0) {
+    n=frames;
+    if(n>ENCODER_PCM_BLOCK_FRAMES) {
+      n=ENCODER_PCM_BLOCK_FRAMES;
+    }
+    samples=n*channels();
+    MixBusFloatToS32(pcm_s32,pcm,samples);
+    if(pcm_bytes==2) {
+      int16_t *dst=(int16_t *)pcm_buffer;
+      for(unsigned i=0;i<samples;i++) {
+	if(pcm_s32[i]>=0x7FFF8000) {
+	  dst[i]=0x7FFF;
+	}
+	else {
+	  dst[i]=(pcm_s32[i]+0x8000)>>16;
+	}
+      }
+    }
+    else {
+      for(unsigned i=0;i<samples;i++) {
+	s=pcm_s32[i];
+	pcm_buffer[3*i]=(s>>8)&0xFF;
+	pcm_buffer[3*i+1]=(s>>16)&0xFF;
+	pcm_buffer[3*i+2]=(s>>24)&0xFF;
+      }
+    }
+    if(wave()->writeWave(pcm_buffer,samples*pcm_bytes)!=
+       (int)(samples*pcm_bytes)) {
+      ret=false;
+    }
+    pcm+=samples;
+    frames-=n;
+  }
+
+  return ret;
+}
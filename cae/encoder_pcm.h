@@ -0,0 +1,50 @@
+// encoder_pcm.h
+//
+// Linear PCM record encoder for caed(8).
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef ENCODER_PCM_H
+#define ENCODER_PCM_H
+
+#include <stdint.h>
+
+#include "encoder.h"
+
+#define ENCODER_PCM_BLOCK_FRAMES 4096
+
+//
+// Handles linear PCM16 and PCM24.  16 bit words are rounded, not dithered,
+// so that audio captured from a 16 bit card lands in the file bit-exact.
+//
+class CaeEncoderPcm : public CaeEncoder
+{
+ public:
+  CaeEncoderPcm(RDWaveFile *wave);
+  ~CaeEncoderPcm();
+
+ protected:
+  bool EncodeData(const float *pcm,unsigned frames);
+
+ private:
+  int32_t *pcm_s32;
+  uint8_t *pcm_buffer;
+  unsigned pcm_bytes;
+};
+
+
+#endif  // ENCODER_PCM_H
@@ -0,0 +1,243 @@
+// faderamp.cpp
+//
+// Sample-accurate gain ramp for caed(8) playout streams.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include <math.h>
+
+#include <rd.h>
+
+#include "faderamp.h"
+
+//
+// Requests are packed into a single word so that the callback can never
+// see a half-written one:
+//
+//   Bits 62-63: Request type
+//   Bits 56-61: Port
+//   Bits 40-55: Starting level
+//   Bits 24-39: Target level
+//   Bits  0-23: Length, in frames
+//
+#define FADERAMP_REQUEST_NONE 0
+#define FADERAMP_REQUEST_START 1
+#define FADERAMP_REQUEST_CANCEL 2
+#define FADERAMP_MAX_LENGTH 0xFFFFFF
+
+FadeRamp::FadeRamp()
+{
+  ramp_request=FADERAMP_REQUEST_NONE;
+  ramp_state=FadeRamp::Idle;
+  ramp_requested_port=-1;
+  ramp_port=-1;
+  ramp_from_level=0.0;
+  ramp_to_level=0.0;
+  ramp_target_level=0;
+  ramp_target_gain=1.0;
+  ramp_length=0;
+  ramp_pos=0;
+  ramp_delay=0;
+}
+
+
+void FadeRamp::start(int port,int from_level,int to_level,unsigned frames)
+{
+  if(frames>FADERAMP_MAX_LENGTH) {
+    frames=FADERAMP_MAX_LENGTH;
+  }
+  ramp_requested_port=port;
+  ramp_request.store(((uint64_t)FADERAMP_REQUEST_START<<62)|
+		     ((uint64_t)(port&0x3F)<<56)|
+		     ((uint64_t)(uint16_t)from_level<<40)|
+		     ((uint64_t)(uint16_t)to_level<<24)|
+		     (uint64_t)frames,std::memory_order_release);
+}
+
+
+void FadeRamp::cancel(int port)
+{
+  //
+  // A negative port cancels regardless of which port is being faded
+  //
+  if((port<0)||(port==ramp_requested_port)) {
+    ramp_request.store((uint64_t)FADERAMP_REQUEST_CANCEL<<62,
+		       std::memory_order_release);
+  }
+}
+
+
+bool FadeRamp::isFinished(int *port,int *level) const
+{
+  if((ramp_request.load(std::memory_order_acquire)==FADERAMP_REQUEST_NONE)&&
+     (ramp_state.load(std::memory_order_acquire)==FadeRamp::Done)) {
+    *port=ramp_port;
+    *level=ramp_target_level;
+    return true;
+  }
+  return false;
+}
+
+
+void FadeRamp::clear()
+{
+  int state=FadeRamp::Done;
+
+  ramp_state.compare_exchange_strong(state,FadeRamp::Idle);
+}
+
+
+void FadeRamp::begin(int port,int from_level,int to_level,unsigned frames,
+		     unsigned delay)
+{
+  //
+  // Start a fade directly from the callback (e.g. a scheduled one), with
+  // the ramp itself held off for 'delay' frames into the next render()
+  //
+  if(frames>FADERAMP_MAX_LENGTH) {
+    frames=FADERAMP_MAX_LENGTH;
+  }
+  ramp_requested_port=port;
+  Begin(port,from_level,to_level,frames,delay);
+}
+
+
+bool FadeRamp::render(float *gains,unsigned frames)
+{
+  unsigned i=0;
+
+  if(ramp_request.load(std::memory_order_relaxed)!=FADERAMP_REQUEST_NONE) {
+    ConsumeRequest();
+  }
+
+  switch(ramp_state.load(std::memory_order_relaxed)) {
+  case FadeRamp::Active:
+    if(ramp_delay>0) {
+      float gain=(float)pow(10.0,CurrentLevel()/2000.0);
+      for(;(i<frames)&&(ramp_delay>0);i++) {
+	gains[i]=gain;
+	ramp_delay--;
+      }
+      if(ramp_delay>0) {
+	return true;
+      }
+    }
+    if(ramp_pos<ramp_length) {
+      //
+      // Re-anchor at the start of every period so that rounding in the
+      // running product can't accumulate over a long fade
+      //
+      double step=(ramp_to_level-ramp_from_level)/(double)ramp_length;
+      float gain=(float)pow(10.0,CurrentLevel()/2000.0);
+      float ratio=(float)pow(10.0,step/2000.0);
+      for(;(i<frames)&&(ramp_pos<ramp_length);i++) {
+	gains[i]=gain;
+	gain*=ratio;
+	ramp_pos++;
+      }
+    }
+    if(ramp_pos>=ramp_length) {
+      ramp_state.store(FadeRamp::Done,std::memory_order_release);
+    }
+    for(;i<frames;i++) {
+      gains[i]=ramp_target_gain;
+    }
+    return true;
+
+  case FadeRamp::Done:
+    for(;i<frames;i++) {
+      gains[i]=ramp_target_gain;
+    }
+    return true;
+  }
+
+  return false;
+}
+
+
+int FadeRamp::port() const
+{
+  return ramp_port;
+}
+
+
+void FadeRamp::ConsumeRequest()
+{
+  uint64_t req=ramp_request.exchange(FADERAMP_REQUEST_NONE,
+				     std::memory_order_acquire);
+
+  switch(req>>62) {
+  case FADERAMP_REQUEST_START:
+    Begin((req>>56)&0x3F,(double)(int16_t)((req>>40)&0xFFFF),
+	  (int16_t)((req>>24)&0xFFFF),req&FADERAMP_MAX_LENGTH,0);
+    break;
+
+  case FADERAMP_REQUEST_CANCEL:
+    ramp_state.store(FadeRamp::Idle,std::memory_order_release);
+    break;
+  }
+}
+
+
+void FadeRamp::Begin(int port,double from_level,int to_level,
+		     unsigned frames,unsigned delay)
+{
+  int state=ramp_state.load(std::memory_order_relaxed);
+
+  //
+  // If we're already fading this port, pick up from wherever that
+  // fade has got to rather than jumping back to the mixer setting
+  //
+  if(port==ramp_port) {
+    if(state==FadeRamp::Active) {
+      from_level=CurrentLevel();
+    }
+    if(state==FadeRamp::Done) {
+      from_level=ramp_target_level;
+    }
+  }
+  ramp_port=port;
+  ramp_target_level=to_level;
+  ramp_from_level=from_level;
+  ramp_to_level=ramp_target_level;
+  if(ramp_from_level<RD_MUTE_DEPTH) {
+    ramp_from_level=RD_MUTE_DEPTH;
+  }
+  if(ramp_to_level<RD_MUTE_DEPTH) {
+    ramp_to_level=RD_MUTE_DEPTH;
+  }
+  if(ramp_target_level>RD_MUTE_DEPTH) {
+    ramp_target_gain=(float)pow(10.0,(double)ramp_target_level/2000.0);
+  }
+  else {
+    ramp_target_gain=0.0;
+  }
+  ramp_length=frames;
+  ramp_pos=0;
+  ramp_delay=delay;
+  ramp_state.store(FadeRamp::Active,std::memory_order_release);
+}
+
+
+double FadeRamp::CurrentLevel() const
+{
+  if(ramp_length==0) {
+    return ramp_to_level;
+  }
+  return ramp_from_level+
+    (ramp_to_level-ramp_from_level)*(double)ramp_pos/(double)ramp_length;
+}
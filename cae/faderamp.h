@@ -0,0 +1,79 @@
+// faderamp.h
+//
+// Sample-accurate gain ramp for caed(8) playout streams.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef FADERAMP_H
+#define FADERAMP_H
+
+#include <stdint.h>
+
+#include <atomic>
+
+//
+// A fade is requested from the main thread with start() and then runs
+// entirely inside the audio callback, which calls render() once per
+// period to get a per-frame gain for the faded port.  The level moves
+// linearly in dB (1/100 dB units, as used throughout caed).
+//
+// Once the ramp reaches its target the callback holds the target gain
+// until the main thread picks up the result with isFinished(), copies
+// the final level into its normal volume tables and calls clear().
+//
+class FadeRamp
+{
+ public:
+  enum State {Idle=0,Active=1,Done=2};
+  FadeRamp();
+
+  //
+  // Main thread
+  //
+  void start(int port,int from_level,int to_level,unsigned frames);
+  void cancel(int port=-1);
+  bool isFinished(int *port,int *level) const;
+  void clear();
+
+  //
+  // Audio callback
+  //
+  void begin(int port,int from_level,int to_level,unsigned frames,
+	     unsigned delay=0);
+  bool render(float *gains,unsigned frames);
+  int port() const;
+
+ private:
+  void ConsumeRequest();
+  void Begin(int port,double from_level,int to_level,unsigned frames,
+	     unsigned delay);
+  double CurrentLevel() const;
+  std::atomic<uint64_t> ramp_request;
+  std::atomic<int> ramp_state;
+  int ramp_requested_port;
+  int ramp_port;
+  double ramp_from_level;
+  double ramp_to_level;
+  int ramp_target_level;
+  float ramp_target_gain;
+  unsigned ramp_length;
+  unsigned ramp_pos;
+  unsigned ramp_delay;
+};
+
+
+#endif  // FADERAMP_H
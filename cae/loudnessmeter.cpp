@@ -0,0 +1,361 @@
+// loudnessmeter.cpp
+//
+// ITU-R BS.1770 loudness meter for caed(8) streams and ports.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__x86_64__)||defined(__i386__)
+#ifdef __SSE2__
+#define LOUDNESSMETER_SSE2
+#include <immintrin.h>
+#endif  // __SSE2__
+#endif  // __x86_64__ || __i386__
+
+#include <rd.h>
+
+#include "loudnessmeter.h"
+
+static double Lufs(double energy)
+{
+  return -0.691+10.0*log10(energy);
+}
+
+
+static int LoudnessValue(double energy)
+{
+  double lufs;
+
+  if(energy<=0.0) {
+    return RD_MUTE_DEPTH;
+  }
+  lufs=100.0*Lufs(energy);
+  if(lufs<(double)RD_MUTE_DEPTH) {
+    return RD_MUTE_DEPTH;
+  }
+  return (int)lrint(lufs);
+}
+
+
+static int BinNumber(double lufs)
+{
+  int bin=(int)floor(10.0*(lufs+70.0));
+
+  if(bin<0) {
+    return 0;
+  }
+  if(bin>=LOUDNESSMETER_BINS) {
+    return LOUDNESSMETER_BINS-1;
+  }
+  return bin;
+}
+
+
+LoudnessMeter::LoudnessMeter(unsigned samprate)
+{
+  double f0;
+  double gain;
+  double q;
+  double k;
+  double vh;
+  double vb;
+  double a0;
+
+  //
+  // K-weighting: a high shelf modelling the acoustic effect of the head
+  // followed by the RLB high pass, each as a biquad stored as
+  // {b0,b1,b2,a1,a2}.  These are the BS.1770 analog prototypes, so that
+  // the filters are correct at sample rates other than 48 kHz.
+  //
+  f0=1681.974450955533;
+  gain=3.999843853973347;
+  q=0.7071752369554196;
+  k=tan(M_PI*f0/(double)samprate);
+  vh=pow(10.0,gain/20.0);
+  vb=pow(vh,0.4996667741545416);
+  a0=1.0+k/q+k*k;
+  meter_coeffs[0][0]=(vh+vb*k/q+k*k)/a0;
+  meter_coeffs[0][1]=2.0*(k*k-vh)/a0;
+  meter_coeffs[0][2]=(vh-vb*k/q+k*k)/a0;
+  meter_coeffs[0][3]=2.0*(k*k-1.0)/a0;
+  meter_coeffs[0][4]=(1.0-k/q+k*k)/a0;
+
+  f0=38.13547087602444;
+  q=0.5003270373238773;
+  k=tan(M_PI*f0/(double)samprate);
+  a0=1.0+k/q+k*k;
+  meter_coeffs[1][0]=1.0;
+  meter_coeffs[1][1]=-2.0;
+  meter_coeffs[1][2]=1.0;
+  meter_coeffs[1][3]=2.0*(k*k-1.0)/a0;
+  meter_coeffs[1][4]=(1.0-k/q+k*k)/a0;
+
+  meter_block_frames=samprate/10;
+  if(meter_block_frames==0) {
+    meter_block_frames=1;
+  }
+  meter_reset=false;
+  Clear();
+}
+
+
+void LoudnessMeter::reset()
+{
+  //
+  // Picked up by the callback the next time that it runs
+  //
+  meter_reset=true;
+  for(int i=0;i<3;i++) {
+    meter_lufs[i]=RD_MUTE_DEPTH;
+  }
+}
+
+
+void LoudnessMeter::getLoudness(short lufs[3]) const
+{
+  for(int i=0;i<3;i++) {
+    lufs[i]=meter_lufs[i];
+  }
+}
+
+
+void LoudnessMeter::process(const float *src,unsigned chans,unsigned frames)
+{
+  switch(chans) {
+  case 1:
+    Run(src,src,1,frames);
+    break;
+
+  case 2:
+    Run(src,src+1,2,frames);
+    break;
+  }
+}
+
+
+void LoudnessMeter::processSplit(const float *left,const float *right,
+				 unsigned frames)
+{
+  Run(left,right,1,frames);
+}
+
+
+void LoudnessMeter::Run(const float *left,const float *right,unsigned stride,
+			unsigned frames)
+{
+  unsigned n;
+
+  if(meter_reset.exchange(false)) {
+    Clear();
+  }
+  while(frames>0) {
+    n=meter_block_frames-meter_block_pos;
+    if(n>frames) {
+      n=frames;
+    }
+    Filter(left,right,stride,n);
+    left+=n*stride;
+    right+=n*stride;
+    frames-=n;
+    meter_block_pos+=n;
+    if(meter_block_pos==meter_block_frames) {
+      EndBlock();
+    }
+  }
+
+  //
+  // Keep the filters out of denormal territory during silence
+  //
+  for(int i=0;i<4;i++) {
+    for(int j=0;j<2;j++) {
+      if(fabs(meter_state[i][j])<1e-30) {
+	meter_state[i][j]=0.0;
+      }
+    }
+  }
+}
+
+
+#ifdef LOUDNESSMETER_SSE2
+void LoudnessMeter::Filter(const float *left,const float *right,
+			   unsigned stride,unsigned frames)
+{
+  //
+  // Both channels go through the filters together, one per lane
+  //
+  __m128d b10=_mm_set1_pd(meter_coeffs[0][0]);
+  __m128d b11=_mm_set1_pd(meter_coeffs[0][1]);
+  __m128d b12=_mm_set1_pd(meter_coeffs[0][2]);
+  __m128d a11=_mm_set1_pd(meter_coeffs[0][3]);
+  __m128d a12=_mm_set1_pd(meter_coeffs[0][4]);
+  __m128d b21=_mm_set1_pd(-2.0);
+  __m128d a21=_mm_set1_pd(meter_coeffs[1][3]);
+  __m128d a22=_mm_set1_pd(meter_coeffs[1][4]);
+  __m128d z10=_mm_load_pd(meter_state[0]);
+  __m128d z11=_mm_load_pd(meter_state[1]);
+  __m128d z20=_mm_load_pd(meter_state[2]);
+  __m128d z21=_mm_load_pd(meter_state[3]);
+  __m128d sum=_mm_setzero_pd();
+  __m128d x;
+  __m128d y;
+  double sums[2];
+
+  for(unsigned i=0;i<frames;i++) {
+    x=_mm_set_pd(right[i*stride],left[i*stride]);
+
+    y=_mm_add_pd(_mm_mul_pd(b10,x),z10);
+    z10=_mm_add_pd(_mm_sub_pd(_mm_mul_pd(b11,x),_mm_mul_pd(a11,y)),z11);
+    z11=_mm_sub_pd(_mm_mul_pd(b12,x),_mm_mul_pd(a12,y));
+
+    x=y;
+    y=_mm_add_pd(x,z20);
+    z20=_mm_add_pd(_mm_sub_pd(_mm_mul_pd(b21,x),_mm_mul_pd(a21,y)),z21);
+    z21=_mm_sub_pd(x,_mm_mul_pd(a22,y));
+
+    sum=_mm_add_pd(sum,_mm_mul_pd(y,y));
+  }
+  _mm_store_pd(meter_state[0],z10);
+  _mm_store_pd(meter_state[1],z11);
+  _mm_store_pd(meter_state[2],z20);
+  _mm_store_pd(meter_state[3],z21);
+  _mm_storeu_pd(sums,sum);
+  meter_sum+=sums[0]+sums[1];
+}
+#else
+void LoudnessMeter::Filter(const float *left,const float *right,
+			   unsigned stride,unsigned frames)
+{
+  const float *src[2]={left,right};
+  double *c0=meter_coeffs[0];
+  double *c1=meter_coeffs[1];
+  double x;
+  double y;
+
+  for(int j=0;j<2;j++) {
+    double z10=meter_state[0][j];
+    double z11=meter_state[1][j];
+    double z20=meter_state[2][j];
+    double z21=meter_state[3][j];
+    for(unsigned i=0;i<frames;i++) {
+      x=src[j][i*stride];
+
+      y=c0[0]*x+z10;
+      z10=c0[1]*x-c0[3]*y+z11;
+      z11=c0[2]*x-c0[4]*y;
+
+      x=y;
+      y=x+z20;
+      z20=-2.0*x-c1[3]*y+z21;
+      z21=x-c1[4]*y;
+
+      meter_sum+=y*y;
+    }
+    meter_state[0][j]=z10;
+    meter_state[1][j]=z11;
+    meter_state[2][j]=z20;
+    meter_state[3][j]=z21;
+  }
+}
+#endif  // LOUDNESSMETER_SSE2
+
+
+void LoudnessMeter::EndBlock()
+{
+  double energy=0.0;
+  double total=0.0;
+  unsigned count=0;
+  int gate;
+
+  meter_blocks[meter_block_ptr]=meter_sum/(double)meter_block_frames;
+  meter_block_ptr=(meter_block_ptr+1)%LOUDNESSMETER_BLOCKS;
+  if(meter_block_count<LOUDNESSMETER_BLOCKS) {
+    meter_block_count++;
+  }
+  meter_sum=0.0;
+  meter_block_pos=0;
+
+  //
+  // Momentary (400 ms), which is also the gating block for the
+  // integrated value
+  //
+  if(meter_block_count<4) {
+    return;
+  }
+  for(unsigned i=1;i<=4;i++) {
+    energy+=meter_blocks[(meter_block_ptr+LOUDNESSMETER_BLOCKS-i)%
+			 LOUDNESSMETER_BLOCKS];
+  }
+  energy/=4.0;
+  meter_lufs[LoudnessMeter::Momentary]=LoudnessValue(energy);
+  if((energy>0.0)&&(Lufs(energy)>=-70.0)) {
+    meter_histogram[BinNumber(Lufs(energy))]++;
+    meter_histogram_energy[BinNumber(Lufs(energy))]+=energy;
+  }
+
+  //
+  // Short-term (3 s)
+  //
+  if(meter_block_count==LOUDNESSMETER_BLOCKS) {
+    energy=0.0;
+    for(unsigned i=0;i<LOUDNESSMETER_BLOCKS;i++) {
+      energy+=meter_blocks[i];
+    }
+    meter_lufs[LoudnessMeter::ShortTerm]=
+      LoudnessValue(energy/(double)LOUDNESSMETER_BLOCKS);
+  }
+
+  //
+  // Integrated, gated 10 LU below the loudness of everything above the
+  // absolute gate
+  //
+  for(int i=0;i<LOUDNESSMETER_BINS;i++) {
+    total+=meter_histogram_energy[i];
+    count+=meter_histogram[i];
+  }
+  if(count==0) {
+    return;
+  }
+  gate=BinNumber(Lufs(total/(double)count)-10.0);
+  total=0.0;
+  count=0;
+  for(int i=gate;i<LOUDNESSMETER_BINS;i++) {
+    total+=meter_histogram_energy[i];
+    count+=meter_histogram[i];
+  }
+  if(count>0) {
+    meter_lufs[LoudnessMeter::Integrated]=
+      LoudnessValue(total/(double)count);
+  }
+}
+
+
+void LoudnessMeter::Clear()
+{
+  memset(meter_state,0,sizeof(meter_state));
+  meter_sum=0.0;
+  meter_block_pos=0;
+  memset(meter_blocks,0,sizeof(meter_blocks));
+  meter_block_ptr=0;
+  meter_block_count=0;
+  memset(meter_histogram,0,sizeof(meter_histogram));
+  memset(meter_histogram_energy,0,sizeof(meter_histogram_energy));
+  for(int i=0;i<3;i++) {
+    meter_lufs[i]=RD_MUTE_DEPTH;
+  }
+}
@@ -0,0 +1,90 @@
+// loudnessmeter.h
+//
+// ITU-R BS.1770 loudness meter for caed(8) streams and ports.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef LOUDNESSMETER_H
+#define LOUDNESSMETER_H
+
+#include <atomic>
+
+//
+// Number of 100 ms sub-blocks kept for the short-term window
+//
+#define LOUDNESSMETER_BLOCKS 30
+
+//
+// Histogram of gating blocks used for the integrated value, in 0.1 LU
+// steps from -70 LUFS (the absolute gate) up to +5 LUFS
+//
+#define LOUDNESSMETER_BINS 750
+
+//
+// K-weighted loudness of a stereo signal, as per ITU-R BS.1770 and
+// EBU R128.  All of the filtering and gating is done in the audio
+// callback, which calls process() (or processSplit(), for drivers that
+// keep each channel in its own buffer) with every period of audio.  The
+// results are published at the end of each 100 ms sub-block and can be
+// read from the main thread at any time with getLoudness().
+//
+// Loudness values are in 1/100 LU, with RD_MUTE_DEPTH meaning that there
+// is not yet enough audio (or nothing above the absolute gate) to
+// measure.  Mono audio is measured as if it were played on both
+// channels.
+//
+class LoudnessMeter
+{
+ public:
+  enum Window {Momentary=0,ShortTerm=1,Integrated=2};
+  LoudnessMeter(unsigned samprate);
+
+  //
+  // Main thread
+  //
+  void reset();
+  void getLoudness(short lufs[3]) const;
+
+  //
+  // Audio callback
+  //
+  void process(const float *src,unsigned chans,unsigned frames);
+  void processSplit(const float *left,const float *right,unsigned frames);
+
+ private:
+  void Run(const float *left,const float *right,unsigned stride,
+	   unsigned frames);
+  void Filter(const float *left,const float *right,unsigned stride,
+	      unsigned frames);
+  void EndBlock();
+  void Clear();
+  std::atomic<bool> meter_reset;
+  std::atomic<int> meter_lufs[3];
+  double meter_coeffs[2][5];
+  alignas(16) double meter_state[4][2];
+  double meter_sum;
+  unsigned meter_block_frames;
+  unsigned meter_block_pos;
+  double meter_blocks[LOUDNESSMETER_BLOCKS];
+  unsigned meter_block_ptr;
+  unsigned meter_block_count;
+  unsigned meter_histogram[LOUDNESSMETER_BINS];
+  double meter_histogram_energy[LOUDNESSMETER_BINS];
+};
+
+
+#endif  // LOUDNESSMETER_H
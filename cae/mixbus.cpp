@@ -0,0 +1,671 @@
+// mixbus.cpp
+//
+// Floating point mixing kernels for caed(8) drivers.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__x86_64__)||defined(__i386__)
+#ifdef __SSE2__
+#define MIXBUS_SSE2
+#include <immintrin.h>
+#endif  // __SSE2__
+#endif  // __x86_64__ || __i386__
+#if defined(__ARM_NEON)||defined(__ARM_NEON__)
+#define MIXBUS_NEON
+#include <arm_neon.h>
+#endif  // __ARM_NEON
+
+#include "mixbus.h"
+
+#define MIXBUS_DITHER_SIZE 4096
+#define MIXBUS_DITHER_MASK (MIXBUS_DITHER_SIZE-1)
+#define MIXBUS_S32_MAX 0.99999994f
+
+//
+// TPDF dither, in units of 16 bit LSBs.  The first eight values are
+// repeated at the end so that vector loads never need to wrap.
+//
+static float mixbus_dither[MIXBUS_DITHER_SIZE+8];
+static const char *mixbus_kernel_name="generic";
+
+static void (*mixbus_s16_to_float)(float *,const int16_t *,unsigned);
+static void (*mixbus_s32_to_float)(float *,const int32_t *,unsigned);
+static void (*mixbus_float_to_s16)(int16_t *,const float *,unsigned,
+				   unsigned *);
+static void (*mixbus_float_to_s32)(int32_t *,const float *,unsigned);
+static void (*mixbus_accumulate)(float *,const float *,float,unsigned);
+static void (*mixbus_accumulate_split)(float *,float *,const float *,float,
+				       unsigned);
+static float (*mixbus_peak)(const float *,unsigned);
+static void (*mixbus_stereo_peak)(const float *,unsigned,float *);
+
+
+//
+// Generic Kernels
+//
+static inline float ClipSample(float x,float max)
+{
+  if(x>max) {
+    return max;
+  }
+  if(x<-1.0f) {
+    return -1.0f;
+  }
+  return x;
+}
+
+
+static void S16ToFloatGeneric(float *dst,const int16_t *src,unsigned n)
+{
+  for(unsigned i=0;i<n;i++) {
+    dst[i]=(float)src[i]/32768.0f;
+  }
+}
+
+
+static void S32ToFloatGeneric(float *dst,const int32_t *src,unsigned n)
+{
+  for(unsigned i=0;i<n;i++) {
+    dst[i]=(float)src[i]/2147483648.0f;
+  }
+}
+
+
+static void FloatToS16Generic(int16_t *dst,const float *src,unsigned n,
+			      unsigned *dither)
+{
+  unsigned d=0;
+  float x;
+
+  if(dither!=NULL) {
+    d=*dither;
+  }
+  for(unsigned i=0;i<n;i++) {
+    x=ClipSample(src[i],1.0f)*32768.0f;
+    if((dither!=NULL)&&(x!=rintf(x))) {
+      x+=mixbus_dither[(d+i)&MIXBUS_DITHER_MASK];
+    }
+    x=lrintf(x);
+    if(x>32767.0f) {
+      x=32767.0f;
+    }
+    if(x<-32768.0f) {
+      x=-32768.0f;
+    }
+    dst[i]=(int16_t)x;
+  }
+  if(dither!=NULL) {
+    *dither=(d+n)&MIXBUS_DITHER_MASK;
+  }
+}
+
+
+static void FloatToS32Generic(int32_t *dst,const float *src,unsigned n)
+{
+  for(unsigned i=0;i<n;i++) {
+    dst[i]=(int32_t)lrintf(ClipSample(src[i],MIXBUS_S32_MAX)*2147483648.0f);
+  }
+}
+
+
+static void AccumulateGeneric(float *dst,const float *src,float gain,
+			      unsigned n)
+{
+  for(unsigned i=0;i<n;i++) {
+    dst[i]+=gain*src[i];
+  }
+}
+
+
+static void AccumulateSplitGeneric(float *left,float *right,
+				   const float *src,float gain,
+				   unsigned frames)
+{
+  for(unsigned i=0;i<frames;i++) {
+    left[i]+=gain*src[2*i];
+    right[i]+=gain*src[2*i+1];
+  }
+}
+
+
+static float PeakGeneric(const float *src,unsigned n)
+{
+  float peak=0.0f;
+
+  for(unsigned i=0;i<n;i++) {
+    if(fabsf(src[i])>peak) {
+      peak=fabsf(src[i]);
+    }
+  }
+  return peak;
+}
+
+
+static void StereoPeakGeneric(const float *src,unsigned frames,float *peaks)
+{
+  peaks[0]=0.0f;
+  peaks[1]=0.0f;
+  for(unsigned i=0;i<frames;i++) {
+    for(unsigned j=0;j<2;j++) {
+      if(fabsf(src[2*i+j])>peaks[j]) {
+	peaks[j]=fabsf(src[2*i+j]);
+      }
+    }
+  }
+}
+
+
+#ifdef MIXBUS_SSE2
+//
+// SSE2 Kernels
+//
+static void S16ToFloatSse2(float *dst,const int16_t *src,unsigned n)
+{
+  const __m128 scale=_mm_set1_ps(1.0f/32768.0f);
+  unsigned i=0;
+
+  for(;(i+8)<=n;i+=8) {
+    __m128i s=_mm_loadu_si128((const __m128i *)(src+i));
+    __m128i lo=_mm_srai_epi32(_mm_unpacklo_epi16(s,s),16);
+    __m128i hi=_mm_srai_epi32(_mm_unpackhi_epi16(s,s),16);
+    _mm_storeu_ps(dst+i,_mm_mul_ps(_mm_cvtepi32_ps(lo),scale));
+    _mm_storeu_ps(dst+i+4,_mm_mul_ps(_mm_cvtepi32_ps(hi),scale));
+  }
+  S16ToFloatGeneric(dst+i,src+i,n-i);
+}
+
+
+static void S32ToFloatSse2(float *dst,const int32_t *src,unsigned n)
+{
+  const __m128 scale=_mm_set1_ps(1.0f/2147483648.0f);
+  unsigned i=0;
+
+  for(;(i+4)<=n;i+=4) {
+    __m128i s=_mm_loadu_si128((const __m128i *)(src+i));
+    _mm_storeu_ps(dst+i,_mm_mul_ps(_mm_cvtepi32_ps(s),scale));
+  }
+  S32ToFloatGeneric(dst+i,src+i,n-i);
+}
+
+
+static void FloatToS16Sse2(int16_t *dst,const float *src,unsigned n,
+			   unsigned *dither)
+{
+  const __m128 max=_mm_set1_ps(1.0f);
+  const __m128 min=_mm_set1_ps(-1.0f);
+  const __m128 scale=_mm_set1_ps(32768.0f);
+  unsigned d=0;
+  unsigned i=0;
+
+  if(dither==NULL) {
+    for(;(i+8)<=n;i+=8) {
+      __m128 a=_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src+i),min),max);
+      __m128 b=_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src+i+4),min),max);
+      _mm_storeu_si128((__m128i *)(dst+i),
+		       _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(a,scale)),
+				       _mm_cvtps_epi32(_mm_mul_ps(b,scale))));
+    }
+    FloatToS16Generic(dst+i,src+i,n-i,NULL);
+    return;
+  }
+
+  //
+  // Samples that are already exact 16 bit values are left undithered
+  //
+  d=*dither;
+  for(;(i+8)<=n;i+=8) {
+    unsigned k=(d+i)&MIXBUS_DITHER_MASK;
+    __m128 a=_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src+i),min),max);
+    __m128 b=_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src+i+4),min),max);
+    a=_mm_mul_ps(a,scale);
+    b=_mm_mul_ps(b,scale);
+    __m128 ma=_mm_cmpneq_ps(a,_mm_cvtepi32_ps(_mm_cvtps_epi32(a)));
+    __m128 mb=_mm_cmpneq_ps(b,_mm_cvtepi32_ps(_mm_cvtps_epi32(b)));
+    a=_mm_add_ps(a,_mm_and_ps(ma,_mm_loadu_ps(mixbus_dither+k)));
+    b=_mm_add_ps(b,_mm_and_ps(mb,_mm_loadu_ps(mixbus_dither+k+4)));
+    _mm_storeu_si128((__m128i *)(dst+i),
+		     _mm_packs_epi32(_mm_cvtps_epi32(a),_mm_cvtps_epi32(b)));
+  }
+  *dither=(d+i)&MIXBUS_DITHER_MASK;
+  FloatToS16Generic(dst+i,src+i,n-i,dither);
+}
+
+
+static void FloatToS32Sse2(int32_t *dst,const float *src,unsigned n)
+{
+  const __m128 max=_mm_set1_ps(MIXBUS_S32_MAX);
+  const __m128 min=_mm_set1_ps(-1.0f);
+  const __m128 scale=_mm_set1_ps(2147483648.0f);
+  unsigned i=0;
+
+  for(;(i+4)<=n;i+=4) {
+    __m128 a=_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src+i),min),max);
+    _mm_storeu_si128((__m128i *)(dst+i),
+		     _mm_cvtps_epi32(_mm_mul_ps(a,scale)));
+  }
+  FloatToS32Generic(dst+i,src+i,n-i);
+}
+
+
+static void AccumulateSse2(float *dst,const float *src,float gain,unsigned n)
+{
+  const __m128 g=_mm_set1_ps(gain);
+  unsigned i=0;
+
+  for(;(i+8)<=n;i+=8) {
+    _mm_storeu_ps(dst+i,_mm_add_ps(_mm_loadu_ps(dst+i),
+				   _mm_mul_ps(_mm_loadu_ps(src+i),g)));
+    _mm_storeu_ps(dst+i+4,_mm_add_ps(_mm_loadu_ps(dst+i+4),
+				     _mm_mul_ps(_mm_loadu_ps(src+i+4),g)));
+  }
+  AccumulateGeneric(dst+i,src+i,gain,n-i);
+}
+
+
+static void AccumulateSplitSse2(float *left,float *right,const float *src,
+				float gain,unsigned frames)
+{
+  const __m128 g=_mm_set1_ps(gain);
+  unsigned i=0;
+
+  for(;(i+4)<=frames;i+=4) {
+    __m128 a=_mm_loadu_ps(src+2*i);    // [L0 R0 L1 R1]
+    __m128 b=_mm_loadu_ps(src+2*i+4);  // [L2 R2 L3 R3]
+    _mm_storeu_ps(left+i,
+		  _mm_add_ps(_mm_loadu_ps(left+i),
+			     _mm_mul_ps(_mm_shuffle_ps(a,b,_MM_SHUFFLE(2,0,2,0)),
+					g)));
+    _mm_storeu_ps(right+i,
+		  _mm_add_ps(_mm_loadu_ps(right+i),
+			     _mm_mul_ps(_mm_shuffle_ps(a,b,_MM_SHUFFLE(3,1,3,1)),
+					g)));
+  }
+  AccumulateSplitGeneric(left+i,right+i,src+2*i,gain,frames-i);
+}
+
+
+static float PeakSse2(const float *src,unsigned n)
+{
+  const __m128 mask=_mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+  __m128 peak=_mm_setzero_ps();
+  float lanes[4];
+  unsigned i=0;
+
+  for(;(i+4)<=n;i+=4) {
+    peak=_mm_max_ps(peak,_mm_and_ps(_mm_loadu_ps(src+i),mask));
+  }
+  _mm_storeu_ps(lanes,peak);
+  float ret=PeakGeneric(src+i,n-i);
+  for(unsigned j=0;j<4;j++) {
+    if(lanes[j]>ret) {
+      ret=lanes[j];
+    }
+  }
+  return ret;
+}
+
+
+static void StereoPeakSse2(const float *src,unsigned frames,float *peaks)
+{
+  const __m128 mask=_mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+  __m128 peak=_mm_setzero_ps();
+  float lanes[4];
+  unsigned i=0;
+
+  for(;(i+2)<=frames;i+=2) {  // [L R L R]
+    peak=_mm_max_ps(peak,_mm_and_ps(_mm_loadu_ps(src+2*i),mask));
+  }
+  _mm_storeu_ps(lanes,peak);
+  StereoPeakGeneric(src+2*i,frames-i,peaks);
+  for(unsigned j=0;j<2;j++) {
+    if(lanes[j]>peaks[j]) {
+      peaks[j]=lanes[j];
+    }
+    if(lanes[j+2]>peaks[j]) {
+      peaks[j]=lanes[j+2];
+    }
+  }
+}
+
+
+//
+// AVX2 Kernels (selected at runtime)
+//
+__attribute__((target("avx2")))
+static void S16ToFloatAvx2(float *dst,const int16_t *src,unsigned n)
+{
+  const __m256 scale=_mm256_set1_ps(1.0f/32768.0f);
+  unsigned i=0;
+
+  for(;(i+8)<=n;i+=8) {
+    __m256i s=
+      _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(src+i)));
+    _mm256_storeu_ps(dst+i,_mm256_mul_ps(_mm256_cvtepi32_ps(s),scale));
+  }
+  S16ToFloatGeneric(dst+i,src+i,n-i);
+}
+
+
+__attribute__((target("avx2")))
+static void AccumulateAvx2(float *dst,const float *src,float gain,unsigned n)
+{
+  const __m256 g=_mm256_set1_ps(gain);
+  unsigned i=0;
+
+  for(;(i+16)<=n;i+=16) {
+    _mm256_storeu_ps(dst+i,
+		     _mm256_add_ps(_mm256_loadu_ps(dst+i),
+				   _mm256_mul_ps(_mm256_loadu_ps(src+i),g)));
+    _mm256_storeu_ps(dst+i+8,
+		     _mm256_add_ps(_mm256_loadu_ps(dst+i+8),
+				   _mm256_mul_ps(_mm256_loadu_ps(src+i+8),g)));
+  }
+  AccumulateGeneric(dst+i,src+i,gain,n-i);
+}
+
+
+__attribute__((target("avx2")))
+static float PeakAvx2(const float *src,unsigned n)
+{
+  const __m256 mask=_mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+  __m256 peak=_mm256_setzero_ps();
+  float lanes[8];
+  unsigned i=0;
+
+  for(;(i+8)<=n;i+=8) {
+    peak=_mm256_max_ps(peak,_mm256_and_ps(_mm256_loadu_ps(src+i),mask));
+  }
+  _mm256_storeu_ps(lanes,peak);
+  float ret=PeakGeneric(src+i,n-i);
+  for(unsigned j=0;j<8;j++) {
+    if(lanes[j]>ret) {
+      ret=lanes[j];
+    }
+  }
+  return ret;
+}
+
+
+__attribute__((target("avx2")))
+static void StereoPeakAvx2(const float *src,unsigned frames,float *peaks)
+{
+  const __m256 mask=_mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+  __m256 peak=_mm256_setzero_ps();
+  float lanes[8];
+  unsigned i=0;
+
+  for(;(i+4)<=frames;i+=4) {  // [L R L R L R L R]
+    peak=_mm256_max_ps(peak,_mm256_and_ps(_mm256_loadu_ps(src+2*i),mask));
+  }
+  _mm256_storeu_ps(lanes,peak);
+  StereoPeakGeneric(src+2*i,frames-i,peaks);
+  for(unsigned j=0;j<8;j++) {
+    if(lanes[j]>peaks[j%2]) {
+      peaks[j%2]=lanes[j];
+    }
+  }
+}
+#endif  // MIXBUS_SSE2
+
+
+#ifdef MIXBUS_NEON
+//
+// NEON Kernels
+//
+static void S16ToFloatNeon(float *dst,const int16_t *src,unsigned n)
+{
+  const float32x4_t scale=vdupq_n_f32(1.0f/32768.0f);
+  unsigned i=0;
+
+  for(;(i+8)<=n;i+=8) {
+    int16x8_t s=vld1q_s16(src+i);
+    vst1q_f32(dst+i,vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(s))),
+			      scale));
+    vst1q_f32(dst+i+4,vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(s))),
+				scale));
+  }
+  S16ToFloatGeneric(dst+i,src+i,n-i);
+}
+
+
+static void AccumulateNeon(float *dst,const float *src,float gain,unsigned n)
+{
+  const float32x4_t g=vdupq_n_f32(gain);
+  unsigned i=0;
+
+  for(;(i+4)<=n;i+=4) {
+    vst1q_f32(dst+i,vmlaq_f32(vld1q_f32(dst+i),vld1q_f32(src+i),g));
+  }
+  AccumulateGeneric(dst+i,src+i,gain,n-i);
+}
+
+
+static void AccumulateSplitNeon(float *left,float *right,const float *src,
+				float gain,unsigned frames)
+{
+  const float32x4_t g=vdupq_n_f32(gain);
+  unsigned i=0;
+
+  for(;(i+4)<=frames;i+=4) {
+    float32x4x2_t s=vld2q_f32(src+2*i);  // De-interleaves as it loads
+    vst1q_f32(left+i,vmlaq_f32(vld1q_f32(left+i),s.val[0],g));
+    vst1q_f32(right+i,vmlaq_f32(vld1q_f32(right+i),s.val[1],g));
+  }
+  AccumulateSplitGeneric(left+i,right+i,src+2*i,gain,frames-i);
+}
+
+
+static float PeakNeon(const float *src,unsigned n)
+{
+  float32x4_t peak=vdupq_n_f32(0.0f);
+  float lanes[4];
+  unsigned i=0;
+
+  for(;(i+4)<=n;i+=4) {
+    peak=vmaxq_f32(peak,vabsq_f32(vld1q_f32(src+i)));
+  }
+  vst1q_f32(lanes,peak);
+  float ret=PeakGeneric(src+i,n-i);
+  for(unsigned j=0;j<4;j++) {
+    if(lanes[j]>ret) {
+      ret=lanes[j];
+    }
+  }
+  return ret;
+}
+#endif  // MIXBUS_NEON
+
+
+void MixBusInit()
+{
+  //
+  // Dither Table
+  //
+  uint32_t seed=22222;
+  for(unsigned i=0;i<MIXBUS_DITHER_SIZE;i++) {
+    float r[2];
+    for(unsigned j=0;j<2;j++) {
+      seed=seed*1664525+1013904223;
+      r[j]=(float)(seed>>8)/16777216.0f;
+    }
+    mixbus_dither[i]=r[0]-r[1];
+  }
+  for(unsigned i=0;i<8;i++) {
+    mixbus_dither[MIXBUS_DITHER_SIZE+i]=mixbus_dither[i];
+  }
+
+  //
+  // Kernels
+  //
+  mixbus_s16_to_float=S16ToFloatGeneric;
+  mixbus_s32_to_float=S32ToFloatGeneric;
+  mixbus_float_to_s16=FloatToS16Generic;
+  mixbus_float_to_s32=FloatToS32Generic;
+  mixbus_accumulate=AccumulateGeneric;
+  mixbus_accumulate_split=AccumulateSplitGeneric;
+  mixbus_peak=PeakGeneric;
+  mixbus_stereo_peak=StereoPeakGeneric;
+  mixbus_kernel_name="generic";
+#ifdef MIXBUS_SSE2
+  mixbus_s16_to_float=S16ToFloatSse2;
+  mixbus_s32_to_float=S32ToFloatSse2;
+  mixbus_float_to_s16=FloatToS16Sse2;
+  mixbus_float_to_s32=FloatToS32Sse2;
+  mixbus_accumulate=AccumulateSse2;
+  mixbus_accumulate_split=AccumulateSplitSse2;
+  mixbus_peak=PeakSse2;
+  mixbus_stereo_peak=StereoPeakSse2;
+  mixbus_kernel_name="SSE2";
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2")) {
+    mixbus_s16_to_float=S16ToFloatAvx2;
+    mixbus_accumulate=AccumulateAvx2;
+    mixbus_peak=PeakAvx2;
+    mixbus_stereo_peak=StereoPeakAvx2;
+    mixbus_kernel_name="AVX2";
+  }
+#endif  // MIXBUS_SSE2
+#ifdef MIXBUS_NEON
+  mixbus_s16_to_float=S16ToFloatNeon;
+  mixbus_accumulate=AccumulateNeon;
+  mixbus_accumulate_split=AccumulateSplitNeon;
+  mixbus_peak=PeakNeon;
+  mixbus_kernel_name="NEON";
+#endif  // MIXBUS_NEON
+}
+
+
+const char *MixBusKernelName()
+{
+  return mixbus_kernel_name;
+}
+
+
+void MixBusS16ToFloat(float *dst,const int16_t *src,unsigned n)
+{
+  mixbus_s16_to_float(dst,src,n);
+}
+
+
+void MixBusS32ToFloat(float *dst,const int32_t *src,unsigned n)
+{
+  mixbus_s32_to_float(dst,src,n);
+}
+
+
+void MixBusFloatToS16(int16_t *dst,const float *src,unsigned n,
+		      unsigned *dither)
+{
+  unsigned start=0;
+
+  if(dither==NULL) {
+    mixbus_float_to_s16(dst,src,n,NULL);
+    return;
+  }
+
+  //
+  // Each call starts at a random point in the dither table, so that the
+  // table's period doesn't show up as a pattern in the output
+  //
+  *dither=*dither*1664525+1013904223;
+  start=(*dither>>16)&MIXBUS_DITHER_MASK;
+  mixbus_float_to_s16(dst,src,n,&start);
+}
+
+
+void MixBusFloatToS32(int32_t *dst,const float *src,unsigned n)
+{
+  mixbus_float_to_s32(dst,src,n);
+}
+
+
+void MixBusZero(float *dst,unsigned n)
+{
+  memset(dst,0,n*sizeof(float));
+}
+
+
+void MixBusMonoToStereo(float *dst,const float *src,unsigned frames)
+{
+  for(unsigned i=0;i<frames;i++) {
+    dst[2*i]=src[i];
+    dst[2*i+1]=src[i];
+  }
+}
+
+
+void MixBusAccumulate(float *dst,const float *src,float gain,unsigned n)
+{
+  mixbus_accumulate(dst,src,gain,n);
+}
+
+
+void MixBusAccumulateRamp(float *dst,const float *src,const float *gains,
+			  unsigned frames)
+{
+  for(unsigned i=0;i<frames;i++) {
+    dst[2*i]+=gains[i]*src[2*i];
+    dst[2*i+1]+=gains[i]*src[2*i+1];
+  }
+}
+
+
+void MixBusAccumulateSplit(float *left,float *right,const float *src,
+			   unsigned chans,float gain,unsigned frames)
+{
+  if(chans==1) {
+    mixbus_accumulate(left,src,gain,frames);
+    mixbus_accumulate(right,src,gain,frames);
+  }
+  else {
+    mixbus_accumulate_split(left,right,src,gain,frames);
+  }
+}
+
+
+void MixBusAccumulateSplitRamp(float *left,float *right,const float *src,
+			       unsigned chans,const float *gains,
+			       unsigned frames)
+{
+  if(chans==1) {
+    for(unsigned i=0;i<frames;i++) {
+      left[i]+=gains[i]*src[i];
+      right[i]+=gains[i]*src[i];
+    }
+  }
+  else {
+    for(unsigned i=0;i<frames;i++) {
+      left[i]+=gains[i]*src[2*i];
+      right[i]+=gains[i]*src[2*i+1];
+    }
+  }
+}
+
+
+float MixBusPeak(const float *src,unsigned n)
+{
+  return mixbus_peak(src,n);
+}
+
+
+void MixBusStereoPeak(const float *src,unsigned frames,float peaks[2])
+{
+  mixbus_stereo_peak(src,frames,peaks);
+}
@@ -0,0 +1,73 @@
+// mixbus.h
+//
+// Floating point mixing kernels for caed(8) drivers.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef MIXBUS_H
+#define MIXBUS_H
+
+#include <stdint.h>
+
+//
+// Select the fastest kernel set supported by the host CPU.  Must be
+// called once before any of the other functions are used.
+//
+void MixBusInit();
+const char *MixBusKernelName();
+
+//
+// Sample format conversion.  Conversions to integer formats clip at full
+// scale.  MixBusFloatToS16() applies TPDF dither to samples that aren't
+// already exact 16 bit values, with '*dither' carrying the dither state
+// between calls; pass NULL to round without dither.
+//
+void MixBusS16ToFloat(float *dst,const int16_t *src,unsigned n);
+void MixBusS32ToFloat(float *dst,const int32_t *src,unsigned n);
+void MixBusFloatToS16(int16_t *dst,const float *src,unsigned n,
+		      unsigned *dither);
+void MixBusFloatToS32(int32_t *dst,const float *src,unsigned n);
+
+//
+// Mixing.  'n' is in samples, 'frames' in stereo sample pairs.
+// MixBusAccumulateRamp() takes one gain value per frame.
+//
+void MixBusZero(float *dst,unsigned n);
+void MixBusMonoToStereo(float *dst,const float *src,unsigned frames);
+void MixBusAccumulate(float *dst,const float *src,float gain,unsigned n);
+void MixBusAccumulateRamp(float *dst,const float *src,const float *gains,
+			  unsigned frames);
+
+//
+// Mixing into a pair of non-interleaved (left, right) buses, as used by
+// JACK ports.  'src' holds 'frames' frames of 'chans' (1 or 2) interleaved
+// channels; a mono source feeds both buses.
+//
+void MixBusAccumulateSplit(float *left,float *right,const float *src,
+			   unsigned chans,float gain,unsigned frames);
+void MixBusAccumulateSplitRamp(float *left,float *right,const float *src,
+			       unsigned chans,const float *gains,
+			       unsigned frames);
+
+//
+// Metering (absolute peak values, 1.0 == full scale)
+//
+float MixBusPeak(const float *src,unsigned n);
+void MixBusStereoPeak(const float *src,unsigned frames,float peaks[2]);
+
+
+#endif  // MIXBUS_H
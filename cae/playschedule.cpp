@@ -0,0 +1,196 @@
+// playschedule.cpp
+//
+// Sample clock scheduled transitions for caed(8) playout streams.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include "playschedule.h"
+
+//
+// Fade parameters are packed into a single word, as in FadeRamp:
+//
+//   Bits 56-63: Port
+//   Bits 40-55: Starting level
+//   Bits 24-39: Target level
+//   Bits  0-23: Length, in frames
+//
+#define PLAYSCHEDULE_MAX_FADE_LENGTH 0xFFFFFF
+
+PlaySchedule::PlaySchedule()
+{
+  for(int i=0;i<PlaySchedule::LastEvent;i++) {
+    sched_clock[i]=PLAYSCHEDULE_NONE;
+  }
+  for(int i=0;i<2;i++) {
+    sched_fade_clock[i]=PLAYSCHEDULE_NONE;
+    sched_fade_params[i]=0;
+  }
+  sched_fade_pending=PLAYSCHEDULE_NONE;
+  sched_fade_generation=0;
+  sched_fade_last=0;
+  sched_fade_taken=0;
+}
+
+
+void PlaySchedule::schedule(Event evt,uint64_t clock)
+{
+  if(clock==PLAYSCHEDULE_NONE) {
+    clock--;
+  }
+  if(evt==PlaySchedule::Fade) {
+    PublishFade(clock,sched_fade_last);  // Same parameters as last time
+    return;
+  }
+  sched_clock[evt].store(clock,std::memory_order_release);
+}
+
+
+void PlaySchedule::scheduleFade(uint64_t clock,int port,int from_level,
+				int to_level,unsigned frames)
+{
+  if(frames>PLAYSCHEDULE_MAX_FADE_LENGTH) {
+    frames=PLAYSCHEDULE_MAX_FADE_LENGTH;
+  }
+  if(clock==PLAYSCHEDULE_NONE) {
+    clock--;
+  }
+  PublishFade(clock,((uint64_t)(port&0xFF)<<56)|
+	      ((uint64_t)(uint16_t)from_level<<40)|
+	      ((uint64_t)(uint16_t)to_level<<24)|
+	      (uint64_t)frames);
+}
+
+
+void PlaySchedule::cancel(Event evt)
+{
+  if(evt==PlaySchedule::Fade) {
+    sched_fade_pending.store(PLAYSCHEDULE_NONE,std::memory_order_release);
+    return;
+  }
+  sched_clock[evt].store(PLAYSCHEDULE_NONE,std::memory_order_release);
+}
+
+
+void PlaySchedule::cancelAll()
+{
+  for(int i=0;i<PlaySchedule::LastEvent;i++) {
+    cancel((PlaySchedule::Event)i);
+  }
+}
+
+
+bool PlaySchedule::isScheduled(Event evt) const
+{
+  if(evt==PlaySchedule::Fade) {
+    return sched_fade_pending.load(std::memory_order_acquire)!=
+      PLAYSCHEDULE_NONE;
+  }
+  return sched_clock[evt].load(std::memory_order_acquire)!=PLAYSCHEDULE_NONE;
+}
+
+
+bool PlaySchedule::take(Event evt,uint64_t clock,unsigned frames,
+			unsigned *offset)
+{
+  //
+  // Claim the request if it falls due in the period of 'frames' frames
+  // starting at 'clock', returning its position within the period
+  //
+  if(evt==PlaySchedule::Fade) {
+    return TakeFade(clock,frames,offset);
+  }
+  uint64_t when=sched_clock[evt].load(std::memory_order_acquire);
+
+  if((when==PLAYSCHEDULE_NONE)||(when>=(clock+frames))) {
+    return false;
+  }
+  if(!sched_clock[evt].compare_exchange_strong(when,PLAYSCHEDULE_NONE,
+					       std::memory_order_acquire)) {
+    return false;
+  }
+  if(when<clock) {
+    *offset=0;
+  }
+  else {
+    *offset=when-clock;
+  }
+  return true;
+}
+
+
+void PlaySchedule::fadeParameters(int *port,int *from_level,int *to_level,
+				  unsigned *frames) const
+{
+  uint64_t fade=sched_fade_taken;
+
+  *port=(fade>>56)&0xFF;
+  *from_level=(int16_t)((fade>>40)&0xFFFF);
+  *to_level=(int16_t)((fade>>24)&0xFFFF);
+  *frames=fade&PLAYSCHEDULE_MAX_FADE_LENGTH;
+}
+
+
+void PlaySchedule::PublishFade(uint64_t clock,uint64_t fade)
+{
+  //
+  // Only the slot that isn't pending is ever written, so a take() whose
+  // claim succeeds has read a slot that was left alone throughout
+  //
+  uint64_t pending=sched_fade_pending.load(std::memory_order_relaxed);
+  int slot=0;
+
+  if((pending!=PLAYSCHEDULE_NONE)&&((pending&1)==0)) {
+    slot=1;
+  }
+  sched_fade_clock[slot].store(clock,std::memory_order_relaxed);
+  sched_fade_params[slot].store(fade,std::memory_order_relaxed);
+  sched_fade_last=fade;
+  sched_fade_pending.store((++sched_fade_generation<<1)|slot,
+			   std::memory_order_release);
+}
+
+
+bool PlaySchedule::TakeFade(uint64_t clock,unsigned frames,unsigned *offset)
+{
+  uint64_t pending=sched_fade_pending.load(std::memory_order_acquire);
+
+  if(pending==PLAYSCHEDULE_NONE) {
+    return false;
+  }
+  uint64_t when=sched_fade_clock[pending&1].load(std::memory_order_relaxed);
+  uint64_t fade=sched_fade_params[pending&1].load(std::memory_order_relaxed);
+  if(when>=(clock+frames)) {
+    return false;
+  }
+
+  //
+  // If the request is still the one that was read then the frame and
+  // parameters belong together
+  //
+  if(!sched_fade_pending.compare_exchange_strong(pending,PLAYSCHEDULE_NONE,
+						 std::memory_order_acquire)) {
+    return false;
+  }
+  sched_fade_taken=fade;
+  if(when<clock) {
+    *offset=0;
+  }
+  else {
+    *offset=when-clock;
+  }
+  return true;
+}
@@ -0,0 +1,86 @@
+// playschedule.h
+//
+// Sample clock scheduled transitions for caed(8) playout streams.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef PLAYSCHEDULE_H
+#define PLAYSCHEDULE_H
+
+#include <stdint.h>
+
+#include <atomic>
+
+#define PLAYSCHEDULE_NONE UINT64_MAX
+
+//
+// Transitions are scheduled from the main thread against the card's
+// sample clock (the number of frames the audio callback has processed
+// since the driver was started) and then carried out by the callback
+// itself, in the period that contains the requested frame.  Requests for
+// a frame that has already gone by are carried out at the start of the
+// next period.
+//
+// There is at most one pending request of each type; scheduling another
+// one replaces it. The parameters returned by fadeParameters() are those
+// of the fade most recently claimed by take().
+//
+class PlaySchedule
+{
+ public:
+  enum Event {Play=0,Stop=1,Fade=2,LastEvent=3};
+  PlaySchedule();
+
+  //
+  // Main thread
+  //
+  void schedule(Event evt,uint64_t clock);
+  void scheduleFade(uint64_t clock,int port,int from_level,int to_level,
+		    unsigned frames);
+  void cancel(Event evt);
+  void cancelAll();
+  bool isScheduled(Event evt) const;
+
+  //
+  // Audio callback
+  //
+  bool take(Event evt,uint64_t clock,unsigned frames,unsigned *offset);
+  void fadeParameters(int *port,int *from_level,int *to_level,
+		      unsigned *frames) const;
+
+ private:
+  void PublishFade(uint64_t clock,uint64_t fade);
+  bool TakeFade(uint64_t clock,unsigned frames,unsigned *offset);
+  std::atomic<uint64_t> sched_clock[PlaySchedule::LastEvent];
+
+  //
+  // A fade's frame and parameters have to be claimed together, so fades
+  // are double buffered rather than kept in 'sched_clock'. The main thread
+  // fills whichever slot isn't pending and then publishes it in
+  // 'sched_fade_pending' as (generation<<1)|slot, so that the callback can
+  // tell if the request changed while it was reading it.
+  //
+  std::atomic<uint64_t> sched_fade_clock[2];
+  std::atomic<uint64_t> sched_fade_params[2];
+  std::atomic<uint64_t> sched_fade_pending;
+  uint64_t sched_fade_generation;  // Main thread only
+  uint64_t sched_fade_last;        // Main thread only
+  uint64_t sched_fade_taken;       // Audio callback only
+};
+
+
+#endif  // PLAYSCHEDULE_H
@@ -0,0 +1,353 @@
+// readerpool.cpp
+//
+// Pool of disk reader/decoder threads for caed(8) drivers.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+
+#include "driver.h"
+#include "readerpool.h"
+
+ReaderBuffer::ReaderBuffer(unsigned size)
+{
+  samples=new float[size];
+}
+
+
+ReaderBuffer::~ReaderBuffer()
+{
+  delete[] samples;
+}
+
+
+
+
+ReaderPool::ReaderPool(Driver *dvr,int threads,int ts_threads,int streams,
+		       unsigned bufsize)
+{
+  pthread_t thread;
+  pthread_attr_t pthread_attr;
+
+  pool_driver=dvr;
+  pool_exiting=false;
+  pool_buffer_size=bufsize;
+  pool_streams=streams;
+  pool_main_buffer=new ReaderBuffer(pool_buffer_size);
+  for(int i=0;i<RD_MAX_CARDS;i++) {
+    pool_locks[i]=NULL;
+    pool_pending[i]=NULL;
+    pool_timescaled[i]=NULL;
+    pool_cpu_time[i]=NULL;
+    if(pool_driver->hasCard(i)) {
+      addCard(i);
+    }
+  }
+  sem_init(&pool_wakeup,0,0);
+  sem_init(&pool_timescale_wakeup,0,0);
+
+  pthread_attr_init(&pthread_attr);
+  for(int i=0;i<threads;i++) {
+    if(pthread_create(&thread,&pthread_attr,ThreadCallback,this)==0) {
+      pool_threads.push_back(thread);
+    }
+    else {
+      rda->syslog(LOG_WARNING,"unable to start reader thread %d",i);
+    }
+  }
+  for(int i=0;i<ts_threads;i++) {
+    if(pthread_create(&thread,&pthread_attr,TimescaleThreadCallback,
+		      this)==0) {
+      pool_timescale_threads.push_back(thread);
+    }
+    else {
+      rda->syslog(LOG_WARNING,"unable to start timescale thread %d",i);
+    }
+  }
+  pthread_attr_destroy(&pthread_attr);
+}
+
+
+ReaderPool::~ReaderPool()
+{
+  pool_exiting=true;
+  for(int i=0;i<pool_threads.size();i++) {
+    sem_post(&pool_wakeup);
+  }
+  for(int i=0;i<pool_timescale_threads.size();i++) {
+    sem_post(&pool_timescale_wakeup);
+  }
+  for(int i=0;i<pool_threads.size();i++) {
+    pthread_join(pool_threads.at(i),NULL);
+  }
+  for(int i=0;i<pool_timescale_threads.size();i++) {
+    pthread_join(pool_timescale_threads.at(i),NULL);
+  }
+  sem_destroy(&pool_wakeup);
+  sem_destroy(&pool_timescale_wakeup);
+  for(int i=0;i<RD_MAX_CARDS;i++) {
+    if(pool_locks[i]!=NULL) {
+      for(int j=0;j<pool_streams;j++) {
+	pthread_mutex_destroy(&pool_locks[i][j]);
+      }
+      delete[] pool_locks[i];
+      delete[] pool_pending[i];
+      delete[] pool_timescaled[i];
+      delete[] pool_cpu_time[i];
+    }
+  }
+  delete pool_main_buffer;
+}
+
+
+void ReaderPool::addCard(int card)
+{
+  //
+  // Per-stream state is only allocated for cards that actually exist.
+  // Must be called before the card is visible through Driver::hasCard().
+  //
+  if(pool_locks[card]!=NULL) {
+    return;
+  }
+  pool_pending[card]=new std::atomic<bool>[pool_streams];
+  pool_timescaled[card]=new std::atomic<bool>[pool_streams];
+  pool_cpu_time[card]=new std::atomic<uint64_t>[pool_streams];
+  pool_locks[card]=new pthread_mutex_t[pool_streams];
+  for(int i=0;i<pool_streams;i++) {
+    pthread_mutex_init(&pool_locks[card][i],NULL);
+    pool_pending[card][i]=false;
+    pool_timescaled[card][i]=false;
+    pool_cpu_time[card][i]=0;
+  }
+}
+
+
+int ReaderPool::threadQuantity() const
+{
+  return pool_threads.size();
+}
+
+
+int ReaderPool::timescaleThreadQuantity() const
+{
+  return pool_timescale_threads.size();
+}
+
+
+void ReaderPool::lock(int card,int stream)
+{
+  pthread_mutex_lock(&pool_locks[card][stream]);
+}
+
+
+void ReaderPool::unlock(int card,int stream)
+{
+  pthread_mutex_unlock(&pool_locks[card][stream]);
+}
+
+
+void ReaderPool::requestFill(int card,int stream)
+{
+  //
+  // Called from the audio callbacks, so must never block
+  //
+  if(!pool_pending[card][stream].exchange(true)) {
+    if(pool_timescaled[card][stream]) {
+      sem_post(&pool_timescale_wakeup);
+    }
+    else {
+      sem_post(&pool_wakeup);
+    }
+  }
+}
+
+
+void ReaderPool::fill(int card,int stream)
+{
+  //
+  // Synchronous refill from the main thread (e.g. at load time)
+  //
+  lock(card,stream);
+  FillStream(card,stream,pool_main_buffer);
+  unlock(card,stream);
+}
+
+
+void ReaderPool::waitFill(int card,int stream)
+{
+  //
+  // Make sure that any outstanding refill (e.g. the preroll queued at load
+  // time) has completed. If no reader thread has picked it up yet, do it
+  // here rather than wait for one. A reader thread only clears the request
+  // while holding the stream lock, so if it is already gone then taking
+  // the lock waits out the refill in progress.
+  //
+  if(pool_pending[card][stream].exchange(false)) {
+    fill(card,stream);
+  }
+  else {
+    lock(card,stream);
+    unlock(card,stream);
+  }
+}
+
+
+bool ReaderPool::isTimescaled(int card,int stream) const
+{
+  return pool_timescaled[card][stream];
+}
+
+
+void ReaderPool::setTimescaled(int card,int stream,bool state)
+{
+  //
+  // Timescaled streams are refilled by their own set of threads, so that
+  // the (much more expensive) time stretching cannot hold off refills of
+  // the other streams.
+  //
+  if(pool_timescale_threads.size()==0) {
+    return;
+  }
+  if(pool_timescaled[card][stream].exchange(state)!=state) {
+    if(pool_pending[card][stream]) {
+      //
+      // A refill may have been queued for the other set of threads, so
+      // wake both of them up rather than leave it stranded
+      //
+      sem_post(&pool_wakeup);
+      sem_post(&pool_timescale_wakeup);
+    }
+  }
+}
+
+
+uint64_t ReaderPool::cpuTime(int card,int stream) const
+{
+  //
+  // Returns the CPU time (in nS) spent refilling the stream since the
+  // last call to resetCpuTime()
+  //
+  return pool_cpu_time[card][stream];
+}
+
+
+void ReaderPool::resetCpuTime(int card,int stream)
+{
+  pool_cpu_time[card][stream]=0;
+}
+
+
+void *ReaderPool::ThreadCallback(void *ptr)
+{
+  ReaderPool *pool=(ReaderPool *)ptr;
+
+  pool->Run(&pool->pool_wakeup,false);
+
+  return NULL;
+}
+
+
+void *ReaderPool::TimescaleThreadCallback(void *ptr)
+{
+  ReaderPool *pool=(ReaderPool *)ptr;
+
+  pool->Run(&pool->pool_timescale_wakeup,true);
+
+  return NULL;
+}
+
+
+void ReaderPool::Run(sem_t *wakeup,bool timescaled)
+{
+  ReaderBuffer *buf=new ReaderBuffer(pool_buffer_size);
+  struct sched_param sched_params;
+
+  //
+  // Reader threads run just above the main thread so that refills are
+  // never held off by command processing.  Timescale threads run one step
+  // lower, so that they can never preempt a plain refill.
+  //
+  if(rda->config()->useRealtime()) {
+    memset(&sched_params,0,sizeof(sched_params));
+    sched_params.sched_priority=rda->config()->realtimePriority();
+    if(timescaled&&
+       (sched_params.sched_priority>sched_get_priority_min(SCHED_FIFO))) {
+      sched_params.sched_priority--;
+    }
+    int r=pthread_setschedparam(pthread_self(),SCHED_FIFO,&sched_params);
+    if(r) {
+      rda->syslog(LOG_WARNING,
+		  "unable to set realtime scheduling for %s thread: %s",
+		  timescaled ? "timescale" : "reader",strerror(r));
+    }
+  }
+
+  while(!pool_exiting) {
+    if(sem_wait(wakeup)!=0) {
+      if(errno!=EINTR) {
+	break;
+      }
+      continue;
+    }
+    if(!pool_exiting) {
+      Service(buf,timescaled);
+    }
+  }
+  delete buf;
+}
+
+
+void ReaderPool::Service(ReaderBuffer *buf,bool timescaled)
+{
+  for(int i=0;i<RD_MAX_CARDS;i++) {
+    if(pool_driver->hasCard(i)) {
+      for(int j=0;j<pool_streams;j++) {
+	//
+	// The request is only claimed with the stream locked, so that
+	// waitFill() either finds it still pending or blocks until the
+	// refill is done
+	//
+	if((pool_timescaled[i][j]==timescaled)&&pool_pending[i][j]) {
+	  lock(i,j);
+	  if(pool_pending[i][j].exchange(false)) {
+	    FillStream(i,j,buf);
+	  }
+	  unlock(i,j);
+	}
+      }
+    }
+  }
+}
+
+
+void ReaderPool::FillStream(int card,int stream,ReaderBuffer *buf)
+{
+  struct timespec start;
+  struct timespec end;
+  uint64_t wall=StreamStats::now();
+
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID,&start);
+  pool_driver->fillStream(card,stream,buf);
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID,&end);
+  pool_cpu_time[card][stream]+=
+    (uint64_t)(end.tv_sec-start.tv_sec)*1000000000+
+    end.tv_nsec-start.tv_nsec;
+  pool_driver->streamStats(card,stream)->addRefill(StreamStats::now()-wall);
+}
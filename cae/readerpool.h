@@ -0,0 +1,89 @@
+// readerpool.h
+//
+// Pool of disk reader/decoder threads for caed(8) drivers.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef READERPOOL_H
+#define READERPOOL_H
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include <QList>
+
+#include <rd.h>
+
+class Driver;
+
+//
+// Scratch space used by a single reader thread while refilling a stream.
+//
+class ReaderBuffer
+{
+ public:
+  ReaderBuffer(unsigned size);
+  ~ReaderBuffer();
+  float *samples;
+};
+
+
+class ReaderPool
+{
+ public:
+  ReaderPool(Driver *dvr,int threads,int ts_threads,int streams,
+	     unsigned bufsize);
+  ~ReaderPool();
+  void addCard(int card);
+  int threadQuantity() const;
+  int timescaleThreadQuantity() const;
+  void lock(int card,int stream);
+  void unlock(int card,int stream);
+  void requestFill(int card,int stream);
+  void fill(int card,int stream);
+  void waitFill(int card,int stream);
+  bool isTimescaled(int card,int stream) const;
+  void setTimescaled(int card,int stream,bool state);
+  uint64_t cpuTime(int card,int stream) const;
+  void resetCpuTime(int card,int stream);
+
+ private:
+  static void *ThreadCallback(void *ptr);
+  static void *TimescaleThreadCallback(void *ptr);
+  void Run(sem_t *wakeup,bool timescaled);
+  void Service(ReaderBuffer *buf,bool timescaled);
+  void FillStream(int card,int stream,ReaderBuffer *buf);
+  Driver *pool_driver;
+  QList<pthread_t> pool_threads;
+  QList<pthread_t> pool_timescale_threads;
+  ReaderBuffer *pool_main_buffer;
+  unsigned pool_buffer_size;
+  int pool_streams;
+  pthread_mutex_t *pool_locks[RD_MAX_CARDS];
+  std::atomic<bool> *pool_pending[RD_MAX_CARDS];
+  std::atomic<bool> *pool_timescaled[RD_MAX_CARDS];
+  std::atomic<uint64_t> *pool_cpu_time[RD_MAX_CARDS];
+  sem_t pool_wakeup;
+  sem_t pool_timescale_wakeup;
+  volatile bool pool_exiting;
+};
+
+
+#endif  // READERPOOL_H
@@ -0,0 +1,190 @@
+// recorddeck.cpp
+//
+// Encoder thread for a caed(8) record deck.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+
+#include <rdapplication.h>
+
+#include "mixbus.h"
+#include "recorddeck.h"
+
+RecordDeck::RecordDeck(CaeEncoder *enc,RDSpscRing *ring,SampleFormat fmt)
+{
+  pthread_attr_t pthread_attr;
+  struct sched_param sched_params;
+
+  deck_encoder=enc;
+  deck_ring=ring;
+  deck_format=fmt;
+  deck_frame_size=enc->channels()*sizeof(float);
+  if(deck_format==RecordDeck::S16) {
+    deck_frame_size=enc->channels()*sizeof(int16_t);
+  }
+  deck_pcm=new float[RECORDDECK_BLOCK_FRAMES*enc->channels()];
+  deck_s16=new int16_t[RECORDDECK_BLOCK_FRAMES*enc->channels()];
+  deck_pending=false;
+  deck_dropped=0;
+  deck_exiting=false;
+  sem_init(&deck_wakeup,0,0);
+
+  //
+  // Don't inherit the (possibly realtime) policy of the calling thread
+  //
+  memset(&sched_params,0,sizeof(sched_params));
+  pthread_attr_init(&pthread_attr);
+  pthread_attr_setinheritsched(&pthread_attr,PTHREAD_EXPLICIT_SCHED);
+  pthread_attr_setschedpolicy(&pthread_attr,SCHED_OTHER);
+  pthread_attr_setschedparam(&pthread_attr,&sched_params);
+  deck_running=
+    pthread_create(&deck_thread,&pthread_attr,ThreadCallback,this)==0;
+  if(!deck_running) {
+    rda->syslog(LOG_WARNING,"unable to start encoder thread");
+  }
+  pthread_attr_destroy(&pthread_attr);
+}
+
+
+RecordDeck::~RecordDeck()
+{
+  finish();
+  sem_destroy(&deck_wakeup);
+  delete[] deck_s16;
+  delete[] deck_pcm;
+  delete deck_encoder;
+}
+
+
+CaeEncoder *RecordDeck::encoder() const
+{
+  return deck_encoder;
+}
+
+
+unsigned RecordDeck::capture(const void *data,unsigned frames)
+{
+  //
+  // Called from the audio callbacks.  When the ring is short of space,
+  // write only as many whole frames as will fit and drop the rest; a
+  // partial frame would shift the channels of every frame after it.
+  // Returns the number of frames written.
+  //
+  unsigned space=deck_ring->writeSpace()/deck_frame_size;
+
+  if(frames>space) {
+    deck_dropped.fetch_add(frames-space,std::memory_order_relaxed);
+    frames=space;
+  }
+  if(frames>0) {
+    deck_ring->write((const char *)data,frames*deck_frame_size);
+  }
+  requestDrain();
+
+  return frames;
+}
+
+
+void RecordDeck::requestDrain()
+{
+  //
+  // Called from the audio callbacks, so must never block
+  //
+  if(!deck_pending.exchange(true)) {
+    sem_post(&deck_wakeup);
+  }
+}
+
+
+unsigned RecordDeck::droppedFrames() const
+{
+  return deck_dropped.load(std::memory_order_relaxed);
+}
+
+
+unsigned RecordDeck::finish()
+{
+  //
+  // Stop the thread, then encode whatever is left in the ring and flush
+  // the encoder.  Returns the total number of frames encoded.
+  //
+  if(!deck_exiting) {
+    deck_exiting=true;
+    if(deck_running) {
+      sem_post(&deck_wakeup);
+      pthread_join(deck_thread,NULL);
+      deck_running=false;
+    }
+    Drain();
+    deck_encoder->finish();
+    if(droppedFrames()>0) {
+      rda->syslog(LOG_WARNING,
+		  "record ring overrun, %u frames dropped",droppedFrames());
+    }
+  }
+  return deck_encoder->framesEncoded();
+}
+
+
+void *RecordDeck::ThreadCallback(void *ptr)
+{
+  RecordDeck *deck=(RecordDeck *)ptr;
+
+  deck->Run();
+
+  return NULL;
+}
+
+
+void RecordDeck::Run()
+{
+  while(!deck_exiting) {
+    if(sem_wait(&deck_wakeup)!=0) {
+      if(errno!=EINTR) {
+	break;
+      }
+      continue;
+    }
+    deck_pending=false;
+    Drain();
+  }
+}
+
+
+void RecordDeck::Drain()
+{
+  unsigned frames=0;
+  unsigned samples=0;
+
+  while((frames=deck_ring->readSpace()/deck_frame_size)>0) {
+    if(frames>RECORDDECK_BLOCK_FRAMES) {
+      frames=RECORDDECK_BLOCK_FRAMES;
+    }
+    samples=frames*deck_encoder->channels();
+    if(deck_format==RecordDeck::S16) {
+      deck_ring->read((char *)deck_s16,frames*deck_frame_size);
+      MixBusS16ToFloat(deck_pcm,deck_s16,samples);
+    }
+    else {
+      deck_ring->read((char *)deck_pcm,frames*deck_frame_size);
+    }
+    deck_encoder->encode(deck_pcm,frames);
+  }
+}
@@ -0,0 +1,77 @@
+// recorddeck.h
+//
+// Encoder thread for a caed(8) record deck.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef RECORDDECK_H
+#define RECORDDECK_H
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include <rdspscring.h>
+
+#include "encoder.h"
+
+#define RECORDDECK_BLOCK_FRAMES 4096
+
+//
+// Drains a capture ring into an encoder from a thread of its own, so that
+// neither the audio callbacks nor the main thread ever wait on an encoder
+// or on the disk.  The thread runs at normal (non-realtime) priority, so
+// that a slow encode can never hold off playout.
+//
+// The deck takes ownership of the encoder, but not of the ring, which
+// must outlive the call to finish().  Writers should fill the ring only
+// through capture(), which never splits a frame.
+//
+class RecordDeck
+{
+ public:
+  enum SampleFormat {Float32=0,S16=1};
+  RecordDeck(CaeEncoder *enc,RDSpscRing *ring,SampleFormat fmt);
+  ~RecordDeck();
+  CaeEncoder *encoder() const;
+  unsigned capture(const void *data,unsigned frames);
+  void requestDrain();
+  unsigned droppedFrames() const;
+  unsigned finish();
+
+ private:
+  static void *ThreadCallback(void *ptr);
+  void Run();
+  void Drain();
+  CaeEncoder *deck_encoder;
+  RDSpscRing *deck_ring;
+  SampleFormat deck_format;
+  unsigned deck_frame_size;
+  float *deck_pcm;
+  int16_t *deck_s16;
+  pthread_t deck_thread;
+  bool deck_running;
+  sem_t deck_wakeup;
+  std::atomic<bool> deck_pending;
+  std::atomic<unsigned> deck_dropped;
+  volatile bool deck_exiting;
+};
+
+
+#endif  // RECORDDECK_H
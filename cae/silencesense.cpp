@@ -0,0 +1,83 @@
+// silencesense.cpp
+//
+// Dead air detector for caed(8) output ports.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include <math.h>
+
+#include "silencesense.h"
+
+SilenceSense::SilenceSense()
+{
+  sense_enabled=false;
+  sense_threshold=0.0;
+  sense_release=0.0;
+  sense_duration=0;
+  sense_silent=false;
+  sense_frames=0;
+}
+
+
+void SilenceSense::setParameters(int threshold,unsigned duration_frames,
+				 int hysteresis)
+{
+  //
+  // The callback compares against linear peaks, so do the conversion once
+  // here
+  //
+  sense_threshold=(float)pow(10.0,(double)threshold/2000.0);
+  sense_release=(float)pow(10.0,(double)(threshold+hysteresis)/2000.0);
+  sense_duration=duration_frames;
+  sense_enabled=true;
+}
+
+
+bool SilenceSense::isEnabled() const
+{
+  return sense_enabled;
+}
+
+
+bool SilenceSense::isSilent() const
+{
+  return sense_silent;
+}
+
+
+void SilenceSense::update(float peak,unsigned frames)
+{
+  if(!sense_enabled) {
+    return;
+  }
+  if(sense_silent) {
+    if(peak>sense_release) {
+      sense_silent=false;
+      sense_frames=0;
+    }
+    return;
+  }
+  if(peak<sense_threshold) {
+    sense_frames+=frames;
+    if(sense_frames>=sense_duration) {
+      sense_silent=true;
+    }
+  }
+  else {
+    sense_frames=0;
+  }
+}
@@ -0,0 +1,71 @@
+// silencesense.h
+//
+// Dead air detector for caed(8) output ports.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef SILENCESENSE_H
+#define SILENCESENSE_H
+
+#include <atomic>
+
+//
+// Defaults for the [SilenceSense] entries in rd.conf(5)
+//
+#define SILENCESENSE_DEFAULT_THRESHOLD -5000
+#define SILENCESENSE_DEFAULT_DURATION 10000
+#define SILENCESENSE_DEFAULT_HYSTERESIS 300
+
+//
+// Watches the peak level of an output port for dead air.  The audio
+// callback feeds it the peak of each period, as already calculated for
+// the output meters, with update().  Once the level has stayed below the
+// threshold for the set duration the port is considered silent, and it
+// remains so until the level comes back above the threshold plus the
+// hysteresis.  The main thread polls the result with isSilent().
+//
+// Levels are in 1/100 dBFS, as used throughout caed.  Detection is off
+// until setParameters() is called.
+//
+class SilenceSense
+{
+ public:
+  SilenceSense();
+
+  //
+  // Main thread
+  //
+  void setParameters(int threshold,unsigned duration_frames,int hysteresis);
+  bool isEnabled() const;
+  bool isSilent() const;
+
+  //
+  // Audio callback
+  //
+  void update(float peak,unsigned frames);
+
+ private:
+  std::atomic<bool> sense_enabled;
+  std::atomic<float> sense_threshold;
+  std::atomic<float> sense_release;
+  std::atomic<unsigned> sense_duration;
+  std::atomic<bool> sense_silent;
+  unsigned sense_frames;
+};
+
+
+#endif  // SILENCESENSE_H
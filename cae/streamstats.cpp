@@ -0,0 +1,174 @@
+// streamstats.cpp
+//
+// Playout stream instrumentation for caed(8).
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include <time.h>
+
+#include "streamstats.h"
+
+//
+// Fill levels are kept in frames and times in nS.  The accessors return
+// fill levels in mS and times in uS, or -1 if nothing has been measured.
+//
+#define STREAMSTATS_NONE UINT64_MAX
+
+StreamStats::StreamStats()
+{
+  reset(0);
+}
+
+
+void StreamStats::reset(unsigned samprate)
+{
+  stats_samprate=samprate;
+  stats_underruns=0;
+  stats_fill_low=UINT32_MAX;
+  stats_fill_high=0;
+  stats_refills=0;
+  stats_refill_total=0;
+  stats_refill_max=0;
+  stats_latency_start=0;
+  stats_latency=STREAMSTATS_NONE;
+}
+
+
+void StreamStats::startLatency()
+{
+  //
+  // Mark the arrival of a play command; the callback completes the
+  // measurement when it mixes the first frame of the stream
+  //
+  stats_latency_start.store(now(),std::memory_order_release);
+}
+
+
+unsigned StreamStats::underruns() const
+{
+  return stats_underruns;
+}
+
+
+int StreamStats::fillLow() const
+{
+  if((stats_samprate==0)||(stats_fill_low==UINT32_MAX)) {
+    return -1;
+  }
+  return (int)((uint64_t)stats_fill_low*1000/stats_samprate);
+}
+
+
+int StreamStats::fillHigh() const
+{
+  if((stats_samprate==0)||(stats_fill_low==UINT32_MAX)) {
+    return -1;
+  }
+  return (int)((uint64_t)stats_fill_high*1000/stats_samprate);
+}
+
+
+unsigned StreamStats::refills() const
+{
+  return stats_refills;
+}
+
+
+int StreamStats::refillAverage() const
+{
+  unsigned refills=stats_refills;
+
+  if(refills==0) {
+    return -1;
+  }
+  return (int)(stats_refill_total/(1000*(uint64_t)refills));
+}
+
+
+int StreamStats::refillMax() const
+{
+  if(stats_refills==0) {
+    return -1;
+  }
+  return (int)(stats_refill_max/1000);
+}
+
+
+int StreamStats::latency() const
+{
+  uint64_t lat=stats_latency;
+
+  if(lat==STREAMSTATS_NONE) {
+    return -1;
+  }
+  return (int)(lat/1000);
+}
+
+
+void StreamStats::updateFill(unsigned frames)
+{
+  //
+  // Only the callback writes these, so no compare-and-swap is needed
+  //
+  if(frames<stats_fill_low.load(std::memory_order_relaxed)) {
+    stats_fill_low.store(frames,std::memory_order_relaxed);
+  }
+  if(frames>stats_fill_high.load(std::memory_order_relaxed)) {
+    stats_fill_high.store(frames,std::memory_order_relaxed);
+  }
+}
+
+
+void StreamStats::addUnderrun()
+{
+  stats_underruns.fetch_add(1,std::memory_order_relaxed);
+}
+
+
+void StreamStats::markFirstSample()
+{
+  uint64_t start=stats_latency_start.load(std::memory_order_acquire);
+
+  if((start!=0)&&
+     stats_latency_start.compare_exchange_strong(start,0,
+						 std::memory_order_relaxed)) {
+    stats_latency.store(now()-start,std::memory_order_relaxed);
+  }
+}
+
+
+void StreamStats::addRefill(uint64_t nsecs)
+{
+  uint64_t max=stats_refill_max.load(std::memory_order_relaxed);
+
+  stats_refills.fetch_add(1,std::memory_order_relaxed);
+  stats_refill_total.fetch_add(nsecs,std::memory_order_relaxed);
+  while((nsecs>max)&&
+	(!stats_refill_max.compare_exchange_weak(max,nsecs,
+						 std::memory_order_relaxed))) {
+  }
+}
+
+
+uint64_t StreamStats::now()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+
+  return (uint64_t)ts.tv_sec*1000000000+ts.tv_nsec;
+}
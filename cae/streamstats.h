@@ -0,0 +1,80 @@
+// streamstats.h
+//
+// Playout stream instrumentation for caed(8).
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef STREAMSTATS_H
+#define STREAMSTATS_H
+
+#include <stdint.h>
+
+#include <atomic>
+
+//
+// Counters for a single playout stream, updated from the audio callback
+// (ring fill level, underruns, first sample) and the reader threads
+// (refill times) and read back from the main thread.  Everything is kept
+// since the last call to reset(), which the drivers make when a stream
+// is loaded.
+//
+class StreamStats
+{
+ public:
+  StreamStats();
+
+  //
+  // Main thread
+  //
+  void reset(unsigned samprate);
+  void startLatency();
+  unsigned underruns() const;
+  int fillLow() const;
+  int fillHigh() const;
+  unsigned refills() const;
+  int refillAverage() const;
+  int refillMax() const;
+  int latency() const;
+
+  //
+  // Audio callback
+  //
+  void updateFill(unsigned frames);
+  void addUnderrun();
+  void markFirstSample();
+
+  //
+  // Reader threads
+  //
+  void addRefill(uint64_t nsecs);
+
+  static uint64_t now();
+
+ private:
+  std::atomic<unsigned> stats_samprate;
+  std::atomic<unsigned> stats_underruns;
+  std::atomic<unsigned> stats_fill_low;
+  std::atomic<unsigned> stats_fill_high;
+  std::atomic<unsigned> stats_refills;
+  std::atomic<uint64_t> stats_refill_total;
+  std::atomic<uint64_t> stats_refill_max;
+  std::atomic<uint64_t> stats_latency_start;
+  std::atomic<uint64_t> stats_latency;
+};
+
+
+#endif  // STREAMSTATS_H
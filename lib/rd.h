@@ -87,18 +87,18 @@
  */
 #define RD_ALSA_DEFAULT_PERIOD_QUANTITY 4
 #define RD_ALSA_DEFAULT_PERIOD_SIZE 1024
-#define RD_ALSA_FADE_INTERVAL 100
 #define RD_ALSA_SAMPLE_RATE_TOLERANCE 100
 
 /*
- * Date Limits
+ * Null Driver Settings
  */
-#define RD_MAX_YEAR 8000
+#define RD_NULL_DEFAULT_PORTS 8
+#define RD_NULL_DEFAULT_PERIOD_SIZE 1024
 
 /*
- * JACK Settings
+ * Date Limits
  */
-#define RD_JACK_FADE_INTERVAL 100
+#define RD_MAX_YEAR 8000
 
 /*
  * RIPCD TCP Port
@@ -110,6 +110,15 @@
  */
 #define CAED_TCP_PORT 5005
 
+/*
+ * CAED Settings
+ */
+#define RD_CAE_DEFAULT_READER_THREADS 2
+#define RD_CAE_DEFAULT_TIMESCALE_THREADS 1
+#define RD_CAE_DEFAULT_PREROLL_LENGTH 3000
+#define RD_CAE_DEFAULT_STATISTICS_INTERVAL 300
+#define RD_CAE_DEFAULT_MAX_STREAMS RD_MAX_STREAMS
+
 /*
  * RdCatchd TCP Port
  */
@@ -140,6 +149,12 @@
  */
 #define RD_MAX_STREAMS 48
 
+/*
+ * Hard ceiling for the caed(8) [Caed] MaxStreams setting.  Stream counts
+ * travel as a single byte in meter frames, so this can be no more than 255.
+ */
+#define RD_MAX_CAE_STREAMS 255
+
 /*
  * Max number of possible audio ports/card/type
  */
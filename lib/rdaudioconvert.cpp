@@ -36,7 +36,7 @@
 #include <rdcart.h>
 #include <rdconf.h>
 #include <rd.h>
-#include <rdtempdirectory.h>
+#include <rdpeakscan.h>
 
 #include <sndfile.h>
 #include <samplerate.h>
@@ -61,6 +61,21 @@
 
 #define STAGE2_XFER_SIZE 2048
 #define STAGE2_BUFFER_SIZE 49152
+#define STAGE3_XFER_SIZE 1152
+
+static int32_t ClipSample(float sample,int32_t scale)
+{
+  long ret=lrintf(sample*(float)scale);
+
+  if(ret>=scale) {
+    return scale-1;
+  }
+  if(ret<-scale) {
+    return -scale;
+  }
+  return ret;
+}
+
 
 RDAudioConvert::RDAudioConvert(QObject *parent)
   : QObject(parent)
@@ -69,6 +84,38 @@ RDAudioConvert::RDAudioConvert(QObject *parent)
   conv_end_point=-1;
   conv_speed_ratio=1.0;
   conv_peak_sample=0.0;
+  conv_measuring=false;
+  conv_measured=false;
+  conv_cancelled=false;
+  conv_progress=0;
+  conv_in_frames=0;
+  conv_in_length=0;
+  conv_stream_err=RDAudioConvert::ErrorOk;
+  conv_in_channels=0;
+  conv_in_samplerate=0;
+  conv_gain_ratio=1.0;
+  conv_src_state=NULL;
+  conv_st_conv=NULL;
+  for(int i=0;i<3;i++) {
+    conv_pcm[i]=NULL;
+  }
+  conv_pcm_frames=0;
+  conv_out_active=false;
+  conv_out_channels=0;
+  conv_out_samplerate=0;
+  conv_out_frames=0;
+  conv_out_fd=-1;
+  conv_out_wave=NULL;
+  conv_out_pcm=NULL;
+#ifdef HAVE_TWOLAME
+  conv_twolame_opts=NULL;
+#endif  // HAVE_TWOLAME
+#ifdef HAVE_LAME
+  conv_lame_opts=NULL;
+#endif  // HAVE_LAME
+#ifdef HAVE_FLAC
+  conv_flac_encoder=NULL;
+#endif  // HAVE_FLAC
   conv_settings=NULL;
   conv_src_wavedata=new RDWaveData();
   conv_dst_wavedata=NULL;
@@ -148,9 +195,6 @@ void RDAudioConvert::setSpeedRatio(float ratio)
 RDAudioConvert::ErrorCode RDAudioConvert::convert()
 {
   RDAudioConvert::ErrorCode err;
-  QString tmpfile1;
-  QString tmpfile2;
-  RDTempDirectory *temp_dir=NULL;
 
   //
   // Make sure we're all set to go...
@@ -174,52 +218,62 @@ RDAudioConvert::ErrorCode RDAudioConvert::convert()
   }
 
   //
-  // Generate Temporary Filenames
-  //
-  temp_dir=new RDTempDirectory("rdaudioconvert");
-  QString err_msg;
-  if(!temp_dir->create(&err_msg)) {
-    delete temp_dir;
-    rda->syslog(LOG_WARNING,"Could not create %s",
-		(const char *)err_msg.toUtf8());
-    return RDAudioConvert::ErrorInternal;
-  }
-  tmpfile1=QString(temp_dir->path())+"/signed32_1.wav";
-  tmpfile2=QString(temp_dir->path())+"/signed32_2.wav";
-
+  // Find the Peak Level for Normalization
   //
-  // Stage One -- Convert Source Format to Signed 32 Bit Integer
+  // The source's own energy data is used if it has any, otherwise we
+  // take a decode-only pass through it to measure the peak.
   //
-  if((err=Stage1Convert(conv_src_filename,tmpfile1))!=
-     RDAudioConvert::ErrorOk) {
-    delete temp_dir;
-    return err;
+  conv_peak_sample=0.0;
+  conv_measured=false;
+  conv_progress=0;
+  if(conv_settings->normalizationLevel()!=0) {
+    if(!ReadEnergyPeak(conv_src_filename)) {
+      conv_measuring=true;
+      err=Stage1Convert(conv_src_filename);
+      conv_measuring=false;
+      conv_measured=true;
+      if(err!=RDAudioConvert::ErrorOk) {
+	return err;
+      }
+    }
   }
 
   //
-  // Stage Two -- Convert Levels, Sample Rate, Channelization, Speed
+  // Convert
+  //
+  // Stage One decodes the source, Stage Two applies levels, sample rate,
+  // channelization and speed and Stage Three encodes the destination
+  // format. Audio is passed between them as blocks of floats, so nothing
+  // but the destination ever gets written to disk.
   //
-  if((err=Stage2Convert(tmpfile1,tmpfile2))!=
-     RDAudioConvert::ErrorOk) {
-    delete temp_dir;
+  if((err=Stage1Convert(conv_src_filename))!=RDAudioConvert::ErrorOk) {
+    AbortPipeline();
     return err;
   }
+  conv_progress=100;
+
+  return RDAudioConvert::ErrorOk;
+}
+
 
+int RDAudioConvert::progress() const
+{
   //
-  // Stage Three -- Write Out Destination Format
+  // Percentage of the source decoded so far. Safe to call from any thread
+  // while convert() is running.
   //
-  if((err=Stage3Convert(tmpfile2,conv_dst_filename))!=
-     RDAudioConvert::ErrorOk) {
-    delete temp_dir;
-    return err;
-  }
+  return conv_progress;
+}
+
 
+void RDAudioConvert::cancel()
+{
   //
-  // Clean Up
+  // Safe to call from any thread. A running convert() returns
+  // ErrorCancelled as soon as the current block is done, after removing
+  // the partial destination file.
   //
-  delete temp_dir;
-
-  return RDAudioConvert::ErrorOk;
+  conv_cancelled=true;
 }
 
 
@@ -281,13 +335,59 @@ QString RDAudioConvert::errorText(RDAudioConvert::ErrorCode err)
   case RDAudioConvert::ErrorNoSpace:
     ret=tr("No space left on device");
     break;
+
+  case RDAudioConvert::ErrorCancelled:
+    ret=tr("Conversion cancelled");
+    break;
   }
   return ret;
 }
 
 
-RDAudioConvert::ErrorCode RDAudioConvert::Stage1Convert(const QString &srcfile,
-							const QString &dstfile)
+bool RDAudioConvert::ReadEnergyPeak(const QString &srcfile)
+{
+  RDWaveFile *wave=new RDWaveFile(srcfile);
+  unsigned chans;
+  unsigned start=0;
+  unsigned end=0;
+  unsigned short level=0;
+
+  if((!wave->openWave())||(wave->getChannels()==0)||(!wave->hasEnergy())) {
+    delete wave;
+    return false;
+  }
+
+  //
+  // There is one energy value per channel for every 1152 frames
+  //
+  chans=wave->getChannels();
+  end=wave->energySize();
+  if(conv_start_point>0) {
+    start=chans*(unsigned)((double)conv_start_point*
+			   (double)wave->getSamplesPerSec()/1152000.0);
+  }
+  if(conv_end_point>=0) {
+    unsigned last=chans*(1+(unsigned)((double)conv_end_point*
+				      (double)wave->getSamplesPerSec()/
+				      1152000.0));
+    if(last<end) {
+      end=last;
+    }
+  }
+  for(unsigned i=start;i<end;i++) {
+    if(wave->energy(i)>level) {
+      level=wave->energy(i);
+    }
+  }
+  conv_peak_sample=(float)level/32768.0;
+  wave->closeWave();
+  delete wave;
+
+  return true;
+}
+
+
+RDAudioConvert::ErrorCode RDAudioConvert::Stage1Convert(const QString &srcfile)
 {
   SNDFILE *sf_src=NULL;
   SF_INFO sf_src_info;
@@ -299,10 +399,11 @@ RDAudioConvert::ErrorCode RDAudioConvert::Stage1Convert(const QString &srcfile,
   //
   wave=new RDWaveFile(srcfile);
   if(wave->openWave(conv_src_wavedata)) {
+    conv_in_length=wave->getSampleLength();
     switch(wave->type()) {
     case RDWaveFile::Wave:
       if(wave->getFormatTag()==WAVE_FORMAT_MPEG) {
-	err=Stage1Mpeg(dstfile,wave);
+	err=Stage1Mpeg(wave);
 	delete wave;
 	return err;
       }
@@ -312,22 +413,22 @@ RDAudioConvert::ErrorCode RDAudioConvert::Stage1Convert(const QString &srcfile,
     case RDWaveFile::Atx:
     case RDWaveFile::Tmc:
     case RDWaveFile::Ambos:
-      err=Stage1Mpeg(dstfile,wave);
+      err=Stage1Mpeg(wave);
       delete wave;
       return err;
 
     case RDWaveFile::Ogg:
-      err=Stage1Vorbis(dstfile,wave);
+      err=Stage1Vorbis(wave);
       delete wave;
       return err;
 
     case RDWaveFile::Flac:
-      err=Stage1Flac(dstfile,wave);
+      err=Stage1Flac(wave);
       delete wave;
       return err;
 
     case RDWaveFile::M4A:
-      err=Stage1M4A(dstfile,wave);
+      err=Stage1M4A(wave);
       delete wave;
       return err;
 
@@ -343,59 +444,52 @@ RDAudioConvert::ErrorCode RDAudioConvert::Stage1Convert(const QString &srcfile,
   //
   memset(&sf_src_info,0,sizeof(sf_src_info));
   if((sf_src=sf_open(srcfile.toUtf8(),SFM_READ,&sf_src_info))!=NULL) {
-    err=Stage1SndFile(dstfile,sf_src,&sf_src_info);
+    conv_in_length=sf_src_info.frames;
+    err=Stage1SndFile(sf_src,&sf_src_info);
     sf_close(sf_src);
-    return RDAudioConvert::ErrorOk;
+    return err;
   }
 
   return err;
 }
 
 
-RDAudioConvert::ErrorCode RDAudioConvert::Stage1Flac(const QString &dstfile,
-						     RDWaveFile *wave)
+RDAudioConvert::ErrorCode RDAudioConvert::Stage1Flac(RDWaveFile *wave)
 {
 #ifdef HAVE_FLAC
-  SNDFILE *sf_dst=NULL;
-  SF_INFO sf_dst_info;
+  RDAudioConvert::ErrorCode err;
   RDFlacDecode *flac=NULL;
 
   //
-  // Open Destination
+  // Open Pipeline
   //
-  memset(&sf_dst_info,0,sizeof(sf_dst_info));
-  sf_dst_info.format=SF_FORMAT_WAV|SF_FORMAT_FLOAT;
-  sf_dst_info.channels=wave->getChannels();
-  sf_dst_info.samplerate=wave->getSamplesPerSec();
-  if((sf_dst=sf_open(dstfile.toUtf8(),SFM_WRITE,&sf_dst_info))==NULL) {
-    return RDAudioConvert::ErrorNoDestination;
+  if((err=Stage1Open(wave->getChannels(),wave->getSamplesPerSec()))!=
+     RDAudioConvert::ErrorOk) {
+    return err;
   }
 
   //
   // Decode
   //
-  flac=new RDFlacDecode(sf_dst);
+  flac=new RDFlacDecode(RDAudioConvert::Stage1Callback,this);
   flac->setRange(conv_start_point,conv_end_point);
-  flac->decode(wave,&conv_peak_sample);
+  flac->decode(wave);
 
   //
   // Clean Up
   //
   delete flac;
-  sf_close(sf_dst);
-  return RDAudioConvert::ErrorOk;
+  return Stage1Close();
 #else
   return RDAudioConvert::ErrorFormatNotSupported;
 #endif  // HAVE_FLAC
 }
 
 
-RDAudioConvert::ErrorCode RDAudioConvert::Stage1Vorbis(const QString &dstfile,
-						       RDWaveFile *wave)
+RDAudioConvert::ErrorCode RDAudioConvert::Stage1Vorbis(RDWaveFile *wave)
 {
 #ifdef HAVE_VORBIS
-  SNDFILE *sf_dst=NULL;
-  SF_INFO sf_dst_info;
+  RDAudioConvert::ErrorCode err;
   ogg_sync_state ogg_sync;
   ogg_stream_state ogg_stream;
   ogg_packet ogg_packet;
@@ -416,21 +510,17 @@ RDAudioConvert::ErrorCode RDAudioConvert::Stage1Vorbis(const QString &dstfile,
   sf_count_t total_frames=0;
 
   //
-  // Open Destination
+  // Open Pipeline
   //
-  memset(&sf_dst_info,0,sizeof(sf_dst_info));
-  sf_dst_info.format=SF_FORMAT_WAV|SF_FORMAT_FLOAT;
-  sf_dst_info.channels=wave->getChannels();
-  sf_dst_info.samplerate=wave->getSamplesPerSec();
-  if((sf_dst=sf_open(dstfile.toUtf8(),SFM_WRITE,&sf_dst_info))==NULL) {
-    return RDAudioConvert::ErrorNoDestination;
+  if((err=Stage1Open(wave->getChannels(),wave->getSamplesPerSec()))!=
+     RDAudioConvert::ErrorOk) {
+    return err;
   }
 
   //
   // Initialize Decoder
   //
   if((fd=open(wave->getName().toUtf8(),O_RDONLY))<0) {
-    sf_close(sf_dst);
     return RDAudioConvert::ErrorNoSource;
   }
   ogg_sync_init(&ogg_sync);
@@ -446,7 +536,8 @@ RDAudioConvert::ErrorCode RDAudioConvert::Stage1Vorbis(const QString &dstfile,
   if(conv_end_point>=0) {
     end=(double)conv_end_point*(double)wave->getSamplesPerSec()/1000.0;
   }
-  while((n=read(fd,ogg_sync_buffer(&ogg_sync,4096),4096))>0) {
+  while((conv_stream_err==RDAudioConvert::ErrorOk)&&
+	((n=read(fd,ogg_sync_buffer(&ogg_sync,4096),4096))>0)) {
     ogg_sync_wrote(&ogg_sync,n);
     while(ogg_sync_pageout(&ogg_sync,&ogg_page)==1) {
       if(serialno<0) {
@@ -480,14 +571,11 @@ RDAudioConvert::ErrorCode RDAudioConvert::Stage1Vorbis(const QString &dstfile,
 	      }
 	      if(total_frames>=start) {
 		if((total_frames+frames)<end) {    // Write entire buffer 
-		  UpdatePeak(pcmbuf,frames*wave->getChannels());
-		  sf_writef_float(sf_dst,pcmbuf,frames);
+		  Stage1Write(pcmbuf,frames);
 		}
 		else {
 		  if(total_frames<(total_frames+frames)) {  // Write start of buffer
-		    UpdatePeak(pcmbuf,
-			       (total_frames+frames-end)*wave->getChannels());
-		    sf_writef_float(sf_dst,pcmbuf,total_frames+frames-end);
+		    Stage1Write(pcmbuf,total_frames+frames-end);
 		    //
 		    // Done -- no need to decode the rest
 		    //
@@ -500,17 +588,15 @@ RDAudioConvert::ErrorCode RDAudioConvert::Stage1Vorbis(const QString &dstfile,
 		    ogg_stream_clear(&ogg_stream);
 		    ogg_sync_clear(&ogg_sync);
 		    ::close(fd);
-		    sf_close(sf_dst);
 
-		    return RDAudioConvert::ErrorOk;
+		    return Stage1Close();
 		  }
 		}
 	      }
 	      else {
 		int diff=total_frames+frames-start;
 		if(diff>0) {   // Write end of buffer
-		  UpdatePeak(pcmbuf+diff,(frames-diff)*wave->getChannels());
-		  sf_writef_float(sf_dst,pcmbuf+diff,frames-diff);
+		  Stage1Write(pcmbuf+diff,frames-diff);
 		}
 	      }
 	      total_frames+=frames;
@@ -535,9 +621,8 @@ RDAudioConvert::ErrorCode RDAudioConvert::Stage1Vorbis(const QString &dstfile,
   ogg_stream_clear(&ogg_stream);
   ogg_sync_clear(&ogg_sync);
   ::close(fd);
-  sf_close(sf_dst);
 
-  return RDAudioConvert::ErrorOk;
+  return Stage1Close();
 #else
   return RDAudioConvert::ErrorFormatNotSupported;
 #endif  // HAVE_VORBIS
@@ -545,12 +630,10 @@ RDAudioConvert::ErrorCode RDAudioConvert::Stage1Vorbis(const QString &dstfile,
 
 #define STAGE1BUFSIZE 16384
 
-RDAudioConvert::ErrorCode RDAudioConvert::Stage1Mpeg(const QString &dstfile,
-						     RDWaveFile *wave)
+RDAudioConvert::ErrorCode RDAudioConvert::Stage1Mpeg(RDWaveFile *wave)
 {
 #ifdef HAVE_MAD
-  SNDFILE *sf_dst=NULL;
-  SF_INFO sf_dst_info;
+  RDAudioConvert::ErrorCode err;
   struct mad_stream mad_stream;
   struct mad_frame mad_frame;
   struct mad_synth mad_synth;
@@ -571,16 +654,12 @@ RDAudioConvert::ErrorCode RDAudioConvert::Stage1Mpeg(const QString &dstfile,
   }
 
   //
-  // Open Destination
+  // Open Pipeline
   //
-  memset(&sf_dst_info,0,sizeof(sf_dst_info));
-  sf_dst_info.format=SF_FORMAT_WAV|SF_FORMAT_FLOAT;
-  sf_dst_info.channels=wave->getChannels();
-  sf_dst_info.samplerate=wave->getSamplesPerSec();
-  if((sf_dst=sf_open(dstfile.toUtf8(),SFM_WRITE,&sf_dst_info))==NULL) {
-    return RDAudioConvert::ErrorNoDestination;
+  if((err=Stage1Open(wave->getChannels(),wave->getSamplesPerSec()))!=
+     RDAudioConvert::ErrorOk) {
+    return err;
   }
-  sf_command(sf_dst,SFC_SET_NORM_DOUBLE,NULL,SF_FALSE);
 
   //
   // Initialize Decoder
@@ -599,7 +678,8 @@ RDAudioConvert::ErrorCode RDAudioConvert::Stage1Mpeg(const QString &dstfile,
   if(conv_end_point>=0) {
     end=(double)conv_end_point*(double)wave->getSamplesPerSec()/1000.0;
   }
-  while((n=wave->readWave(buffer+left_over,fsize))>0) {
+  while((conv_stream_err==RDAudioConvert::ErrorOk)&&
+	((n=wave->readWave(buffer+left_over,fsize))>0)) {
     if((buffer[left_over]==0xff)&&(buffer[2+left_over]&0x02)!=0) {
        n+=wave->readWave(buffer+left_over+n,1);  // Padding slot
     }
@@ -625,14 +705,11 @@ RDAudioConvert::ErrorCode RDAudioConvert::Stage1Mpeg(const QString &dstfile,
       }
       if(frames>=start) {
 	if((end<0)||((frames+mad_synth.pcm.length)<end)) { // Write full buffer 
-	  UpdatePeak(sf_buffer,mad_synth.pcm.length*wave->getChannels());
-	  sf_writef_float(sf_dst,sf_buffer,mad_synth.pcm.length);
+	  Stage1Write(sf_buffer,mad_synth.pcm.length);
 	}
 	else {
 	  if(frames<(frames+mad_synth.pcm.length)) {  // Write start of buffer
-	    UpdatePeak(sf_buffer,
-		       (frames+mad_synth.pcm.length-end)*wave->getChannels());
-	    sf_writef_float(sf_dst,sf_buffer,frames+mad_synth.pcm.length-end);
+	    Stage1Write(sf_buffer,frames+mad_synth.pcm.length-end);
 	    //
 	    // Done -- no need to decode the rest
 	    //
@@ -640,17 +717,14 @@ RDAudioConvert::ErrorCode RDAudioConvert::Stage1Mpeg(const QString &dstfile,
 	    mad_frame_finish(&mad_frame);
 	    mad_stream_finish(&mad_stream);
 	    wave->closeWave();
-	    sf_close(sf_dst);
-	    return RDAudioConvert::ErrorOk;
+	    return Stage1Close();
 	  }
 	}
       }
       else {
 	int diff=frames+mad_synth.pcm.length-start;
 	if(diff>0) {   // Write end of buffer
-	  UpdatePeak(sf_buffer+diff,
-		     (mad_synth.pcm.length-diff)*wave->getChannels());
-	  sf_writef_float(sf_dst,sf_buffer+diff,mad_synth.pcm.length-diff);
+	  Stage1Write(sf_buffer+diff,mad_synth.pcm.length-diff);
 	}
       }
       frames+=mad_synth.pcm.length;
@@ -677,8 +751,7 @@ RDAudioConvert::ErrorCode RDAudioConvert::Stage1Mpeg(const QString &dstfile,
 	  (float)mad_f_todouble(mad_synth.pcm.samples[j][i]);
       }
     }
-    UpdatePeak(sf_buffer,mad_synth.pcm.length*wave->getChannels());
-    sf_writef_float(sf_dst,sf_buffer,mad_synth.pcm.length);
+    Stage1Write(sf_buffer,mad_synth.pcm.length);
   }
 
   //
@@ -689,21 +762,16 @@ RDAudioConvert::ErrorCode RDAudioConvert::Stage1Mpeg(const QString &dstfile,
   mad_stream_finish(&mad_stream);
   wave->closeWave();
 
-  sf_close(sf_dst);
-
-  return RDAudioConvert::ErrorOk;
+  return Stage1Close();
 #else
   return RDAudioConvert::ErrorFormatNotSupported;
 #endif  // HAVE_MAD
 }
 
 // Based on libfaad's frontend/main.c, but using libmp4v2 for MP4 access.
-RDAudioConvert::ErrorCode RDAudioConvert::Stage1M4A(const QString &dstfile,
-						    RDWaveFile *wave) 
+RDAudioConvert::ErrorCode RDAudioConvert::Stage1M4A(RDWaveFile *wave) 
 {
 #ifdef HAVE_MP4_LIBS
-  SNDFILE *sf_dst=NULL;
-  SF_INFO sf_dst_info;
   MP4FileHandle f;
   MP4TrackId audioTrack;
   MP4SampleId firstSample, lastSample;
@@ -768,18 +836,13 @@ RDAudioConvert::ErrorCode RDAudioConvert::Stage1M4A(const QString &dstfile,
   }
 
   //
-  // Open Destination
+  // Open Pipeline
   //
   
-  memset(&sf_dst_info,0,sizeof(sf_dst_info));
-  sf_dst_info.format=SF_FORMAT_WAV|SF_FORMAT_FLOAT;
-  sf_dst_info.channels=wave->getChannels();
-  sf_dst_info.samplerate=wave->getSamplesPerSec();
-  if((sf_dst=sf_open(dstfile.toUtf8(),SFM_WRITE,&sf_dst_info))==NULL) {
-    ret = RDAudioConvert::ErrorNoDestination;
+  if((ret=Stage1Open(wave->getChannels(),wave->getSamplesPerSec()))!=
+     RDAudioConvert::ErrorOk) {
     goto out_mp4_configbuf;
   }
-  sf_command(sf_dst,SFC_SET_NORM_DOUBLE,NULL,SF_FALSE);
   
   //
   // Initialize Decoder
@@ -826,11 +889,8 @@ RDAudioConvert::ErrorCode RDAudioConvert::Stage1M4A(const QString &dstfile,
       break;
     }
 
-    UpdatePeak((const float*)sample_buffer, frameInfo.samples);
-    
-    if(sf_write_float(sf_dst, (const float*)sample_buffer, frameInfo.samples) != (sf_count_t)frameInfo.samples) {
-      rda->syslog(LOG_WARNING,"%s",sf_strerror(sf_dst));
-      ret = RDAudioConvert::ErrorInternal;
+    if(!Stage1Write((const float*)sample_buffer, frameInfo.samples/wave->getChannels())) {
+      ret = conv_stream_err;
       break;
     }
 
@@ -842,8 +902,10 @@ RDAudioConvert::ErrorCode RDAudioConvert::Stage1M4A(const QString &dstfile,
 
  out_decoder:
   dlmp4.NeAACDecClose(hDecoder);
-  // out_sf: 
-  sf_close(sf_dst);
+  // out_pipeline: 
+  if(ret == RDAudioConvert::ErrorOk) {
+    ret = Stage1Close();
+  }
  out_mp4_configbuf:
   free(aacConfigBuffer);
  out_mp4_buf:
@@ -858,22 +920,19 @@ RDAudioConvert::ErrorCode RDAudioConvert::Stage1M4A(const QString &dstfile,
 #endif
 }
 
-RDAudioConvert::ErrorCode RDAudioConvert::Stage1SndFile(const QString &dstfile,
-							SNDFILE *sf_src,
+RDAudioConvert::ErrorCode RDAudioConvert::Stage1SndFile(SNDFILE *sf_src,
 							SF_INFO *sf_src_info)
 {
-  SNDFILE *sf_dst=NULL;
-  SF_INFO sf_dst_info;
+  RDAudioConvert::ErrorCode err;
   sf_count_t start=0;
   sf_count_t end=sf_src_info->frames;
 
   //
-  // Open Destination
+  // Open Pipeline
   //
-  sf_dst_info=*sf_src_info;
-  sf_dst_info.format=SF_FORMAT_WAV|SF_FORMAT_FLOAT;
-  if((sf_dst=sf_open(dstfile.toUtf8(),SFM_WRITE,&sf_dst_info))==NULL) {
-    return RDAudioConvert::ErrorNoDestination;
+  if((err=Stage1Open(sf_src_info->channels,sf_src_info->samplerate))!=
+     RDAudioConvert::ErrorOk) {
+    return err;
   }
 
   //
@@ -890,581 +949,508 @@ RDAudioConvert::ErrorCode RDAudioConvert::Stage1SndFile(const QString &dstfile,
     end=(double)conv_end_point*(double)sf_src_info->samplerate/1000.0;
   }
   while((n=sf_readf_float(sf_src,buffer,buffer_size))>0) {
-    UpdatePeak(buffer,n*sf_src_info->channels);
-    sf_writef_float(sf_dst,buffer,n);
+    if(!Stage1Write(buffer,n)) {
+      break;
+    }
     start+=n;
     if((end-start)<buffer_size) {
       buffer_size=end-start;
     }
     usleep(conv_transcoding_delay);
   }
-  delete buffer;
-  sf_close(sf_dst);
+  delete[] buffer;
 
-  return RDAudioConvert::ErrorOk;
+  return Stage1Close();
 }
 
 
-RDAudioConvert::ErrorCode RDAudioConvert::Stage2Convert(const QString &srcfile,
-							const QString &dstfile)
+RDAudioConvert::ErrorCode RDAudioConvert::Stage1Open(int chans,int samprate)
 {
-  soundtouch::SoundTouch *st_conv=NULL;
-  SNDFILE *src_sf=NULL;
-  SNDFILE *dst_sf=NULL;
-  SF_INFO src_info;
-  SF_INFO dst_info;
-  SRC_STATE *src_state=NULL;
-  SRC_DATA src_data;
-  float *pcm[3]={NULL,NULL,NULL};
-  bool free_pcm[3]={false,false,false};
-  int err;
-  sf_count_t n;
-  float ratio=1.0;
+  conv_stream_err=RDAudioConvert::ErrorOk;
+  conv_in_channels=chans;
+  conv_in_samplerate=samprate;
 
   //
-  // Open Files
+  // Progress is measured against the part of the source being converted
   //
-  memset(&src_info,0,sizeof(src_info));
-  if((src_sf=sf_open(srcfile.toUtf8(),SFM_READ,&src_info))==NULL) {
-    rda->syslog(LOG_WARNING,"Could not open %s",(const char *)srcfile.toUtf8());
-    return RDAudioConvert::ErrorInternal;
+  conv_in_frames=0;
+  if(conv_end_point>=0) {
+    sf_count_t end=(double)conv_end_point*(double)samprate/1000.0;
+    if((conv_in_length==0)||(end<conv_in_length)) {
+      conv_in_length=end;
+    }
   }
-  sf_command(src_sf,SFC_SET_NORM_FLOAT,NULL,SF_FALSE);
-  sf_command(dst_sf,SFC_SET_CLIPPING,NULL,SF_TRUE);
-  memset(&dst_info,0,sizeof(dst_info));
-  dst_info.format=SF_FORMAT_WAV|SF_FORMAT_PCM_32;
-  dst_info.channels=conv_settings->channels();
-  dst_info.samplerate=conv_settings->sampleRate();
-  if((dst_sf=sf_open(dstfile.toUtf8(),SFM_WRITE,&dst_info))==NULL) {
-    sf_close(src_sf);
-    rda->syslog(LOG_WARNING,"Could not open %s",(const char *)dstfile.toUtf8());
-    return RDAudioConvert::ErrorInternal;
+  if(conv_start_point>0) {
+    sf_count_t start=(double)conv_start_point*(double)samprate/1000.0;
+    conv_in_length=start<conv_in_length ? conv_in_length-start : 0;
+  }
+
+  if(conv_measuring) {
+    return RDAudioConvert::ErrorOk;
+  }
+  return Stage2Open(chans,samprate);
+}
+
+
+bool RDAudioConvert::Stage1Write(const float pcm[],unsigned frames)
+{
+  int pct;
+
+  if(conv_stream_err!=RDAudioConvert::ErrorOk) {
+    return false;
+  }
+  if(conv_cancelled) {
+    conv_stream_err=RDAudioConvert::ErrorCancelled;
+    return false;
   }
 
   //
-  // Allocate Buffers
+  // Update Progress
   //
-  pcm[0]=new float[STAGE2_BUFFER_SIZE];
-  free_pcm[0]=true;
-  if(dst_info.samplerate!=src_info.samplerate) {
-    pcm[1]=new float[STAGE2_BUFFER_SIZE];
-    free_pcm[1]=true;
-    if(dst_info.channels!=src_info.channels) {
-      pcm[2]=new float[STAGE2_BUFFER_SIZE];
-      free_pcm[2]=true;
-    }
-    else {
-      pcm[2]=pcm[1];
+  // When a measuring pass is needed, it takes up the first half.
+  //
+  conv_in_frames+=frames;
+  if(conv_in_length>0) {
+    pct=100*conv_in_frames/conv_in_length;
+    if(pct>100) {
+      pct=100;
     }
-  }
-  else {
-    pcm[1]=pcm[0];
-    if(dst_info.channels!=src_info.channels) {
-      pcm[2]=new float[STAGE2_BUFFER_SIZE];
-      free_pcm[2]=true;
+    if(conv_measuring) {
+      pct=pct/2;
     }
-    else {
-      pcm[2]=pcm[0];
+    if(conv_measured) {
+      pct=50+pct/2;
     }
-  }  
+    conv_progress=pct;
+  }
+
+  if(conv_measuring) {
+    UpdatePeak(pcm,frames*conv_in_channels);
+    return true;
+  }
+  return Stage2Write(pcm,frames);
+}
+
+
+RDAudioConvert::ErrorCode RDAudioConvert::Stage1Close()
+{
+  if(conv_measuring) {
+    return conv_stream_err;
+  }
+  if(conv_stream_err!=RDAudioConvert::ErrorOk) {
+    AbortPipeline();
+    return conv_stream_err;
+  }
+  return Stage2Close();
+}
+
 
+bool RDAudioConvert::Stage1Callback(const float pcm[],unsigned frames,
+				    void *priv)
+{
+  return static_cast<RDAudioConvert *>(priv)->Stage1Write(pcm,frames);
+}
+
+
+RDAudioConvert::ErrorCode RDAudioConvert::Stage2Open(int chans,int samprate)
+{
+  RDAudioConvert::ErrorCode ret;
+  int out_chans=conv_settings->channels();
+  int out_samprate=conv_settings->sampleRate();
+  unsigned size;
+  int err;
+
+  if((chans<=0)||(samprate<=0)) {
+    return RDAudioConvert::ErrorInvalidSource;
+  }
+
+  //
+  // Allocate Buffers
+  //
+  // [0] holds level-adjusted input, [1] rate-converted audio and [2] the
+  // output of channelization and speed conversion.
+  //
+  conv_pcm_frames=STAGE2_XFER_SIZE;
+  if(out_samprate>samprate) {
+    conv_pcm_frames=STAGE2_XFER_SIZE*out_samprate/samprate+chans;
+  }
+  size=conv_pcm_frames*(chans>out_chans?chans:out_chans);
+  if(size<STAGE2_BUFFER_SIZE) {
+    size=STAGE2_BUFFER_SIZE;
+  }
+  for(int i=0;i<3;i++) {
+    conv_pcm[i]=new float[size];
+  }
 
   //
   // Initialize Rate Converter
   //
-  if(dst_info.samplerate!=src_info.samplerate) {
-    if((src_state=src_new(conv_src_converter,src_info.channels,&err))==NULL) {
-      sf_close(src_sf);
-      sf_close(dst_sf);
+  if(out_samprate!=samprate) {
+    if((conv_src_state=src_new(conv_src_converter,chans,&err))==NULL) {
+      Stage2Free();
       rda->syslog(LOG_WARNING,"%s",src_strerror(err));
       return RDAudioConvert::ErrorInternal;
     }
-    memset(&src_data,0,sizeof(src_data));
-    src_data.src_ratio=(double)dst_info.samplerate/(double)src_info.samplerate;
-    src_data.data_in=pcm[0];
-    src_data.data_out=pcm[1];
-    src_data.output_frames=STAGE2_XFER_SIZE*dst_info.samplerate/
-      src_info.samplerate+src_info.channels;
+    memset(&conv_src_data,0,sizeof(conv_src_data));
+    conv_src_data.src_ratio=(double)out_samprate/(double)samprate;
+    conv_src_data.data_out=conv_pcm[1];
+    conv_src_data.output_frames=conv_pcm_frames;
   }
 
   //
   // Initialize Speed Converter
   //
   if(conv_speed_ratio!=1.0) {
-    st_conv=new soundtouch::SoundTouch();
-    st_conv->setTempo(conv_speed_ratio);
-    st_conv->setSampleRate(dst_info.samplerate);
-    st_conv->setChannels(dst_info.channels);
+    conv_st_conv=new soundtouch::SoundTouch();
+    conv_st_conv->setTempo(conv_speed_ratio);
+    conv_st_conv->setSampleRate(out_samprate);
+    conv_st_conv->setChannels(out_chans);
   }
 
   //
   // Calculate Gain Ratio
   //
-  if(conv_settings->normalizationLevel()!=0) {
+  conv_gain_ratio=1.0;
+  if((conv_settings->normalizationLevel()!=0)&&(conv_peak_sample>0.0)) {
     float gain=
       (float)conv_settings->normalizationLevel()-20.0*log10f(conv_peak_sample);
-    ratio=exp10f(gain/20.0);
+    conv_gain_ratio=exp10f(gain/20.0);
   }
 
-  //
-  // Convert
-  //
-  while((n=sf_readf_float(src_sf,pcm[0],STAGE2_XFER_SIZE))>0) {
+  if((ret=Stage3Open(out_chans,out_samprate))!=RDAudioConvert::ErrorOk) {
+    Stage2Free();
+  }
+  return ret;
+}
+
+
+bool RDAudioConvert::Stage2Write(const float pcm[],unsigned frames)
+{
+  const float *data;
+  unsigned n;
+  int err;
+
+  while(frames>0) {
+    data=pcm;
+    n=frames;
+    if(n>STAGE2_XFER_SIZE) {
+      n=STAGE2_XFER_SIZE;
+    }
+    pcm+=n*conv_in_channels;
+    frames-=n;
 
     //
     // Levels
     //
-    if(ratio!=1.0) {
-      for(unsigned i=0;i<(n*src_info.channels);i++) {
-	pcm[0][i]=ratio*pcm[0][i];
+    if(conv_gain_ratio!=1.0) {
+      for(unsigned i=0;i<(n*conv_in_channels);i++) {
+	conv_pcm[0][i]=conv_gain_ratio*data[i];
       }
+      data=conv_pcm[0];
     }
 
     //
     // Sample Rate
     //
-    if(src_state!=NULL) {
-      src_data.input_frames=n;
-      if((err=src_process(src_state,&src_data))!=0) {
-        fprintf(stderr,"SRC Error: %s\n",src_strerror(err));
+    if(conv_src_state!=NULL) {
+      conv_src_data.data_in=data;
+      conv_src_data.input_frames=n;
+      if((err=src_process(conv_src_state,&conv_src_data))!=0) {
         rda->syslog(LOG_WARNING,"%s",src_strerror(err));
-        return RDAudioConvert::ErrorInternal;
+	conv_stream_err=RDAudioConvert::ErrorInternal;
+        return false;
       }
-      n=src_data.output_frames_gen;
+      n=conv_src_data.output_frames_gen;
+      data=conv_pcm[1];
     }
 
     //
     // Channelization
     //
-    switch(src_info.channels) {
-    case 1:
-      switch(dst_info.channels) {
-      case 1:  // Nothing to do
-	break;
-
-      case 2:
+    if(conv_out_channels!=conv_in_channels) {
+      if(conv_out_channels==1) {
 	for(unsigned i=0;i<n;i++) {
-	  pcm[2][2*i]=pcm[1][i];
-	  pcm[2][2*i+1]=pcm[1][i];
+	  float sum=0.0;
+	  for(int j=0;j<conv_in_channels;j++) {
+	    sum+=data[conv_in_channels*i+j];
+	  }
+	  conv_pcm[2][i]=sum/conv_in_channels;
 	}
-	break;
       }
-      break;
-
-    case 2:
-      switch(dst_info.channels) {
-      case 1:
+      else {
 	for(unsigned i=0;i<n;i++) {
-	  pcm[2][i]=(pcm[1][2*i]+pcm[1][2*i+1])/2;
+	  for(int j=0;j<conv_out_channels;j++) {
+	    conv_pcm[2][conv_out_channels*i+j]=
+	      data[conv_in_channels*i+(j%conv_in_channels)];
+	  }
 	}
-	break;
-
-      case 2:  // Nothing to do
-	break;
       }
-      break;
+      data=conv_pcm[2];
     }
 
     //
     // Speed
     //
-    if(st_conv!=NULL) {
-      st_conv->putSamples((soundtouch::SAMPLETYPE *)pcm[2],n);
-      n=st_conv->receiveSamples((soundtouch::SAMPLETYPE *)pcm[2],STAGE2_BUFFER_SIZE/dst_info.channels);
+    if(conv_st_conv!=NULL) {
+      conv_st_conv->putSamples((const soundtouch::SAMPLETYPE *)data,n);
+      while((n=conv_st_conv->
+	     receiveSamples((soundtouch::SAMPLETYPE *)conv_pcm[2],
+			    conv_pcm_frames))>0) {
+	if(!Stage3Write(conv_pcm[2],n)) {
+	  return false;
+	}
+      }
     }
 
     //
     // Write Output
     //
-    if(sf_writef_float(dst_sf,pcm[2],n)!=n) {
-      for(unsigned i=0;i<3;i++) {
-	if(free_pcm[i]) {
-	  delete pcm[i];
-	}
-      }
-      if(src_state!=NULL) {
-	src_delete(src_state);
+    else {
+      if((n>0)&&(!Stage3Write(data,n))) {
+	return false;
       }
-      sf_close(src_sf);
-      sf_close(dst_sf);
-      return RDAudioConvert::ErrorNoSpace;
     }
     usleep(conv_transcoding_delay);
   }
 
+  return true;
+}
+
+
+RDAudioConvert::ErrorCode RDAudioConvert::Stage2Close()
+{
+  unsigned n;
+
   //
   // Finish Up Speed Conversion
   //
-  if(st_conv!=NULL) {
-    st_conv->flush();
-    while((n=st_conv->
-	   receiveSamples((soundtouch::SAMPLETYPE *)pcm[2],
-			  STAGE2_BUFFER_SIZE/dst_info.channels))>0) {
-      if(sf_writef_float(dst_sf,pcm[2],n)!=n) {
-	for(unsigned i=0;i<3;i++) {
-	  if(free_pcm[i]) {
-	    delete pcm[i];
-	  }
-	}
-	if(src_state!=NULL) {
-	  src_delete(src_state);
-	}
-	sf_close(src_sf);
-	sf_close(dst_sf);
-	return RDAudioConvert::ErrorNoSpace;
+  if(conv_st_conv!=NULL) {
+    conv_st_conv->flush();
+    while((n=conv_st_conv->
+	   receiveSamples((soundtouch::SAMPLETYPE *)conv_pcm[2],
+			  conv_pcm_frames))>0) {
+      if(!Stage3Write(conv_pcm[2],n)) {
+	AbortPipeline();
+	return conv_stream_err;
       }
       usleep(conv_transcoding_delay);
     }
-    delete st_conv;
   }
+  Stage2Free();
 
-  //
-  // Clean Up
-  //
-  for(unsigned i=0;i<3;i++) {
-    if(free_pcm[i]) {
-      delete pcm[i];
-    }
+  return Stage3Close();
+}
+
+
+void RDAudioConvert::Stage2Free()
+{
+  if(conv_st_conv!=NULL) {
+    delete conv_st_conv;
+    conv_st_conv=NULL;
   }
-  if(src_state!=NULL) {
-    src_delete(src_state);
+  if(conv_src_state!=NULL) {
+    src_delete(conv_src_state);
+    conv_src_state=NULL;
+  }
+  for(int i=0;i<3;i++) {
+    delete[] conv_pcm[i];
+    conv_pcm[i]=NULL;
   }
-  sf_close(src_sf);
-  sf_close(dst_sf);
-
-  return RDAudioConvert::ErrorOk;
 }
 
 
-RDAudioConvert::ErrorCode RDAudioConvert::Stage3Convert(const QString &srcfile,
-							const QString &dstfile)
+RDAudioConvert::ErrorCode RDAudioConvert::Stage3Open(int chans,int samprate)
 {
-  SNDFILE *src_sf=NULL;
-  SF_INFO src_sf_info;
-  RDAudioConvert::ErrorCode ret;
+  RDAudioConvert::ErrorCode ret=RDAudioConvert::ErrorInvalidSettings;
 
-  //
-  // Open Source File
-  //
-  if((src_sf=sf_open(srcfile.toUtf8(),SFM_READ,&src_sf_info))==NULL) {
-    rda->syslog(LOG_WARNING,"%s",sf_strerror(NULL));
-    return RDAudioConvert::ErrorInternal;
-  }
+  conv_out_channels=chans;
+  conv_out_samplerate=samprate;
+  conv_out_frames=0;
+  conv_out_fd=-1;
+  conv_out_wave=NULL;
 
   switch(conv_settings->format()) {
   case RDSettings::Pcm16:
-    ret=Stage3Pcm16(src_sf,&src_sf_info,dstfile);
+    ret=Stage3OpenPcm(16);
     break;
 
   case RDSettings::Pcm24:
-    ret=Stage3Pcm24(src_sf,&src_sf_info,dstfile);
+    ret=Stage3OpenPcm(24);
     break;
 
   case RDSettings::MpegL2:
-    ret=Stage3Layer2(src_sf,&src_sf_info,dstfile);
+    ret=Stage3OpenLayer2(false);
     break;
 
   case RDSettings::MpegL2Wav:
-    ret=Stage3Layer2Wav(src_sf,&src_sf_info,dstfile);
+    ret=Stage3OpenLayer2(true);
     break;
 
   case RDSettings::MpegL3:
-    ret=Stage3Layer3(src_sf,&src_sf_info,dstfile);
+    ret=Stage3OpenLayer3();
     break;
 
   case RDSettings::Flac:
-    ret=Stage3Flac(src_sf,&src_sf_info,dstfile);
+    ret=Stage3OpenFlac();
     break;
 
   case RDSettings::OggVorbis:
-    ret=Stage3Vorbis(src_sf,&src_sf_info,dstfile);
+    ret=Stage3OpenVorbis();
     break;
 
   case RDSettings::MpegL1:
   default:
     ret=RDAudioConvert::ErrorInvalidSettings;
   }
+  if(ret==RDAudioConvert::ErrorOk) {
+    conv_out_pcm=new uint8_t[STAGE3_XFER_SIZE*chans*sizeof(int32_t)];
+    conv_out_active=true;
+  }
+  else {
+    //
+    // Don't leave a half-opened destination behind
+    //
+    if((conv_out_wave!=NULL)||(conv_out_fd>=0)) {
+      if(conv_out_wave!=NULL) {
+	conv_out_wave->closeWave();
+	delete conv_out_wave;
+	conv_out_wave=NULL;
+      }
+      if(conv_out_fd>=0) {
+	::close(conv_out_fd);
+	conv_out_fd=-1;
+      }
+      unlink(conv_dst_filename.toUtf8());
+    }
+  }
 
-  sf_close(src_sf);
   return ret;
 }
 
 
-RDAudioConvert::ErrorCode RDAudioConvert::Stage3Flac(SNDFILE *src_sf,
-						     SF_INFO *src_sf_info,
-						     const QString &dstfile)
+RDAudioConvert::ErrorCode RDAudioConvert::Stage3OpenPcm(int bits)
 {
-#ifdef HAVE_FLAC
-  sf_count_t n;
-  int32_t *pcm;
-
-  //
-  // Initialize Encoder
-  //
-  FLAC::Encoder::File *flac=new FLAC::Encoder::File();
-  flac->set_channels(src_sf_info->channels);
-  flac->set_bits_per_sample(16);  // FIXME: Should vary by input file
-  flac->set_sample_rate(src_sf_info->samplerate);
-  //flac->set_compression_level(8);
-  flac->set_blocksize(0);
-  unlink(dstfile.toUtf8());
-  /*
-   * FLAC <1.2.x
-   *
-  flac->set_filename(dstfile.ascii());
-  switch(flac->init()) {
-    case 0:
-      break;
-
-    default:
-      delete flac;
-      rda->log(RDConfig::LogWarning,QString("flac->init() failure"));
-      return RDAudioConvert::ErrorInternal;
+  conv_out_wave=new RDWaveFile(conv_dst_filename);
+  conv_out_wave->setFormatTag(WAVE_FORMAT_PCM);
+  conv_out_wave->setChannels(conv_out_channels);
+  conv_out_wave->setSamplesPerSec(conv_out_samplerate);
+  conv_out_wave->setBitsPerSample(bits);
+  conv_out_wave->setBextChunk(true);
+  conv_out_wave->setCartChunk(conv_dst_wavedata!=NULL);
+  conv_out_wave->setRdxlContents(conv_dst_rdxl);
+  if((conv_dst_wavedata!=NULL)&&(conv_settings->normalizationLevel()!=0)) {
+    conv_out_wave->setCartLevelRef(32768*
+	      exp10((double)conv_settings->normalizationLevel()/20.0));
+  }
+  conv_out_wave->setLevlChunk(true);
+  unlink(conv_dst_filename.toUtf8());
+  if(!conv_out_wave->createWave(conv_dst_wavedata,conv_start_point)) {
+    return RDAudioConvert::ErrorNoDestination;
   }
-  */
-  /*
-   * FLAC 1.2.x
-   */
-  switch(flac->init(dstfile.toUtf8())) {
-  case FLAC__STREAM_ENCODER_INIT_STATUS_OK:
-    break;
 
-  case FLAC__STREAM_ENCODER_INIT_STATUS_INVALID_NUMBER_OF_CHANNELS:
-  case FLAC__STREAM_ENCODER_INIT_STATUS_INVALID_BITS_PER_SAMPLE:
-  case FLAC__STREAM_ENCODER_INIT_STATUS_INVALID_SAMPLE_RATE:
-    delete flac;
-    return RDAudioConvert::ErrorInvalidSettings;
+  return RDAudioConvert::ErrorOk;
+}
 
-  case FLAC__STREAM_ENCODER_INIT_STATUS_ENCODER_ERROR:
-  case FLAC__STREAM_ENCODER_INIT_STATUS_UNSUPPORTED_CONTAINER:
-  case FLAC__STREAM_ENCODER_INIT_STATUS_INVALID_MAX_LPC_ORDER:
-  case FLAC__STREAM_ENCODER_INIT_STATUS_INVALID_QLP_COEFF_PRECISION:
-  case FLAC__STREAM_ENCODER_INIT_STATUS_BLOCK_SIZE_TOO_SMALL_FOR_LPC_ORDER:
-  case FLAC__STREAM_ENCODER_INIT_STATUS_NOT_STREAMABLE:
-  case FLAC__STREAM_ENCODER_INIT_STATUS_INVALID_METADATA:
-  default:
-    delete flac;
-    rda->syslog(LOG_WARNING,"flac->init() failure");
-    return RDAudioConvert::ErrorInternal;
-  }
 
-  pcm=new int32_t[2048*src_sf_info->channels];
+RDAudioConvert::ErrorCode RDAudioConvert::Stage3OpenLayer2(bool wav)
+{
+#ifdef HAVE_TWOLAME
+  TWOLAME_MPEG_mode mpeg_mode=TWOLAME_STEREO;
 
   //
-  // Encode
+  // Load TwoLAME
   //
-  while((n=sf_readf_int(src_sf,pcm,2048))>0) {
-    for(unsigned i=0;i<(n*src_sf_info->channels);i++) {
-      pcm[i]=pcm[i]>>16;
-    }
-    flac->process_interleaved(pcm,n);
+  if(!LoadTwoLame()) {
+    return RDAudioConvert::ErrorFormatNotSupported;
+  }
+  if((!wav)&&(conv_settings->bitRate()>192000)&&(conv_out_channels<2)) {
+    return RDAudioConvert::ErrorInvalidSettings;
   }
-  flac->finish();
 
   //
-  // Clean Up
+  // Determine MPEG Mode
   //
-  delete pcm;
-  delete flac;
+  switch(conv_out_channels) {
+  case 1:
+    mpeg_mode=TWOLAME_MONO;
+    break;
 
-  return RDAudioConvert::ErrorOk;
-#else
-  return RDAudioConvert::ErrorFormatNotSupported;
-#endif  // HAVE_FLAC
-}
-
-
-RDAudioConvert::ErrorCode RDAudioConvert::Stage3Vorbis(SNDFILE *src_sf,
-						       SF_INFO *src_sf_info,
-						       const QString &dstfile)
-{
-#ifdef HAVE_VORBIS
-  ogg_stream_state ogg_stream;
-  ogg_page ogg_page;
-  ogg_packet header;
-  ogg_packet comment;
-  ogg_packet codebook;
-  ogg_packet ogg_packet;
-  vorbis_info vorbis_info;
-  vorbis_comment vorbis_comment;
-  vorbis_dsp_state vorbis_dsp;
-  vorbis_block vorbis_block;
-  float *pcm=NULL;
-  float **vorbis;
-  sf_count_t n;
-  int dst_fd=-1;
-
-  //
-  // Open Destination File
-  //
-  unlink(dstfile.toUtf8());
-  if((dst_fd=open(dstfile.toUtf8(),O_WRONLY|O_CREAT|O_TRUNC,
-		  S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH))<0) {
-    return RDAudioConvert::ErrorNoDestination;
-  } 
+  case 2:
+    mpeg_mode=TWOLAME_STEREO;    
+    break;
 
-  //
-  // Initialize the Encoder
-  //
-  vorbis_info_init(&vorbis_info);
-  switch(vorbis_encode_init_vbr(&vorbis_info,src_sf_info->channels,
-				src_sf_info->samplerate,
-				conv_settings->quality())) {
-  case OV_EFAULT:
   default:
-    rda->syslog(LOG_WARNING,"vorbis_encode_init_vbr() failure");
-    return RDAudioConvert::ErrorInternal;
-
-  case OV_EINVAL:
-  case OV_EIMPL:
     return RDAudioConvert::ErrorInvalidSettings;
-
-  case 0:
-    break;
   }
-  vorbis_comment_init(&vorbis_comment);
-  // Metadata stuff goes here...
-  vorbis_analysis_init(&vorbis_dsp,&vorbis_info);
-  vorbis_block_init(&vorbis_dsp,&vorbis_block);
-  vorbis_analysis_headerout(&vorbis_dsp,&vorbis_comment,
-			    &header,&comment,&codebook);
-  ogg_stream_init(&ogg_stream,rand());
-  ogg_stream_packetin(&ogg_stream,&header);
-  ogg_stream_packetin(&ogg_stream,&comment);
-  ogg_stream_packetin(&ogg_stream,&codebook);
-  pcm=new float[2048*src_sf_info->channels];
 
   //
-  // Encode
+  // Open Destination File
   //
-  while((n=sf_readf_float(src_sf,pcm,2048))>0) {
-    vorbis=vorbis_analysis_buffer(&vorbis_dsp,n);
-    for(unsigned i=0;i<n;i++) {
-      for(int j=0;j<src_sf_info->channels;j++) {
-	vorbis[j][i]=pcm[src_sf_info->channels*i+j];
-      }
-    }
-    vorbis_analysis_wrote(&vorbis_dsp,n);
-    while(vorbis_analysis_blockout(&vorbis_dsp,&vorbis_block)>0) {
-      vorbis_analysis(&vorbis_block,&ogg_packet);
-      ogg_stream_packetin(&ogg_stream,&ogg_packet);
-      while(ogg_stream_pageout(&ogg_stream,&ogg_page)!=0) {
-	if(write(dst_fd,ogg_page.header,ogg_page.header_len)!=
-	   ogg_page.header_len) {
-	  ::close(dst_fd);
-	  delete pcm;
-	  ogg_stream_clear(&ogg_stream);
-	  vorbis_comment_clear(&vorbis_comment);
-	  vorbis_info_clear(&vorbis_info);
-	  return RDAudioConvert::ErrorNoSpace; 
-	}
-	if(write(dst_fd,ogg_page.body,ogg_page.body_len)!=
-	   ogg_page.body_len) {
-	  ::close(dst_fd);
-	  delete pcm;
-	  ogg_stream_clear(&ogg_stream);
-	  vorbis_comment_clear(&vorbis_comment);
-	  vorbis_info_clear(&vorbis_info);
-	  return RDAudioConvert::ErrorNoSpace; 
-	}
-      }
-    }
-    while(ogg_stream_flush(&ogg_stream,&ogg_page)!=0) {
-      if(write(dst_fd,ogg_page.header,ogg_page.header_len)!=
-	 ogg_page.header_len) {
-	  ::close(dst_fd);
-	  delete pcm;
-	  ogg_stream_clear(&ogg_stream);
-	  vorbis_comment_clear(&vorbis_comment);
-	  vorbis_info_clear(&vorbis_info);
-	  return RDAudioConvert::ErrorNoSpace; 
-	}
-      }
-    if(write(dst_fd,ogg_page.body,ogg_page.body_len)!=
-       ogg_page.body_len) {
-      ::close(dst_fd);
-      delete pcm;
-      ogg_stream_clear(&ogg_stream);
-      vorbis_comment_clear(&vorbis_comment);
-      vorbis_info_clear(&vorbis_info);
-      return RDAudioConvert::ErrorNoSpace; 
+  unlink(conv_dst_filename.toUtf8());
+  if(wav) {
+    conv_out_wave=new RDWaveFile(conv_dst_filename);
+    conv_out_wave->setFormatTag(WAVE_FORMAT_MPEG);
+    conv_out_wave->setChannels(conv_out_channels);
+    switch(conv_out_channels) {
+    case 1:
+      conv_out_wave->setHeadMode(ACM_MPEG_SINGLECHANNEL);
+      break;
+
+    case 2:
+      conv_out_wave->setHeadMode(ACM_MPEG_STEREO);
+      break;
     }
-  }
-  vorbis=vorbis_analysis_buffer(&vorbis_dsp,0);
-  vorbis_analysis_wrote(&vorbis_dsp,0);
-  while(vorbis_analysis_blockout(&vorbis_dsp,&vorbis_block)>0) {
-    vorbis_analysis(&vorbis_block,&ogg_packet);
-    ogg_stream_packetin(&ogg_stream,&ogg_packet);
-    while(ogg_stream_pageout(&ogg_stream,&ogg_page)!=0) {
-      if(write(dst_fd,ogg_page.header,ogg_page.header_len)!=
-	 ogg_page.header_len) {
-	::close(dst_fd);
-	delete pcm;
-	ogg_stream_clear(&ogg_stream);
-	vorbis_comment_clear(&vorbis_comment);
-	vorbis_info_clear(&vorbis_info);
-	return RDAudioConvert::ErrorNoSpace; 
-      }
-      if(write(dst_fd,ogg_page.body,ogg_page.body_len)!=
-	 ogg_page.body_len) {
-	::close(dst_fd);
-	delete pcm;
-	ogg_stream_clear(&ogg_stream);
-	vorbis_comment_clear(&vorbis_comment);
-	vorbis_info_clear(&vorbis_info);
-	return RDAudioConvert::ErrorNoSpace; 
-      }
+    conv_out_wave->setSamplesPerSec(conv_out_samplerate);
+    conv_out_wave->setHeadLayer(2);
+    conv_out_wave->setHeadBitRate(conv_settings->bitRate());
+    conv_out_wave->setBextChunk(true);
+    conv_out_wave->setMextChunk(true);
+    conv_out_wave->setCartChunk(conv_dst_wavedata!=NULL);
+    conv_out_wave->setLevlChunk(true);
+    conv_out_wave->setRdxlContents(conv_dst_rdxl);
+    if(!conv_out_wave->createWave(conv_dst_wavedata,conv_start_point)) {
+      return RDAudioConvert::ErrorNoDestination;
     }
   }
-  while(ogg_stream_flush(&ogg_stream,&ogg_page)!=0) {
-    if(write(dst_fd,ogg_page.header,ogg_page.header_len)!=
-       ogg_page.header_len) {
-      ::close(dst_fd);
-      delete pcm;
-      ogg_stream_clear(&ogg_stream);
-      vorbis_comment_clear(&vorbis_comment);
-      vorbis_info_clear(&vorbis_info);
-      return RDAudioConvert::ErrorNoSpace; 
-    }
-    if(write(dst_fd,ogg_page.body,ogg_page.body_len)!=
-       ogg_page.body_len) {
-      ::close(dst_fd);
-      delete pcm;
-      ogg_stream_clear(&ogg_stream);
-      vorbis_comment_clear(&vorbis_comment);
-      vorbis_info_clear(&vorbis_info);
-      return RDAudioConvert::ErrorNoSpace; 
+  else {
+    if((conv_out_fd=open(conv_dst_filename.toUtf8(),O_WRONLY|O_CREAT|O_TRUNC,
+			 S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH))<0) {
+      return RDAudioConvert::ErrorNoDestination;
     }
   }
 
   //
-  // Clean Up
+  // Initialize Encoder
   //
-  ::close(dst_fd);
-  delete pcm;
-  ogg_stream_clear(&ogg_stream);
-  vorbis_comment_clear(&vorbis_comment);
-  vorbis_info_clear(&vorbis_info);
+  if((conv_twolame_opts=twolame_init())==NULL) {
+    rda->syslog(LOG_WARNING,"twolame_init() failure");
+    return RDAudioConvert::ErrorInternal;
+  }
+  twolame_set_mode(conv_twolame_opts,mpeg_mode);
+  twolame_set_num_channels(conv_twolame_opts,conv_out_channels);
+  twolame_set_in_samplerate(conv_twolame_opts,conv_out_samplerate);
+  twolame_set_out_samplerate(conv_twolame_opts,conv_out_samplerate);
+  twolame_set_bitrate(conv_twolame_opts,conv_settings->bitRate()/1000);
+  if(wav) {
+    twolame_set_energy_levels(conv_twolame_opts,1);
+  }
+  if(twolame_init_params(conv_twolame_opts)!=0) {
+    twolame_close(&conv_twolame_opts);
+    conv_twolame_opts=NULL;
+    return RDAudioConvert::ErrorInvalidSettings;
+  }
 
   return RDAudioConvert::ErrorOk;
 #else
   return RDAudioConvert::ErrorFormatNotSupported;
-#endif  // HAVE_VORBIS
+#endif  // HAVE_TWOLAME
 }
 
 
-RDAudioConvert::ErrorCode RDAudioConvert::Stage3Layer3(SNDFILE *src_sf,
-						       SF_INFO *src_sf_info,
-						       const QString &dstfile)
+RDAudioConvert::ErrorCode RDAudioConvert::Stage3OpenLayer3()
 {
 #ifdef HAVE_LAME
   MPEG_mode mpeg_mode=STEREO;
-  lame_global_flags *lameopts=NULL;
-  int dst_fd=-1;
-  int16_t pcm[2304];
-  unsigned char mpeg[2048];
-  sf_count_t n;
-  sf_count_t s;
 
   //
   // Load LAME
@@ -1476,7 +1462,7 @@ RDAudioConvert::ErrorCode RDAudioConvert::Stage3Layer3(SNDFILE *src_sf,
   //
   // Determine MPEG Mode
   //
-  switch(src_sf_info->channels) {
+  switch(conv_out_channels) {
   case 1:
     mpeg_mode=MONO;
     break;
@@ -1492,81 +1478,31 @@ RDAudioConvert::ErrorCode RDAudioConvert::Stage3Layer3(SNDFILE *src_sf,
   //
   // Open Destination File
   //
-  unlink(dstfile.toUtf8());
-  if((dst_fd=open(dstfile.toUtf8(),O_WRONLY|O_CREAT|O_TRUNC,
-		  S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH))<0) {
+  unlink(conv_dst_filename.toUtf8());
+  if((conv_out_fd=open(conv_dst_filename.toUtf8(),O_WRONLY|O_CREAT|O_TRUNC,
+		       S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH))<0) {
     return RDAudioConvert::ErrorNoDestination;
   } 
 
   //
   // Initialize Encoder
   //
-  if((lameopts=lame_init())==NULL) {
-    lame_close(lameopts);
-    ::close(dst_fd);
+  if((conv_lame_opts=lame_init())==NULL) {
     rda->syslog(LOG_WARNING,"lame_init() failure");
     return RDAudioConvert::ErrorInternal;
   }
-  lame_set_mode(lameopts,mpeg_mode);
-  lame_set_num_channels(lameopts,src_sf_info->channels);
-  lame_set_in_samplerate(lameopts,src_sf_info->samplerate);
-  lame_set_out_samplerate(lameopts,src_sf_info->samplerate);
-  lame_set_brate(lameopts,conv_settings->bitRate()/1000);
-  lame_set_bWriteVbrTag(lameopts,0);
-  if(lame_init_params(lameopts)!=0) {
-    lame_close(lameopts);
-    ::close(dst_fd);
+  lame_set_mode(conv_lame_opts,mpeg_mode);
+  lame_set_num_channels(conv_lame_opts,conv_out_channels);
+  lame_set_in_samplerate(conv_lame_opts,conv_out_samplerate);
+  lame_set_out_samplerate(conv_lame_opts,conv_out_samplerate);
+  lame_set_brate(conv_lame_opts,conv_settings->bitRate()/1000);
+  lame_set_bWriteVbrTag(conv_lame_opts,0);
+  if(lame_init_params(conv_lame_opts)!=0) {
+    lame_close(conv_lame_opts);
+    conv_lame_opts=NULL;
     return RDAudioConvert::ErrorInvalidSettings;
   }
 
-  //
-  // Encode
-  //
-  if(src_sf_info->channels==2) {
-    while((n=sf_readf_short(src_sf,pcm,1152))>0) {
-      if((s=lame_encode_buffer_interleaved(lameopts,pcm,n,mpeg,2048))>=0) {
-	if(write(dst_fd,mpeg,s)!=s) {
-	  lame_close(lameopts);
-	  ::close(dst_fd);
-	  return RDAudioConvert::ErrorNoSpace;
-	}
-      }
-      usleep(conv_transcoding_delay);
-    }
-  }
-  else {
-    while((n=sf_readf_short(src_sf,pcm,1152))>0) {
-      if((s=lame_encode_buffer(lameopts,pcm,NULL,n,mpeg,2048))>=0) {
-	if(write(dst_fd,mpeg,s)!=s) {
-	  lame_close(lameopts);
-	  ::close(dst_fd);
-	  return RDAudioConvert::ErrorNoSpace;
-	}
-	usleep(conv_transcoding_delay);
-      }
-    }
-  }
-  if((s=lame_encode_flush(lameopts,mpeg,2048))>=0) {
-    if(write(dst_fd,mpeg,s)!=s) {
-      lame_close(lameopts);
-      ::close(dst_fd);
-      return RDAudioConvert::ErrorNoSpace;
-    }
-  }
-
-  //
-  // Clean Up
-  //
-  lame_close(lameopts);
-  ::close(dst_fd);
-
-  //
-  // Apply Metadata
-  //
-  if(conv_dst_wavedata!=NULL) {
-    ApplyId3Tag(dstfile,conv_dst_wavedata);
-  }
-
   return RDAudioConvert::ErrorOk;
 #else
   return RDAudioConvert::ErrorFormatNotSupported;
@@ -1574,333 +1510,408 @@ RDAudioConvert::ErrorCode RDAudioConvert::Stage3Layer3(SNDFILE *src_sf,
 }
 
 
-RDAudioConvert::ErrorCode RDAudioConvert::Stage3Layer2Wav(SNDFILE *src_sf,
-							  SF_INFO *src_sf_info,
-							  const QString &dstfile)
+RDAudioConvert::ErrorCode RDAudioConvert::Stage3OpenFlac()
 {
-#ifdef HAVE_TWOLAME
-  sf_count_t n;
-  ssize_t s;
-  RDWaveFile *wave=NULL;
-  TWOLAME_MPEG_mode mpeg_mode=TWOLAME_STEREO;
-  twolame_options *lameopts=NULL;
-  float pcm[2304];
-  unsigned char mpeg[2048];
-
-  //
-  // Load TwoLAME
-  //
-  if(!LoadTwoLame()) {
-    return RDAudioConvert::ErrorFormatNotSupported;
-  }
-
+#ifdef HAVE_FLAC
   //
-  // Determine MPEG Mode
+  // Initialize Encoder
   //
-  switch(src_sf_info->channels) {
-  case 1:
-    mpeg_mode=TWOLAME_MONO;
+  conv_flac_encoder=new FLAC::Encoder::File();
+  conv_flac_encoder->set_channels(conv_out_channels);
+  conv_flac_encoder->set_bits_per_sample(16);  // FIXME: Should vary by input file
+  conv_flac_encoder->set_sample_rate(conv_out_samplerate);
+  //conv_flac_encoder->set_compression_level(8);
+  conv_flac_encoder->set_blocksize(0);
+  unlink(conv_dst_filename.toUtf8());
+  switch(conv_flac_encoder->init(conv_dst_filename.toUtf8())) {
+  case FLAC__STREAM_ENCODER_INIT_STATUS_OK:
     break;
 
-  case 2:
-    mpeg_mode=TWOLAME_STEREO;    
-    break;
+  case FLAC__STREAM_ENCODER_INIT_STATUS_INVALID_NUMBER_OF_CHANNELS:
+  case FLAC__STREAM_ENCODER_INIT_STATUS_INVALID_BITS_PER_SAMPLE:
+  case FLAC__STREAM_ENCODER_INIT_STATUS_INVALID_SAMPLE_RATE:
+    delete conv_flac_encoder;
+    conv_flac_encoder=NULL;
+    return RDAudioConvert::ErrorInvalidSettings;
 
+  case FLAC__STREAM_ENCODER_INIT_STATUS_ENCODER_ERROR:
+  case FLAC__STREAM_ENCODER_INIT_STATUS_UNSUPPORTED_CONTAINER:
+  case FLAC__STREAM_ENCODER_INIT_STATUS_INVALID_MAX_LPC_ORDER:
+  case FLAC__STREAM_ENCODER_INIT_STATUS_INVALID_QLP_COEFF_PRECISION:
+  case FLAC__STREAM_ENCODER_INIT_STATUS_BLOCK_SIZE_TOO_SMALL_FOR_LPC_ORDER:
+  case FLAC__STREAM_ENCODER_INIT_STATUS_NOT_STREAMABLE:
+  case FLAC__STREAM_ENCODER_INIT_STATUS_INVALID_METADATA:
   default:
-    return RDAudioConvert::ErrorInvalidSettings;
+    delete conv_flac_encoder;
+    conv_flac_encoder=NULL;
+    rda->syslog(LOG_WARNING,"flac->init() failure");
+    return RDAudioConvert::ErrorInternal;
   }
 
+  return RDAudioConvert::ErrorOk;
+#else
+  return RDAudioConvert::ErrorFormatNotSupported;
+#endif  // HAVE_FLAC
+}
+
+
+RDAudioConvert::ErrorCode RDAudioConvert::Stage3OpenVorbis()
+{
+#ifdef HAVE_VORBIS
+  ogg_packet header;
+  ogg_packet comment;
+  ogg_packet codebook;
+
   //
   // Open Destination File
   //
-  wave=new RDWaveFile(dstfile);
-  wave->setFormatTag(WAVE_FORMAT_MPEG);
-  wave->setChannels(src_sf_info->channels);
-  switch(src_sf_info->channels) {
-  case 1:
-    wave->setHeadMode(ACM_MPEG_SINGLECHANNEL);
-    break;
-
-  case 2:
-    wave->setHeadMode(ACM_MPEG_STEREO);
-    break;
-  }
-  wave->setSamplesPerSec(src_sf_info->samplerate);
-  wave->setHeadLayer(2);
-  wave->setHeadBitRate(conv_settings->bitRate());
-  wave->setBextChunk(true);
-  wave->setMextChunk(true);
-  wave->setCartChunk(conv_dst_wavedata!=NULL);
-  wave->setLevlChunk(true);
-  wave->setRdxlContents(conv_dst_rdxl);
-  unlink(dstfile.toUtf8());
-  if(!wave->createWave(conv_dst_wavedata,conv_start_point)) {
+  unlink(conv_dst_filename.toUtf8());
+  if((conv_out_fd=open(conv_dst_filename.toUtf8(),O_WRONLY|O_CREAT|O_TRUNC,
+		       S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH))<0) {
     return RDAudioConvert::ErrorNoDestination;
-  }
+  } 
 
   //
-  // Initialize Encoder
+  // Initialize the Encoder
   //
-  if((lameopts=twolame_init())==NULL) {
-    wave->closeWave();
-    rda->syslog(LOG_WARNING,"twolame_init() failure");
+  vorbis_info_init(&conv_vorbis_info);
+  switch(vorbis_encode_init_vbr(&conv_vorbis_info,conv_out_channels,
+				conv_out_samplerate,
+				conv_settings->quality())) {
+  case OV_EFAULT:
+  default:
+    vorbis_info_clear(&conv_vorbis_info);
+    rda->syslog(LOG_WARNING,"vorbis_encode_init_vbr() failure");
     return RDAudioConvert::ErrorInternal;
-  }
-  twolame_set_mode(lameopts,mpeg_mode);
-  twolame_set_num_channels(lameopts,src_sf_info->channels);
-  twolame_set_in_samplerate(lameopts,src_sf_info->samplerate);
-  twolame_set_out_samplerate(lameopts,src_sf_info->samplerate);
-  twolame_set_bitrate(lameopts,conv_settings->bitRate()/1000);
-  twolame_set_energy_levels(lameopts,1);
-  if(twolame_init_params(lameopts)!=0) {
-    twolame_close(&lameopts);
-    wave->closeWave();
+
+  case OV_EINVAL:
+  case OV_EIMPL:
+    vorbis_info_clear(&conv_vorbis_info);
     return RDAudioConvert::ErrorInvalidSettings;
+
+  case 0:
+    break;
   }
+  vorbis_comment_init(&conv_vorbis_comment);
+  // Metadata stuff goes here...
+  vorbis_analysis_init(&conv_vorbis_dsp,&conv_vorbis_info);
+  vorbis_block_init(&conv_vorbis_dsp,&conv_vorbis_block);
+  vorbis_analysis_headerout(&conv_vorbis_dsp,&conv_vorbis_comment,
+			    &header,&comment,&codebook);
+  ogg_stream_init(&conv_ogg_stream,rand());
+  ogg_stream_packetin(&conv_ogg_stream,&header);
+  ogg_stream_packetin(&conv_ogg_stream,&comment);
+  ogg_stream_packetin(&conv_ogg_stream,&codebook);
 
   //
-  // Encode
+  // Audio must start on a fresh page
   //
-  while((n=sf_readf_float(src_sf,pcm,1152))>0) {
-    if((s=twolame_encode_buffer_float32_interleaved(lameopts,
-						    pcm,n,mpeg,2048))>=0) {
-      if(wave->writeWave(mpeg,s)!=s) {
-	twolame_close(&lameopts);
-	wave->closeWave(src_sf_info->frames);
-	return RDAudioConvert::ErrorNoSpace;
-      }
-    }
-    else {
-      fprintf(stderr,"TwoLAME encode error\n");
-    }
-    usleep(conv_transcoding_delay);
-  }
-  if((s=twolame_encode_flush(lameopts,mpeg,2048))>=0) {
-    if(wave->writeWave(mpeg,s)!=s) {
-      twolame_close(&lameopts);
-      wave->closeWave(src_sf_info->frames);
-      return RDAudioConvert::ErrorNoSpace;
-    }
-  }
-  else {
-    fprintf(stderr,"TwoLAME encode error\n");
+  if(!Stage3WriteOgg(true)) {
+    ogg_stream_clear(&conv_ogg_stream);
+    vorbis_block_clear(&conv_vorbis_block);
+    vorbis_dsp_clear(&conv_vorbis_dsp);
+    vorbis_comment_clear(&conv_vorbis_comment);
+    vorbis_info_clear(&conv_vorbis_info);
+    return RDAudioConvert::ErrorNoSpace;
   }
 
-  //
-  // Clean Up
-  //
-  twolame_close(&lameopts);
-  wave->closeWave(src_sf_info->frames);
   return RDAudioConvert::ErrorOk;
 #else
   return RDAudioConvert::ErrorFormatNotSupported;
-#endif  // HAVE_TWOLAME
+#endif  // HAVE_VORBIS
 }
 
 
-RDAudioConvert::ErrorCode RDAudioConvert::Stage3Layer2(SNDFILE *src_sf,
-						       SF_INFO *src_sf_info,
-						       const QString &dstfile)
+bool RDAudioConvert::Stage3Write(const float pcm[],unsigned frames)
 {
-#ifdef HAVE_TWOLAME
-  sf_count_t n;
-  ssize_t s;
-  int dst_fd=-1;
-  TWOLAME_MPEG_mode mpeg_mode=TWOLAME_STEREO;
-  twolame_options *lameopts=NULL;
-  float pcm[2304];
+  int16_t *pcm16=(int16_t *)conv_out_pcm;
+#ifdef HAVE_FLAC
+  int32_t *pcm32=(int32_t *)conv_out_pcm;
+#endif  // HAVE_FLAC
+#if defined HAVE_TWOLAME || defined HAVE_LAME
   unsigned char mpeg[2048];
+  ssize_t s;
+#endif  // HAVE_TWOLAME || HAVE_LAME
+  unsigned n;
 
-  if(!LoadTwoLame()) {
-    return RDAudioConvert::ErrorFormatNotSupported;
+  while(frames>0) {
+    n=frames;
+    if(n>STAGE3_XFER_SIZE) {
+      n=STAGE3_XFER_SIZE;
+    }
+    switch(conv_settings->format()) {
+    case RDSettings::Pcm16:
+      for(unsigned i=0;i<(n*conv_out_channels);i++) {
+	pcm16[i]=ClipSample(pcm[i],32768);
+      }
+      if(!Stage3Output(pcm16,n*conv_out_channels*sizeof(int16_t))) {
+	return false;
+      }
+      break;
+
+    case RDSettings::Pcm24:
+      for(unsigned i=0;i<(n*conv_out_channels);i++) {
+	int32_t samp=ClipSample(pcm[i],8388608);
+	conv_out_pcm[3*i]=0xFF&samp;
+	conv_out_pcm[3*i+1]=0xFF&(samp>>8);
+	conv_out_pcm[3*i+2]=0xFF&(samp>>16);
+      }
+      if(!Stage3Output(conv_out_pcm,n*conv_out_channels*3)) {
+	return false;
+      }
+      break;
+
+    case RDSettings::MpegL2:
+    case RDSettings::MpegL2Wav:
+#ifdef HAVE_TWOLAME
+      if((s=twolame_encode_buffer_float32_interleaved(conv_twolame_opts,
+						      pcm,n,mpeg,2048))>=0) {
+	if(!Stage3Output(mpeg,s)) {
+	  return false;
+	}
+      }
+      else {
+	fprintf(stderr,"TwoLAME encode error\n");
+      }
+#endif  // HAVE_TWOLAME
+      break;
+
+    case RDSettings::MpegL3:
+#ifdef HAVE_LAME
+      for(unsigned i=0;i<(n*conv_out_channels);i++) {
+	pcm16[i]=ClipSample(pcm[i],32768);
+      }
+      if(conv_out_channels==2) {
+	s=lame_encode_buffer_interleaved(conv_lame_opts,pcm16,n,mpeg,2048);
+      }
+      else {
+	s=lame_encode_buffer(conv_lame_opts,pcm16,NULL,n,mpeg,2048);
+      }
+      if((s>=0)&&(!Stage3Output(mpeg,s))) {
+	return false;
+      }
+#endif  // HAVE_LAME
+      break;
+
+    case RDSettings::Flac:
+#ifdef HAVE_FLAC
+      for(unsigned i=0;i<(n*conv_out_channels);i++) {
+	pcm32[i]=ClipSample(pcm[i],32768);
+      }
+      if(!conv_flac_encoder->process_interleaved(pcm32,n)) {
+	conv_stream_err=RDAudioConvert::ErrorNoSpace;
+	return false;
+      }
+#endif  // HAVE_FLAC
+      break;
+
+    case RDSettings::OggVorbis:
+      if(!Stage3WriteVorbis(pcm,n)) {
+	return false;
+      }
+      break;
+
+    default:
+      break;
+    }
+    conv_out_frames+=n;
+    pcm+=n*conv_out_channels;
+    frames-=n;
   }
-  if((conv_settings->bitRate()>192000)&&(src_sf_info->channels<2)) {
-    return RDAudioConvert::ErrorInvalidSettings;
+
+  return true;
+}
+
+
+bool RDAudioConvert::Stage3WriteVorbis(const float pcm[],unsigned frames)
+{
+#ifdef HAVE_VORBIS
+  ogg_packet ogg_packet;
+  float **vorbis;
+
+  if(frames>0) {
+    vorbis=vorbis_analysis_buffer(&conv_vorbis_dsp,frames);
+    for(unsigned i=0;i<frames;i++) {
+      for(int j=0;j<conv_out_channels;j++) {
+	vorbis[j][i]=pcm[conv_out_channels*i+j];
+      }
+    }
+  }
+  vorbis_analysis_wrote(&conv_vorbis_dsp,frames);
+  while(vorbis_analysis_blockout(&conv_vorbis_dsp,&conv_vorbis_block)>0) {
+    vorbis_analysis(&conv_vorbis_block,&ogg_packet);
+    ogg_stream_packetin(&conv_ogg_stream,&ogg_packet);
+    if(!Stage3WriteOgg(false)) {
+      return false;
+    }
   }
+#endif  // HAVE_VORBIS
+  return true;
+}
 
-  //
-  // Determine MPEG Mode
-  //
-  switch(src_sf_info->channels) {
-  case 1:
-    mpeg_mode=TWOLAME_MONO;
-    break;
 
-  case 2:
-    mpeg_mode=TWOLAME_STEREO;    
-    break;
+bool RDAudioConvert::Stage3WriteOgg(bool flush)
+{
+#ifdef HAVE_VORBIS
+  ogg_page ogg_page;
 
-  default:
-    return RDAudioConvert::ErrorInvalidSettings;
+  while((flush?ogg_stream_flush(&conv_ogg_stream,&ogg_page):
+	 ogg_stream_pageout(&conv_ogg_stream,&ogg_page))!=0) {
+    if((!Stage3Output(ogg_page.header,ogg_page.header_len))||
+       (!Stage3Output(ogg_page.body,ogg_page.body_len))) {
+      return false;
+    }
   }
+#endif  // HAVE_VORBIS
+  return true;
+}
 
-  //
-  // Open Destination File
-  //
-  unlink(dstfile.toUtf8());
-  if((dst_fd=open(dstfile.toUtf8(),O_WRONLY|O_CREAT|O_TRUNC,
-		  S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH))<0) {
-    return RDAudioConvert::ErrorNoDestination;
-  } 
 
-  //
-  // Initialize Encoder
-  //
-  if((lameopts=twolame_init())==NULL) {
-    ::close(dst_fd);
-    rda->syslog(LOG_WARNING,"twolame_init() failure");
-    return RDAudioConvert::ErrorInternal;
+bool RDAudioConvert::Stage3Output(const void *data,ssize_t len)
+{
+  if(conv_out_wave!=NULL) {
+    if(conv_out_wave->writeWave((void *)data,len)!=len) {
+      conv_stream_err=RDAudioConvert::ErrorNoSpace;
+      return false;
+    }
   }
-  twolame_set_mode(lameopts,mpeg_mode);
-  twolame_set_num_channels(lameopts,src_sf_info->channels);
-  twolame_set_in_samplerate(lameopts,src_sf_info->samplerate);
-  twolame_set_out_samplerate(lameopts,src_sf_info->samplerate);
-  twolame_set_bitrate(lameopts,conv_settings->bitRate()/1000);
-  if(twolame_init_params(lameopts)!=0) {
-    twolame_close(&lameopts);
-    ::close(dst_fd);
-    return RDAudioConvert::ErrorInvalidSettings;
+  else {
+    if(write(conv_out_fd,data,len)!=len) {
+      conv_stream_err=RDAudioConvert::ErrorNoSpace;
+      return false;
+    }
   }
+  return true;
+}
 
-  //
-  // Encode
-  //
-  while((n=sf_readf_float(src_sf,pcm,1152))>0) {
-    if((s=twolame_encode_buffer_float32_interleaved(lameopts,
-						    pcm,n,mpeg,2048))>=0) {
-      if(write(dst_fd,mpeg,s)!=s) {
-	twolame_close(&lameopts);
-	::close(dst_fd);
-	return RDAudioConvert::ErrorNoSpace;
+
+RDAudioConvert::ErrorCode RDAudioConvert::Stage3Close()
+{
+#if defined HAVE_TWOLAME || defined HAVE_LAME
+  unsigned char mpeg[8192];
+  ssize_t s;
+#endif  // HAVE_TWOLAME || HAVE_LAME
+  bool id3=false;
+
+  switch(conv_settings->format()) {
+  case RDSettings::MpegL2:
+  case RDSettings::MpegL2Wav:
+#ifdef HAVE_TWOLAME
+    if((s=twolame_encode_flush(conv_twolame_opts,mpeg,sizeof(mpeg)))>=0) {
+      if(!Stage3Output(mpeg,s)) {
+	AbortPipeline();
+	return conv_stream_err;
       }
     }
     else {
       fprintf(stderr,"TwoLAME encode error\n");
     }
-    usleep(conv_transcoding_delay);
-  }
-  if((s=twolame_encode_flush(lameopts,mpeg,2048))>=0) {
-    if(write(dst_fd,mpeg,s)!=s) {
-      twolame_close(&lameopts);
-      ::close(dst_fd);
-      return RDAudioConvert::ErrorNoSpace;
+    id3=(conv_settings->format()==RDSettings::MpegL2);
+#endif  // HAVE_TWOLAME
+    break;
+
+  case RDSettings::MpegL3:
+#ifdef HAVE_LAME
+    if((s=lame_encode_flush(conv_lame_opts,mpeg,sizeof(mpeg)))>=0) {
+      if(!Stage3Output(mpeg,s)) {
+	AbortPipeline();
+	return conv_stream_err;
+      }
     }
-  }
-  else {
-    fprintf(stderr,"TwoLAME encode error\n");
-  }
+    id3=true;
+#endif  // HAVE_LAME
+    break;
 
-  //
-  // Clean Up
-  //
-  twolame_close(&lameopts);
-  ::close(dst_fd);
+  case RDSettings::Flac:
+#ifdef HAVE_FLAC
+    conv_flac_encoder->finish();
+#endif  // HAVE_FLAC
+    break;
+
+  case RDSettings::OggVorbis:
+#ifdef HAVE_VORBIS
+    if((!Stage3WriteVorbis(NULL,0))||(!Stage3WriteOgg(true))) {
+      AbortPipeline();
+      return conv_stream_err;
+    }
+#endif  // HAVE_VORBIS
+    break;
+
+  default:
+    break;
+  }
+  Stage3Free(false);
 
   //
   // Apply Metadata
   //
-  if(conv_dst_wavedata!=NULL) {
-    ApplyId3Tag(dstfile,conv_dst_wavedata);
+  if(id3&&(conv_dst_wavedata!=NULL)) {
+    ApplyId3Tag(conv_dst_filename,conv_dst_wavedata);
   }
 
   return RDAudioConvert::ErrorOk;
-#else
-  return RDAudioConvert::ErrorFormatNotSupported;
-#endif  // HAVE_TWOLAME
 }
 
 
-RDAudioConvert::ErrorCode RDAudioConvert::Stage3Pcm16(SNDFILE *src_sf,
-						      SF_INFO *src_sf_info,
-						      const QString &dstfile)
+void RDAudioConvert::Stage3Free(bool unlink_dst)
 {
-  short *sf_buffer=NULL;
-  ssize_t n;
-
-  RDWaveFile *wave=new RDWaveFile(dstfile);
-  wave->setFormatTag(WAVE_FORMAT_PCM);
-  wave->setChannels(src_sf_info->channels);
-  wave->setSamplesPerSec(src_sf_info->samplerate);
-  wave->setBitsPerSample(16);
-  wave->setBextChunk(true);
-  wave->setCartChunk(conv_dst_wavedata!=NULL);
-  wave->setRdxlContents(conv_dst_rdxl);
-  if((conv_dst_wavedata!=NULL)&&(conv_settings->normalizationLevel()!=0)) {
-    wave->setCartLevelRef(32768*
-	      exp10((double)conv_settings->normalizationLevel()/20.0));
+  if(!conv_out_active) {
+    return;
   }
-  wave->setLevlChunk(true);
-  sf_buffer=new int16_t[2048*src_sf_info->channels];
-  unlink(dstfile.toUtf8());
-  if(!wave->createWave(conv_dst_wavedata,conv_start_point)) {
-    return RDAudioConvert::ErrorNoDestination;
+#ifdef HAVE_TWOLAME
+  if(conv_twolame_opts!=NULL) {
+    twolame_close(&conv_twolame_opts);
+    conv_twolame_opts=NULL;
   }
-  while((n=sf_readf_short(src_sf,sf_buffer,2048))>0) {
-    if((unsigned)wave->
-       writeWave(sf_buffer,n*sizeof(short)*src_sf_info->channels)!=
-       (n*sizeof(short)*src_sf_info->channels)) {
-      delete sf_buffer;
-      wave->closeWave();
-      delete wave;
-      return RDAudioConvert::ErrorNoSpace;
-    }
-    usleep(conv_transcoding_delay);
+#endif  // HAVE_TWOLAME
+#ifdef HAVE_LAME
+  if(conv_lame_opts!=NULL) {
+    lame_close(conv_lame_opts);
+    conv_lame_opts=NULL;
   }
-  delete sf_buffer;
-  wave->closeWave();
-  delete wave;
-  return RDAudioConvert::ErrorOk;
-}
-
-
-RDAudioConvert::ErrorCode RDAudioConvert::Stage3Pcm24(SNDFILE *src_sf,
-						      SF_INFO *src_sf_info,
-						      const QString &dstfile)
-{
-  int *sf_buffer=NULL;
-  uint8_t *pcm24=NULL;
-  ssize_t n;
-
-  RDWaveFile *wave=new RDWaveFile(dstfile);
-  wave->setFormatTag(WAVE_FORMAT_PCM);
-  wave->setChannels(src_sf_info->channels);
-  wave->setSamplesPerSec(src_sf_info->samplerate);
-  wave->setBitsPerSample(24);
-  wave->setBextChunk(true);
-  wave->setCartChunk(conv_dst_wavedata!=NULL);
-  wave->setRdxlContents(conv_dst_rdxl);
-  if((conv_dst_wavedata!=NULL)&&(conv_settings->normalizationLevel()!=0)) {
-    wave->setCartLevelRef(32768*
-	      exp10((double)conv_settings->normalizationLevel()/20.0));
+#endif  // HAVE_LAME
+#ifdef HAVE_FLAC
+  if(conv_flac_encoder!=NULL) {
+    delete conv_flac_encoder;
+    conv_flac_encoder=NULL;
   }
-  wave->setLevlChunk(true);
-  sf_buffer=new int[2048*src_sf_info->channels];
-  pcm24=new uint8_t[2048*src_sf_info->channels*sizeof(int)];
-  unlink(dstfile.toUtf8());
-  if(!wave->createWave(conv_dst_wavedata,conv_start_point)) {
-    return RDAudioConvert::ErrorNoDestination;
+#endif  // HAVE_FLAC
+#ifdef HAVE_VORBIS
+  if(conv_settings->format()==RDSettings::OggVorbis) {
+    ogg_stream_clear(&conv_ogg_stream);
+    vorbis_block_clear(&conv_vorbis_block);
+    vorbis_dsp_clear(&conv_vorbis_dsp);
+    vorbis_comment_clear(&conv_vorbis_comment);
+    vorbis_info_clear(&conv_vorbis_info);
   }
-  while((n=sf_readf_int(src_sf,sf_buffer,2048))>0) {
-    for(ssize_t i=0;i<(n*src_sf_info->channels);i++) {
-      pcm24[3*i]=0xFF&(sf_buffer[i]>>8);
-      pcm24[3*i+1]=0xFF&(sf_buffer[i]>>16);
-      pcm24[3*i+2]=0xFF&(sf_buffer[i]>>24);
+#endif  // HAVE_VORBIS
+  if(conv_out_wave!=NULL) {
+    if(conv_settings->format()==RDSettings::MpegL2Wav) {
+      conv_out_wave->closeWave(conv_out_frames);
     }
-    if((unsigned)wave->writeWave(pcm24,n*3*src_sf_info->channels)!=
-       (n*3*src_sf_info->channels)) {
-      delete sf_buffer;
-      delete pcm24;
-      wave->closeWave();
-      delete wave;
-      return RDAudioConvert::ErrorNoSpace;
+    else {
+      conv_out_wave->closeWave();
     }
-    usleep(conv_transcoding_delay);
+    delete conv_out_wave;
+    conv_out_wave=NULL;
+  }
+  if(conv_out_fd>=0) {
+    ::close(conv_out_fd);
+    conv_out_fd=-1;
+  }
+  delete[] conv_out_pcm;
+  conv_out_pcm=NULL;
+  conv_out_active=false;
+  if(unlink_dst) {
+    unlink(conv_dst_filename.toUtf8());
   }
-  delete sf_buffer;
-  delete pcm24;
-  wave->closeWave();
-  delete wave;
-  return RDAudioConvert::ErrorOk;
+}
+
+
+void RDAudioConvert::AbortPipeline()
+{
+  Stage2Free();
+  Stage3Free(true);
 }
 
 
@@ -1944,10 +1955,20 @@ void RDAudioConvert::ApplyId3Tag(const QString &filename,RDWaveData *wavedata)
   }
   tag->setProperties(*map);
 
-  RDCart *cart=new RDCart(wavedata->cartNumber());
-  if(cart->exists()) {
-    QString xml=
-      cart->xml(true,conv_start_point<0,conv_settings,wavedata->cutNumber());
+  //
+  // Only go to the database for the RDXL if the caller hasn't supplied it,
+  // so that conversions can be run from threads that have no connection
+  //
+  QString xml=conv_dst_rdxl;
+  if(xml.isEmpty()) {
+    RDCart *cart=new RDCart(wavedata->cartNumber());
+    if(cart->exists()) {
+      xml=cart->xml(true,conv_start_point<0,conv_settings,
+		    wavedata->cutNumber());
+    }
+    delete cart;
+  }
+  if(!xml.isEmpty()) {
     TagLib::ID3v2::UserTextIdentificationFrame *frame=
       new TagLib::ID3v2::UserTextIdentificationFrame(TagLib::String::UTF8);
     frame->setDescription("rdxl");
@@ -1955,7 +1976,6 @@ void RDAudioConvert::ApplyId3Tag(const QString &filename,RDWaveData *wavedata)
     				  TagLib::String::UTF8));
     tag->addFrame(frame);
   }
-  delete cart;
 
   file->save();
   delete map;
@@ -1976,12 +1996,14 @@ void RDAudioConvert::AddId3Property(TagLib::PropertyMap *map,const QString &key,
 
 void RDAudioConvert::UpdatePeak(const float data[],ssize_t len)
 {
-  float peak;
+  //
+  // All channels are treated as one, so scan it as mono
+  //
+  RDPeakScan scan(1);
 
-  for(ssize_t i=0;i<len;i++) {
-    if((peak=fabsf(data[i]))>conv_peak_sample) {
-      conv_peak_sample=peak;
-    }
+  scan.scan(data,RDPeakScan::Float,len);
+  if(scan.peak(0)>conv_peak_sample) {
+    conv_peak_sample=scan.peak(0);
   }
 }
 
@@ -21,7 +21,12 @@
 #ifndef RDAUDIOCONVERT_H
 #define RDAUDIOCONVERT_H
 
+#include <stdint.h>
+
+#include <atomic>
+
 #include <sndfile.h>
+#include <samplerate.h>
 #include <taglib/taglib.h>
 #include <taglib/tpropertymap.h>
 #ifdef HAVE_TWOLAME
@@ -33,6 +38,13 @@
 #ifdef HAVE_MAD
 #include <mad.h>
 #endif  // HAVE_MAD
+#ifdef HAVE_VORBIS
+#include <ogg/ogg.h>
+#include <vorbis/vorbisenc.h>
+#endif  // HAVE_VORBIS
+#ifdef HAVE_FLAC
+#include <FLAC++/encoder.h>
+#endif  // HAVE_FLAC
 
 #include <rdmp4.h>
 
@@ -43,6 +55,10 @@
 #include "rdwavedata.h"
 #include "rdwavefile.h"
 
+namespace soundtouch {
+  class SoundTouch;
+}
+
 class RDAudioConvert : public QObject
 {
   Q_OBJECT;
@@ -50,7 +66,8 @@ class RDAudioConvert : public QObject
   enum ErrorCode {ErrorOk=0,ErrorInvalidSettings=1,ErrorNoSource=2,
 		  ErrorNoDestination=3,ErrorInvalidSource=4,ErrorInternal=5,
 		  ErrorFormatNotSupported=6,ErrorNoDisc=7,ErrorNoTrack=8,
-		  ErrorInvalidSpeed=9,ErrorFormatError=10,ErrorNoSpace=11};
+		  ErrorInvalidSpeed=9,ErrorFormatError=10,ErrorNoSpace=11,
+		  ErrorCancelled=12};
   RDAudioConvert(QObject *parent=0);
   ~RDAudioConvert();
   void setSourceFile(const QString &filename);
@@ -63,42 +80,41 @@ class RDAudioConvert : public QObject
   void setRange(int start_pt,int end_pt);
   void setSpeedRatio(float ratio);
   RDAudioConvert::ErrorCode convert();
+  int progress() const;
+  void cancel();
   static bool settingsValid(RDSettings *settings);
   static QString errorText(RDAudioConvert::ErrorCode err);
 
  private:
-  RDAudioConvert::ErrorCode Stage1Convert(const QString &srcfile,
-					  const QString &dstfile);
-  RDAudioConvert::ErrorCode Stage1Flac(const QString &dstfile,
-				       RDWaveFile *wave);
-  RDAudioConvert::ErrorCode Stage1Vorbis(const QString &dstfile,
-					 RDWaveFile *wave);
-  RDAudioConvert::ErrorCode Stage1Mpeg(const QString &dstfile,
-				       RDWaveFile *wave);
-  RDAudioConvert::ErrorCode Stage1M4A(const QString &dstfile,
-				      RDWaveFile *wave);
-  RDAudioConvert::ErrorCode Stage1SndFile(const QString &dstfile,
-					  SNDFILE *sf_src,
+  bool ReadEnergyPeak(const QString &srcfile);
+  RDAudioConvert::ErrorCode Stage1Convert(const QString &srcfile);
+  RDAudioConvert::ErrorCode Stage1Flac(RDWaveFile *wave);
+  RDAudioConvert::ErrorCode Stage1Vorbis(RDWaveFile *wave);
+  RDAudioConvert::ErrorCode Stage1Mpeg(RDWaveFile *wave);
+  RDAudioConvert::ErrorCode Stage1M4A(RDWaveFile *wave);
+  RDAudioConvert::ErrorCode Stage1SndFile(SNDFILE *sf_src,
 					  SF_INFO *sf_src_info);
-  RDAudioConvert::ErrorCode Stage2Convert(const QString &srcfile,
-					  const QString &dstfile);
-  RDAudioConvert::ErrorCode Stage3Convert(const QString &srcfile,
-					  const QString &dstfile);
-  RDAudioConvert::ErrorCode Stage3Flac(SNDFILE *src_sf,SF_INFO *src_sf_info,
-				       const QString &dstfile);
-  RDAudioConvert::ErrorCode Stage3Vorbis(SNDFILE *src_sf,SF_INFO *src_sf_info,
-					 const QString &dstfile);
-  RDAudioConvert::ErrorCode Stage3Layer3(SNDFILE *src_sf,SF_INFO *src_sf_info,
-					 const QString &dstfile);
-  RDAudioConvert::ErrorCode Stage3Layer2Wav(SNDFILE *src_sf,
-					    SF_INFO *src_sf_info,
-					    const QString &dstfile);
-  RDAudioConvert::ErrorCode Stage3Layer2(SNDFILE *src_sf,SF_INFO *src_sf_info,
-					 const QString &dstfile);
-  RDAudioConvert::ErrorCode Stage3Pcm16(SNDFILE *src_sf,SF_INFO *src_sf_info,
-					const QString &dstfile);
-  RDAudioConvert::ErrorCode Stage3Pcm24(SNDFILE *src_sf,SF_INFO *src_sf_info,
-					const QString &dstfile);
+  RDAudioConvert::ErrorCode Stage1Open(int chans,int samprate);
+  bool Stage1Write(const float pcm[],unsigned frames);
+  RDAudioConvert::ErrorCode Stage1Close();
+  static bool Stage1Callback(const float pcm[],unsigned frames,void *priv);
+  RDAudioConvert::ErrorCode Stage2Open(int chans,int samprate);
+  bool Stage2Write(const float pcm[],unsigned frames);
+  RDAudioConvert::ErrorCode Stage2Close();
+  void Stage2Free();
+  RDAudioConvert::ErrorCode Stage3Open(int chans,int samprate);
+  RDAudioConvert::ErrorCode Stage3OpenPcm(int bits);
+  RDAudioConvert::ErrorCode Stage3OpenLayer2(bool wav);
+  RDAudioConvert::ErrorCode Stage3OpenLayer3();
+  RDAudioConvert::ErrorCode Stage3OpenFlac();
+  RDAudioConvert::ErrorCode Stage3OpenVorbis();
+  bool Stage3Write(const float pcm[],unsigned frames);
+  bool Stage3WriteVorbis(const float pcm[],unsigned frames);
+  bool Stage3WriteOgg(bool flush);
+  bool Stage3Output(const void *data,ssize_t len);
+  RDAudioConvert::ErrorCode Stage3Close();
+  void Stage3Free(bool unlink_dst);
+  void AbortPipeline();
   void ApplyId3Tag(const QString &filename,RDWaveData *wavedata);
   void AddId3Property(TagLib::PropertyMap *map,
 		      const QString &key,const QString &value) const;
@@ -119,6 +135,28 @@ class RDAudioConvert : public QObject
   QString conv_src_rdxl;
   QString conv_dst_rdxl;
   float conv_peak_sample;
+  bool conv_measuring;
+  bool conv_measured;
+  std::atomic<bool> conv_cancelled;
+  std::atomic<int> conv_progress;
+  sf_count_t conv_in_frames;
+  sf_count_t conv_in_length;
+  RDAudioConvert::ErrorCode conv_stream_err;
+  int conv_in_channels;
+  int conv_in_samplerate;
+  float conv_gain_ratio;
+  SRC_STATE *conv_src_state;
+  SRC_DATA conv_src_data;
+  soundtouch::SoundTouch *conv_st_conv;
+  float *conv_pcm[3];
+  unsigned conv_pcm_frames;
+  bool conv_out_active;
+  int conv_out_channels;
+  int conv_out_samplerate;
+  sf_count_t conv_out_frames;
+  int conv_out_fd;
+  RDWaveFile *conv_out_wave;
+  uint8_t *conv_out_pcm;
   int conv_src_converter;
   void *conv_mad_handle;
   void *conv_lame_handle;
@@ -135,6 +173,7 @@ class RDAudioConvert : public QObject
   void (*mad_stream_finish)(struct mad_stream *);
 #endif  // HAVE_MAD
 #ifdef HAVE_TWOLAME
+  twolame_options *conv_twolame_opts;
   twolame_options *(*twolame_init)(void);
   void (*twolame_set_mode)(twolame_options *,TWOLAME_MPEG_mode);
   void (*twolame_set_num_channels)(twolame_options *,int);
@@ -149,6 +188,7 @@ class RDAudioConvert : public QObject
   int (*twolame_set_energy_levels)(twolame_options *,int);
 #endif  // HAVE_TWOLAME
 #ifdef HAVE_LAME
+  lame_global_flags *conv_lame_opts;
   lame_global_flags *(*lame_init)(void);
   void (*lame_set_mode)(lame_global_flags *,int);
   void (*lame_set_num_channels)(lame_global_flags *,int);
@@ -164,6 +204,16 @@ class RDAudioConvert : public QObject
   int (*lame_encode_flush)(lame_global_flags *,unsigned char *,int);
   int (*lame_set_bWriteVbrTag)(lame_global_flags *, int);
 #endif  // HAVE_LAME
+#ifdef HAVE_FLAC
+  FLAC::Encoder::File *conv_flac_encoder;
+#endif  // HAVE_FLAC
+#ifdef HAVE_VORBIS
+  ogg_stream_state conv_ogg_stream;
+  vorbis_info conv_vorbis_info;
+  vorbis_comment conv_vorbis_comment;
+  vorbis_dsp_state conv_vorbis_dsp;
+  vorbis_block conv_vorbis_block;
+#endif  // HAVE_VORBIS
 #ifdef HAVE_MP4_LIBS
   DLMP4 dlmp4;
 #endif
@@ -46,6 +46,9 @@ __RDCae_PlayChannel::__RDCae_PlayChannel(unsigned card,unsigned port)
   for(int i=0;i<2;i++) {
     d_stream_levels[i]=RD_MUTE_DEPTH;
   }
+  for(int i=0;i<3;i++) {
+    d_stream_loudness[i]=RD_MUTE_DEPTH;
+  }
 }
 
 
@@ -88,6 +91,22 @@ void __RDCae_PlayChannel::setStreamLevels(short left_lvl,short right_lvl)
 }
 
 
+void __RDCae_PlayChannel::getStreamLoudness(short lufs[3])
+{
+  for(int i=0;i<3;i++) {
+    lufs[i]=d_stream_loudness[i];
+  }
+}
+
+
+void __RDCae_PlayChannel::setStreamLoudness(short lufs[3])
+{
+  for(int i=0;i<3;i++) {
+    d_stream_loudness[i]=lufs[i];
+  }
+}
+
+
 bool __RDCae_PlayChannel::operator==(const __RDCae_PlayChannel &other) const
 {
   return (d_card==other.d_card)&&(d_port==other.d_port);
@@ -170,8 +189,14 @@ RDCae::RDCae(RDStation *station,RDConfig *config,QObject *parent)
 	cae_input_levels[i][j][k]=-10000;
 	cae_output_levels[i][j][k]=-10000;
       }
+      for(unsigned k=0;k<3;k++) {
+	cae_output_loudness[i][j][k]=-10000;
+      }
     }
+    cae_meter_sequence[i]=0;
+    cae_meter_shm_sequence[i]=0;
   }
+  cae_meter_shm=new RDMeterShm();
 }
 
 
@@ -182,6 +207,7 @@ RDCae::~RDCae() {
   if(cae_meter_socket>=0) {
     close(cae_meter_socket);
   }
+  delete cae_meter_shm;
 }
 
 
@@ -240,6 +266,18 @@ void RDCae::enableMetering(QList<int> *cards)
       }
     }
   }
+  //
+  // If caed(8) is on this host, read meters straight from its shared
+  // segment. Otherwise ask for binary meter frames.  Older versions of
+  // caed(8) will refuse either and carry on sending text updates, which
+  // we still understand.
+  //
+  if(CaeIsLocal()&&cae_meter_shm->attach()) {
+    SendCommand(QString().sprintf("MF %u!",RDMETERSHM_METER_FORMAT));
+  }
+  else {
+    SendCommand(QString().sprintf("MF %u!",RDMETERFRAME_VERSION));
+  }
   SendCommand(cmd+"!");
 }
 
@@ -293,12 +331,33 @@ void RDCae::play(unsigned serial,unsigned length,int speed,bool pitch)
 }
 
 
+void RDCae::playAt(unsigned serial,uint64_t clock,unsigned length,int speed,
+		   bool pitch)
+{
+  int pitch_state=0;
+
+  if(pitch) {
+    pitch_state=1;
+  }
+  SendCommand(QString().sprintf("PA %u %llu %u %d %d!",serial,
+				(unsigned long long)clock,length,speed,
+				pitch_state));
+}
+
+
 void RDCae::stopPlay(unsigned serial)
 {
   SendCommand(QString().sprintf("SP %u!",serial));
 }
 
 
+void RDCae::stopPlayAt(unsigned serial,uint64_t clock)
+{
+  SendCommand(QString().sprintf("SA %u %llu!",serial,
+				(unsigned long long)clock));
+}
+
+
 void RDCae::loadRecord(int card,int stream,QString name,
 		       AudioCoding coding,int chan,int samp_rate,
 		       int bit_rate)
@@ -352,6 +411,14 @@ void RDCae::fadeOutputVolume(unsigned serial,int level,int length)
 }
 
 
+void RDCae::fadeOutputVolumeAt(unsigned serial,uint64_t clock,int level,
+			       int length)
+{
+  SendCommand(QString().sprintf("FA %u %llu %d %d!",serial,
+				(unsigned long long)clock,level,length));
+}
+
+
 void RDCae::setInputLevel(int card,int port,int level)
 {
   SendCommand(QString().sprintf("IL %d %d %d!",card,port,level));
@@ -428,6 +495,30 @@ void RDCae::outputStreamMeterUpdate(unsigned serial,short levels[2])
 }
 
 
+void RDCae::outputLoudnessUpdate(int card,int port,short lufs[3])
+{
+  //
+  // Momentary, short-term and integrated loudness, in 1/100 LU.  Only
+  // sent by caed(8) when [Caed] LoudnessMeters is enabled.
+  //
+  UpdateMeters();
+  for(int i=0;i<3;i++) {
+    lufs[i]=cae_output_loudness[card][port][i];
+  }
+}
+
+
+void RDCae::outputStreamLoudnessUpdate(unsigned serial,short lufs[3])
+{
+  __RDCae_PlayChannel *chan=NULL;
+
+  if((chan=cae_play_channels.value(serial))!=NULL) {
+    UpdateMeters();
+    chan->getStreamLoudness(lufs);
+  }
+}
+
+
 unsigned RDCae::playPosition(unsigned serial)
 {
   __RDCae_PlayChannel *chan=NULL;
@@ -446,6 +537,18 @@ void RDCae::requestTimescale(int card)
 }
 
 
+void RDCae::requestOutputSilence(int card,int port)
+{
+  SendCommand(QString::asprintf("OS %d %d!",card,port));
+}
+
+
+void RDCae::requestSampleClock(int card)
+{
+  SendCommand(QString().sprintf("CK %d!",card));
+}
+
+
 bool RDCae::playPortStatus(int card,int port,unsigned except_serial) const
 {
   for(QMap<unsigned,__RDCae_PlayChannel *>::const_iterator it=
@@ -567,6 +670,18 @@ void RDCae::DispatchCommand(const QString &cmd)
     was_processed=true;
   }
 
+  if((cmds.at(0)=="FC")&&(cmds.size()==3)) {   // Fade Complete
+    if(cmds.at(2)=='+') {
+      unsigned serial=cmds.at(1).toUInt(&ok);
+      if(ok) {
+	if(SerialCheck(serial,LINE_NUMBER)) {
+	  emit playFaded(serial);
+	}
+      }
+    }
+    was_processed=true;
+  }
+
   if((cmds.at(0)=="TS")&&(cmds.size()==3)) {   // Timescaling Support
     int card=cmds.at(1).toInt(&ok);
     if(ok&&(card>=0)&&(card<RD_MAX_CARDS)) {
@@ -575,6 +690,22 @@ void RDCae::DispatchCommand(const QString &cmd)
     was_processed=true;
   }
 
+  if(cmds.at(0)=="CK") {   // Sample Clock
+    if((cmds.size()==5)&&(cmds.at(4)=='+')) {
+      int card=cmds.at(1).toInt(&ok);
+      if(ok&&(card>=0)&&(card<RD_MAX_CARDS)) {
+	uint64_t clock=cmds.at(2).toULongLong(&ok);
+	if(ok) {
+	  unsigned samprate=cmds.at(3).toUInt(&ok);
+	  if(ok) {
+	    emit sampleClockReceived(card,clock,samprate);
+	  }
+	}
+      }
+    }
+    was_processed=true;
+  }
+
   if((cmds.at(0)=="LR")&&(cmds.size()==9)) {   // Load Record
     if(cmds.at(8)=='+') {
       int card=cmds.at(1).toInt(&ok);
@@ -648,12 +779,45 @@ void RDCae::DispatchCommand(const QString &cmd)
     was_processed=true;
   }
 
+  //
+  // Sent both on change and in reply to requestOutputSilence()
+  //
+  if((cmds.at(0)=="OS")&&((cmds.size()==4)||(cmds.size()==5))) {
+    int card=cmds.at(1).toInt(&ok);
+    if(ok&&(card>=0)&&(card<RD_MAX_CARDS)) {
+      int port=cmds.at(2).toInt(&ok);
+      if(ok&&(port>=0)&&(port<RD_MAX_PORTS)) {
+	emit outputSilenceChanged(card,port,cmds.at(3)=="1");
+      }
+    }
+    was_processed=true;
+  }
+
   //
   // Processing stubs
   //
   if(cmds.at(0)=="FV") {  // Fade Output Volume
     was_processed=true;
   }
+  if(cmds.at(0)=="FA") {  // Fade Output Volume At
+    was_processed=true;
+  }
+  if(cmds.at(0)=="PA") {  // Play At
+    was_processed=true;
+  }
+  if(cmds.at(0)=="SA") {  // Stop Play At
+    was_processed=true;
+  }
+  if((cmds.at(0)=="MF")&&(cmds.size()==3)) {  // Meter Format
+    if((cmds.at(1).toUInt()==RDMETERSHM_METER_FORMAT)&&(cmds.at(2)=="-")) {
+      //
+      // Shared meters refused, fall back to UDP
+      //
+      cae_meter_shm->detach();
+      SendCommand(QString().sprintf("MF %u!",RDMETERFRAME_VERSION));
+    }
+    was_processed=true;
+  }
   if(cmds.at(0)=="ME") {  // Meter Enable
     was_processed=true;
   }
@@ -673,14 +837,24 @@ void RDCae::DispatchCommand(const QString &cmd)
 
 void RDCae::UpdateMeters()
 {
-  char msg[1501];
+  char msg[RDMETERFRAME_MAX_SIZE+1];
   int n;
   QStringList args;
   __RDCae_PlayChannel *chan=NULL;
+  short lufs[3];
+  int card;
+  int port;
 
   bool ok=false;
 
-  while((n=read(cae_meter_socket,msg,1500))>0) {
+  if(cae_meter_shm->isValid()) {
+    UpdateMeterShm();
+  }
+  while((n=read(cae_meter_socket,msg,RDMETERFRAME_MAX_SIZE))>0) {
+    if(RDMeterFrame::isMeterFrame(msg,n)) {
+      UpdateMeterFrame(msg,n);
+      continue;
+    }
     msg[n]=0;
     args=QString(msg).split(" ");
     if(args[0]=="ML") {
@@ -715,7 +889,122 @@ void RDCae::UpdateMeters()
 	}
       }
     }
+    if(args[0]=="LL") {
+      if((args.size()==7)&&(args[1]=="O")) {
+	card=args.at(2).toInt();
+	port=args.at(3).toInt();
+	if((card>=0)&&(card<RD_MAX_CARDS)&&(port>=0)&&(port<RD_MAX_PORTS)) {
+	  for(int i=0;i<3;i++) {
+	    cae_output_loudness[card][port][i]=args.at(4+i).toShort();
+	  }
+	}
+      }
+    }
+    if(args[0]=="LO") {
+      if(args.size()==5) {
+	unsigned serial=args.at(1).toUInt(&ok);
+	if(ok) {
+	  if((chan=cae_play_channels.value(serial))!=NULL) {
+	    for(int i=0;i<3;i++) {
+	      lufs[i]=args.at(2+i).toShort();
+	    }
+	    chan->setStreamLoudness(lufs);
+	  }
+	}
+      }
+    }
+  }
+}
+
+
+void RDCae::UpdateMeterFrame(const char *data,int len)
+{
+  __RDCae_PlayChannel *chan=NULL;
+  unsigned card;
+  unsigned serial;
+  unsigned pos;
+  short lvls[2];
+
+  if(!cae_meter_frame.read(data,len)) {
+    return;
+  }
+  card=cae_meter_frame.card();
+  if((card>=RD_MAX_CARDS)||
+     (!RDMeterFrame::isNewer(cae_meter_frame.sequence(),
+			     cae_meter_sequence[card]))) {
+    return;  // Reordered or duplicated datagram
+  }
+  cae_meter_sequence[card]=cae_meter_frame.sequence();
+  for(unsigned i=0;i<RD_MAX_PORTS;i++) {
+    if(cae_meter_frame.inputLevels(i,lvls)) {
+      cae_input_levels[card][i][0]=lvls[0];
+      cae_input_levels[card][i][1]=lvls[1];
+    }
+    if(cae_meter_frame.outputLevels(i,lvls)) {
+      cae_output_levels[card][i][0]=lvls[0];
+      cae_output_levels[card][i][1]=lvls[1];
+    }
+  }
+  for(unsigned i=0;i<cae_meter_frame.streamQuantity();i++) {
+    cae_meter_frame.stream(i,&serial,lvls,&pos);
+    if((chan=cae_play_channels.value(serial))!=NULL) {
+      chan->setStreamLevels(lvls[0],lvls[1]);
+    }
+    emit playPositionChanged(serial,pos);
+  }
+}
+
+
+void RDCae::UpdateMeterShm()
+{
+  __RDCae_PlayChannel *chan=NULL;
+  uint32_t seq;
+
+  for(int i=0;i<RD_MAX_CARDS;i++) {
+    if((cae_meter_shm->sequence(i)==cae_meter_shm_sequence[i])||
+       (!cae_meter_shm->read(i,&cae_meter_shm_data,&seq))) {
+      continue;
+    }
+    cae_meter_shm_sequence[i]=seq;
+    for(int j=0;j<RD_MAX_PORTS;j++) {
+      if((cae_meter_shm_data.input_mask&(1u<<j))!=0) {
+	cae_input_levels[i][j][0]=cae_meter_shm_data.input_levels[j][0];
+	cae_input_levels[i][j][1]=cae_meter_shm_data.input_levels[j][1];
+      }
+      if((cae_meter_shm_data.output_mask&(1u<<j))!=0) {
+	cae_output_levels[i][j][0]=cae_meter_shm_data.output_levels[j][0];
+	cae_output_levels[i][j][1]=cae_meter_shm_data.output_levels[j][1];
+      }
+    }
+    for(int j=0;j<RD_MAX_CAE_STREAMS;j++) {
+      const RDMeterShmStream *strm=cae_meter_shm_data.streams+j;
+      if((strm->owner==cae_meter_port)&&(strm->serial!=0)) {
+	if((chan=cae_play_channels.value(strm->serial))!=NULL) {
+	  chan->setStreamLevels(strm->levels[0],strm->levels[1]);
+	}
+	emit playPositionChanged(strm->serial,strm->position);
+      }
+    }
+  }
+}
+
+
+bool RDCae::CaeIsLocal() const
+{
+  struct sockaddr_in local;
+  struct sockaddr_in peer;
+  socklen_t len;
+
+  len=sizeof(local);
+  if(getsockname(cae_socket,(struct sockaddr *)(&local),&len)<0) {
+    return false;
+  }
+  len=sizeof(peer);
+  if(getpeername(cae_socket,(struct sockaddr *)(&peer),&len)<0) {
+    return false;
   }
+  return ((ntohl(peer.sin_addr.s_addr)>>24)==127)||
+    (peer.sin_addr.s_addr==local.sin_addr.s_addr);
 }
 
 
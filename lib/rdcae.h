@@ -29,6 +29,8 @@
 #include <rdcmd_cache.h>
 #include <rdstation.h>
 #include <rdconfig.h>
+#include <rdmeterframe.h>
+#include <rdmetershm.h>
 
 class __RDCae_PlayChannel
 {
@@ -40,6 +42,8 @@ class __RDCae_PlayChannel
   void setPosition(unsigned pos);
   void getStreamLevels(short lvls[2]);
   void setStreamLevels(short left_lvl,short right_lvl);
+  void getStreamLoudness(short lufs[3]);
+  void setStreamLoudness(short lufs[3]);
   bool operator==(const __RDCae_PlayChannel &other) const;
 
  private:
@@ -47,6 +51,7 @@ class __RDCae_PlayChannel
   unsigned d_port;
   unsigned d_position;
   short d_stream_levels[2];
+  short d_stream_loudness[3];
 };
 
 
@@ -68,7 +73,10 @@ class RDCae : public QObject
   void unloadPlay(unsigned serial);
   void positionPlay(unsigned serial,int pos);
   void play(unsigned serial,unsigned length,int speed,bool pitch);
+  void playAt(unsigned serial,uint64_t clock,unsigned length,int speed,
+	      bool pitch);
   void stopPlay(unsigned serial);
+  void stopPlayAt(unsigned serial,uint64_t clock);
   void loadRecord(int card,int stream,QString name,AudioCoding coding,
 		  int chan,int samp_rate,int bit_rate);
   void unloadRecord(int card,int stream);
@@ -78,6 +86,8 @@ class RDCae : public QObject
   void setInputVolume(int card,int stream,int level);
   void setOutputVolume(unsigned serial,int level);
   void fadeOutputVolume(unsigned serial,int level,int length);
+  void fadeOutputVolumeAt(unsigned serial,uint64_t clock,int level,
+			  int length);
   void setInputLevel(int card,int port,int level);
   void setOutputLevel(int card,int port,int level);
   void setInputMode(int card,int stream,RDCae::ChannelMode mode);
@@ -89,8 +99,12 @@ class RDCae : public QObject
   void inputMeterUpdate(int card,int port,short levels[2]);
   void outputMeterUpdate(int card,int port,short levels[2]);
   void outputStreamMeterUpdate(unsigned serial,short levels[2]);
+  void outputLoudnessUpdate(int card,int port,short lufs[3]);
+  void outputStreamLoudnessUpdate(unsigned serial,short lufs[3]);
   unsigned playPosition(unsigned serial);
   void requestTimescale(int card);
+  void requestOutputSilence(int card,int port);
+  void requestSampleClock(int card);
   bool playPortStatus(int card,int port,unsigned except_serial=0) const;
 
  signals:
@@ -99,6 +113,7 @@ class RDCae : public QObject
   void playPositioned(unsigned serial,unsigned pos);
   void playing(unsigned serial);
   void playStopped(unsigned serial);
+  void playFaded(unsigned serial);
   void playUnloaded(unsigned serial);
   void recordLoaded(int card,int stream);
   void recording(int card,int stream);
@@ -109,7 +124,9 @@ class RDCae : public QObject
   void inputStatusChanged(int card,int stream,bool state);
   void playPositionChanged(unsigned serial,unsigned sample);
   void timescalingSupported(int card,bool state);
+  void sampleClockReceived(int card,uint64_t clock,unsigned samprate);
   void playPortStatusChanged(int card,int port,bool status);
+  void outputSilenceChanged(int card,int port,bool state);
 
  private slots:
   void readyData();
@@ -119,6 +136,9 @@ class RDCae : public QObject
   void DispatchCommand(const QString &cmd);
   bool SerialCheck(unsigned serial,int linenum) const;
   void UpdateMeters();
+  void UpdateMeterFrame(const char *data,int len);
+  void UpdateMeterShm();
+  bool CaeIsLocal() const;
   unsigned next_serial_number;
   int cae_socket;
   bool debug;
@@ -131,6 +151,12 @@ class RDCae : public QObject
   int cae_meter_port_range;
   short cae_input_levels[RD_MAX_CARDS][RD_MAX_PORTS][2];
   short cae_output_levels[RD_MAX_CARDS][RD_MAX_PORTS][2];
+  short cae_output_loudness[RD_MAX_CARDS][RD_MAX_PORTS][3];
+  RDMeterFrame cae_meter_frame;
+  uint32_t cae_meter_sequence[RD_MAX_CARDS];
+  RDMeterShm *cae_meter_shm;
+  RDMeterShmData cae_meter_shm_data;
+  uint32_t cae_meter_shm_sequence[RD_MAX_CARDS];
   QMap<unsigned,__RDCae_PlayChannel *> cae_play_channels;
   RDStation *cae_station;
   RDConfig *cae_config;
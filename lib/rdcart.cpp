@@ -37,6 +37,7 @@
 #include <rdescape_string.h>
 #include <rdformpost.h>
 #include <rdgroup.h>
+#include <rdpeakpyramid.h>
 #include <rdstation.h>
 #include <rdsystem.h>
 #include <rdtextvalidator.h>
@@ -1758,6 +1759,7 @@ bool RDCart::removeCutAudio(RDStation *station,RDUser *user,unsigned cart_num,
   if(user==NULL) { 
     unlink(RDCut::pathName(cutname).toUtf8());
     unlink((RDCut::pathName(cutname)+".energy").toUtf8());
+    unlink(RDPeakPyramid::sidecarName(RDCut::pathName(cutname)).toUtf8());
     sql=QString("delete from `CUT_EVENTS` where ")+
       "`CUT_NAME`='"+cutname+"'";
     q=new RDSqlQuery(sql);
@@ -309,6 +309,48 @@ int RDConfig::alsaChannelsPerPcm() const
 }
 
 
+int RDConfig::nullCards() const
+{
+  return conf_null_cards;
+}
+
+
+int RDConfig::nullPorts() const
+{
+  return conf_null_ports;
+}
+
+
+int RDConfig::nullStreams() const
+{
+  return conf_null_streams;
+}
+
+
+int RDConfig::nullPeriodSize() const
+{
+  return conf_null_period_size;
+}
+
+
+int RDConfig::nullSpeed() const
+{
+  return conf_null_speed;
+}
+
+
+QString RDConfig::nullTapFile() const
+{
+  return conf_null_tap_file;
+}
+
+
+int RDConfig::nullTapPort() const
+{
+  return conf_null_tap_port;
+}
+
+
 QString RDConfig::stationName() const
 {
   return conf_station_name;
@@ -507,6 +549,48 @@ bool RDConfig::testOutputStreams() const
 }
 
 
+int RDConfig::caeReaderThreads() const
+{
+  return conf_cae_reader_threads;
+}
+
+
+int RDConfig::caeTimescaleThreads() const
+{
+  return conf_cae_timescale_threads;
+}
+
+
+int RDConfig::caePrerollLength() const
+{
+  return conf_cae_preroll_length;
+}
+
+
+int RDConfig::caeStatisticsInterval() const
+{
+  return conf_cae_statistics_interval;
+}
+
+
+int RDConfig::caeMaxStreams() const
+{
+  return conf_cae_max_streams;
+}
+
+
+bool RDConfig::caeLoudnessMeters() const
+{
+  return conf_cae_loudness_meters;
+}
+
+
+bool RDConfig::caeDither() const
+{
+  return conf_cae_dither;
+}
+
+
 bool RDConfig::useRealtime()
 {
   return conf_use_realtime;
@@ -684,6 +768,34 @@ bool RDConfig::load()
     profile->intValue("Alsa","PeriodSize",RD_ALSA_DEFAULT_PERIOD_SIZE);
   conf_alsa_channels_per_pcm=profile->intValue("Alsa","ChannelsPerPcm",-1);
 
+  conf_null_cards=profile->intValue("NullDriver","Cards",0);
+  if(conf_null_cards<0) {
+    conf_null_cards=0;
+  }
+  conf_null_ports=
+    profile->intValue("NullDriver","Ports",RD_NULL_DEFAULT_PORTS);
+  if((conf_null_ports<1)||(conf_null_ports>RD_MAX_PORTS)) {
+    conf_null_ports=RD_NULL_DEFAULT_PORTS;
+  }
+  conf_null_streams=profile->intValue("NullDriver","Streams",RD_MAX_STREAMS);
+  if((conf_null_streams<1)||(conf_null_streams>RD_MAX_CAE_STREAMS)) {
+    conf_null_streams=RD_MAX_STREAMS;
+  }
+  conf_null_period_size=
+    profile->intValue("NullDriver","PeriodSize",RD_NULL_DEFAULT_PERIOD_SIZE);
+  if(conf_null_period_size<16) {
+    conf_null_period_size=RD_NULL_DEFAULT_PERIOD_SIZE;
+  }
+  conf_null_speed=profile->intValue("NullDriver","Speed",1);
+  if(conf_null_speed<0) {
+    conf_null_speed=1;
+  }
+  conf_null_tap_file=profile->stringValue("NullDriver","TapFile","");
+  conf_null_tap_port=profile->intValue("NullDriver","TapPort",0);
+  if((conf_null_tap_port<0)||(conf_null_tap_port>=conf_null_ports)) {
+    conf_null_tap_port=0;
+  }
+
   conf_disable_maint_checks=
     profile->boolValue("Hacks","DisableMaintChecks",false);
   conf_save_webget_files_directory=
@@ -735,6 +847,38 @@ bool RDConfig::load()
 
   conf_enable_mixer_logging=profile->boolValue("Caed","EnableMixerLogging");
   conf_test_output_streams=profile->boolValue("Caed","TestOutputStreams");
+  conf_cae_reader_threads=profile->intValue("Caed","ReaderThreads",
+					    RD_CAE_DEFAULT_READER_THREADS);
+  if(conf_cae_reader_threads<1) {
+    conf_cae_reader_threads=1;
+  }
+  conf_cae_timescale_threads=
+    profile->intValue("Caed","TimescaleThreads",
+		      RD_CAE_DEFAULT_TIMESCALE_THREADS);
+  if(conf_cae_timescale_threads<1) {
+    conf_cae_timescale_threads=1;
+  }
+  conf_cae_preroll_length=profile->intValue("Caed","PrerollLength",
+					    RD_CAE_DEFAULT_PREROLL_LENGTH);
+  if(conf_cae_preroll_length<0) {
+    conf_cae_preroll_length=0;
+  }
+  conf_cae_statistics_interval=
+    profile->intValue("Caed","StatisticsInterval",
+		      RD_CAE_DEFAULT_STATISTICS_INTERVAL);
+  if(conf_cae_statistics_interval<0) {
+    conf_cae_statistics_interval=0;
+  }
+  conf_cae_max_streams=profile->intValue("Caed","MaxStreams",
+					 RD_CAE_DEFAULT_MAX_STREAMS);
+  if(conf_cae_max_streams<1) {
+    conf_cae_max_streams=1;
+  }
+  if(conf_cae_max_streams>RD_MAX_CAE_STREAMS) {
+    conf_cae_max_streams=RD_MAX_CAE_STREAMS;
+  }
+  conf_cae_loudness_meters=profile->boolValue("Caed","LoudnessMeters",false);
+  conf_cae_dither=profile->boolValue("Caed","Dither",false);
   conf_use_realtime=profile->boolValue("Tuning","UseRealtime",false);
   conf_realtime_priority=profile->intValue("Tuning","RealtimePriority",9);
   conf_transcoding_delay=profile->intValue("Tuning","TranscodingDelay");
@@ -812,6 +956,13 @@ void RDConfig::clear()
   conf_alsa_period_quantity=RD_ALSA_DEFAULT_PERIOD_QUANTITY;
   conf_alsa_period_size=RD_ALSA_DEFAULT_PERIOD_SIZE;
   conf_alsa_channels_per_pcm=-1;
+  conf_null_cards=0;
+  conf_null_ports=RD_NULL_DEFAULT_PORTS;
+  conf_null_streams=RD_MAX_STREAMS;
+  conf_null_period_size=RD_NULL_DEFAULT_PERIOD_SIZE;
+  conf_null_speed=1;
+  conf_null_tap_file="";
+  conf_null_tap_port=0;
   conf_station_name="";
   conf_password="";
   conf_http_user_agent="";
@@ -858,6 +1009,13 @@ void RDConfig::clear()
   conf_rn_rml_gid=65535;
   conf_enable_mixer_logging=false;
   conf_test_output_streams=false;
+  conf_cae_reader_threads=RD_CAE_DEFAULT_READER_THREADS;
+  conf_cae_timescale_threads=RD_CAE_DEFAULT_TIMESCALE_THREADS;
+  conf_cae_preroll_length=RD_CAE_DEFAULT_PREROLL_LENGTH;
+  conf_cae_statistics_interval=RD_CAE_DEFAULT_STATISTICS_INTERVAL;
+  conf_cae_max_streams=RD_CAE_DEFAULT_MAX_STREAMS;
+  conf_cae_loudness_meters=false;
+  conf_cae_dither=false;
   conf_use_realtime=false;
   conf_realtime_priority=9;
   conf_transcoding_delay=0;
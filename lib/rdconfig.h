@@ -75,6 +75,13 @@ class RDConfig
   int alsaPeriodQuantity() const;
   int alsaPeriodSize() const;
   int alsaChannelsPerPcm() const;
+  int nullCards() const;
+  int nullPorts() const;
+  int nullStreams() const;
+  int nullPeriodSize() const;
+  int nullSpeed() const;
+  QString nullTapFile() const;
+  int nullTapPort() const;
   QString stationName() const;
   QString password() const;
   QString audioOwner() const;
@@ -115,6 +122,13 @@ class RDConfig
   bool killPypadAfterJsonError() const;
   bool enableMixerLogging() const;
   bool testOutputStreams() const;
+  int caeReaderThreads() const;
+  int caeTimescaleThreads() const;
+  int caePrerollLength() const;
+  int caeStatisticsInterval() const;
+  int caeMaxStreams() const;
+  bool caeLoudnessMeters() const;
+  bool caeDither() const;
   uid_t uid() const;
   gid_t gid() const;
   uid_t pypadUid() const;
@@ -166,6 +180,13 @@ class RDConfig
   int conf_alsa_period_quantity;
   int conf_alsa_period_size;
   int conf_alsa_channels_per_pcm;
+  int conf_null_cards;
+  int conf_null_ports;
+  int conf_null_streams;
+  int conf_null_period_size;
+  int conf_null_speed;
+  QString conf_null_tap_file;
+  int conf_null_tap_port;
   QString conf_station_name;
   QString conf_password;
   QString conf_audio_owner;
@@ -211,6 +232,13 @@ class RDConfig
   gid_t conf_rn_rml_gid;
   bool conf_enable_mixer_logging;
   bool conf_test_output_streams;
+  int conf_cae_reader_threads;
+  int conf_cae_timescale_threads;
+  int conf_cae_preroll_length;
+  int conf_cae_statistics_interval;
+  int conf_cae_max_streams;
+  bool conf_cae_loudness_meters;
+  bool conf_cae_dither;
   bool conf_use_realtime;
   int conf_transcoding_delay;
   int conf_realtime_priority;
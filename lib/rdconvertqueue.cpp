@@ -0,0 +1,328 @@
+// rdconvertqueue.cpp
+//
+// Run audio conversions on a pool of worker threads.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU Library General Public License
+//   version 2 as published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include <syslog.h>
+#include <unistd.h>
+
+#include <rdapplication.h>
+
+#include "rdconvertqueue.h"
+
+RDConvertQueue::Job::Job(int job_id,RDConvertQueue::Priority prio,
+			 RDAudioConvert *conv)
+{
+  id=job_id;
+  priority=prio;
+  converter=conv;
+  error=RDAudioConvert::ErrorOk;
+  started=false;
+  done=false;
+  started_sent=false;
+  progress=0;
+}
+
+
+RDConvertQueue::Job::~Job()
+{
+  delete converter;
+}
+
+
+
+
+RDConvertQueue::RDConvertQueue(int threads,QObject *parent)
+  : QObject(parent)
+{
+  pthread_t thread;
+  pthread_attr_t pthread_attr;
+
+  queue_exiting=false;
+  queue_next_id=1;
+  pthread_mutex_init(&queue_mutex,NULL);
+  pthread_cond_init(&queue_cond,NULL);
+
+  queue_poll_timer=new QTimer(this);
+  connect(queue_poll_timer,SIGNAL(timeout()),this,SLOT(pollData()));
+
+  //
+  // Default to one worker per core
+  //
+  if(threads<=0) {
+    threads=sysconf(_SC_NPROCESSORS_ONLN);
+    if(threads<=0) {
+      threads=1;
+    }
+  }
+  pthread_attr_init(&pthread_attr);
+  for(int i=0;i<threads;i++) {
+    if(pthread_create(&thread,&pthread_attr,ThreadCallback,this)==0) {
+      queue_threads.push_back(thread);
+    }
+    else {
+      rda->syslog(LOG_WARNING,"unable to start conversion thread %d",i);
+    }
+  }
+  pthread_attr_destroy(&pthread_attr);
+}
+
+
+RDConvertQueue::~RDConvertQueue()
+{
+  //
+  // Running jobs are cancelled, queued ones simply dropped
+  //
+  pthread_mutex_lock(&queue_mutex);
+  queue_exiting=true;
+  queue_pending.clear();
+  for(QMap<int,Job *>::const_iterator it=queue_jobs.constBegin();
+      it!=queue_jobs.constEnd();it++) {
+    it.value()->converter->cancel();
+  }
+  pthread_cond_broadcast(&queue_cond);
+  pthread_mutex_unlock(&queue_mutex);
+  for(int i=0;i<queue_threads.size();i++) {
+    pthread_join(queue_threads.at(i),NULL);
+  }
+  for(QMap<int,Job *>::const_iterator it=queue_jobs.constBegin();
+      it!=queue_jobs.constEnd();it++) {
+    delete it.value();
+  }
+  pthread_cond_destroy(&queue_cond);
+  pthread_mutex_destroy(&queue_mutex);
+  delete queue_poll_timer;
+}
+
+
+int RDConvertQueue::threadQuantity() const
+{
+  return queue_threads.size();
+}
+
+
+int RDConvertQueue::jobQuantity() const
+{
+  int ret;
+
+  pthread_mutex_lock(&queue_mutex);
+  ret=queue_jobs.size();
+  pthread_mutex_unlock(&queue_mutex);
+
+  return ret;
+}
+
+
+int RDConvertQueue::addJob(RDAudioConvert *conv,RDConvertQueue::Priority prio)
+{
+  Job *job=NULL;
+
+  pthread_mutex_lock(&queue_mutex);
+  job=new Job(queue_next_id++,prio,conv);
+  queue_jobs[job->id]=job;
+  Enqueue(job);
+  pthread_cond_signal(&queue_cond);
+  pthread_mutex_unlock(&queue_mutex);
+  if(!queue_poll_timer->isActive()) {
+    queue_poll_timer->start(RDCONVERTQUEUE_POLL_INTERVAL);
+  }
+
+  return job->id;
+}
+
+
+bool RDConvertQueue::setPriority(int id,RDConvertQueue::Priority prio)
+{
+  //
+  // Only has an effect on jobs that have yet to be started
+  //
+  bool ret=false;
+
+  pthread_mutex_lock(&queue_mutex);
+  for(int i=0;i<queue_pending.size();i++) {
+    if(queue_pending.at(i)->id==id) {
+      Job *job=queue_pending.takeAt(i);
+      job->priority=prio;
+      Enqueue(job);
+      ret=true;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&queue_mutex);
+
+  return ret;
+}
+
+
+int RDConvertQueue::progress(int id) const
+{
+  int ret=-1;
+
+  pthread_mutex_lock(&queue_mutex);
+  QMap<int,Job *>::const_iterator it=queue_jobs.constFind(id);
+  if(it!=queue_jobs.constEnd()) {
+    ret=it.value()->converter->progress();
+  }
+  pthread_mutex_unlock(&queue_mutex);
+
+  return ret;
+}
+
+
+void RDConvertQueue::cancel(int id)
+{
+  pthread_mutex_lock(&queue_mutex);
+  QMap<int,Job *>::const_iterator it=queue_jobs.constFind(id);
+  if(it!=queue_jobs.constEnd()) {
+    Job *job=it.value();
+    if(job->started) {
+      job->converter->cancel();
+    }
+    else {
+      queue_pending.removeAll(job);
+      job->error=RDAudioConvert::ErrorCancelled;
+      job->done=true;
+    }
+  }
+  pthread_mutex_unlock(&queue_mutex);
+}
+
+
+void RDConvertQueue::cancelAll()
+{
+  pthread_mutex_lock(&queue_mutex);
+  queue_pending.clear();
+  for(QMap<int,Job *>::const_iterator it=queue_jobs.constBegin();
+      it!=queue_jobs.constEnd();it++) {
+    Job *job=it.value();
+    if(job->started) {
+      job->converter->cancel();
+    }
+    else {
+      job->error=RDAudioConvert::ErrorCancelled;
+      job->done=true;
+    }
+  }
+  pthread_mutex_unlock(&queue_mutex);
+}
+
+
+void RDConvertQueue::pollData()
+{
+  QList<int> started;
+  QList<int> progressed;
+  QList<int> percents;
+  QList<Job *> finished;
+  bool idle=false;
+
+  //
+  // Collect state changes under the lock, then signal them without it so
+  // that slots are free to call back into the queue
+  //
+  pthread_mutex_lock(&queue_mutex);
+  QMap<int,Job *>::iterator it=queue_jobs.begin();
+  while(it!=queue_jobs.end()) {
+    Job *job=it.value();
+    if(job->started) {
+      if(!job->started_sent) {
+	started.push_back(job->id);
+	job->started_sent=true;
+      }
+      int pct=job->converter->progress();
+      if(pct!=job->progress) {
+	job->progress=pct;
+	progressed.push_back(job->id);
+	percents.push_back(pct);
+      }
+    }
+    if(job->done) {
+      finished.push_back(job);
+      it=queue_jobs.erase(it);
+    }
+    else {
+      it++;
+    }
+  }
+  idle=queue_jobs.size()==0;
+  pthread_mutex_unlock(&queue_mutex);
+
+  for(int i=0;i<started.size();i++) {
+    emit jobStarted(started.at(i));
+  }
+  for(int i=0;i<progressed.size();i++) {
+    emit jobProgress(progressed.at(i),percents.at(i));
+  }
+  for(int i=0;i<finished.size();i++) {
+    emit jobFinished(finished.at(i)->id,finished.at(i)->error);
+    delete finished.at(i);
+  }
+  if(idle&&(jobQuantity()==0)) {
+    queue_poll_timer->stop();
+    emit allFinished();
+  }
+}
+
+
+void *RDConvertQueue::ThreadCallback(void *ptr)
+{
+  RDConvertQueue *queue=(RDConvertQueue *)ptr;
+
+  queue->Run();
+
+  return NULL;
+}
+
+
+void RDConvertQueue::Run()
+{
+  Job *job=NULL;
+  RDAudioConvert::ErrorCode err;
+
+  pthread_mutex_lock(&queue_mutex);
+  while(!queue_exiting) {
+    if(queue_pending.size()==0) {
+      pthread_cond_wait(&queue_cond,&queue_mutex);
+      continue;
+    }
+    job=queue_pending.takeFirst();
+    job->started=true;
+    pthread_mutex_unlock(&queue_mutex);
+
+    err=job->converter->convert();
+
+    pthread_mutex_lock(&queue_mutex);
+    job->error=err;
+    job->done=true;
+  }
+  pthread_mutex_unlock(&queue_mutex);
+}
+
+
+void RDConvertQueue::Enqueue(Job *job)
+{
+  //
+  // Must be called with the queue locked
+  //
+  int i=0;
+
+  while((i<queue_pending.size())&&
+	(queue_pending.at(i)->priority>=job->priority)) {
+    i++;
+  }
+  queue_pending.insert(i,job);
+}
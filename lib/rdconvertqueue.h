@@ -0,0 +1,99 @@
+// rdconvertqueue.h
+//
+// Run audio conversions on a pool of worker threads.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU Library General Public License
+//   version 2 as published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef RDCONVERTQUEUE_H
+#define RDCONVERTQUEUE_H
+
+#include <pthread.h>
+
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QTimer>
+
+#include <rdaudioconvert.h>
+
+#define RDCONVERTQUEUE_POLL_INTERVAL 250
+
+//
+// Each job is a fully set up RDAudioConvert, which the queue takes
+// ownership of. Jobs are started in order of priority, and in the order
+// they were added within the same priority. All signals are emitted from
+// the thread that owns the queue, which must be running an event loop.
+//
+// Conversions run outside of that thread, so must not need the database.
+// MPEG jobs that carry destination wave data should have their RDXL set
+// with RDAudioConvert::setDestinationRdxl().
+//
+class RDConvertQueue : public QObject
+{
+  Q_OBJECT;
+ public:
+  enum Priority {PriorityLow=0,PriorityNormal=1,PriorityHigh=2};
+  RDConvertQueue(int threads=0,QObject *parent=0);
+  ~RDConvertQueue();
+  int threadQuantity() const;
+  int jobQuantity() const;
+  int addJob(RDAudioConvert *conv,
+	     RDConvertQueue::Priority prio=RDConvertQueue::PriorityNormal);
+  bool setPriority(int id,RDConvertQueue::Priority prio);
+  int progress(int id) const;
+  void cancel(int id);
+  void cancelAll();
+
+ signals:
+  void jobStarted(int id);
+  void jobProgress(int id,int percent);
+  void jobFinished(int id,RDAudioConvert::ErrorCode err);
+  void allFinished();
+
+ private slots:
+  void pollData();
+
+ private:
+  class Job
+  {
+   public:
+    Job(int job_id,RDConvertQueue::Priority prio,RDAudioConvert *conv);
+    ~Job();
+    int id;
+    RDConvertQueue::Priority priority;
+    RDAudioConvert *converter;
+    RDAudioConvert::ErrorCode error;
+    bool started;
+    bool done;
+    bool started_sent;
+    int progress;
+  };
+  static void *ThreadCallback(void *ptr);
+  void Run();
+  void Enqueue(Job *job);
+  QList<Job *> queue_pending;
+  QMap<int,Job *> queue_jobs;
+  QList<pthread_t> queue_threads;
+  mutable pthread_mutex_t queue_mutex;
+  pthread_cond_t queue_cond;
+  bool queue_exiting;
+  int queue_next_id;
+  QTimer *queue_poll_timer;
+};
+
+
+#endif  // RDCONVERTQUEUE_H
@@ -1495,6 +1495,7 @@ unsigned RDFeed::postFile(const QString &srcfile,QString *err_msg)
   case RDAudioConvert::ErrorInvalidSpeed:
   case RDAudioConvert::ErrorFormatError:
   case RDAudioConvert::ErrorNoSpace:
+  case RDAudioConvert::ErrorCancelled:
     delete settings;
     delete conv;
     //    *err=RDFeed::ErrorGeneral;
@@ -24,10 +24,12 @@
 #include <rdflacdecode.h>
 
 #ifdef HAVE_FLAC
-RDFlacDecode::RDFlacDecode(SNDFILE *dst_sf)
+RDFlacDecode::RDFlacDecode(bool (*write_cb)(const float pcm[],unsigned frames,
+					    void *priv),void *priv)
   : FLAC::Decoder::File()
 {
-  flac_sf_dst=dst_sf;
+  flac_write_cb=write_cb;
+  flac_write_priv=priv;
   flac_start_point=-1;
   flac_end_point=-1;
 }
@@ -40,11 +42,10 @@ void RDFlacDecode::setRange(int start_pt,int end_pt)
 }
 
 
-void RDFlacDecode::decode(RDWaveFile *wave,float *peak)
+void RDFlacDecode::decode(RDWaveFile *wave)
 {
   flac_active=true;
   flac_wavefile=wave;
-  flac_peak_sample=peak;
   if(flac_start_point<0) {
     flac_start_sample=0;
   }
@@ -82,19 +83,19 @@ RDFlacDecode::write_callback(const ::FLAC__Frame *frame,
   }
   if(flac_total_frames>=flac_start_sample) {
     if((flac_total_frames+frame->header.blocksize)<(unsigned)flac_end_sample) {    // Write entire buffer 
-      UpdatePeak(pcm,frame->header.blocksize*flac_wavefile->getChannels());
-      sf_writef_float(flac_sf_dst,pcm,frame->header.blocksize);
+      if(!WritePcm(pcm,frame->header.blocksize)) {
+	delete[] pcm;
+	return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+      }
     }
     else {
       if((unsigned)flac_total_frames<(flac_total_frames+frame->header.blocksize)) {  // Write start of buffer
-	UpdatePeak(pcm,
-		   (flac_total_frames+frame->header.blocksize-flac_end_sample)*flac_wavefile->getChannels());
-	sf_writef_float(flac_sf_dst,pcm,flac_total_frames+frame->header.blocksize-flac_end_sample);
+	WritePcm(pcm,flac_total_frames+frame->header.blocksize-flac_end_sample);
 	//
 	// Done
 	//
-	sf_close(flac_sf_dst);
 	flac_active=false;
+	delete[] pcm;
 	return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
       }
     }
@@ -102,13 +103,15 @@ RDFlacDecode::write_callback(const ::FLAC__Frame *frame,
   else {
     int diff=flac_total_frames+frame->header.blocksize-flac_start_sample;
     if(diff>0) {   // Write end of buffer
-      UpdatePeak(pcm+diff,(frame->header.blocksize-diff)*flac_wavefile->getChannels());
-      sf_writef_float(flac_sf_dst,pcm+diff,frame->header.blocksize-diff);
+      if(!WritePcm(pcm+diff,frame->header.blocksize-diff)) {
+	delete[] pcm;
+	return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+      }
     }
   }
   flac_total_frames+=frame->header.blocksize;
 
-  delete pcm;
+  delete[] pcm;
   return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
 }
 
@@ -124,18 +127,16 @@ void RDFlacDecode::metadata_callback(const FLAC__StreamMetadata*)
 }
 
 
-void RDFlacDecode::UpdatePeak(const float data[],ssize_t len)
+bool RDFlacDecode::WritePcm(const float pcm[],unsigned frames)
 {
-  float peak;
-
   if(!flac_active) {
-    return;
+    return false;
   }
-  for(ssize_t i=0;i<len;i++) {
-    if((peak=fabsf(data[i]))>*flac_peak_sample) {
-      *flac_peak_sample=peak;
-    }
+  if(!flac_write_cb(pcm,frames,flac_write_priv)) {
+    flac_active=false;
+    return false;
   }
+  return true;
 }
 
 #endif  // HAVE_FLAC
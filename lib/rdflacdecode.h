@@ -21,7 +21,6 @@
 #ifndef RDFLACDECODE_H
 #define RDFLACDECODE_H
 
-#include <sndfile.h>
 #ifdef HAVE_FLAC
 #include <FLAC++/decoder.h>
 
@@ -30,9 +29,10 @@
 class RDFlacDecode : public FLAC::Decoder::File
 {
  public:
-  RDFlacDecode(SNDFILE *dst_sf);
+  RDFlacDecode(bool (*write_cb)(const float pcm[],unsigned frames,void *priv),
+	       void *priv);
   void setRange(int start_pt,int end_pt);
-  void decode(RDWaveFile *src_wave,float *peak);
+  void decode(RDWaveFile *src_wave);
 
  protected:
   FLAC__StreamDecoderWriteStatus 
@@ -42,13 +42,13 @@ class RDFlacDecode : public FLAC::Decoder::File
   void metadata_callback(const FLAC__StreamMetadata*);
 
  private:
-  void UpdatePeak(const float data[],ssize_t len);
-  SNDFILE *flac_sf_dst;
+  bool WritePcm(const float pcm[],unsigned frames);
+  bool (*flac_write_cb)(const float pcm[],unsigned frames,void *priv);
+  void *flac_write_priv;
   int flac_start_point;
   int flac_end_point;
   int flac_start_sample;
   int flac_end_sample;
-  float *flac_peak_sample;
   int flac_total_frames;
   RDWaveFile *flac_wavefile;
   bool flac_active;
@@ -0,0 +1,228 @@
+// rdmeterframe.cpp
+//
+// Binary meter/position datagram exchanged between caed(8) and RDCae.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include <string.h>
+
+#include <rdmeterframe.h>
+
+//
+// How far back a sequence number may jump before we assume that caed(8)
+// has been restarted, rather than that the datagram is stale
+//
+#define RDMETERFRAME_RESTART_WINDOW 1000
+
+RDMeterFrame::RDMeterFrame()
+{
+  clear(0,0);
+}
+
+
+unsigned RDMeterFrame::card() const
+{
+  return frame_data[5];
+}
+
+
+uint32_t RDMeterFrame::sequence() const
+{
+  return ReadUInt32(8);
+}
+
+
+bool RDMeterFrame::inputLevels(unsigned port,short lvls[2]) const
+{
+  return GetLevels(RDMETERFRAME_HEADER_SIZE,12,port,lvls);
+}
+
+
+bool RDMeterFrame::outputLevels(unsigned port,short lvls[2]) const
+{
+  return GetLevels(RDMETERFRAME_HEADER_SIZE+4*PortSlots(),16,port,lvls);
+}
+
+
+unsigned RDMeterFrame::streamQuantity() const
+{
+  return frame_data[7];
+}
+
+
+void RDMeterFrame::stream(unsigned n,unsigned *serial,short lvls[2],
+			  unsigned *pos) const
+{
+  int offset=RDMETERFRAME_HEADER_SIZE+8*PortSlots()+
+    RDMETERFRAME_STREAM_SIZE*n;
+
+  *serial=ReadUInt32(offset);
+  lvls[0]=(int16_t)ReadUInt16(offset+4);
+  lvls[1]=(int16_t)ReadUInt16(offset+6);
+  *pos=ReadUInt32(offset+8);
+}
+
+
+const char *RDMeterFrame::data() const
+{
+  return (const char *)frame_data;
+}
+
+
+int RDMeterFrame::size() const
+{
+  return frame_size;
+}
+
+
+void RDMeterFrame::clear(unsigned card,uint32_t seq)
+{
+  memset(frame_data,0,RDMETERFRAME_HEADER_SIZE+8*RD_MAX_PORTS);
+  memcpy(frame_data,"RDMF",4);
+  frame_data[4]=RDMETERFRAME_VERSION;
+  frame_data[5]=card;
+  frame_data[6]=RD_MAX_PORTS;
+  frame_data[7]=0;
+  WriteUInt32(8,seq);
+  frame_size=RDMETERFRAME_HEADER_SIZE+8*RD_MAX_PORTS;
+}
+
+
+void RDMeterFrame::setInputLevels(unsigned port,const short lvls[2])
+{
+  SetLevels(RDMETERFRAME_HEADER_SIZE,12,port,lvls);
+}
+
+
+void RDMeterFrame::setOutputLevels(unsigned port,const short lvls[2])
+{
+  SetLevels(RDMETERFRAME_HEADER_SIZE+4*RD_MAX_PORTS,16,port,lvls);
+}
+
+
+bool RDMeterFrame::addStream(unsigned serial,const short lvls[2],
+			     unsigned pos)
+{
+  if(frame_data[7]>=RD_MAX_CAE_STREAMS) {
+    return false;
+  }
+  WriteUInt32(frame_size,serial);
+  WriteUInt16(frame_size+4,lvls[0]);
+  WriteUInt16(frame_size+6,lvls[1]);
+  WriteUInt32(frame_size+8,pos);
+  frame_size+=RDMETERFRAME_STREAM_SIZE;
+  frame_data[7]++;
+
+  return true;
+}
+
+
+bool RDMeterFrame::read(const char *data,int len)
+{
+  if(!isMeterFrame(data,len)) {
+    return false;
+  }
+  if(((uint8_t)data[6]>32)||((uint8_t)data[7]>RD_MAX_CAE_STREAMS)) {
+    return false;
+  }
+  int size=RDMETERFRAME_HEADER_SIZE+8*(uint8_t)data[6]+
+    RDMETERFRAME_STREAM_SIZE*(uint8_t)data[7];
+  if((len<size)||(size>RDMETERFRAME_MAX_SIZE)) {
+    return false;
+  }
+  memcpy(frame_data,data,size);
+  frame_size=size;
+
+  return true;
+}
+
+
+bool RDMeterFrame::isMeterFrame(const char *data,int len)
+{
+  return (len>=RDMETERFRAME_HEADER_SIZE)&&(memcmp(data,"RDMF",4)==0)&&
+    (data[4]==RDMETERFRAME_VERSION);
+}
+
+
+bool RDMeterFrame::isNewer(uint32_t seq,uint32_t last_seq)
+{
+  int32_t diff=(int32_t)(seq-last_seq);
+
+  return (diff>0)||(diff<-RDMETERFRAME_RESTART_WINDOW);
+}
+
+
+unsigned RDMeterFrame::PortSlots() const
+{
+  return frame_data[6];
+}
+
+
+void RDMeterFrame::SetLevels(int offset,int maskoff,unsigned port,
+			     const short lvls[2])
+{
+  if(port<RD_MAX_PORTS) {
+    WriteUInt16(offset+4*port,lvls[0]);
+    WriteUInt16(offset+4*port+2,lvls[1]);
+    WriteUInt32(maskoff,ReadUInt32(maskoff)|(1u<<port));
+  }
+}
+
+
+bool RDMeterFrame::GetLevels(int offset,int maskoff,unsigned port,
+			     short lvls[2]) const
+{
+  if((port>=PortSlots())||((ReadUInt32(maskoff)&(1u<<port))==0)) {
+    return false;
+  }
+  lvls[0]=(int16_t)ReadUInt16(offset+4*port);
+  lvls[1]=(int16_t)ReadUInt16(offset+4*port+2);
+
+  return true;
+}
+
+
+void RDMeterFrame::WriteUInt16(int offset,uint16_t value)
+{
+  frame_data[offset]=0xFF&value;
+  frame_data[offset+1]=0xFF&(value>>8);
+}
+
+
+void RDMeterFrame::WriteUInt32(int offset,uint32_t value)
+{
+  for(int i=0;i<4;i++) {
+    frame_data[offset+i]=0xFF&(value>>(8*i));
+  }
+}
+
+
+uint16_t RDMeterFrame::ReadUInt16(int offset) const
+{
+  return (uint16_t)frame_data[offset]|((uint16_t)frame_data[offset+1]<<8);
+}
+
+
+uint32_t RDMeterFrame::ReadUInt32(int offset) const
+{
+  uint32_t ret=0;
+
+  for(int i=0;i<4;i++) {
+    ret|=(uint32_t)frame_data[offset+i]<<(8*i);
+  }
+  return ret;
+}
@@ -0,0 +1,95 @@
+// rdmeterframe.h
+//
+// Binary meter/position datagram exchanged between caed(8) and RDCae.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef RDMETERFRAME_H
+#define RDMETERFRAME_H
+
+#include <stdint.h>
+
+#include <rd.h>
+
+//
+// One frame carries every port level for a single card, plus the levels
+// and positions of the recipient's own playout streams on that card.
+// All fields are little-endian.
+//
+//   Offset  Size  Field
+//   ------  ----  -----
+//        0     4  Magic ("RDMF")
+//        4     1  Version
+//        5     1  Card number
+//        6     1  Port slots (P)
+//        7     1  Stream entries (S)
+//        8     4  Sequence number
+//       12     4  Input port mask (bit set == level present)
+//       16     4  Output port mask (bit set == level present)
+//       20  4*P   Input levels (left, right), int16
+//   20+4*P  4*P   Output levels (left, right), int16
+//   20+8*P 12*S   Streams: serial (uint32), left, right (int16),
+//                 position (uint32)
+//
+#define RDMETERFRAME_VERSION 1
+#define RDMETERFRAME_HEADER_SIZE 20
+#define RDMETERFRAME_STREAM_SIZE 12
+#define RDMETERFRAME_MAX_SIZE (RDMETERFRAME_HEADER_SIZE+8*RD_MAX_PORTS+\
+			       RDMETERFRAME_STREAM_SIZE*RD_MAX_CAE_STREAMS)
+
+class RDMeterFrame
+{
+ public:
+  RDMeterFrame();
+  unsigned card() const;
+  uint32_t sequence() const;
+  bool inputLevels(unsigned port,short lvls[2]) const;
+  bool outputLevels(unsigned port,short lvls[2]) const;
+  unsigned streamQuantity() const;
+  void stream(unsigned n,unsigned *serial,short lvls[2],unsigned *pos) const;
+  const char *data() const;
+  int size() const;
+
+  //
+  // Encoding (caed)
+  //
+  void clear(unsigned card,uint32_t seq);
+  void setInputLevels(unsigned port,const short lvls[2]);
+  void setOutputLevels(unsigned port,const short lvls[2]);
+  bool addStream(unsigned serial,const short lvls[2],unsigned pos);
+
+  //
+  // Decoding (RDCae)
+  //
+  bool read(const char *data,int len);
+  static bool isMeterFrame(const char *data,int len);
+  static bool isNewer(uint32_t seq,uint32_t last_seq);
+
+ private:
+  unsigned PortSlots() const;
+  void SetLevels(int offset,int maskoff,unsigned port,const short lvls[2]);
+  bool GetLevels(int offset,int maskoff,unsigned port,short lvls[2]) const;
+  void WriteUInt16(int offset,uint16_t value);
+  void WriteUInt32(int offset,uint32_t value);
+  uint16_t ReadUInt16(int offset) const;
+  uint32_t ReadUInt32(int offset) const;
+  uint8_t frame_data[RDMETERFRAME_MAX_SIZE];
+  int frame_size;
+};
+
+
+#endif  // RDMETERFRAME_H
@@ -0,0 +1,187 @@
+// rdmetershm.cpp
+//
+// Shared-memory meter and play-position segment published by caed(8).
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <rdmetershm.h>
+
+//
+// How many times a reader will retry before giving up on a card for
+// this pass (the writer only holds a card for a few microseconds)
+//
+#define RDMETERSHM_READ_RETRIES 16
+
+RDMeterShm::RDMeterShm()
+{
+  shm_segment=NULL;
+  shm_owner=false;
+}
+
+
+RDMeterShm::~RDMeterShm()
+{
+  detach();
+}
+
+
+bool RDMeterShm::isValid() const
+{
+  return shm_segment!=NULL;
+}
+
+
+bool RDMeterShm::create(QString *err_msg)
+{
+  int fd;
+  void *ptr;
+
+  detach();
+  shm_unlink(RDMETERSHM_NAME);  // Left over from an unclean shutdown
+  if((fd=shm_open(RDMETERSHM_NAME,O_RDWR|O_CREAT|O_EXCL,0644))<0) {
+    *err_msg=QString::asprintf("unable to create meter segment [%s]",
+			       strerror(errno));
+    return false;
+  }
+  fchmod(fd,0644);  // Regardless of umask
+  if(ftruncate(fd,sizeof(RDMeterShmSegment))<0) {
+    *err_msg=QString::asprintf("unable to size meter segment [%s]",
+			       strerror(errno));
+    close(fd);
+    shm_unlink(RDMETERSHM_NAME);
+    return false;
+  }
+  ptr=mmap(NULL,sizeof(RDMeterShmSegment),PROT_READ|PROT_WRITE,MAP_SHARED,
+	   fd,0);
+  close(fd);
+  if(ptr==MAP_FAILED) {
+    *err_msg=QString::asprintf("unable to map meter segment [%s]",
+			       strerror(errno));
+    shm_unlink(RDMETERSHM_NAME);
+    return false;
+  }
+  shm_segment=(RDMeterShmSegment *)ptr;
+  shm_owner=true;
+  memset(ptr,0,sizeof(RDMeterShmSegment));
+  for(int i=0;i<RD_MAX_CARDS;i++) {
+    shm_segment->cards[i].sequence.store(0);
+  }
+  shm_segment->version=RDMETERSHM_VERSION;
+  shm_segment->size=sizeof(RDMeterShmSegment);
+  shm_segment->pid=getpid();
+
+  //
+  // Written last, so that readers never accept a half-initialized segment
+  //
+  std::atomic_thread_fence(std::memory_order_release);
+  shm_segment->magic=RDMETERSHM_MAGIC;
+  *err_msg="ok";
+
+  return true;
+}
+
+
+bool RDMeterShm::attach()
+{
+  int fd;
+  void *ptr;
+  struct stat st;
+
+  detach();
+  if((fd=shm_open(RDMETERSHM_NAME,O_RDONLY,0))<0) {
+    return false;
+  }
+  if((fstat(fd,&st)<0)||(st.st_size<(off_t)sizeof(RDMeterShmSegment))) {
+    close(fd);
+    return false;
+  }
+  ptr=mmap(NULL,sizeof(RDMeterShmSegment),PROT_READ,MAP_SHARED,fd,0);
+  close(fd);
+  if(ptr==MAP_FAILED) {
+    return false;
+  }
+  shm_segment=(RDMeterShmSegment *)ptr;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if((shm_segment->magic!=RDMETERSHM_MAGIC)||
+     (shm_segment->version!=RDMETERSHM_VERSION)||
+     (shm_segment->size!=sizeof(RDMeterShmSegment))) {
+    detach();
+    return false;
+  }
+
+  return true;
+}
+
+
+void RDMeterShm::detach()
+{
+  if(shm_segment!=NULL) {
+    munmap(shm_segment,sizeof(RDMeterShmSegment));
+    shm_segment=NULL;
+    if(shm_owner) {
+      shm_unlink(RDMETERSHM_NAME);
+      shm_owner=false;
+    }
+  }
+}
+
+
+void RDMeterShm::write(unsigned card,const RDMeterShmData *data)
+{
+  RDMeterShmCard *c=shm_segment->cards+card;
+  uint32_t seq=c->sequence.load(std::memory_order_relaxed);
+
+  c->sequence.store(seq+1,std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(&c->data,data,sizeof(RDMeterShmData));
+  c->sequence.store(seq+2,std::memory_order_release);
+}
+
+
+uint32_t RDMeterShm::sequence(unsigned card) const
+{
+  return shm_segment->cards[card].sequence.load(std::memory_order_acquire);
+}
+
+
+bool RDMeterShm::read(unsigned card,RDMeterShmData *data,uint32_t *seq) const
+{
+  const RDMeterShmCard *c=shm_segment->cards+card;
+  uint32_t seq0;
+  uint32_t seq1;
+
+  for(int i=0;i<RDMETERSHM_READ_RETRIES;i++) {
+    seq0=c->sequence.load(std::memory_order_acquire);
+    if((seq0&1)==0) {
+      memcpy(data,&c->data,sizeof(RDMeterShmData));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      seq1=c->sequence.load(std::memory_order_relaxed);
+      if(seq0==seq1) {
+	*seq=seq0;
+	return true;
+      }
+    }
+  }
+  return false;
+}
@@ -0,0 +1,107 @@
+// rdmetershm.h
+//
+// Shared-memory meter and play-position segment published by caed(8).
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef RDMETERSHM_H
+#define RDMETERSHM_H
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include <QString>
+
+#include <rd.h>
+
+#define RDMETERSHM_NAME "/rivendell-caed-meters"
+#define RDMETERSHM_MAGIC 0x52444D53  // "RDMS"
+#define RDMETERSHM_VERSION 2
+
+//
+// Meter format value (for the CAE 'MF' command) used by clients that read
+// the segment and so want no UDP meter updates at all
+//
+#define RDMETERSHM_METER_FORMAT 2
+
+//
+// Per-stream entry.  'owner' is the UDP meter port of the RDCae
+// connection that loaded the stream, which is unique among the clients
+// on a given host; 'serial' is that client's serial number.
+//
+struct RDMeterShmStream
+{
+  uint16_t owner;
+  uint16_t reserved;
+  uint32_t serial;
+  int16_t levels[2];
+  uint32_t position;
+};
+
+
+struct RDMeterShmData
+{
+  uint32_t input_mask;
+  uint32_t output_mask;
+  int16_t input_levels[RD_MAX_PORTS][2];
+  int16_t output_levels[RD_MAX_PORTS][2];
+  RDMeterShmStream streams[RD_MAX_CAE_STREAMS];
+};
+
+
+//
+// Each card is guarded by a seqlock: the sequence is odd while caed(8)
+// is writing, and readers retry if it was odd or changed under them.
+//
+struct RDMeterShmCard
+{
+  std::atomic<uint32_t> sequence;
+  RDMeterShmData data;
+};
+
+
+struct RDMeterShmSegment
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t size;
+  uint32_t pid;
+  RDMeterShmCard cards[RD_MAX_CARDS];
+};
+
+
+class RDMeterShm
+{
+ public:
+  RDMeterShm();
+  ~RDMeterShm();
+  bool isValid() const;
+  bool create(QString *err_msg);
+  bool attach();
+  void detach();
+  void write(unsigned card,const RDMeterShmData *data);
+  uint32_t sequence(unsigned card) const;
+  bool read(unsigned card,RDMeterShmData *data,uint32_t *seq) const;
+
+ private:
+  RDMeterShmSegment *shm_segment;
+  bool shm_owner;
+};
+
+
+#endif  // RDMETERSHM_H
@@ -0,0 +1,415 @@
+// rdpeakpyramid.cpp
+//
+// Multi-resolution audio peak data, cached in a sidecar file per cut.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU Library General Public License
+//   version 2 as published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <QFileInfo>
+
+#include <rdpeakpyramid.h>
+#include <rdwavefile.h>
+
+//
+// Sidecar layout (host byte order):
+//
+//   char[4]   "RDPK"
+//   uint32_t  version
+//   uint32_t  channels
+//   uint32_t  sample rate
+//   uint32_t  sample length, in frames
+//   uint32_t  level count
+//   then for each level:
+//     uint32_t  frames per peak
+//     uint32_t  number of peaks
+//     uint32_t  offset of the peak data from the start of the file
+//   then the peak data for each level, in order.
+//
+#define RDPEAKPYRAMID_MAGIC "RDPK"
+#define RDPEAKPYRAMID_VERSION 1
+#define RDPEAKPYRAMID_HEADER_WORDS 5
+#define RDPEAKPYRAMID_SCAN_FRAMES 4096
+
+RDPeakPyramid::RDPeakPyramid(const QString &wavename)
+{
+  pyr_wave_name=wavename;
+  pyr_channels=0;
+  pyr_sample_rate=0;
+  pyr_sample_length=0;
+  pyr_level=-1;
+}
+
+
+QString RDPeakPyramid::waveName() const
+{
+  return pyr_wave_name;
+}
+
+
+unsigned RDPeakPyramid::channels() const
+{
+  return pyr_channels;
+}
+
+
+unsigned RDPeakPyramid::sampleRate() const
+{
+  return pyr_sample_rate;
+}
+
+
+unsigned RDPeakPyramid::sampleLength() const
+{
+  return pyr_sample_length;
+}
+
+
+int RDPeakPyramid::level() const
+{
+  return pyr_level;
+}
+
+
+unsigned RDPeakPyramid::size() const
+{
+  if(pyr_channels==0) {
+    return 0;
+  }
+  return pyr_data.size()/(2*pyr_channels);
+}
+
+
+int16_t RDPeakPyramid::peakMin(unsigned peak,unsigned chan) const
+{
+  return pyr_data[2*(peak*pyr_channels+chan)];
+}
+
+
+int16_t RDPeakPyramid::peakMax(unsigned peak,unsigned chan) const
+{
+  return pyr_data[2*(peak*pyr_channels+chan)+1];
+}
+
+
+const int16_t *RDPeakPyramid::data() const
+{
+  return pyr_data.data();
+}
+
+
+bool RDPeakPyramid::load(int level)
+{
+  if((level<0)||(level>=RDPEAKPYRAMID_LEVELS)) {
+    return false;
+  }
+  if(ReadLevel(level)) {
+    return true;
+  }
+  return generate()&&ReadLevel(level);
+}
+
+
+bool RDPeakPyramid::generate()
+{
+  std::vector<int16_t> levels[RDPEAKPYRAMID_LEVELS];
+  bool ret=false;
+
+  RDWaveFile *wave=new RDWaveFile(pyr_wave_name);
+  if(!wave->openWave()) {
+    delete wave;
+    return false;
+  }
+  pyr_channels=wave->getChannels();
+  pyr_sample_rate=wave->getSamplesPerSec();
+  pyr_sample_length=wave->getSampleLength();
+  if(pyr_channels==0) {
+    wave->closeWave();
+    delete wave;
+    return false;
+  }
+  if(ScanPcm(wave,&levels[0])||ScanEnergy(wave,&levels[0])) {
+    //
+    // Each level above the base is folded from the one below it
+    //
+    for(int i=1;i<RDPEAKPYRAMID_LEVELS;i++) {
+      const std::vector<int16_t> &src=levels[i-1];
+      unsigned src_peaks=src.size()/(2*pyr_channels);
+      for(unsigned j=0;j<src_peaks;j+=RDPEAKPYRAMID_FACTOR) {
+	for(unsigned k=0;k<pyr_channels;k++) {
+	  int16_t min=src[2*(j*pyr_channels+k)];
+	  int16_t max=src[2*(j*pyr_channels+k)+1];
+	  for(unsigned l=j+1;
+	      (l<(j+RDPEAKPYRAMID_FACTOR))&&(l<src_peaks);l++) {
+	    if(src[2*(l*pyr_channels+k)]<min) {
+	      min=src[2*(l*pyr_channels+k)];
+	    }
+	    if(src[2*(l*pyr_channels+k)+1]>max) {
+	      max=src[2*(l*pyr_channels+k)+1];
+	    }
+	  }
+	  levels[i].push_back(min);
+	  levels[i].push_back(max);
+	}
+      }
+    }
+    ret=WriteSidecar(levels);
+  }
+  wave->closeWave();
+  delete wave;
+
+  return ret;
+}
+
+
+unsigned RDPeakPyramid::framesPerPeak(int level)
+{
+  unsigned ret=RDPEAKPYRAMID_BASE_FRAMES;
+
+  for(int i=0;i<level;i++) {
+    ret*=RDPEAKPYRAMID_FACTOR;
+  }
+  return ret;
+}
+
+
+int RDPeakPyramid::levelForFrames(unsigned frames_per_peak)
+{
+  //
+  // The coarsest level that still has at least the requested resolution
+  //
+  int ret=0;
+
+  while((ret<(RDPEAKPYRAMID_LEVELS-1))&&
+	(framesPerPeak(ret+1)<=frames_per_peak)) {
+    ret++;
+  }
+  return ret;
+}
+
+
+QString RDPeakPyramid::sidecarName(const QString &wavename)
+{
+  return wavename+RDPEAKPYRAMID_EXTENSION;
+}
+
+
+bool RDPeakPyramid::ReadLevel(int level)
+{
+  char magic[4];
+  uint32_t hdr[RDPEAKPYRAMID_HEADER_WORDS];
+  uint32_t index[3*RDPEAKPYRAMID_LEVELS];
+  int fd=-1;
+  size_t len;
+
+  //
+  // Ignore a sidecar made from an earlier version of the audio
+  //
+  QFileInfo wave_info(pyr_wave_name);
+  QFileInfo peak_info(sidecarName(pyr_wave_name));
+  if((!wave_info.exists())||(!peak_info.exists())||
+     (peak_info.lastModified()<wave_info.lastModified())) {
+    return false;
+  }
+  if((fd=open(sidecarName(pyr_wave_name).toUtf8(),O_RDONLY))<0) {
+    return false;
+  }
+  if((read(fd,magic,4)!=4)||
+     (memcmp(magic,RDPEAKPYRAMID_MAGIC,4)!=0)||
+     (read(fd,hdr,sizeof(hdr))!=sizeof(hdr))||
+     (hdr[0]!=RDPEAKPYRAMID_VERSION)||(hdr[1]==0)||
+     (hdr[4]!=RDPEAKPYRAMID_LEVELS)||
+     (read(fd,index,sizeof(index))!=sizeof(index))||
+     (index[3*level]!=framesPerPeak(level))) {
+    close(fd);
+    return false;
+  }
+  pyr_channels=hdr[1];
+  pyr_sample_rate=hdr[2];
+  pyr_sample_length=hdr[3];
+  pyr_level=-1;
+  len=(size_t)index[3*level+1]*2*pyr_channels;
+  pyr_data.resize(len);
+  if((lseek(fd,index[3*level+2],SEEK_SET)<0)||
+     (read(fd,pyr_data.data(),len*sizeof(int16_t))!=
+      (ssize_t)(len*sizeof(int16_t)))) {
+    pyr_data.clear();
+    close(fd);
+    return false;
+  }
+  close(fd);
+  pyr_level=level;
+
+  return true;
+}
+
+
+bool RDPeakPyramid::ScanPcm(RDWaveFile *wave,std::vector<int16_t> *base)
+{
+  unsigned bytes=0;
+  std::vector<int16_t> min(pyr_channels);
+  std::vector<int16_t> max(pyr_channels);
+  unsigned count=0;
+  int n;
+
+  switch(wave->type()) {
+  case RDWaveFile::Ogg:  // Decoded to PCM16 by readWave()
+    bytes=2;
+    break;
+
+  case RDWaveFile::Wave:
+    if(wave->getFormatTag()==WAVE_FORMAT_PCM) {
+      switch(wave->getBitsPerSample()) {
+      case 16:
+	bytes=2;
+	break;
+
+      case 24:
+	bytes=3;
+	break;
+      }
+    }
+    break;
+
+  default:
+    break;
+  }
+  if(bytes==0) {
+    return false;
+  }
+
+  unsigned frame_bytes=bytes*pyr_channels;
+  uint8_t *pcm=new uint8_t[RDPEAKPYRAMID_SCAN_FRAMES*frame_bytes];
+  base->reserve(2*pyr_channels*
+		(pyr_sample_length/RDPEAKPYRAMID_BASE_FRAMES+1));
+  wave->seekWave(0,SEEK_SET);
+  while((n=wave->readWave(pcm,RDPEAKPYRAMID_SCAN_FRAMES*frame_bytes))>=
+	(int)frame_bytes) {
+    for(unsigned i=0;i<(n/frame_bytes);i++) {
+      for(unsigned j=0;j<pyr_channels;j++) {
+	const uint8_t *s=pcm+i*frame_bytes+j*bytes;
+	int16_t sample=(int16_t)(s[bytes-2]|(s[bytes-1]<<8));
+	if((count==0)||(sample<min[j])) {
+	  min[j]=sample;
+	}
+	if((count==0)||(sample>max[j])) {
+	  max[j]=sample;
+	}
+      }
+      if(++count==RDPEAKPYRAMID_BASE_FRAMES) {
+	for(unsigned j=0;j<pyr_channels;j++) {
+	  base->push_back(min[j]);
+	  base->push_back(max[j]);
+	}
+	count=0;
+      }
+    }
+  }
+  if(count>0) {
+    for(unsigned j=0;j<pyr_channels;j++) {
+      base->push_back(min[j]);
+      base->push_back(max[j]);
+    }
+  }
+  delete[] pcm;
+
+  return true;
+}
+
+
+bool RDPeakPyramid::ScanEnergy(RDWaveFile *wave,std::vector<int16_t> *base)
+{
+  //
+  // Formats that RDWaveFile cannot decode (MPEG) only have the 'levl'
+  // energy data, one absolute peak per DEFAULT_LEVL_BLOCK_SIZE frames, so
+  // that is spread across the finer levels.
+  //
+  if(!wave->hasEnergy()) {
+    return false;
+  }
+  unsigned blocks=wave->energySize()/pyr_channels;
+  unsigned peaks=
+    (pyr_sample_length+RDPEAKPYRAMID_BASE_FRAMES-1)/RDPEAKPYRAMID_BASE_FRAMES;
+  for(unsigned i=0;i<peaks;i++) {
+    unsigned block=i*RDPEAKPYRAMID_BASE_FRAMES/DEFAULT_LEVL_BLOCK_SIZE;
+    if(block>=blocks) {
+      break;
+    }
+    for(unsigned j=0;j<pyr_channels;j++) {
+      unsigned e=wave->energy(block*pyr_channels+j);
+      if(e>32767) {
+	e=32767;
+      }
+      base->push_back(-(int16_t)e);
+      base->push_back((int16_t)e);
+    }
+  }
+  return true;
+}
+
+
+bool RDPeakPyramid::WriteSidecar(std::vector<int16_t> levels[]) const
+{
+  uint32_t hdr[RDPEAKPYRAMID_HEADER_WORDS]={RDPEAKPYRAMID_VERSION,
+					     pyr_channels,
+					     pyr_sample_rate,
+					     pyr_sample_length,
+					     RDPEAKPYRAMID_LEVELS};
+  uint32_t index[3*RDPEAKPYRAMID_LEVELS];
+  uint32_t offset=4+sizeof(hdr)+sizeof(index);
+  QString tmpname=sidecarName(pyr_wave_name)+".tmp";
+  mode_t prev_mask;
+  int fd=-1;
+  bool ok=true;
+
+  for(int i=0;i<RDPEAKPYRAMID_LEVELS;i++) {
+    index[3*i]=framesPerPeak(i);
+    index[3*i+1]=levels[i].size()/(2*pyr_channels);
+    index[3*i+2]=offset;
+    offset+=levels[i].size()*sizeof(int16_t);
+  }
+
+  //
+  // Write to a temporary name first, so that a concurrent reader never
+  // sees a partial sidecar.
+  //
+  prev_mask=umask(0113);  // Set umask so files are user and group writable.
+  fd=open(tmpname.toUtf8(),O_WRONLY|O_CREAT|O_TRUNC,0666);
+  umask(prev_mask);
+  if(fd<0) {
+    return false;
+  }
+  ok=ok&&(write(fd,RDPEAKPYRAMID_MAGIC,4)==4);
+  ok=ok&&(write(fd,hdr,sizeof(hdr))==sizeof(hdr));
+  ok=ok&&(write(fd,index,sizeof(index))==sizeof(index));
+  for(int i=0;i<RDPEAKPYRAMID_LEVELS;i++) {
+    ssize_t len=levels[i].size()*sizeof(int16_t);
+    ok=ok&&(write(fd,levels[i].data(),len)==len);
+  }
+  close(fd);
+  if((!ok)||
+     (rename(tmpname.toUtf8(),sidecarName(pyr_wave_name).toUtf8())!=0)) {
+    unlink(tmpname.toUtf8());
+    return false;
+  }
+  return true;
+}
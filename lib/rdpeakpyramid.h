@@ -0,0 +1,83 @@
+// rdpeakpyramid.h
+//
+// Multi-resolution audio peak data, cached in a sidecar file per cut.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU Library General Public License
+//   version 2 as published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef RDPEAKPYRAMID_H
+#define RDPEAKPYRAMID_H
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <QString>
+
+class RDWaveFile;
+
+//
+// Level 0 holds one peak for every RDPEAKPYRAMID_BASE_FRAMES frames, and
+// each level above it RDPEAKPYRAMID_FACTOR times fewer (64, 256, 1024 and
+// 4096 frames per peak).
+//
+#define RDPEAKPYRAMID_LEVELS 4
+#define RDPEAKPYRAMID_BASE_FRAMES 64
+#define RDPEAKPYRAMID_FACTOR 4
+#define RDPEAKPYRAMID_EXTENSION ".peaks"
+
+//
+// Every peak is a minimum and a maximum sample value for each channel,
+// stored interleaved as [min0,max0,min1,max1,...]. A level is read from
+// the sidecar on its own, so that a client drawing at a given zoom never
+// has to touch the other levels or the audio itself. The sidecar is
+// (re)generated from the audio whenever it is missing or older than the
+// audio file.
+//
+class RDPeakPyramid
+{
+ public:
+  RDPeakPyramid(const QString &wavename);
+  QString waveName() const;
+  unsigned channels() const;
+  unsigned sampleRate() const;
+  unsigned sampleLength() const;
+  int level() const;
+  unsigned size() const;
+  int16_t peakMin(unsigned peak,unsigned chan) const;
+  int16_t peakMax(unsigned peak,unsigned chan) const;
+  const int16_t *data() const;
+  bool load(int level);
+  bool generate();
+  static unsigned framesPerPeak(int level);
+  static int levelForFrames(unsigned frames_per_peak);
+  static QString sidecarName(const QString &wavename);
+
+ private:
+  bool ReadLevel(int level);
+  bool ScanPcm(RDWaveFile *wave,std::vector<int16_t> *base);
+  bool ScanEnergy(RDWaveFile *wave,std::vector<int16_t> *base);
+  bool WriteSidecar(std::vector<int16_t> levels[]) const;
+  QString pyr_wave_name;
+  unsigned pyr_channels;
+  unsigned pyr_sample_rate;
+  unsigned pyr_sample_length;
+  int pyr_level;
+  std::vector<int16_t> pyr_data;
+};
+
+
+#endif  // RDPEAKPYRAMID_H
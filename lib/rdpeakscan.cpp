@@ -0,0 +1,677 @@
+// rdpeakscan.cpp
+//
+// Vectorized peak and RMS scanning of PCM audio.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU Library General Public License
+//   version 2 as published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+
+#if defined(__x86_64__)||defined(__i386__)
+#ifdef __SSE2__
+#define RDPEAKSCAN_SSE2
+#include <immintrin.h>
+#endif  // __SSE2__
+#endif  // __x86_64__ || __i386__
+
+#include <rdpeakscan.h>
+
+//
+// Generic Kernels
+//
+// Each kernel leaves the extremes and sum of squares of the samples it
+// was given for each channel in 'min', 'max' and 'sumsq', which must
+// hold 'chans' entries. Sums of PCM16 squares are kept as integers so
+// that every kernel gives exactly the same result.
+//
+static void ScanS16Generic(const int16_t *src,unsigned chans,unsigned frames,
+			   int *min,int *max,int64_t *sumsq)
+{
+  for(unsigned i=0;i<chans;i++) {
+    min[i]=INT_MAX;
+    max[i]=INT_MIN;
+    sumsq[i]=0;
+  }
+  for(unsigned i=0;i<frames;i++) {
+    for(unsigned j=0;j<chans;j++) {
+      int s=src[chans*i+j];
+      if(s<min[j]) {
+	min[j]=s;
+      }
+      if(s>max[j]) {
+	max[j]=s;
+      }
+      sumsq[j]+=s*s;
+    }
+  }
+}
+
+
+static void ScanS24Generic(const uint8_t *src,unsigned chans,unsigned frames,
+			   int *min,int *max,double *sumsq)
+{
+  for(unsigned i=0;i<chans;i++) {
+    min[i]=INT_MAX;
+    max[i]=INT_MIN;
+    sumsq[i]=0.0;
+  }
+  for(unsigned i=0;i<frames;i++) {
+    for(unsigned j=0;j<chans;j++) {
+      const uint8_t *p=src+3*(chans*i+j);
+      int s=((int)((p[0]<<8)|(p[1]<<16)|(p[2]<<24)))>>8;
+      if(s<min[j]) {
+	min[j]=s;
+      }
+      if(s>max[j]) {
+	max[j]=s;
+      }
+      sumsq[j]+=(double)s*(double)s;
+    }
+  }
+}
+
+
+static void ScanFloatGeneric(const float *src,unsigned chans,unsigned frames,
+			     float *min,float *max,double *sumsq)
+{
+  for(unsigned i=0;i<chans;i++) {
+    min[i]=FLT_MAX;
+    max[i]=-FLT_MAX;
+    sumsq[i]=0.0;
+  }
+  for(unsigned i=0;i<frames;i++) {
+    for(unsigned j=0;j<chans;j++) {
+      float s=src[chans*i+j];
+      if(s<min[j]) {
+	min[j]=s;
+      }
+      if(s>max[j]) {
+	max[j]=s;
+      }
+      sumsq[j]+=(double)s*(double)s;
+    }
+  }
+}
+
+
+//
+// Folds the per-lane results of a vector kernel (lane 'n' carries channel
+// n%chans) and the generic kernel's handling of the leftover frames into
+// per-channel values.
+//
+template<class T,class S>
+static void MergeLanes(const T *lane_min,const T *lane_max,unsigned lanes,
+		       const T *tail_min,const T *tail_max,const S *tail_sumsq,
+		       unsigned chans,T *min,T *max,S *sumsq)
+{
+  for(unsigned i=0;i<chans;i++) {
+    min[i]=tail_min[i];
+    max[i]=tail_max[i];
+    sumsq[i]+=tail_sumsq[i];
+  }
+  for(unsigned i=0;i<lanes;i++) {
+    if(lane_min[i]<min[i%chans]) {
+      min[i%chans]=lane_min[i];
+    }
+    if(lane_max[i]>max[i%chans]) {
+      max[i%chans]=lane_max[i];
+    }
+  }
+}
+
+
+#ifdef RDPEAKSCAN_SSE2
+//
+// SSE2 Kernels
+//
+// These require 4%chans==0, so that every vector starts on a frame
+// boundary and each lane always carries the same channel.
+//
+static void ScanS16Sse2(const int16_t *src,unsigned chans,unsigned frames,
+			int *min,int *max,int64_t *sumsq)
+{
+  //
+  // The squares of the even and odd int16 lanes are taken separately with
+  // _mm_madd_epi16() and widened into 64 bit sums, as 'e0' (int16 lanes
+  // 0 and 4), 'e1' (2 and 6), 'o0' (1 and 5) and 'o1' (3 and 7).
+  //
+  const __m128i even=_mm_set1_epi32(0x0000FFFF);
+  const __m128i odd=_mm_set1_epi32((int)0xFFFF0000);
+  const __m128i low=_mm_set_epi32(0,-1,0,-1);
+  __m128i vmin=_mm_set1_epi16(SHRT_MAX);
+  __m128i vmax=_mm_set1_epi16(SHRT_MIN);
+  __m128i e0=_mm_setzero_si128();
+  __m128i e1=_mm_setzero_si128();
+  __m128i o0=_mm_setzero_si128();
+  __m128i o1=_mm_setzero_si128();
+  unsigned n=frames*chans;
+  unsigned i=0;
+
+  for(;(i+8)<=n;i+=8) {
+    __m128i s=_mm_loadu_si128((const __m128i *)(src+i));
+    vmin=_mm_min_epi16(vmin,s);
+    vmax=_mm_max_epi16(vmax,s);
+    __m128i xe=_mm_madd_epi16(s,_mm_and_si128(s,even));
+    __m128i xo=_mm_madd_epi16(s,_mm_and_si128(s,odd));
+    e0=_mm_add_epi64(e0,_mm_and_si128(xe,low));
+    e1=_mm_add_epi64(e1,_mm_srli_epi64(xe,32));
+    o0=_mm_add_epi64(o0,_mm_and_si128(xo,low));
+    o1=_mm_add_epi64(o1,_mm_srli_epi64(xo,32));
+  }
+
+  int tail_min[RDPEAKSCAN_MAX_CHANNELS];
+  int tail_max[RDPEAKSCAN_MAX_CHANNELS];
+  int64_t tail_sumsq[RDPEAKSCAN_MAX_CHANNELS];
+  ScanS16Generic(src+i,chans,(n-i)/chans,tail_min,tail_max,tail_sumsq);
+
+  int16_t m[2][8];
+  int lane_min[8];
+  int lane_max[8];
+  int64_t sq[4][2];
+  _mm_storeu_si128((__m128i *)m[0],vmin);
+  _mm_storeu_si128((__m128i *)m[1],vmax);
+  for(unsigned j=0;j<8;j++) {
+    lane_min[j]=m[0][j];
+    lane_max[j]=m[1][j];
+  }
+  _mm_storeu_si128((__m128i *)sq[0],e0);
+  _mm_storeu_si128((__m128i *)sq[1],o0);
+  _mm_storeu_si128((__m128i *)sq[2],e1);
+  _mm_storeu_si128((__m128i *)sq[3],o1);
+  for(unsigned j=0;j<chans;j++) {
+    sumsq[j]=0;
+  }
+  for(unsigned j=0;j<4;j++) {
+    sumsq[j%chans]+=sq[j][0]+sq[j][1];
+  }
+  MergeLanes(lane_min,lane_max,8,tail_min,tail_max,tail_sumsq,
+	     chans,min,max,sumsq);
+}
+
+
+static void ScanS24Sse2(const uint8_t *src,unsigned chans,unsigned frames,
+			int *min,int *max,double *sumsq)
+{
+  //
+  // SSE2 has no byte shuffle, so each group of four samples is gathered
+  // with plain 32 bit loads, the top byte of which belongs to the next
+  // sample and is shifted back out. SSE2 has no 32 bit integer min/max
+  // either, but 24 bit values are exact as floats so the extremes are
+  // taken there.
+  //
+  __m128 vmin=_mm_set1_ps(8388608.0f);  // Just outside of 24 bit range
+  __m128 vmax=_mm_set1_ps(-8388609.0f);
+  __m128d lo=_mm_setzero_pd();  // Lanes 0 and 1
+  __m128d hi=_mm_setzero_pd();  // Lanes 2 and 3
+  uint32_t w[4];
+  unsigned n=frames*chans;
+  unsigned i=0;
+
+  for(;(i+5)<=n;i+=4) {  // The last load runs one byte past the group
+    for(unsigned j=0;j<4;j++) {
+      memcpy(w+j,src+3*(i+j),4);
+    }
+    __m128i s=_mm_loadu_si128((const __m128i *)w);
+    s=_mm_srai_epi32(_mm_slli_epi32(s,8),8);
+    __m128 f=_mm_cvtepi32_ps(s);
+    vmin=_mm_min_ps(vmin,f);
+    vmax=_mm_max_ps(vmax,f);
+    __m128d dlo=_mm_cvtepi32_pd(s);
+    __m128d dhi=_mm_cvtepi32_pd(_mm_unpackhi_epi64(s,s));
+    lo=_mm_add_pd(lo,_mm_mul_pd(dlo,dlo));
+    hi=_mm_add_pd(hi,_mm_mul_pd(dhi,dhi));
+  }
+
+  int tail_min[RDPEAKSCAN_MAX_CHANNELS];
+  int tail_max[RDPEAKSCAN_MAX_CHANNELS];
+  double tail_sumsq[RDPEAKSCAN_MAX_CHANNELS];
+  ScanS24Generic(src+3*i,chans,(n-i)/chans,tail_min,tail_max,tail_sumsq);
+
+  float m[2][4];
+  int lane_min[4];
+  int lane_max[4];
+  double sq[4];
+  _mm_storeu_ps(m[0],vmin);
+  _mm_storeu_ps(m[1],vmax);
+  for(unsigned j=0;j<4;j++) {
+    lane_min[j]=(int)m[0][j];
+    lane_max[j]=(int)m[1][j];
+  }
+  _mm_storeu_pd(sq,lo);
+  _mm_storeu_pd(sq+2,hi);
+  for(unsigned j=0;j<chans;j++) {
+    sumsq[j]=0.0;
+  }
+  for(unsigned j=0;j<4;j++) {
+    sumsq[j%chans]+=sq[j];
+  }
+  MergeLanes(lane_min,lane_max,4,tail_min,tail_max,tail_sumsq,
+	     chans,min,max,sumsq);
+}
+
+
+static void ScanFloatSse2(const float *src,unsigned chans,unsigned frames,
+			  float *min,float *max,double *sumsq)
+{
+  __m128 vmin=_mm_set1_ps(FLT_MAX);
+  __m128 vmax=_mm_set1_ps(-FLT_MAX);
+  __m128d lo=_mm_setzero_pd();  // Lanes 0 and 1
+  __m128d hi=_mm_setzero_pd();  // Lanes 2 and 3
+  unsigned n=frames*chans;
+  unsigned i=0;
+
+  for(;(i+4)<=n;i+=4) {
+    __m128 s=_mm_loadu_ps(src+i);
+    vmin=_mm_min_ps(vmin,s);
+    vmax=_mm_max_ps(vmax,s);
+    __m128d dlo=_mm_cvtps_pd(s);
+    __m128d dhi=_mm_cvtps_pd(_mm_movehl_ps(s,s));
+    lo=_mm_add_pd(lo,_mm_mul_pd(dlo,dlo));
+    hi=_mm_add_pd(hi,_mm_mul_pd(dhi,dhi));
+  }
+
+  float tail_min[RDPEAKSCAN_MAX_CHANNELS];
+  float tail_max[RDPEAKSCAN_MAX_CHANNELS];
+  double tail_sumsq[RDPEAKSCAN_MAX_CHANNELS];
+  ScanFloatGeneric(src+i,chans,(n-i)/chans,tail_min,tail_max,tail_sumsq);
+
+  float lane_min[4];
+  float lane_max[4];
+  double sq[4];
+  _mm_storeu_ps(lane_min,vmin);
+  _mm_storeu_ps(lane_max,vmax);
+  _mm_storeu_pd(sq,lo);
+  _mm_storeu_pd(sq+2,hi);
+  for(unsigned j=0;j<chans;j++) {
+    sumsq[j]=0.0;
+  }
+  for(unsigned j=0;j<4;j++) {
+    sumsq[j%chans]+=sq[j];
+  }
+  MergeLanes(lane_min,lane_max,4,tail_min,tail_max,tail_sumsq,
+	     chans,min,max,sumsq);
+}
+
+
+//
+// AVX2 Kernels (selected at runtime)
+//
+// Laid out exactly as the SSE2 ones above, at twice the width.
+//
+__attribute__((target("avx2")))
+static void ScanS16Avx2(const int16_t *src,unsigned chans,unsigned frames,
+			int *min,int *max,int64_t *sumsq)
+{
+  const __m256i even=_mm256_set1_epi32(0x0000FFFF);
+  const __m256i odd=_mm256_set1_epi32((int)0xFFFF0000);
+  const __m256i low=_mm256_set1_epi64x(0xFFFFFFFF);
+  __m256i vmin=_mm256_set1_epi16(SHRT_MAX);
+  __m256i vmax=_mm256_set1_epi16(SHRT_MIN);
+  __m256i e0=_mm256_setzero_si256();
+  __m256i e1=_mm256_setzero_si256();
+  __m256i o0=_mm256_setzero_si256();
+  __m256i o1=_mm256_setzero_si256();
+  unsigned n=frames*chans;
+  unsigned i=0;
+
+  for(;(i+16)<=n;i+=16) {
+    __m256i s=_mm256_loadu_si256((const __m256i *)(src+i));
+    vmin=_mm256_min_epi16(vmin,s);
+    vmax=_mm256_max_epi16(vmax,s);
+    __m256i xe=_mm256_madd_epi16(s,_mm256_and_si256(s,even));
+    __m256i xo=_mm256_madd_epi16(s,_mm256_and_si256(s,odd));
+    e0=_mm256_add_epi64(e0,_mm256_and_si256(xe,low));
+    e1=_mm256_add_epi64(e1,_mm256_srli_epi64(xe,32));
+    o0=_mm256_add_epi64(o0,_mm256_and_si256(xo,low));
+    o1=_mm256_add_epi64(o1,_mm256_srli_epi64(xo,32));
+  }
+
+  int tail_min[RDPEAKSCAN_MAX_CHANNELS];
+  int tail_max[RDPEAKSCAN_MAX_CHANNELS];
+  int64_t tail_sumsq[RDPEAKSCAN_MAX_CHANNELS];
+  ScanS16Generic(src+i,chans,(n-i)/chans,tail_min,tail_max,tail_sumsq);
+
+  int16_t m[2][16];
+  int lane_min[16];
+  int lane_max[16];
+  int64_t sq[4][4];
+  _mm256_storeu_si256((__m256i *)m[0],vmin);
+  _mm256_storeu_si256((__m256i *)m[1],vmax);
+  for(unsigned j=0;j<16;j++) {
+    lane_min[j]=m[0][j];
+    lane_max[j]=m[1][j];
+  }
+  _mm256_storeu_si256((__m256i *)sq[0],e0);
+  _mm256_storeu_si256((__m256i *)sq[1],o0);
+  _mm256_storeu_si256((__m256i *)sq[2],e1);
+  _mm256_storeu_si256((__m256i *)sq[3],o1);
+  for(unsigned j=0;j<chans;j++) {
+    sumsq[j]=0;
+  }
+  for(unsigned j=0;j<4;j++) {
+    sumsq[j%chans]+=sq[j][0]+sq[j][1]+sq[j][2]+sq[j][3];
+  }
+  MergeLanes(lane_min,lane_max,16,tail_min,tail_max,tail_sumsq,
+	     chans,min,max,sumsq);
+}
+
+
+__attribute__((target("avx2")))
+static void ScanS24Avx2(const uint8_t *src,unsigned chans,unsigned frames,
+			int *min,int *max,double *sumsq)
+{
+  //
+  // Each group of eight samples (24 bytes) is spread so that each 128 bit
+  // half holds four of them, and then widened to 32 bits with a byte
+  // shuffle, leaving the low byte of each at zero for the sign extension.
+  //
+  const __m256i spread=_mm256_setr_epi32(0,1,2,3,3,4,5,6);
+  const __m256i widen=_mm256_setr_epi8(-128,0,1,2,-128,3,4,5,
+				       -128,6,7,8,-128,9,10,11,
+				       -128,0,1,2,-128,3,4,5,
+				       -128,6,7,8,-128,9,10,11);
+  __m256i vmin=_mm256_set1_epi32(INT_MAX);
+  __m256i vmax=_mm256_set1_epi32(INT_MIN);
+  __m256d lo=_mm256_setzero_pd();  // Lanes 0 - 3
+  __m256d hi=_mm256_setzero_pd();  // Lanes 4 - 7
+  unsigned n=frames*chans;
+  unsigned i=0;
+
+  for(;(i+11)<=n;i+=8) {  // Each load runs eight bytes past the group
+    __m256i s=_mm256_loadu_si256((const __m256i *)(src+3*i));
+    s=_mm256_permutevar8x32_epi32(s,spread);
+    s=_mm256_srai_epi32(_mm256_shuffle_epi8(s,widen),8);
+    vmin=_mm256_min_epi32(vmin,s);
+    vmax=_mm256_max_epi32(vmax,s);
+    __m256d dlo=_mm256_cvtepi32_pd(_mm256_castsi256_si128(s));
+    __m256d dhi=_mm256_cvtepi32_pd(_mm256_extracti128_si256(s,1));
+    lo=_mm256_add_pd(lo,_mm256_mul_pd(dlo,dlo));
+    hi=_mm256_add_pd(hi,_mm256_mul_pd(dhi,dhi));
+  }
+
+  int tail_min[RDPEAKSCAN_MAX_CHANNELS];
+  int tail_max[RDPEAKSCAN_MAX_CHANNELS];
+  double tail_sumsq[RDPEAKSCAN_MAX_CHANNELS];
+  ScanS24Generic(src+3*i,chans,(n-i)/chans,tail_min,tail_max,tail_sumsq);
+
+  int lane_min[8];
+  int lane_max[8];
+  double sq[8];
+  _mm256_storeu_si256((__m256i *)lane_min,vmin);
+  _mm256_storeu_si256((__m256i *)lane_max,vmax);
+  _mm256_storeu_pd(sq,lo);
+  _mm256_storeu_pd(sq+4,hi);
+  for(unsigned j=0;j<chans;j++) {
+    sumsq[j]=0.0;
+  }
+  for(unsigned j=0;j<8;j++) {
+    sumsq[j%chans]+=sq[j];
+  }
+  MergeLanes(lane_min,lane_max,8,tail_min,tail_max,tail_sumsq,
+	     chans,min,max,sumsq);
+}
+
+
+__attribute__((target("avx2")))
+static void ScanFloatAvx2(const float *src,unsigned chans,unsigned frames,
+			  float *min,float *max,double *sumsq)
+{
+  __m256 vmin=_mm256_set1_ps(FLT_MAX);
+  __m256 vmax=_mm256_set1_ps(-FLT_MAX);
+  __m256d lo=_mm256_setzero_pd();  // Lanes 0 - 3
+  __m256d hi=_mm256_setzero_pd();  // Lanes 4 - 7
+  unsigned n=frames*chans;
+  unsigned i=0;
+
+  for(;(i+8)<=n;i+=8) {
+    __m256 s=_mm256_loadu_ps(src+i);
+    vmin=_mm256_min_ps(vmin,s);
+    vmax=_mm256_max_ps(vmax,s);
+    __m256d dlo=_mm256_cvtps_pd(_mm256_castps256_ps128(s));
+    __m256d dhi=_mm256_cvtps_pd(_mm256_extractf128_ps(s,1));
+    lo=_mm256_add_pd(lo,_mm256_mul_pd(dlo,dlo));
+    hi=_mm256_add_pd(hi,_mm256_mul_pd(dhi,dhi));
+  }
+
+  float tail_min[RDPEAKSCAN_MAX_CHANNELS];
+  float tail_max[RDPEAKSCAN_MAX_CHANNELS];
+  double tail_sumsq[RDPEAKSCAN_MAX_CHANNELS];
+  ScanFloatGeneric(src+i,chans,(n-i)/chans,tail_min,tail_max,tail_sumsq);
+
+  float lane_min[8];
+  float lane_max[8];
+  double sq[8];
+  _mm256_storeu_ps(lane_min,vmin);
+  _mm256_storeu_ps(lane_max,vmax);
+  _mm256_storeu_pd(sq,lo);
+  _mm256_storeu_pd(sq+4,hi);
+  for(unsigned j=0;j<chans;j++) {
+    sumsq[j]=0.0;
+  }
+  for(unsigned j=0;j<8;j++) {
+    sumsq[j%chans]+=sq[j];
+  }
+  MergeLanes(lane_min,lane_max,8,tail_min,tail_max,tail_sumsq,
+	     chans,min,max,sumsq);
+}
+#endif  // RDPEAKSCAN_SSE2
+
+
+RDPeakScan::RDPeakScan(unsigned chans,bool generic)
+{
+  scan_channels=chans;
+  if(scan_channels>RDPEAKSCAN_MAX_CHANNELS) {
+    scan_channels=RDPEAKSCAN_MAX_CHANNELS;
+  }
+  if(scan_channels==0) {
+    scan_channels=1;
+  }
+  scan_generic=generic||((4%scan_channels)!=0);
+  scan_avx2=false;
+#ifdef RDPEAKSCAN_SSE2
+  __builtin_cpu_init();
+  scan_avx2=__builtin_cpu_supports("avx2");
+#endif  // RDPEAKSCAN_SSE2
+  reset();
+}
+
+
+unsigned RDPeakScan::channels() const
+{
+  return scan_channels;
+}
+
+
+const char *RDPeakScan::kernelName() const
+{
+  if(scan_generic) {
+    return "generic";
+  }
+#ifdef RDPEAKSCAN_SSE2
+  if(scan_avx2) {
+    return "AVX2";
+  }
+  return "SSE2";
+#else
+  return "generic";
+#endif  // RDPEAKSCAN_SSE2
+}
+
+
+void RDPeakScan::reset()
+{
+  scan_frames=0;
+  for(unsigned i=0;i<RDPEAKSCAN_MAX_CHANNELS;i++) {
+    scan_min[i]=0.0;
+    scan_max[i]=0.0;
+    scan_sumsq[i]=0.0;
+  }
+}
+
+
+void RDPeakScan::scan(const void *data,RDPeakScan::Format fmt,
+		      unsigned frames)
+{
+  int imin[RDPEAKSCAN_MAX_CHANNELS];
+  int imax[RDPEAKSCAN_MAX_CHANNELS];
+  int64_t isumsq[RDPEAKSCAN_MAX_CHANNELS];
+  float fmin[RDPEAKSCAN_MAX_CHANNELS];
+  float fmax[RDPEAKSCAN_MAX_CHANNELS];
+  double fsumsq[RDPEAKSCAN_MAX_CHANNELS];
+
+  if(frames==0) {
+    return;
+  }
+  switch(fmt) {
+  case RDPeakScan::S16:
+    if(scan_generic) {
+      ScanS16Generic((const int16_t *)data,scan_channels,frames,
+		     imin,imax,isumsq);
+    }
+    else {
+#ifdef RDPEAKSCAN_SSE2
+      if(scan_avx2) {
+	ScanS16Avx2((const int16_t *)data,scan_channels,frames,
+		    imin,imax,isumsq);
+      }
+      else {
+	ScanS16Sse2((const int16_t *)data,scan_channels,frames,
+		    imin,imax,isumsq);
+      }
+#else
+      ScanS16Generic((const int16_t *)data,scan_channels,frames,
+		     imin,imax,isumsq);
+#endif  // RDPEAKSCAN_SSE2
+    }
+    for(unsigned i=0;i<scan_channels;i++) {
+      fmin[i]=(float)imin[i]/32768.0f;
+      fmax[i]=(float)imax[i]/32768.0f;
+      fsumsq[i]=(double)isumsq[i]/1073741824.0;
+    }
+    break;
+
+  case RDPeakScan::S24:
+    if(scan_generic) {
+      ScanS24Generic((const uint8_t *)data,scan_channels,frames,
+		     imin,imax,fsumsq);
+    }
+    else {
+#ifdef RDPEAKSCAN_SSE2
+      if(scan_avx2) {
+	ScanS24Avx2((const uint8_t *)data,scan_channels,frames,
+		    imin,imax,fsumsq);
+      }
+      else {
+	ScanS24Sse2((const uint8_t *)data,scan_channels,frames,
+		    imin,imax,fsumsq);
+      }
+#else
+      ScanS24Generic((const uint8_t *)data,scan_channels,frames,
+		     imin,imax,fsumsq);
+#endif  // RDPEAKSCAN_SSE2
+    }
+    for(unsigned i=0;i<scan_channels;i++) {
+      fmin[i]=(float)imin[i]/8388608.0f;
+      fmax[i]=(float)imax[i]/8388608.0f;
+      fsumsq[i]/=70368744177664.0;
+    }
+    break;
+
+  case RDPeakScan::Float:
+    if(scan_generic) {
+      ScanFloatGeneric((const float *)data,scan_channels,frames,
+		       fmin,fmax,fsumsq);
+    }
+    else {
+#ifdef RDPEAKSCAN_SSE2
+      if(scan_avx2) {
+	ScanFloatAvx2((const float *)data,scan_channels,frames,
+		      fmin,fmax,fsumsq);
+      }
+      else {
+	ScanFloatSse2((const float *)data,scan_channels,frames,
+		      fmin,fmax,fsumsq);
+      }
+#else
+      ScanFloatGeneric((const float *)data,scan_channels,frames,
+		       fmin,fmax,fsumsq);
+#endif  // RDPEAKSCAN_SSE2
+    }
+    break;
+  }
+  for(unsigned i=0;i<scan_channels;i++) {
+    if((scan_frames==0)||(fmin[i]<scan_min[i])) {
+      scan_min[i]=fmin[i];
+    }
+    if((scan_frames==0)||(fmax[i]>scan_max[i])) {
+      scan_max[i]=fmax[i];
+    }
+    scan_sumsq[i]+=fsumsq[i];
+  }
+  scan_frames+=frames;
+}
+
+
+unsigned RDPeakScan::frames() const
+{
+  return scan_frames;
+}
+
+
+float RDPeakScan::minimum(unsigned chan) const
+{
+  return scan_min[chan];
+}
+
+
+float RDPeakScan::maximum(unsigned chan) const
+{
+  return scan_max[chan];
+}
+
+
+float RDPeakScan::peak(unsigned chan) const
+{
+  if(-scan_min[chan]>scan_max[chan]) {
+    return -scan_min[chan];
+  }
+  return scan_max[chan];
+}
+
+
+float RDPeakScan::rms(unsigned chan) const
+{
+  if(scan_frames==0) {
+    return 0.0;
+  }
+  return sqrt(scan_sumsq[chan]/(double)scan_frames);
+}
+
+
+unsigned short RDPeakScan::energy(unsigned chan) const
+{
+  //
+  // The scale used by the 'levl' chunk
+  //
+  float lvl=peak(chan)*32768.0f;
+  if(lvl>32767.0f) {
+    return 32767;
+  }
+  return (unsigned short)lvl;
+}
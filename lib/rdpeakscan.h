@@ -0,0 +1,64 @@
+// rdpeakscan.h
+//
+// Vectorized peak and RMS scanning of PCM audio.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU Library General Public License
+//   version 2 as published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef RDPEAKSCAN_H
+#define RDPEAKSCAN_H
+
+#include <stdint.h>
+
+#define RDPEAKSCAN_MAX_CHANNELS 8
+
+//
+// Accumulates the minimum, maximum and mean square of each channel of
+// interleaved audio across any number of scan() calls. Values are
+// normalized so that full scale is 1.0 for every format.
+//
+// Vector kernels (SSE2, or AVX2 when the CPU supports it) are used for
+// PCM16, PCM24 and float data with 1, 2 or 4 channels; everything else goes
+// through the generic kernels, which can also be forced for testing.
+//
+class RDPeakScan
+{
+ public:
+  enum Format {S16=0,S24=1,Float=2};
+  RDPeakScan(unsigned chans,bool generic=false);
+  unsigned channels() const;
+  const char *kernelName() const;
+  void reset();
+  void scan(const void *data,Format fmt,unsigned frames);
+  unsigned frames() const;
+  float minimum(unsigned chan) const;
+  float maximum(unsigned chan) const;
+  float peak(unsigned chan) const;
+  float rms(unsigned chan) const;
+  unsigned short energy(unsigned chan) const;
+
+ private:
+  unsigned scan_channels;
+  bool scan_generic;
+  bool scan_avx2;
+  unsigned scan_frames;
+  float scan_min[RDPEAKSCAN_MAX_CHANNELS];
+  float scan_max[RDPEAKSCAN_MAX_CHANNELS];
+  double scan_sumsq[RDPEAKSCAN_MAX_CHANNELS];
+};
+
+
+#endif  // RDPEAKSCAN_H
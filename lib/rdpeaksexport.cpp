@@ -65,6 +65,7 @@ RDPeaksExport::RDPeaksExport(QObject *parent)
 {
   conv_cart_number=0;
   conv_cut_number=0;
+  conv_frames_per_peak=0;
   conv_energy_data=NULL;
   conv_write_ptr=0;
 }
@@ -82,6 +83,22 @@ void RDPeaksExport::setCutNumber(unsigned cutnum)
 }
 
 
+unsigned RDPeaksExport::framesPerPeak() const
+{
+  return conv_frames_per_peak;
+}
+
+
+void RDPeaksExport::setFramesPerPeak(unsigned frames)
+{
+  //
+  // When non-zero, fetch just that level of the cut's peak pyramid
+  // (interleaved min/max words per channel) instead of the 'levl' energy.
+  //
+  conv_frames_per_peak=frames;
+}
+
+
 RDPeaksExport::ErrorCode RDPeaksExport::runExport(const QString &username,
 						  const QString &password)
 {
@@ -113,6 +130,13 @@ RDPeaksExport::ErrorCode RDPeaksExport::runExport(const QString &username,
 	       CURLFORM_COPYCONTENTS,
 	       QString::asprintf("%u",conv_cut_number).toUtf8().constData(),
 	       CURLFORM_END);
+  if(conv_frames_per_peak>0) {
+    curl_formadd(&first,&last,CURLFORM_PTRNAME,"FRAMES_PER_PEAK",
+		 CURLFORM_COPYCONTENTS,
+		 QString::asprintf("%u",conv_frames_per_peak).toUtf8().
+		 constData(),
+		 CURLFORM_END);
+  }
   if((curl=curl_easy_init())==NULL) {
     curl_formfree(first);
     return RDPeaksExport::ErrorInternal;
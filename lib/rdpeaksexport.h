@@ -35,6 +35,8 @@ class RDPeaksExport
   ~RDPeaksExport();
   void setCartNumber(unsigned cartnum);
   void setCutNumber(unsigned cutnum);
+  unsigned framesPerPeak() const;
+  void setFramesPerPeak(unsigned frames);
   RDPeaksExport::ErrorCode runExport(const QString &username,
 				     const QString &password);
   unsigned energySize();
@@ -45,6 +47,7 @@ class RDPeaksExport
  private:
   unsigned conv_cart_number;
   unsigned conv_cut_number;
+  unsigned conv_frames_per_peak;
   unsigned short *conv_energy_data;
   unsigned conv_write_ptr;
   friend size_t RDPeaksExportWrite(void *ptr, size_t size, size_t nmemb, 
@@ -0,0 +1,251 @@
+// rdspscring.cpp
+//
+// A lock-free single producer/single consumer ring buffer.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU Library General Public License 
+//   version 2 as published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <rdspscring.h>
+
+RDSpscSpan::RDSpscSpan()
+{
+  data[0]=NULL;
+  data[1]=NULL;
+  len[0]=0;
+  len[1]=0;
+}
+
+
+size_t RDSpscSpan::size() const
+{
+  return len[0]+len[1];
+}
+
+
+
+
+RDSpscRing::RDSpscRing(size_t sz)
+{
+  void *ptr=NULL;
+
+  ring_size=RDSPSCRING_CACHE_LINE;
+  while(ring_size<sz) {
+    ring_size*=2;
+  }
+  ring_mask=ring_size-1;
+  if(posix_memalign(&ptr,RDSPSCRING_CACHE_LINE,ring_size)!=0) {
+    abort();
+  }
+  ring_buffer=(char *)ptr;
+  ring_mlocked=false;
+  reset();
+}
+
+
+RDSpscRing::~RDSpscRing()
+{
+  if(ring_mlocked) {
+    munlock(ring_buffer,ring_size);
+  }
+  free(ring_buffer);
+}
+
+
+size_t RDSpscRing::size() const
+{
+  return ring_size;
+}
+
+
+bool RDSpscRing::mlock()
+{
+  if(::mlock(ring_buffer,ring_size)!=0) {
+    return false;
+  }
+  ring_mlocked=true;
+  return true;
+}
+
+
+void RDSpscRing::reset()
+{
+  //
+  // Only safe while neither side is active
+  //
+  ring_write_index.store(0,std::memory_order_relaxed);
+  ring_read_index.store(0,std::memory_order_relaxed);
+  ring_read_cache=0;
+  ring_write_cache=0;
+  ring_flush.store(false,std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+
+bool RDSpscRing::flush(int timeout_msecs)
+{
+  //
+  // Called with the writer held off, so the write index stays put until
+  // the reader has caught up with it
+  //
+  ring_flush.store(true,std::memory_order_release);
+  for(int i=0;i<2*timeout_msecs;i++) {
+    if(!ring_flush.load(std::memory_order_acquire)) {
+      ring_read_cache=ring_read_index.load(std::memory_order_acquire);
+      return true;
+    }
+    usleep(500);
+  }
+
+  //
+  // The reader never came around, so it isn't running and it is safe to
+  // discard on its behalf
+  //
+  if(ring_flush.exchange(false,std::memory_order_acq_rel)) {
+    ring_write_cache=ring_write_index.load(std::memory_order_relaxed);
+    ring_read_index.store(ring_write_cache,std::memory_order_release);
+    ring_read_cache=ring_write_cache;
+    return false;
+  }
+  ring_read_cache=ring_read_index.load(std::memory_order_acquire);
+  return true;
+}
+
+
+void RDSpscRing::serviceFlush()
+{
+  if(ring_flush.load(std::memory_order_acquire)) {
+    ring_write_cache=ring_write_index.load(std::memory_order_acquire);
+    ring_read_index.store(ring_write_cache,std::memory_order_release);
+    ring_flush.store(false,std::memory_order_release);
+  }
+}
+
+
+size_t RDSpscRing::writeSpace() const
+{
+  return ring_size-(ring_write_index.load(std::memory_order_relaxed)-
+		    ring_read_index.load(std::memory_order_acquire));
+}
+
+
+size_t RDSpscRing::readSpace() const
+{
+  return ring_write_index.load(std::memory_order_acquire)-
+    ring_read_index.load(std::memory_order_relaxed);
+}
+
+
+size_t RDSpscRing::reserveWrite(RDSpscSpan *span,size_t cnt)
+{
+  size_t w=ring_write_index.load(std::memory_order_relaxed);
+  size_t avail=ring_size-(w-ring_read_cache);
+
+  if(avail<cnt) {
+    ring_read_cache=ring_read_index.load(std::memory_order_acquire);
+    avail=ring_size-(w-ring_read_cache);
+  }
+  if(cnt>avail) {
+    cnt=avail;
+  }
+  MakeSpan(span,w,cnt);
+
+  return cnt;
+}
+
+
+void RDSpscRing::commitWrite(size_t cnt)
+{
+  ring_write_index.store(ring_write_index.load(std::memory_order_relaxed)+cnt,
+			 std::memory_order_release);
+}
+
+
+size_t RDSpscRing::reserveRead(RDSpscSpan *span,size_t cnt)
+{
+  size_t r=ring_read_index.load(std::memory_order_relaxed);
+  size_t avail=ring_write_cache-r;
+
+  if(avail<cnt) {
+    ring_write_cache=ring_write_index.load(std::memory_order_acquire);
+    avail=ring_write_cache-r;
+  }
+  if(cnt>avail) {
+    cnt=avail;
+  }
+  MakeSpan(span,r,cnt);
+
+  return cnt;
+}
+
+
+void RDSpscRing::commitRead(size_t cnt)
+{
+  ring_read_index.store(ring_read_index.load(std::memory_order_relaxed)+cnt,
+			std::memory_order_release);
+}
+
+
+size_t RDSpscRing::write(const char *src,size_t cnt)
+{
+  RDSpscSpan span;
+
+  cnt=reserveWrite(&span,cnt);
+  memcpy(span.data[0],src,span.len[0]);
+  if(span.len[1]>0) {
+    memcpy(span.data[1],src+span.len[0],span.len[1]);
+  }
+  commitWrite(cnt);
+
+  return cnt;
+}
+
+
+size_t RDSpscRing::read(char *dest,size_t cnt)
+{
+  RDSpscSpan span;
+
+  cnt=reserveRead(&span,cnt);
+  memcpy(dest,span.data[0],span.len[0]);
+  if(span.len[1]>0) {
+    memcpy(dest+span.len[0],span.data[1],span.len[1]);
+  }
+  commitRead(cnt);
+
+  return cnt;
+}
+
+
+void RDSpscRing::MakeSpan(RDSpscSpan *span,size_t index,size_t cnt) const
+{
+  size_t offset=index&ring_mask;
+
+  span->data[0]=ring_buffer+offset;
+  if((offset+cnt)>ring_size) {
+    span->len[0]=ring_size-offset;
+    span->data[1]=ring_buffer;
+    span->len[1]=cnt-span->len[0];
+  }
+  else {
+    span->len[0]=cnt;
+    span->data[1]=NULL;
+    span->len[1]=0;
+  }
+}
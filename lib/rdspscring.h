@@ -0,0 +1,101 @@
+// rdspscring.h
+//
+// A lock-free single producer/single consumer ring buffer.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU Library General Public License 
+//   version 2 as published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef RDSPSCRING_H
+#define RDSPSCRING_H
+
+#include <stddef.h>
+
+#include <atomic>
+
+#define RDSPSCRING_CACHE_LINE 64
+#define RDSPSCRING_FLUSH_TIMEOUT 500
+
+//
+// A region of the ring, in at most two pieces (the second one is used
+// only when the region wraps around the end of the buffer).
+//
+class RDSpscSpan
+{
+ public:
+  RDSpscSpan();
+  size_t size() const;
+  char *data[2];
+  size_t len[2];
+};
+
+
+//
+// Exactly one thread may write and exactly one thread may read at a time.
+// The writer calls reserveWrite(), fills the returned span and then
+// commitWrite()s however much of it it used; the reader does the same with
+// reserveRead() / commitRead(). Committed data becomes visible to the other
+// side with release/acquire ordering.
+//
+// reset() may only be called while neither side is running. To empty a
+// ring that is live, hold off the writer and call flush(); the discard is
+// then carried out by the reader the next time it calls serviceFlush().
+//
+class RDSpscRing
+{
+ public:
+  RDSpscRing(size_t sz);
+  ~RDSpscRing();
+  size_t size() const;
+  bool mlock();
+  void reset();
+  bool flush(int timeout_msecs=RDSPSCRING_FLUSH_TIMEOUT);
+  void serviceFlush();
+  size_t writeSpace() const;
+  size_t readSpace() const;
+  size_t reserveWrite(RDSpscSpan *span,size_t cnt);
+  void commitWrite(size_t cnt);
+  size_t reserveRead(RDSpscSpan *span,size_t cnt);
+  void commitRead(size_t cnt);
+  size_t write(const char *src,size_t cnt);
+  size_t read(char *dest,size_t cnt);
+
+ private:
+  void MakeSpan(RDSpscSpan *span,size_t index,size_t cnt) const;
+
+  //
+  // The indices run freely and are only masked when used to address
+  // 'ring_buffer', so a full ring can be told from an empty one without
+  // giving up a slot. Each side keeps a private copy of the other side's
+  // index, and the groups are padded apart so that the two threads never
+  // write to the same cache line.
+  //
+  char *ring_buffer;
+  size_t ring_size;
+  size_t ring_mask;
+  bool ring_mlocked;
+  char ring_pad0[RDSPSCRING_CACHE_LINE];
+  std::atomic<size_t> ring_write_index;
+  size_t ring_read_cache;
+  char ring_pad1[RDSPSCRING_CACHE_LINE];
+  std::atomic<size_t> ring_read_index;
+  size_t ring_write_cache;
+  char ring_pad2[RDSPSCRING_CACHE_LINE];
+  std::atomic<bool> ring_flush;
+  char ring_pad3[RDSPSCRING_CACHE_LINE];
+};
+
+
+#endif  // RDSPSCRING_H
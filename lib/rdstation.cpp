@@ -606,6 +606,9 @@ QString RDStation::driverVersion(AudioDriver driver) const
   case RDStation::Alsa:
     return RDGetSqlValue("STATIONS","NAME",station_name,"ALSA_VERSION").
       toString();
+
+  case RDStation::Null:
+    break;
   }
   return QString();
 }
@@ -628,6 +631,9 @@ void RDStation::setDriverVersion(AudioDriver driver,QString ver) const
   case RDStation::Alsa:
     SetRow("ALSA_VERSION",ver);
     break;
+
+  case RDStation::Null:
+    break;
   }
 }
 
@@ -2016,6 +2022,10 @@ QString RDStation::audioDriverText(RDStation::AudioDriver dvr)
   case RDStation::Alsa:
     ret=QObject::tr("Advance Linux Sound Architecture (ALSA)");
     break;
+
+  case RDStation::Null:
+    ret=QObject::tr("Null (No Hardware)");
+    break;
   }
   return ret;
 }
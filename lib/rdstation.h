@@ -28,7 +28,7 @@
 class RDStation
 {
  public:
-  enum AudioDriver {None=0,Hpi=1,Jack=2,Alsa=3};
+  enum AudioDriver {None=0,Hpi=1,Jack=2,Alsa=3,Null=4};
   enum Capability {HaveOggenc=0,HaveOgg123=1,HaveFlac=2,
 		   HaveLame=3,HaveMpg321=4,HaveTwoLame=5,HaveMp4Decode=6};
   enum FilterMode {FilterSynchronous=0,FilterAsynchronous=1};
@@ -23,6 +23,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <syslog.h>
@@ -32,8 +33,11 @@
 #include <unistd.h>
 #include <errno.h>
 #include <assert.h>
+#include <pthread.h>
+#include <signal.h>
 #include <arpa/inet.h>
 
+#include <atomic>
 #include <typeinfo>
 
 #include <id3/tag.h>
@@ -53,11 +57,51 @@
 #include <rdwavefile.h>
 #include <rdconf.h>
 #include <rdmp4.h>
+#include <rdpeakpyramid.h>
 
 #ifdef HAVE_MP4_LIBS
 #include <mp4v2/mp4v2.h>
 #endif
 
+//
+// SIGBUS guard for reads out of a mapping. A page that can't be supplied
+// (the file was truncated after it was mapped, or the backing store
+// returned an I/O error) is reported with SIGBUS, which would otherwise
+// take down the whole process.
+//
+static __thread sigjmp_buf *volatile map_guard_env=NULL;
+static struct sigaction map_guard_old_action;
+static pthread_once_t map_guard_once=PTHREAD_ONCE_INIT;
+
+static void MapGuardHandler(int signum,siginfo_t *info,void *ctx)
+{
+  sigjmp_buf *env=map_guard_env;
+
+  if(env!=NULL) {
+    map_guard_env=NULL;
+    siglongjmp(*env,1);
+  }
+
+  //
+  // Not one of ours, so put back whatever was there before and let the
+  // faulting access happen again
+  //
+  sigaction(SIGBUS,&map_guard_old_action,NULL);
+}
+
+
+static void MapGuardInstall()
+{
+  struct sigaction sa;
+
+  memset(&sa,0,sizeof(sa));
+  sa.sa_sigaction=MapGuardHandler;
+  sa.sa_flags=SA_SIGINFO;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGBUS,&sa,&map_guard_old_action);
+}
+
+
 RDWaveFile::RDWaveFile(QString file_name)
 {
   // 
@@ -103,6 +147,12 @@ RDWaveFile::RDWaveFile(QString file_name)
   }
   data_chunk=false;
   data_length=0;
+  map_data=NULL;
+  map_length=0;
+  map_pos=0;
+  chunk_indexed=false;
+  chunk_index_big_end=false;
+  metadata_pending=false;
   cart_chunk=false;
   cart_version=0;
   cart_title="";
@@ -176,6 +226,7 @@ RDWaveFile::RDWaveFile(QString file_name)
 
 RDWaveFile::~RDWaveFile()
 {
+  UnmapWave();
   if(bext_coding_data!=NULL) {
     free(bext_coding_data);
   }
@@ -219,6 +270,7 @@ bool RDWaveFile::openWave(RDWaveData *data)
   }
   switch(GetType(wave_file.handle())) {
   case RDWaveFile::Wave:
+    IndexChunks(wave_file.handle(),false);
     if(GetFmt(wave_file.handle())) {
       wave_type=RDWaveFile::Wave;
     }
@@ -276,17 +328,27 @@ bool RDWaveFile::openWave(RDWaveData *data)
 	ext_time_length=0;
       }
     }
-    GetCart(wave_file.handle());
-    GetBext(wave_file.handle());
     GetMext(wave_file.handle());
-    GetList(wave_file.handle());
-    GetScot(wave_file.handle());
-    GetAv10(wave_file.handle());
-    GetAir1(wave_file.handle());
-    GetRdxl(wave_file.handle());
+    if(wave_data==NULL) {
+      //
+      // Nobody is waiting on the metadata, so leave it to be decoded
+      // on the first call to one of its accessors.
+      //
+      metadata_pending=true;
+    }
+    else {
+      GetCart(wave_file.handle());
+      GetBext(wave_file.handle());
+      GetList(wave_file.handle());
+      GetScot(wave_file.handle());
+      GetAv10(wave_file.handle());
+      GetAir1(wave_file.handle());
+      GetRdxl(wave_file.handle());
+    }
     break;
 
   case RDWaveFile::Aiff:
+    IndexChunks(wave_file.handle(),true);
     if(GetComm(wave_file.handle())) {
       wave_type=RDWaveFile::Aiff;
     }
@@ -461,7 +523,9 @@ bool RDWaveFile::openWave(RDWaveData *data)
     lseek(wave_file.handle(),data_start,SEEK_SET);
     format_chunk=true;
     wave_type=RDWaveFile::Tmc;
-    ReadTmcMetadata(wave_file.handle());
+    if(wave_data!=NULL) {
+      ReadTmcMetadata(wave_file.handle());
+    }
     break;
 #ifdef HAVE_FLAC
   case RDWaveFile::Flac:
@@ -500,6 +564,9 @@ bool RDWaveFile::createWave(RDWaveData *data,unsigned ptr_offset)
   bool rc;
   wave_data=data;
   ptr_offset_msecs=ptr_offset;
+  chunk_index.clear();
+  chunk_indexed=false;
+  metadata_pending=false;
   if(wave_data!=NULL) {
     cart_title=wave_data->title();
     cart_artist=wave_data->artist();
@@ -537,6 +604,7 @@ bool RDWaveFile::createWave(RDWaveData *data,unsigned ptr_offset)
         prev_mask = umask(0113);      // Set umask so files are user and group writable.
         rc=wave_file.open(QIODevice::ReadWrite|QIODevice::Truncate);
 	unlink((wave_file_name+".energy").toUtf8());
+	unlink(RDPeakPyramid::sidecarName(wave_file_name).toUtf8());
         umask(prev_mask);
 	if(rc==false) {
 	  return false;
@@ -788,6 +856,7 @@ void RDWaveFile::closeWave(int samples)
     }
 #endif  // HAVE_VORBIS
   }
+  UnmapWave();
   wave_file.close();
   recordable=false;
   time_length=0;
@@ -892,6 +961,9 @@ void RDWaveFile::closeWave(int samples)
   atx_offset=0;
   av10_chunk=false;
   rdxl_chunk=false;
+  chunk_index.clear();
+  chunk_indexed=false;
+  metadata_pending=false;
 }
 
 
@@ -967,6 +1039,20 @@ int RDWaveFile::readWave(void *buf,int count)
   int16_t *sample;
 #endif  // HAVE_VORBIS
 
+  if(map_data!=NULL) {
+    const void *data=NULL;
+    sigjmp_buf env;
+    if(sigsetjmp(env,1)!=0) {
+      abandonMap();
+      return 0;
+    }
+    armMapGuard(&env);
+    if((c=mapReadWave(&data,count))>0) {
+      memcpy(buf,data,c);
+    }
+    disarmMapGuard();
+    return c;
+  }
   switch(wave_type) {
       case RDWaveFile::Ogg:
 #ifdef HAVE_VORBIS
@@ -1016,6 +1102,113 @@ int RDWaveFile::readWave(void *buf,int count)
 }
 
 
+bool RDWaveFile::mapWave()
+{
+  struct stat st;
+
+  //
+  // Only for plain little-endian PCM, where the data chunk can be used
+  // exactly as it sits on disk
+  //
+  if(map_data!=NULL) {
+    return true;
+  }
+  if((wave_type!=RDWaveFile::Wave)||(format_tag!=WAVE_FORMAT_PCM)||
+     recordable||(data_length==0)||(htonl(1l)==1)) {
+    return false;
+  }
+
+  //
+  // Touching a page beyond the end of the file raises SIGBUS, so a data
+  // chunk that claims more than is actually there (e.g. a truncated
+  // file) is left to the read() path
+  //
+  if((fstat(wave_file.handle(),&st)!=0)||(data_start<0)||
+     (st.st_size<data_start)||
+     ((uint64_t)(st.st_size-data_start)<(uint64_t)data_length)) {
+    return false;
+  }
+  map_length=(size_t)data_start+data_length;
+  if((map_data=(unsigned char *)mmap(NULL,map_length,PROT_READ,MAP_SHARED,
+				     wave_file.handle(),0))==MAP_FAILED) {
+    map_data=NULL;
+    map_length=0;
+    return false;
+  }
+  map_pos=lseek(wave_file.handle(),0,SEEK_CUR)-data_start;
+  if(map_pos>data_length) {
+    map_pos=0;
+  }
+  AdviseMap(MADV_SEQUENTIAL);
+  AdviseMap(MADV_WILLNEED);
+
+  return true;
+}
+
+
+bool RDWaveFile::isMapped() const
+{
+  return map_data!=NULL;
+}
+
+
+int RDWaveFile::mapReadWave(const void **buf,int count)
+{
+  if(map_data==NULL) {
+    *buf=NULL;
+    return -1;
+  }
+  if(count<0) {
+    count=0;
+  }
+  if((unsigned)count>(data_length-map_pos)) {
+    count=data_length-map_pos;
+  }
+  *buf=map_data+data_start+map_pos;
+  map_pos+=count;
+  if(((map_pos-count)/RDWAVEFILE_MAP_READAHEAD)!=
+     (map_pos/RDWAVEFILE_MAP_READAHEAD)) {
+    AdviseMap(MADV_WILLNEED);
+  }
+
+  return count;
+}
+
+
+void RDWaveFile::abandonMap()
+{
+  //
+  // For use after a guarded access to the mapping has faulted. Whatever
+  // was left of the data chunk is treated as lost, so subsequent reads
+  // go through read() and hit EOF.
+  //
+  if(map_data!=NULL) {
+    UnmapWave();
+    lseek(wave_file.handle(),0,SEEK_END);
+  }
+}
+
+
+void RDWaveFile::armMapGuard(sigjmp_buf *env)
+{
+  //
+  // 'env' must have been set with sigsetjmp(*env,1) by the caller, which
+  // then has until disarmMapGuard() to touch data from mapReadWave(). A
+  // fault in between returns to 'env' with the guard already disarmed.
+  //
+  pthread_once(&map_guard_once,MapGuardInstall);
+  map_guard_env=env;
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+
+void RDWaveFile::disarmMapGuard()
+{
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+  map_guard_env=NULL;
+}
+
+
 int RDWaveFile::writeWave(void *buf,int count)
 {
   if(!recordable) {
@@ -1329,6 +1522,26 @@ int RDWaveFile::seekWave(int offset,int whence)
   int pos;
   unsigned abspos;
 
+  if(map_data!=NULL) {
+    switch(whence) {
+    case SEEK_CUR:
+      offset+=map_pos;
+      break;
+
+    case SEEK_END:
+      offset+=data_length;
+      break;
+    }
+    if(offset<0) {
+      offset=0;
+    }
+    if((unsigned)offset>data_length) {
+      offset=data_length;
+    }
+    map_pos=offset;
+    AdviseMap(MADV_WILLNEED);
+    return map_pos;
+  }
   switch(wave_type) {
       case RDWaveFile::Ogg:
 #ifdef HAVE_VORBIS
@@ -1558,12 +1771,14 @@ unsigned short RDWaveFile::getHeadFlags() const
 
 bool RDWaveFile::getCartChunk() const
 {
+  LoadMetadata();
   return cart_chunk;
 }
 
 
 void RDWaveFile::setCartChunk(bool state)
 {
+  LoadMetadata();
   if(!recordable) {
     cart_chunk=state;
   }
@@ -1572,180 +1787,210 @@ void RDWaveFile::setCartChunk(bool state)
 
 unsigned RDWaveFile::getCartVersion() const
 {
+  LoadMetadata();
   return cart_version;
 }
 
 
 QString RDWaveFile::getCartTitle() const
 {
+  LoadMetadata();
   return cart_title;
 }
 
 
 void RDWaveFile::setCartTitle(QString string)
 {
+  LoadMetadata();
   cart_title=string;
 }
 
 
 QString RDWaveFile::getCartArtist() const
 {
+  LoadMetadata();
   return cart_artist;
 }
 
 
 void RDWaveFile::setCartArtist(QString string)
 {
+  LoadMetadata();
   cart_artist=string;
 }
 
 
 QString RDWaveFile::getCartCutID() const
 {
+  LoadMetadata();
   return cart_cut_id;
 }
 
 
 void RDWaveFile::setCartCutID(QString string)
 {
+  LoadMetadata();
   cart_cut_id=string;
 }
 
 
 QString RDWaveFile::getCartClientID() const
 {
+  LoadMetadata();
   return cart_client_id;
 }
 
 
 void RDWaveFile::setCartClientID(QString string)
 {
+  LoadMetadata();
   cart_client_id=string;
 }
 
 
 QString RDWaveFile::getCartCategory() const
 {
+  LoadMetadata();
   return cart_category;
 }
 
 
 void RDWaveFile::setCartCategory(QString string)
 {
+  LoadMetadata();
   cart_category=string;
 }
 
 
 QString RDWaveFile::getCartClassification() const
 {
+  LoadMetadata();
   return cart_classification;
 }
 
 
 void RDWaveFile::setCartClassification(QString string)
 {
+  LoadMetadata();
   cart_classification=string;
 }
 
 
 QString RDWaveFile::getCartOutCue() const
 {
+  LoadMetadata();
   return cart_out_cue;
 }
 
 
 void RDWaveFile::setCartOutCue(QString string)
 {
+  LoadMetadata();
   cart_out_cue=string;
 }
 
 
 QDate RDWaveFile::getCartStartDate() const
 {
+  LoadMetadata();
   return cart_start_date;
 }
 
 
 void RDWaveFile::setCartStartDate(QDate date)
 {
+  LoadMetadata();
   cart_start_date=date;
 }
 
 
 QTime RDWaveFile::getCartStartTime() const
 {
+  LoadMetadata();
   return cart_start_time;
 }
 
 
 void RDWaveFile::setCartStartTime(QTime time)
 {
+  LoadMetadata();
   cart_start_time=time;
 }
 
 
 QDate RDWaveFile::getCartEndDate() const
 {
+  LoadMetadata();
   return cart_end_date;
 }
 
 
 void RDWaveFile::setCartEndDate(QDate date)
 {
+  LoadMetadata();
   cart_end_date=date;
 }
 
 
 QTime RDWaveFile::getCartEndTime() const
 {
+  LoadMetadata();
   return cart_end_time;
 }
 
 
 void RDWaveFile::setCartEndTime(QTime time)
 {
+  LoadMetadata();
   cart_end_time=time;
 }
 
 
 QString RDWaveFile::getCartProducerAppID() const
 {
+  LoadMetadata();
   return cart_producer_app_id;
 }
 
 
 QString RDWaveFile::getCartProducerAppVer() const
 {
+  LoadMetadata();
   return cart_producer_app_ver;
 }
 
 
 QString RDWaveFile::getCartUserDef() const
 {
+  LoadMetadata();
   return cart_user_def;
 }
 
 
 void RDWaveFile::setCartUserDef(QString string)
 {
+  LoadMetadata();
   cart_user_def=string;
 }
 
 
 unsigned RDWaveFile::getCartLevelRef() const
 {
+  LoadMetadata();
   return cart_level_ref;
 }
 
 
 void RDWaveFile::setCartLevelRef(unsigned level)
 {
+  LoadMetadata();
   cart_level_ref=level;
 }
 
 
 QString RDWaveFile::getCartTimerLabel(int index) const
 {
+  LoadMetadata();
   if(index<MAX_TIMERS) {
     return cart_timer_label[index];
   }
@@ -1755,6 +2000,7 @@ QString RDWaveFile::getCartTimerLabel(int index) const
 
 unsigned RDWaveFile::getCartTimerSample(int index) const
 {
+  LoadMetadata();
   if(index<MAX_TIMERS) {
     return cart_timer_sample[index];
   }
@@ -1764,30 +2010,35 @@ unsigned RDWaveFile::getCartTimerSample(int index) const
 
 QString RDWaveFile::getCartURL() const
 {
+  LoadMetadata();
   return cart_url;
 }
 
 
 void RDWaveFile::setCartURL(QString string)
 {
+  LoadMetadata();
   cart_url=string;
 }
 
 
 QString RDWaveFile::getCartTagText() const
 {
+  LoadMetadata();
   return cart_tag_text;
 }
 
 
 bool RDWaveFile::getBextChunk() const
 {
+  LoadMetadata();
   return bext_chunk;
 }
 
 
 void RDWaveFile::setBextChunk(bool state) 
 {
+  LoadMetadata();
   if(!recordable) {
     bext_chunk=state;
   }
@@ -1796,96 +2047,112 @@ void RDWaveFile::setBextChunk(bool state)
 
 QString RDWaveFile::getBextDescription() const
 {
+  LoadMetadata();
   return bext_description;
 }
 
 
 void RDWaveFile::setBextDescription(QString string)
 {
+  LoadMetadata();
   bext_description=string;
 }
 
 
 QString RDWaveFile::getBextOriginator() const
 {
+  LoadMetadata();
   return bext_originator;
 }
 
 
 void RDWaveFile::setBextOriginator(QString string)
 {
+  LoadMetadata();
   bext_originator=string;
 }
 
 
 QString RDWaveFile::getBextOriginatorRef() const
 {
+  LoadMetadata();
   return bext_originator_ref;
 }
 
 
 void RDWaveFile::setBextOriginatorRef(QString string) 
 {
+  LoadMetadata();
   bext_originator_ref=string;
 }
 
 
 QDate RDWaveFile::getBextOriginationDate() const
 {
+  LoadMetadata();
   return bext_origination_date;
 }
 
 
 void RDWaveFile::setBextOriginationDate(QDate date)
 {
+  LoadMetadata();
   bext_origination_date=date;
 }
 
 
 QTime RDWaveFile::getBextOriginationTime() const
 {
+  LoadMetadata();
   return bext_origination_time;
 }
 
 
 void RDWaveFile::setBextOriginationTime(QTime time)
 {
+  LoadMetadata();
   bext_origination_time=time;
 }
 
 
 unsigned RDWaveFile::getBextTimeReferenceLow() const
 {
+  LoadMetadata();
   return bext_time_reference_low;
 }
 
 
 void RDWaveFile::setBextTimeReferenceLow(unsigned sample)
 {
+  LoadMetadata();
   bext_time_reference_low=sample;
 }
 
 
 unsigned RDWaveFile::getBextTimeReferenceHigh() const
 {
+  LoadMetadata();
   return bext_time_reference_low;
 }
 
 
 void RDWaveFile::setBextTimeReferenceHigh(unsigned sample)
 {
+  LoadMetadata();
   bext_time_reference_high=sample;
 }
 
 
 unsigned short RDWaveFile::getBextVersion() const
 {
+  LoadMetadata();
   return bext_version;
 }
 
 
 void RDWaveFile::getBextUMD(unsigned char *buf) const
 {
+  LoadMetadata();
   for(int i=0;i<64;i++) {
     buf[i]=bext_umid[i];
   }
@@ -1894,6 +2161,7 @@ void RDWaveFile::getBextUMD(unsigned char *buf) const
 
 void RDWaveFile::setBextUMD(unsigned char *buf)
 {
+  LoadMetadata();
   for(int i=0;i<64;i++) {
     bext_umid[i]=buf[i];
   }
@@ -1902,12 +2170,14 @@ void RDWaveFile::setBextUMD(unsigned char *buf)
 
 QString RDWaveFile::getBextCodingHistory() const
 {
+  LoadMetadata();
   return bext_coding_history;
 }
 
 
 void RDWaveFile::setBextCodingHistory(QString string)
 {
+  LoadMetadata();
   if(!recordable) {
     bext_coding_history=string;
   }
@@ -2110,30 +2380,35 @@ void RDWaveFile::setSerialNumber(int serial)
 
 bool RDWaveFile::getScotChunk() const
 {
+  LoadMetadata();
   return scot_chunk;
 }
 
 
 bool RDWaveFile::getAIR1Chunk() const
 {
+  LoadMetadata();
   return AIR1_chunk;
 }
 
 
 bool RDWaveFile::getRdxlChunk() const
 {
+  LoadMetadata();
   return rdxl_chunk;
 }
 
 
 QString RDWaveFile::getRdxlContents() const
 {
+  LoadMetadata();
   return rdxl_contents;
 }
 
 
 void RDWaveFile::setRdxlContents(const QString &xml)
 {
+  LoadMetadata();
   rdxl_contents=xml;
 
   //
@@ -2476,6 +2751,51 @@ bool RDWaveFile::IsM4A(int fd)
 }
 
 
+void RDWaveFile::IndexChunks(int fd,bool big_end)
+{
+  //
+  // Walk the chunk headers once, so that the subsequent FindChunk() calls
+  // made while opening the file need not each rescan it from the top.
+  //
+  ChunkEntry entry;
+  unsigned char buffer[4];
+  off_t pos=12;
+
+  chunk_index.clear();
+  chunk_index_big_end=big_end;
+  entry.name[4]=0;
+  while(pread(fd,entry.name,4,pos)==4) {
+    //
+    // Same fencepost workaround as in FindChunk()
+    //
+    if(!isalnum(0xff&entry.name[0])) {
+      entry.name[0]=entry.name[1];
+      entry.name[1]=entry.name[2];
+      entry.name[2]=entry.name[3];
+      if(pread(fd,entry.name+3,1,pos+4)!=1) {
+	break;
+      }
+      pos++;
+    }
+    if(pread(fd,buffer,4,pos+4)!=4) {
+      break;
+    }
+    if(big_end) {
+      entry.size=
+	buffer[3]+(256*buffer[2])+(65536*buffer[1])+(16777216*buffer[0]);
+    }
+    else {
+      entry.size=
+	buffer[0]+(256*buffer[1])+(65536*buffer[2])+(16777216*buffer[3]);
+    }
+    entry.offset=pos+8;
+    chunk_index.push_back(entry);
+    pos=entry.offset+entry.size;
+  }
+  chunk_indexed=true;
+}
+
+
 off_t RDWaveFile::FindChunk(int fd,const char *chunk_name,unsigned *chunk_size,
 			    bool big_end)
 {
@@ -2483,6 +2803,15 @@ off_t RDWaveFile::FindChunk(int fd,const char *chunk_name,unsigned *chunk_size,
   char name[5]={0,0,0,0,0};
   unsigned char buffer[4];
 
+  if(chunk_indexed&&(fd==wave_file.handle())&&(big_end==chunk_index_big_end)) {
+    for(unsigned i=0;i<chunk_index.size();i++) {
+      if(strcasecmp(chunk_name,chunk_index.at(i).name)==0) {
+	*chunk_size=chunk_index.at(i).size;
+	return lseek(fd,chunk_index.at(i).offset,SEEK_SET);
+      }
+    }
+    return -1;
+  }
   lseek(fd,12,SEEK_SET);
   offset=read(fd,name,4);
   if(!isalnum(0xff&name[0])) {
@@ -3266,6 +3595,27 @@ bool RDWaveFile::GetComm(int fd)
 }
 
 
+void RDWaveFile::LoadMetadata() const
+{
+  RDWaveFile *wave=const_cast<RDWaveFile *>(this);
+  int fd=wave->wave_file.handle();
+  off_t pos;
+
+  if((!metadata_pending)||(!wave_file.isOpen())) {
+    return;
+  }
+  wave->metadata_pending=false;
+  pos=lseek(fd,0,SEEK_CUR);
+  wave->GetCart(fd);
+  wave->GetBext(fd);
+  wave->GetScot(fd);
+  wave->GetAv10(fd);
+  wave->GetAir1(fd);
+  wave->GetRdxl(fd);
+  lseek(fd,pos,SEEK_SET);
+}
+
+
 bool RDWaveFile::GetList(int fd)
 {
   unsigned chunk_size=0;
@@ -4419,6 +4769,8 @@ unsigned short RDWaveFile::ReadSword(unsigned char *buffer,unsigned offset)
 void RDWaveFile::GetEnergy()
 {
   int file_ptr;
+  unsigned map_ptr;
+  bool mapped;
 
   ReadEnergyFile(wave_file_name);
   
@@ -4429,10 +4781,16 @@ void RDWaveFile::GetEnergy()
     return;
   }
   file_ptr=lseek(wave_file.handle(),0,SEEK_CUR);
+  map_ptr=map_pos;
+  mapped=isMapped();
   lseek(wave_file.handle(),0,SEEK_SET);
   LoadEnergy();
   energy_loaded=true;
+  if(mapped&&(!isMapped())) {
+    return;  // Lost the mapping, so leave the file at EOF
+  }
   lseek(wave_file.handle(),file_ptr,SEEK_SET);
+  map_pos=map_ptr;
 }
 
 
@@ -4440,9 +4798,6 @@ unsigned RDWaveFile::LoadEnergy()
 {
   unsigned i=0;
   unsigned char block[5];
-  char pcm[4608];
-  int block_size;
-  int offset;
   unsigned energy_size;
 
   energy_data.clear();
@@ -4479,71 +4834,22 @@ unsigned RDWaveFile::LoadEnergy()
   case WAVE_FORMAT_PCM:
     switch(bits_per_sample) {
     case 16:
-      block_size=2304*channels;
-      while(i<energy_size) {
-	if(read(wave_file.handle(),pcm,block_size)!=block_size) {
-	  has_energy=true;
-	  return i;
-	}
-	for(int j=0;j<channels;j++) {
-	  energy_data.push_back(0);
-	  for(int k=0;k<1152;k++) {
-	    offset=2*k*channels+2*j;
-	    if((pcm[offset]+256*pcm[offset+1])>energy_data[i]) {
-	      energy_data[i]=pcm[offset]+256*pcm[offset+1];
-	    }
-	  }
-	  i++;
-	}
-      }
-      has_energy=true;
-      return i;
+      return ScanEnergy(RDPeakScan::S16,2,energy_size);
 
     case 24:
-      block_size=3456*channels;
-      while(i<energy_size) {
-	if(read(wave_file.handle(),pcm,block_size)!=block_size) {
-	  has_energy=true;
-	  return i;
-	}
-	for(int j=0;j<channels;j++) {
-	  energy_data.push_back(0);
-	  for(int k=0;k<1152;k++) {
-	    offset=3*k*channels+3*j;
-	    if((pcm[offset]+256*pcm[offset+1])>energy_data[i]) {
-	      energy_data[i]=pcm[offset]+256*pcm[offset+1];
-	    }
-	  }
-	  i++;
-	}
-      }
-      has_energy=true;
-      return i;
+      return ScanEnergy(RDPeakScan::S24,3,energy_size);
     }
     break;
 
-  case WAVE_FORMAT_VORBIS:
-    block_size=2304*channels;
-    while(i<energy_size) {
-      if(readWave(pcm,block_size)!=block_size) {
-	has_energy=true;
-	return i;
-      }
-      for(int j=0;j<channels;j++) {
-	energy_data.push_back(0);
-	for(int k=0;k<1152;k++) {
-	  offset=2*k*channels+2*j;
-	  if((pcm[offset]+256*pcm[offset+1])>energy_data[i]) {
-	    energy_data[i]=pcm[offset]+256*pcm[offset+1];
-	  }
-	}
-	i++;
-      }
+  case WAVE_FORMAT_IEEE_FLOAT:
+    if(bits_per_sample==32) {
+      return ScanEnergy(RDPeakScan::Float,4,energy_size);
     }
-    has_energy=true;
-    return i;
     break;
 
+  case WAVE_FORMAT_VORBIS:  // Decoded to PCM16 by readWave()
+    return ScanEnergy(RDPeakScan::S16,2,energy_size);
+
   default:
     has_energy=false;
     return 0;
@@ -4553,6 +4859,73 @@ unsigned RDWaveFile::LoadEnergy()
 }
 
 
+unsigned RDWaveFile::ScanEnergy(RDPeakScan::Format fmt,unsigned bytes,
+				unsigned energy_size)
+{
+  //
+  // Read RDWAVEFILE_ENERGY_BLOCKS levl blocks at a go (straight out of the
+  // mapping if there is one) and take the peaks of each one with
+  // RDPeakScan.
+  //
+  volatile unsigned i=0;
+  unsigned block_bytes=DEFAULT_LEVL_BLOCK_SIZE*bytes*channels;
+  unsigned read_bytes=RDWAVEFILE_ENERGY_BLOCKS*block_bytes;
+  const void *data=NULL;
+  char *buffer=NULL;
+  int n;
+  sigjmp_buf env;
+
+  //
+  // RDPeakScan only keeps track of so many channels
+  //
+  if((channels==0)||(channels>RDPEAKSCAN_MAX_CHANNELS)) {
+    has_energy=false;
+    return 0;
+  }
+  RDPeakScan *scan=new RDPeakScan(channels);
+  if(isMapped()) {
+    if(sigsetjmp(env,1)!=0) {
+      abandonMap();  // Keep what was scanned before the fault
+      delete scan;
+      has_energy=true;
+      return i;
+    }
+    armMapGuard(&env);
+  }
+  else {
+    buffer=new char[read_bytes];
+  }
+  while(i<energy_size) {
+    if(isMapped()) {
+      n=mapReadWave(&data,read_bytes);
+    }
+    else {
+      n=readWave(buffer,read_bytes);
+      data=buffer;
+    }
+    if(n<(int)block_bytes) {
+      break;
+    }
+    for(unsigned j=0;(j<(n/block_bytes))&&(i<energy_size);j++) {
+      scan->reset();
+      scan->scan((const char *)data+j*block_bytes,fmt,
+		 DEFAULT_LEVL_BLOCK_SIZE);
+      for(int k=0;k<channels;k++) {
+	energy_data.push_back(scan->energy(k));
+	i++;
+      }
+    }
+  }
+  disarmMapGuard();
+  delete scan;
+  if(buffer!=NULL) {
+    delete[] buffer;
+  }
+  has_energy=true;
+  return i;
+}
+
+
 bool RDWaveFile::ReadEnergyFile(QString wave_file_name)
 {
   if(has_energy && energy_loaded) return true;
@@ -4696,3 +5069,33 @@ int RDWaveFile::CheckExitCode(const QString &msg,int exit_code)
   }
   return exit_code;
 }
+
+
+void RDWaveFile::AdviseMap(int advice)
+{
+  //
+  // Apply 'advice' from the current read position onward, limited to
+  // RDWAVEFILE_MAP_READAHEAD bytes in the case of MADV_WILLNEED
+  //
+  size_t page=sysconf(_SC_PAGESIZE);
+  size_t start=(data_start+map_pos)/page*page;
+  size_t len=map_length-start;
+
+  if((advice==MADV_WILLNEED)&&(len>RDWAVEFILE_MAP_READAHEAD)) {
+    len=RDWAVEFILE_MAP_READAHEAD;
+  }
+  if(len>0) {
+    madvise(map_data+start,len,advice);
+  }
+}
+
+
+void RDWaveFile::UnmapWave()
+{
+  if(map_data!=NULL) {
+    munmap(map_data,map_length);
+    map_data=NULL;
+    map_length=0;
+    map_pos=0;
+  }
+}
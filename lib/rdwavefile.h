@@ -22,6 +22,7 @@
 #ifndef RDWAVEFILE_H
 #define RDWAVEFILE_H
 
+#include <setjmp.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -39,6 +40,7 @@
 #endif  // HAVE_VORBIS
 
 #include <rdmp4.h>
+#include <rdpeakscan.h>
 #include <rdringbuffer.h>
 #include <rdsettings.h>
 #include <rdwavedata.h>
@@ -87,6 +89,16 @@
 //
 #define MPEG_BUFFER_SIZE 32768
 
+//
+// Readahead window used when the data chunk is memory mapped
+//
+#define RDWAVEFILE_MAP_READAHEAD 1048576
+
+//
+// Number of levl blocks read at a time when scanning PCM for energy data
+//
+#define RDWAVEFILE_ENERGY_BLOCKS 256
+
 //
 // Default Values
 //
@@ -117,6 +129,12 @@ class RDWaveFile
   bool getDataChunk() const;
   unsigned getDataLength() const;
   int readWave(void *buf,int count);
+  bool mapWave();
+  bool isMapped() const;
+  int mapReadWave(const void **buf,int count);
+  void abandonMap();
+  static void armMapGuard(sigjmp_buf *env);
+  static void disarmMapGuard();
   int writeWave(void *buf,int count);
   int seekWave(int offset,int whence);
   void getSettings(RDSettings *settings);
@@ -257,6 +275,7 @@ class RDWaveFile
    bool IsFlac(int fd);
    bool IsAiff(int fd);
    bool IsM4A(int fd);
+   void IndexChunks(int fd,bool big_end);
    off_t FindChunk(int fd,const char *chunk_name,unsigned *chunk_size,
 		   bool big_end=false);
    bool GetChunk(int fd,const char *chunk_name,unsigned *chunk_size,
@@ -276,6 +295,7 @@ class RDWaveFile
    bool GetAir1(int fd);
    bool GetRdxl(int fd);
    bool GetComm(int fd);
+   void LoadMetadata() const;
    bool ReadListElement(unsigned char *buffer,unsigned *offset,unsigned size);
    bool ReadTmcMetadata(int fd);
    void ReadTmcTag(const QString tag,const QString value);
@@ -296,6 +316,8 @@ class RDWaveFile
    unsigned short ReadSword(unsigned char *,unsigned);
    void GetEnergy();
    unsigned LoadEnergy();
+   unsigned ScanEnergy(RDPeakScan::Format fmt,unsigned bytes,
+		       unsigned energy_size);
    bool ReadNormalizeLevel(QString wave_file_name);
    bool ReadEnergyFile(QString wave_file_name);
    void GrowAlloc(size_t size);
@@ -305,6 +327,8 @@ class RDWaveFile
    int WriteOggBuffer(char *buf,int size);
    unsigned FrameOffset(int msecs) const;
    int CheckExitCode(const QString &msg,int exit_code);
+   void AdviseMap(int advice);
+   void UnmapWave();
    QString wave_file_name;
    QFile wave_file;
    RDWaveData *wave_data;
@@ -340,6 +364,18 @@ class RDWaveFile
    bool data_chunk;                // Does 'data' chunk exist?
    int data_start;                 // Start position of WAV data
    unsigned data_length;           // Length of raw audio data
+   unsigned char *map_data;        // mmap() of the file, if mapped
+   size_t map_length;              // Length of the mapping
+   unsigned map_pos;               // Read position within the data chunk
+   struct ChunkEntry {
+     char name[5];
+     off_t offset;                 // Start of the chunk body
+     unsigned size;
+   };
+   std::vector<ChunkEntry> chunk_index;  // Chunk headers, in file order
+   bool chunk_indexed;             // Is chunk_index valid for this file?
+   bool chunk_index_big_end;
+   bool metadata_pending;          // Metadata chunks not yet decoded?
    bool cart_chunk;                   // Does 'cart' chunk exist?
    unsigned cart_version;             // CartChunk Version field
    QString cart_title;                // CartChunk Title field
@@ -362,6 +362,22 @@ void EditAudioPorts::ReadRecord(int card)
     }
     break;
 
+  case RDStation::Null:
+    card_driver_edit->setText(tr("Null (No Hardware)"));
+    edit_clock_box->setDisabled(true);
+    edit_clock_label->setDisabled(true);
+    for (int i=0;i<RD_MAX_PORTS;i++) {
+      edit_type_label[i]->setDisabled(true);
+      edit_type_box[i]->setDisabled(true);
+      edit_mode_label[i]->setDisabled(true);
+      edit_mode_box[i]->setDisabled(true);
+      edit_input_label[i]->setDisabled(true);
+      edit_input_box[i]->setDisabled(true);
+      edit_output_label[i]->setDisabled(true);
+      edit_output_box[i]->setDisabled(true);
+    }
+    break;
+
   case RDStation::None:
   default:
     card_label_edit->setText(tr("[none]"));
@@ -121,6 +121,10 @@ ViewAdapters::ViewAdapters(RDStation *rdstation,QWidget *parent)
 	case RDStation::Alsa:
 	  text+=tr("      Driver: Advanced Linux Sound Architecture (ALSA)\n");
 	break;
+
+	case RDStation::Null:
+	  text+=tr("      Driver: Null (No Hardware)\n");
+	  break;
 	      
 	case RDStation::None:
 	  text+=tr("      Driver: UNKNOWN\n");
@@ -47,6 +47,7 @@ LocalAudio::LocalAudio(RDMatrix *matrix,QObject *parent)
   connect(bt_gpo_oneshot,SIGNAL(timeout(int)),this,SLOT(gpoOneshotData(int)));
 
   InitializeHpi(matrix);
+  InitializeSilenceSense(matrix);
 }
 
 
@@ -72,7 +73,7 @@ RDMatrix::Type LocalAudio::type()
 
 unsigned LocalAudio::gpiQuantity()
 {
-  return 0;
+  return bt_gpis;
 }
 
 
@@ -254,6 +255,18 @@ void LocalAudio::gpoOneshotData(int value)
 }
 
 
+void LocalAudio::outputSilenceChangedData(int card,int port,bool state)
+{
+  if((card==bt_card)&&(port<(int)bt_silence_states.size())&&
+     (state!=bt_silence_states[port])) {
+    bt_silence_states[port]=state;
+    rda->syslog(LOG_DEBUG,"LocalAudio: emitting gpiChanged(%d,%d,%d)",
+		matrixNumber(),port,state);
+    emit gpiChanged(matrixNumber(),port,state);
+  }
+}
+
+
 void LocalAudio::InitializeHpi(RDMatrix *matrix)
 {
 #ifdef HPI
@@ -341,6 +354,38 @@ void LocalAudio::InitializeHpi(RDMatrix *matrix)
 }
 
 
+void LocalAudio::InitializeSilenceSense(RDMatrix *matrix)
+{
+  //
+  // Cards mixed in software have no GPIO hardware of their own, but
+  // caed(8) can watch their output ports for dead air as configured in
+  // the [SilenceSense] section of rd.conf(5).  Each output port gets a
+  // GPI line that is ON while the port is silent.
+  //
+  switch(rda->station()->cardDriver(bt_card)) {
+  case RDStation::Alsa:
+  case RDStation::Jack:
+  case RDStation::Null:
+    break;
+
+  default:
+    return;
+  }
+  bt_gpis=bt_outputs;
+  bt_gpos=0;
+  UpdateDb(matrix);
+  for(int i=0;i<bt_gpis;i++) {
+    bt_silence_states.push_back(false);
+    insertGpioEntry(false,i+1);
+  }
+  connect(rda->cae(),SIGNAL(outputSilenceChanged(int,int,bool)),
+	  this,SLOT(outputSilenceChangedData(int,int,bool)));
+  for(int i=0;i<bt_gpis;i++) {
+    rda->cae()->requestOutputSilence(bt_card,i);
+  }
+}
+
+
 void LocalAudio::SetGpo(int line,bool state)
 {
 #ifdef HPI
@@ -55,9 +55,11 @@ class LocalAudio : public Switcher
  private slots:
   void pollData();
   void gpoOneshotData(int value);
+  void outputSilenceChangedData(int card,int port,bool state);
 
  private:
   void InitializeHpi(RDMatrix *matrix);
+  void InitializeSilenceSense(RDMatrix *matrix);
   void SetGpo(int line,bool state);
   void UpdateDb(RDMatrix *matrix) const;
 #ifdef HPI
@@ -67,6 +69,7 @@ class LocalAudio : public Switcher
   hpi_handle_t bt_gpos_param;
   std::vector<uint8_t> bt_gpi_states;
 #endif  // HPI
+  std::vector<bool> bt_silence_states;
   RDOneShot *bt_gpo_oneshot;
   uint8_t *bt_gpi_values;
   uint8_t *bt_gpo_values;
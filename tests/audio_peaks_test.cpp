@@ -19,8 +19,11 @@
 //
 
 #include <QApplication>
+#include <QDateTime>
 
 #include <rdcmd_switch.h>
+#include <rdpeakpyramid.h>
+#include <rdpeakscan.h>
 #include <rdwavefile.h>
 
 #include "audio_peaks_test.h"
@@ -31,6 +34,10 @@ MainObject::MainObject(QObject *parent)
   QString filename;
   unsigned frame=0;
   bool frame_used=false;
+  int level=-1;
+  bool verify=false;
+  unsigned errors=0;
+  qint64 msecs;
   bool ok=false;
 
   //
@@ -51,6 +58,18 @@ MainObject::MainObject(QObject *parent)
       frame_used=true;
       cmd->setProcessed(i,true);
     }
+    if(cmd->key(i)=="--level") {
+      level=cmd->value(i).toInt(&ok);
+      if((!ok)||(level<0)||(level>=RDPEAKPYRAMID_LEVELS)) {
+	fprintf(stderr,"audio_peaks_test: invalid --level argument\n");
+	exit(256);
+      }
+      cmd->setProcessed(i,true);
+    }
+    if(cmd->key(i)=="--verify") {
+      verify=true;
+      cmd->setProcessed(i,true);
+    }
     if(!cmd->processed(i)) {
       fprintf(stderr,"audio_peaks_test: unknown option \"%s\"\n",
 	      cmd->value(i).toUtf8().constData());
@@ -62,6 +81,26 @@ MainObject::MainObject(QObject *parent)
     exit(256);
   }
 
+  if(level>=0) {
+    RDPeakPyramid *pyramid=new RDPeakPyramid(filename);
+    if(!pyramid->load(level)) {
+      fprintf(stderr,"audio_peaks_test: unable to load peak level %d\n",
+	      level);
+      exit(256);
+    }
+    printf("\"%s\" level %d: %u frames/peak, size: %u\n",
+	   filename.toUtf8().constData(),level,
+	   RDPeakPyramid::framesPerPeak(level),pyramid->size());
+    if(frame_used&&(frame<pyramid->size())) {
+      for(unsigned i=0;i<pyramid->channels();i++) {
+	printf("peak %u: chan %u: min: %d  max: %d\n",frame,i,
+	       pyramid->peakMin(frame,i),pyramid->peakMax(frame,i));
+      }
+    }
+    delete pyramid;
+    exit(0);
+  }
+
   RDWaveFile *wave=new RDWaveFile();
   wave->nameWave(filename);
   if(!wave->openWave()) {
@@ -69,9 +108,18 @@ MainObject::MainObject(QObject *parent)
 	    filename.toUtf8().constData());
     exit(256);
   }
+  msecs=QDateTime::currentMSecsSinceEpoch();
   if(wave->hasEnergy()) {
+    msecs=QDateTime::currentMSecsSinceEpoch()-msecs;
     printf("\"%s\" has energy, size: %u\n",filename.toUtf8().constData(),
 	   wave->energySize());
+    if(wave->getLevlChunk()) {
+      printf("energy read from levl chunk in %lld mS\n",msecs);
+    }
+    else {
+      printf("energy scanned with %s kernel in %lld mS\n",
+	     RDPeakScan(wave->getChannels()).kernelName(),msecs);
+    }
     if(frame_used) {
       if(wave->getChannels()==1) {
 	printf("frame: %u: %d\n",frame,0xFFFF&wave->energy(frame));
@@ -86,10 +134,81 @@ MainObject::MainObject(QObject *parent)
   else {
     printf("\"%s\" does NOT have energy\n",filename.toUtf8().constData());
   }
+  if(verify&&wave->hasEnergy()) {
+    errors=Verify(filename,wave);
+  }
+  wave->closeWave();
+  delete wave;
+
+  exit(errors==0?0:1);
+}
+
+
+unsigned MainObject::Verify(const QString &filename,RDWaveFile *energy_wave)
+{
+  RDPeakScan::Format fmt=RDPeakScan::S16;
+  unsigned bytes=0;
+  unsigned block=0;
+  unsigned errors=0;
+
+  RDWaveFile *wave=new RDWaveFile(filename);
+  if(!wave->openWave()) {
+    fprintf(stderr,"audio_peaks_test: unable to reopen \"%s\"\n",
+	    filename.toUtf8().constData());
+    exit(256);
+  }
+  switch(wave->getFormatTag()) {
+  case WAVE_FORMAT_PCM:
+    if(wave->getBitsPerSample()==16) {
+      bytes=2;
+    }
+    if(wave->getBitsPerSample()==24) {
+      fmt=RDPeakScan::S24;
+      bytes=3;
+    }
+    break;
+
+  case WAVE_FORMAT_IEEE_FLOAT:
+    fmt=RDPeakScan::Float;
+    bytes=4;
+    break;
+
+  case WAVE_FORMAT_VORBIS:
+    bytes=2;
+    break;
+  }
+  if(bytes==0) {
+    fprintf(stderr,"audio_peaks_test: unable to verify this format\n");
+    exit(256);
+  }
+
+  unsigned chans=wave->getChannels();
+  unsigned block_bytes=DEFAULT_LEVL_BLOCK_SIZE*bytes*chans;
+  char *pcm=new char[block_bytes];
+  RDPeakScan *scan=new RDPeakScan(chans,true);
+  wave->seekWave(0,SEEK_SET);
+  while((chans*(block+1)<=energy_wave->energySize())&&
+	(wave->readWave(pcm,block_bytes)==(int)block_bytes)) {
+    scan->reset();
+    scan->scan(pcm,fmt,DEFAULT_LEVL_BLOCK_SIZE);
+    for(unsigned i=0;i<chans;i++) {
+      if(scan->energy(i)!=energy_wave->energy(chans*block+i)) {
+	if(errors<10) {
+	  printf("block %u, chan %u: energy: %u  expected: %u\n",block,i,
+		 energy_wave->energy(chans*block+i),scan->energy(i));
+	}
+	errors++;
+      }
+    }
+    block++;
+  }
+  printf("verified %u blocks, %u mismatches\n",block,errors);
+  delete scan;
+  delete[] pcm;
   wave->closeWave();
   delete wave;
 
-  exit(0);
+  return errors;
 }
 
 
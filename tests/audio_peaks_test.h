@@ -23,12 +23,17 @@
 
 #include <qobject.h>
 
-#define AUDIO_PEAKS_TEST_USAGE "[options]\n\nTest the Rivendell audio peak routines\n\nOptions are:\n--filename=<wav-file>\n     File to process.\n\n--frame=<num>\n     Print value for block number <num>.\n\n"
+#include <rdwavefile.h>
+
+#define AUDIO_PEAKS_TEST_USAGE "[options]\n\nTest the Rivendell audio peak routines\n\nOptions are:\n--filename=<wav-file>\n     File to process.\n\n--frame=<num>\n     Print value for block number <num>.\n\n--level=<num>\n     Use level <num> of the peak pyramid rather than the energy data.\n\n--verify\n     Check every energy value against a block by block rescan of the audio\n     with the generic (non-vector) peak kernel.\n\n"
 
 class MainObject : public QObject
 {
  public:
   MainObject(QObject *parent=0);
+
+ private:
+  unsigned Verify(const QString &filename,RDWaveFile *energy_wave);
 };
 
 
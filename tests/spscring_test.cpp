@@ -0,0 +1,287 @@
+// spscring_test.cpp
+//
+// Benchmark RDSpscRing against RDRingBuffer.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <QCoreApplication>
+
+#include <rdcmd_switch.h>
+#include <rdringbuffer.h>
+#include <rdspscring.h>
+
+#include "spscring_test.h"
+
+//
+// The producer stamps a running counter into the first byte of every
+// 64 byte block, so the consumer can tell if anything was lost, duplicated
+// or reordered without the checking swamping the cost of the ring itself.
+//
+struct TestContext
+{
+  RDRingBuffer *old_ring;
+  RDSpscRing *new_ring;
+  size_t chunk_size;
+  size_t total_size;
+  bool ok;
+};
+
+
+double Now()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return (double)ts.tv_sec+(double)ts.tv_nsec/1000000000.0;
+}
+
+
+void Stamp(char *data,size_t len,size_t offset)
+{
+  for(size_t i=(64-(offset&63))&63;i<len;i+=64) {
+    data[i]=0xFF&((offset+i)>>6);
+  }
+}
+
+
+bool Verify(const char *data,size_t len,size_t offset)
+{
+  for(size_t i=(64-(offset&63))&63;i<len;i+=64) {
+    if(data[i]!=(char)(0xFF&((offset+i)>>6))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+void *RingBufferProducer(void *ptr)
+{
+  TestContext *cxt=(TestContext *)ptr;
+  char *chunk=new char[cxt->chunk_size]();
+  size_t sent=0;
+  size_t n;
+
+  while(sent<cxt->total_size) {
+    n=cxt->chunk_size;
+    if(n>(cxt->total_size-sent)) {
+      n=cxt->total_size-sent;
+    }
+    Stamp(chunk,n,sent);
+    for(size_t i=0;i<n;) {
+      size_t m=cxt->old_ring->write(chunk+i,n-i);
+      if(m==0) {
+	sched_yield();
+      }
+      i+=m;
+    }
+    sent+=n;
+  }
+  delete[] chunk;
+
+  return NULL;
+}
+
+
+void *SpscRingProducer(void *ptr)
+{
+  TestContext *cxt=(TestContext *)ptr;
+  RDSpscSpan span;
+  size_t sent=0;
+  size_t n;
+
+  //
+  // Write straight into the ring, as a decoder would
+  //
+  while(sent<cxt->total_size) {
+    n=cxt->chunk_size;
+    if(n>(cxt->total_size-sent)) {
+      n=cxt->total_size-sent;
+    }
+    if((n=cxt->new_ring->reserveWrite(&span,n))==0) {
+      sched_yield();
+      continue;
+    }
+    for(unsigned i=0;i<2;i++) {
+      Stamp(span.data[i],span.len[i],sent);
+      sent+=span.len[i];
+    }
+    cxt->new_ring->commitWrite(n);
+  }
+
+  return NULL;
+}
+
+
+MainObject::MainObject(QObject *parent)
+  :QObject(parent)
+{
+  bool ok=false;
+  double old_secs=0.0;
+  double new_secs=0.0;
+
+  test_ring_size=262144;
+  test_chunk_size=4096;
+  test_total_size=1024*1048576ul;
+
+  //
+  // Read Command Options
+  //
+  RDCmdSwitch *cmd=new RDCmdSwitch("spscring_test",SPSCRING_TEST_USAGE);
+  for(unsigned i=0;i<cmd->keys();i++) {
+    if(cmd->key(i)=="--ring-size") {
+      test_ring_size=cmd->value(i).toUInt(&ok);
+      if((!ok)||(test_ring_size==0)) {
+	fprintf(stderr,"spscring_test: invalid --ring-size\n");
+	exit(256);
+      }
+      cmd->setProcessed(i,true);
+    }
+    if(cmd->key(i)=="--chunk-size") {
+      test_chunk_size=cmd->value(i).toUInt(&ok);
+      if((!ok)||(test_chunk_size==0)) {
+	fprintf(stderr,"spscring_test: invalid --chunk-size\n");
+	exit(256);
+      }
+      cmd->setProcessed(i,true);
+    }
+    if(cmd->key(i)=="--megabytes") {
+      test_total_size=1048576ul*cmd->value(i).toUInt(&ok);
+      if((!ok)||(test_total_size==0)) {
+	fprintf(stderr,"spscring_test: invalid --megabytes\n");
+	exit(256);
+      }
+      cmd->setProcessed(i,true);
+    }
+    if(!cmd->processed(i)) {
+      fprintf(stderr,"spscring_test: unknown option \"%s\"\n",
+	      cmd->key(i).toUtf8().constData());
+      exit(256);
+    }
+  }
+
+  printf("Moving %lu MB through a %lu byte ring in %lu byte chunks\n",
+	 test_total_size/1048576,test_ring_size,test_chunk_size);
+  if(!RunRingBuffer(&old_secs)) {
+    fprintf(stderr,"spscring_test: RDRingBuffer data corrupted\n");
+    exit(1);
+  }
+  printf("  RDRingBuffer: %8.1f MB/s\n",
+	 (double)test_total_size/(1048576.0*old_secs));
+  if(!RunSpscRing(&new_secs)) {
+    fprintf(stderr,"spscring_test: RDSpscRing data corrupted\n");
+    exit(1);
+  }
+  printf("  RDSpscRing:   %8.1f MB/s (%.2fx)\n",
+	 (double)test_total_size/(1048576.0*new_secs),old_secs/new_secs);
+
+  exit(0);
+}
+
+
+bool MainObject::RunRingBuffer(double *secs) const
+{
+  TestContext cxt;
+  pthread_t thread;
+  char *chunk=new char[test_chunk_size];
+  size_t recvd=0;
+  size_t n;
+  double start;
+
+  cxt.old_ring=new RDRingBuffer(test_ring_size);
+  cxt.new_ring=NULL;
+  cxt.chunk_size=test_chunk_size;
+  cxt.total_size=test_total_size;
+  cxt.ok=true;
+
+  start=Now();
+  pthread_create(&thread,NULL,RingBufferProducer,&cxt);
+  while(recvd<test_total_size) {
+    if((n=cxt.old_ring->read(chunk,test_chunk_size))==0) {
+      sched_yield();
+      continue;
+    }
+    if(!Verify(chunk,n,recvd)) {
+      cxt.ok=false;
+    }
+    recvd+=n;
+  }
+  pthread_join(thread,NULL);
+  *secs=Now()-start;
+
+  delete cxt.old_ring;
+  delete[] chunk;
+
+  return cxt.ok;
+}
+
+
+bool MainObject::RunSpscRing(double *secs) const
+{
+  TestContext cxt;
+  pthread_t thread;
+  RDSpscSpan span;
+  size_t recvd=0;
+  size_t n;
+  double start;
+
+  cxt.old_ring=NULL;
+  cxt.new_ring=new RDSpscRing(test_ring_size);
+  cxt.chunk_size=test_chunk_size;
+  cxt.total_size=test_total_size;
+  cxt.ok=true;
+
+  //
+  // Read straight out of the ring, as an audio callback would
+  //
+  start=Now();
+  pthread_create(&thread,NULL,SpscRingProducer,&cxt);
+  while(recvd<test_total_size) {
+    if((n=cxt.new_ring->reserveRead(&span,test_chunk_size))==0) {
+      sched_yield();
+      continue;
+    }
+    for(unsigned i=0;i<2;i++) {
+      if(!Verify(span.data[i],span.len[i],recvd)) {
+	cxt.ok=false;
+      }
+      recvd+=span.len[i];
+    }
+    cxt.new_ring->commitRead(n);
+  }
+  pthread_join(thread,NULL);
+  *secs=Now()-start;
+
+  delete cxt.new_ring;
+
+  return cxt.ok;
+}
+
+
+int main(int argc,char *argv[])
+{
+  QCoreApplication a(argc,argv,false);
+  new MainObject();
+  return a.exec();
+}
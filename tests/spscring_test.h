@@ -0,0 +1,42 @@
+// spscring_test.h
+//
+// Benchmark RDSpscRing against RDRingBuffer.
+//
+//   (C) Copyright 2024 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef SPSCRING_TEST_H
+#define SPSCRING_TEST_H
+
+#include <qobject.h>
+
+#define SPSCRING_TEST_USAGE "[options]\n\nMove a block of data between two threads through each of RDRingBuffer and\nRDSpscRing, check that it arrives intact and report the throughput.\n\nOptions are:\n--ring-size=<bytes>\n     Size of the ring buffer.  Default is 262144.\n\n--chunk-size=<bytes>\n     Size of each read and write.  Default is 4096.\n\n--megabytes=<mb>\n     Amount of data to move through each ring.  Default is 1024.\n\n"
+
+class MainObject : public QObject
+{
+ public:
+  MainObject(QObject *parent=0);
+
+ private:
+  bool RunRingBuffer(double *secs) const;
+  bool RunSpscRing(double *secs) const;
+  size_t test_ring_size;
+  size_t test_chunk_size;
+  size_t test_total_size;
+};
+
+
+#endif  // SPSCRING_TEST_H
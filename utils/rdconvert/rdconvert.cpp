@@ -19,6 +19,7 @@
 //
 
 #include <QApplication>
+#include <QFileInfo>
 
 #include <rdapplication.h>
 #include <rddb.h>
@@ -27,6 +28,11 @@
 
 #include "rdconvert.h"
 
+//
+// Global Variables
+//
+RDConfig *rdconfig;
+
 MainObject::MainObject(QObject *parent)
   :QObject(parent)
 {
@@ -36,8 +42,10 @@ MainObject::MainObject(QObject *parent)
   start_point=-1;
   end_point=-1;
   speed_ratio=1.0;
+  jobs=0;
+  verbose=false;
+  failed=false;
   bool ok=false;
-  RDAudioConvert::ErrorCode conv_err;
 
   //
   // Open the Database
@@ -56,12 +64,31 @@ MainObject::MainObject(QObject *parent)
     fprintf(stderr,"rdconvert: missing argument\n");
     exit(256);
   }
-  source_filename=rda->cmdSwitch()->key(rda->cmdSwitch()->keys()-1);
-  for(unsigned i=0;i<rda->cmdSwitch()->keys()-1;i++) {
+  for(unsigned i=0;i<rda->cmdSwitch()->keys();i++) {
+    if(rda->cmdSwitch()->key(i).left(1)!="-") {
+      source_filenames.push_back(rda->cmdSwitch()->key(i));
+      rda->cmdSwitch()->setProcessed(i,true);
+    }
     if(rda->cmdSwitch()->key(i)=="--destination-file") {
       destination_filename=rda->cmdSwitch()->value(i);
       rda->cmdSwitch()->setProcessed(i,true);
     }
+    if(rda->cmdSwitch()->key(i)=="--destination-dir") {
+      destination_dir=rda->cmdSwitch()->value(i);
+      if(!QFileInfo(destination_dir).isDir()) {
+	fprintf(stderr,"rdconvert: no such destination directory\n");
+	exit(256);
+      }
+      rda->cmdSwitch()->setProcessed(i,true);
+    }
+    if(rda->cmdSwitch()->key(i)=="--jobs") {
+      jobs=rda->cmdSwitch()->value(i).toInt(&ok);
+      if((!ok)||(jobs<0)) {
+	fprintf(stderr,"rdconvert: invalid jobs value\n");
+	exit(256);
+      }
+      rda->cmdSwitch()->setProcessed(i,true);
+    }
     if(rda->cmdSwitch()->key(i)=="--start-point") {
       start_point=rda->cmdSwitch()->value(i).toInt(&ok);
       if(!ok) {
@@ -155,14 +182,22 @@ MainObject::MainObject(QObject *parent)
       }
       rda->cmdSwitch()->setProcessed(i,true);
     }
+    if(rda->cmdSwitch()->key(i)=="--verbose") {
+      verbose=true;
+      rda->cmdSwitch()->setProcessed(i,true);
+    }
   }
-  if(source_filename.isEmpty()) {
+  if(source_filenames.size()==0) {
     fprintf(stderr,"rdconvert: missing source-file\n");
     exit(256);
   }
-  if(destination_filename.isEmpty()) {
-    destination_filename=source_filename+"."+
-      RDSettings::defaultExtension(destination_settings->format());
+  if((!destination_filename.isEmpty())&&(source_filenames.size()>1)) {
+    fprintf(stderr,"rdconvert: --destination-file cannot be used with multiple source files\n");
+    exit(256);
+  }
+  if((!destination_filename.isEmpty())&&(!destination_dir.isEmpty())) {
+    fprintf(stderr,"rdconvert: --destination-file and --destination-dir are mutually exclusive\n");
+    exit(256);
   }
   if((destination_settings->bitRate()!=0)&&
      (destination_settings->quality()!=0)) {
@@ -177,19 +212,54 @@ MainObject::MainObject(QObject *parent)
   rdconfig->load();
   rdconfig->setModuleName("rdconvert");
 
-  RDAudioConvert *conv=new RDAudioConvert(this);
-  conv->setSourceFile(source_filename);
-  conv->setDestinationFile(destination_filename);
-  conv->setDestinationSettings(destination_settings);
-  conv->setRange(start_point,end_point);
-  conv->setSpeedRatio(speed_ratio);
-  conv_err=conv->convert();
-  if(conv_err!=RDAudioConvert::ErrorOk) {
-    fprintf(stderr,"%s\n",
-	    RDAudioConvert::errorText(conv_err).toUtf8().constData());
-    exit(256);
+  //
+  // Queue Conversions
+  //
+  RDConvertQueue *queue=new RDConvertQueue(jobs,this);
+  connect(queue,SIGNAL(jobFinished(int,RDAudioConvert::ErrorCode)),
+	  this,SLOT(jobFinishedData(int,RDAudioConvert::ErrorCode)));
+  connect(queue,SIGNAL(allFinished()),this,SLOT(allFinishedData()));
+  for(int i=0;i<source_filenames.size();i++) {
+    QString dstname=destination_filename;
+    if(dstname.isEmpty()) {
+      if(destination_dir.isEmpty()) {
+	dstname=source_filenames.at(i);
+      }
+      else {
+	dstname=destination_dir+"/"+QFileInfo(source_filenames.at(i)).fileName();
+      }
+      dstname+="."+RDSettings::defaultExtension(destination_settings->format());
+    }
+    RDAudioConvert *conv=new RDAudioConvert();
+    conv->setSourceFile(source_filenames.at(i));
+    conv->setDestinationFile(dstname);
+    conv->setDestinationSettings(destination_settings);
+    conv->setRange(start_point,end_point);
+    conv->setSpeedRatio(speed_ratio);
+    job_filenames[queue->addJob(conv)]=source_filenames.at(i);
   }
+}
 
+
+void MainObject::jobFinishedData(int id,RDAudioConvert::ErrorCode err)
+{
+  if(err!=RDAudioConvert::ErrorOk) {
+    failed=true;
+  }
+  if((err!=RDAudioConvert::ErrorOk)||verbose) {
+    fprintf(stderr,"rdconvert: %s: %s\n",
+	    job_filenames.value(id).toUtf8().constData(),
+	    RDAudioConvert::errorText(err).toUtf8().constData());
+  }
+  job_filenames.remove(id);
+}
+
+
+void MainObject::allFinishedData()
+{
+  if(failed) {
+    exit(256);
+  }
   exit(0);
 }
 
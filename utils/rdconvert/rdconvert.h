@@ -23,29 +23,36 @@
 
 #include <list>
 
+#include <QMap>
+#include <QStringList>
 #include <qobject.h>
 #include <qsqldatabase.h>
 
 #include <rdconfig.h>
+#include <rdconvertqueue.h>
 #include <rdsettings.h>
-#include <rdcmd_switch.cpp>
 
-#define RDCONVERT_USAGE "[options] <src-file>\n\nTest the Rivendell audio converter routines\n\nOptions are:\n--destination-file=<filename>\n\n--start-point=<msecs>\n\n--end-point=<msecs>\n\n--destination-format=<fmt>\n     Supported formats are:\n        0 - PCM16 WAV\n        2 - MPEG Layer 2\n        3 - MPEG Layer 3\n        4 - FLAC\n        5 - OggVorbis\n        6 - MPEG Layer 2 WAV\n        7 - PCM24 WAV\n\n--destination-channels=<chans>\n\n--destination-sample-rate=<rate>\n\n--destination-bit-rate=<rate>\n\n--destination-quality=<qual>\n\n--normalization-level=<dbfs>\n\n--speed-ratio=<ratio>\n\n"
-
-//
-// Global Variables
-//
-RDConfig *rdconfig;
+#define RDCONVERT_USAGE "[options] <src-file> [<src-file> ...]\n\nTest the Rivendell audio converter routines\n\nOptions are:\n--destination-file=<filename>\n     Valid only with a single <src-file>.\n\n--destination-dir=<dir>\n\n--jobs=<threads>\n     Number of files to convert at once. Default is one per CPU core.\n\n--start-point=<msecs>\n\n--end-point=<msecs>\n\n--destination-format=<fmt>\n     Supported formats are:\n        0 - PCM16 WAV\n        2 - MPEG Layer 2\n        3 - MPEG Layer 3\n        4 - FLAC\n        5 - OggVorbis\n        6 - MPEG Layer 2 WAV\n        7 - PCM24 WAV\n\n--destination-channels=<chans>\n\n--destination-sample-rate=<rate>\n\n--destination-bit-rate=<rate>\n\n--destination-quality=<qual>\n\n--normalization-level=<dbfs>\n\n--speed-ratio=<ratio>\n\n--verbose\n\n"
 
 
 class MainObject : public QObject
 {
+  Q_OBJECT;
  public:
   MainObject(QObject *parent=0);
 
+ private slots:
+  void jobFinishedData(int id,RDAudioConvert::ErrorCode err);
+  void allFinishedData();
+
  private:
-  QString source_filename;
+  QStringList source_filenames;
   QString destination_filename;
+  QString destination_dir;
+  QMap<int,QString> job_filenames;
+  int jobs;
+  bool verbose;
+  bool failed;
   int start_point;
   int end_point;
   float speed_ratio;
@@ -29,6 +29,7 @@
 #include <rdcart.h>
 #include <rdconf.h>
 #include <rdformpost.h>
+#include <rdpeakpyramid.h>
 #include <rdweb.h>
 
 #include <rdxport.h>
@@ -60,6 +61,7 @@ void Xport::DeleteAudio()
   }
   unlink(RDCut::pathName(cartnum,cutnum).toUtf8());
   unlink((RDCut::pathName(cartnum,cutnum)+".energy").toUtf8());
+  unlink(RDPeakPyramid::sidecarName(RDCut::pathName(cartnum,cutnum)).toUtf8());
   QString sql=QString("delete from `CUT_EVENTS` where ")+
     "`CUT_NAME`='"+RDCut::cutName(cartnum,cutnum)+"'";
   RDSqlQuery *q=new RDSqlQuery(sql);
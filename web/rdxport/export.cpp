@@ -202,6 +202,7 @@ void Xport::Export()
   case RDAudioConvert::ErrorNoDestination:
   case RDAudioConvert::ErrorInvalidSource:
   case RDAudioConvert::ErrorNoSpace:
+  case RDAudioConvert::ErrorCancelled:
   case RDAudioConvert::ErrorInternal:
   case RDAudioConvert::ErrorNoDisc:
   case RDAudioConvert::ErrorNoTrack:
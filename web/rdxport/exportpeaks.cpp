@@ -29,6 +29,7 @@
 #include <rdcart.h>
 #include <rdconf.h>
 #include <rdformpost.h>
+#include <rdpeakpyramid.h>
 #include <rdsettings.h>
 #include <rdweb.h>
 
@@ -47,6 +48,8 @@ void Xport::ExportPeaks()
   if(!xport_post->getValue("CUT_NUMBER",&cutnum)) {
     XmlExit("Missing CUT_NUMBER",400,"exportpeaks.cpp",LINE_NUMBER);
   }
+  unsigned frames_per_peak=0;
+  xport_post->getValue("FRAMES_PER_PEAK",&frames_per_peak);
 
   //
   // Verify User Perms
@@ -55,6 +58,26 @@ void Xport::ExportPeaks()
     XmlExit("No such cart",404,"exportpeaks.cpp",LINE_NUMBER);
   }
 
+  //
+  // Send a Single Pyramid Level
+  //
+  if(frames_per_peak>0) {
+    int level=RDPeakPyramid::levelForFrames(frames_per_peak);
+    if(RDPeakPyramid::framesPerPeak(level)!=frames_per_peak) {
+      XmlExit("Invalid FRAMES_PER_PEAK",400,"exportpeaks.cpp",LINE_NUMBER);
+    }
+    RDPeakPyramid *pyramid=new RDPeakPyramid(RDCut::pathName(cartnum,cutnum));
+    if(!pyramid->load(level)) {
+      XmlExit("No peak data available",400,"exportpeaks.cpp",LINE_NUMBER);
+    }
+    printf("Content-type: application/octet-stream\n\n");
+    fflush(NULL);
+    ssize_t len=sizeof(int16_t)*2*pyramid->channels()*pyramid->size();
+    RDCheckReturnCode("ExportPeaks() write",
+		      write(1,pyramid->data(),len),len);
+    Exit(0);
+  }
+
   //
   // Open Audio File
   //
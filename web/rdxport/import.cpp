@@ -31,6 +31,7 @@
 #include <rdgroup.h>
 #include <rdhash.h>
 #include <rdlibrary_conf.h>
+#include <rdpeakpyramid.h>
 #include <rdsettings.h>
 #include <rdweb.h>
 
@@ -251,6 +252,7 @@ void Xport::Import()
   case RDAudioConvert::ErrorInvalidSource:
   case RDAudioConvert::ErrorInternal:
   case RDAudioConvert::ErrorNoSpace:
+  case RDAudioConvert::ErrorCancelled:
   case RDAudioConvert::ErrorNoDisc:
   case RDAudioConvert::ErrorNoTrack:
   case RDAudioConvert::ErrorInvalidSpeed:
@@ -266,6 +268,17 @@ void Xport::Import()
     if(!title.isEmpty()) {
       cart->setTitle(title);
     }
+
+    //
+    // Build the peak sidecar now, rather than on the first waveform request
+    //
+    RDPeakPyramid *pyramid=new RDPeakPyramid(RDCut::pathName(cartnum,cutnum));
+    if(!pyramid->generate()) {
+      rda->syslog(LOG_WARNING,"unable to generate peak data for cut %s",
+		  RDCut::cutName(cartnum,cutnum).toUtf8().constData());
+    }
+    delete pyramid;
+
     printf("Content-type: application/xml; charset=utf-8\n");
     printf("Status: %d\n",resp_code);
     printf("\n");
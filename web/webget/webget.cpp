@@ -320,6 +320,7 @@ void MainObject::GetAudio()
   case RDAudioConvert::ErrorNoDestination:
   case RDAudioConvert::ErrorInvalidSource:
   case RDAudioConvert::ErrorNoSpace:
+  case RDAudioConvert::ErrorCancelled:
   case RDAudioConvert::ErrorInternal:
   case RDAudioConvert::ErrorNoDisc:
   case RDAudioConvert::ErrorNoTrack: